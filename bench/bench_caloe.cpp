@@ -0,0 +1,452 @@
+/**
+ ******************************************************************************* 
+ * @file bench_caloe.cpp
+ *  @brief Access latency and throughput benchmarks (against the local simulator or a board)
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "../lib/System.h"
+#include "../lib/OperationTable.h"
+#include "../lib/sim_internals.h"
+#include "../lib/transport_internals.h"
+
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+using namespace std;
+using namespace caloe;
+
+/// Register used by single access benchmarks (DIO block)
+#define BENCH_REGISTER 0x62304
+
+/// Default number of samples of each benchmark
+#define BENCH_SAMPLES 1000
+
+/// Default number of warm-up runs (not measured)
+#define BENCH_WARMUP 10
+
+/// Default number of operations of the synthetic configuration file (startup benchmark)
+#define BENCH_CFG_OPERATIONS 10000
+
+/// Number of samples of the startup benchmark (each one parses the whole file)
+#define BENCH_CFG_SAMPLES 10
+
+/** @brief Result of one benchmark **/
+
+struct BenchResult {
+	/// Benchmark name
+	string name;
+	
+	/// Number of samples
+	int samples;
+	
+	/// Number of failed runs
+	int errors;
+	
+	/// Latency of each run (us)
+	vector<double> latencies;
+};
+
+static double now_us() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1e6 + ts.tv_nsec/1e3;
+}
+
+static double percentile(vector<double> & sorted, double p) {
+	if(sorted.empty())
+		return 0;
+
+	unsigned int i = (unsigned int)(p*(sorted.size()-1) + 0.5);
+
+	return sorted[i];
+}
+
+/** @brief Runs an access_caloe benchmark (the access function is called once per sample) **/
+
+static BenchResult bench_access(string name, int (*fn)(access_caloe *), access_caloe * access, int samples, int warmup) {
+	BenchResult res;
+
+	res.name = name;
+	res.samples = samples;
+	res.errors = 0;
+
+	for(int i = 0 ; i < warmup ; i++)
+		fn(access);
+
+	for(int i = 0 ; i < samples ; i++) {
+		double t0 = now_us();
+
+		if(fn(access) != ALL_OK)
+			res.errors++;
+
+		res.latencies.push_back(now_us() - t0);
+	}
+
+	return res;
+}
+
+/** @brief Runs one operation of a device with default parameters (index 0 of offsets/masks, value 0) **/
+
+static BenchResult bench_operation(Device & dev, string name, string ip, int samples, int warmup) {
+	BenchResult res;
+	ParamOperation params;
+	vector<char> needed = dev.getNeededParameters(name);
+
+	res.name = dev.getName() + "." + name;
+	res.samples = samples;
+	res.errors = 0;
+
+	for(unsigned int i = 0 ; i < needed.size() ; i++) {
+		ParamAccess pa;
+
+		if(needed[i] & PARAM_NETADDRESS)
+			pa.setIP(ip);
+		if(needed[i] & PARAM_PORT)
+			pa.setPort(SIM_DEFAULT_PORT);
+		if(needed[i] & PARAM_OFFSET)
+			pa.setOffset(0);
+		if(needed[i] & PARAM_MASK)
+			pa.setMask(0);
+		if(needed[i] & PARAM_VALUE)
+			pa.setValue(0);
+
+		params.addParameter(pa);
+	}
+
+	for(int i = 0 ; i < warmup ; i++)
+		dev.execute(name,params);
+
+	for(int i = 0 ; i < samples ; i++) {
+		double t0 = now_us();
+
+		dev.execute(name,params);
+
+		res.latencies.push_back(now_us() - t0);
+	}
+
+	return res;
+}
+
+/** @brief Measures a full SDB scan of the endpoint (the session cache is dropped before each sample) **/
+
+static BenchResult bench_sdb_scan(access_caloe * access, int samples) {
+	BenchResult res;
+	session_caloe * session;
+
+	res.name = "sdb_scan";
+	res.samples = samples;
+	res.errors = 0;
+
+	if(acquire_session_caloe(default_session_pool_caloe(),&access->networkc,&session) != ALL_OK) {
+		res.errors = samples;
+		return res;
+	}
+
+	for(int i = 0 ; i < samples ; i++) {
+		double t0 = now_us();
+
+		if(fill_sdb_cache_caloe(session->device,&session->sdb) != ALL_OK)
+			res.errors++;
+
+		res.latencies.push_back(now_us() - t0);
+	}
+
+	release_session_caloe(default_session_pool_caloe(),session,ALL_OK);
+
+	return res;
+}
+
+/** @brief Writes a configuration file with the given number of operations (one access each)
+ *
+ *  @return Path of the file or an empty string on error
+ **/
+
+static string write_synthetic_cfg(int operations) {
+	char path[] = "/tmp/bench_caloe_XXXXXX";
+	int fd = mkstemp(path);
+	FILE * f;
+
+	if(fd < 0 || (f = fdopen(fd,"w")) == NULL)
+		return "";
+
+	fprintf(f,"# Synthetic configuration file (%d operations)\n\n",operations);
+
+	for(int i = 0 ; i < operations ; i++) {
+		fprintf(f,"BOPERATION\n\tNAME op_%d\n\tDOC Synthetic operation %d\n\n",i,i);
+		fprintf(f,"\tBACTION\n\t\tNETP\n\t\tADDRESS 0x%x\n\t\tMODE %c\n",BENCH_REGISTER + 4*(i % 64),(i % 2 ? 'W' : 'R'));
+		fprintf(f,"\t\tMASKP {0x01,0x02,0x04,0x08}\n\t\tMSKNEG\n\t\tALIGN 4\n\tEACTION\n\nEOPERATION\n\n");
+	}
+
+	fclose(f);
+
+	return path;
+}
+
+/** @brief Measures the load of a configuration file (parsed on each sample unless cached is set) **/
+
+static BenchResult bench_cfg_load(string name, string path, int operations, bool cached, int samples) {
+	BenchResult res;
+
+	res.name = name;
+	res.samples = samples;
+	res.errors = 0;
+
+	// The first load fills the cache
+	if(cached) {
+		Device warm;
+		warm.loadCfgFile(path,"synthetic");
+	}
+
+	for(int i = 0 ; i < samples ; i++) {
+		Device dev;
+
+		if(!cached)
+			OperationTable::clearCache();
+
+		double t0 = now_us();
+
+		dev.loadCfgFile(path,"synthetic");
+
+		res.latencies.push_back(now_us() - t0);
+
+		if(dev.getOperationNames().size() != (unsigned int) operations)
+			res.errors++;
+	}
+
+	OperationTable::clearCache();
+
+	return res;
+}
+
+static void print_results(vector<BenchResult> & results, bool csv, FILE * out) {
+	if(csv)
+		fprintf(out,"name,samples,errors,mean_us,p50_us,p99_us,ops_per_s\n");
+	else
+		fprintf(out,"{\n  \"benchmarks\": [\n");
+
+	for(unsigned int i = 0 ; i < results.size() ; i++) {
+		vector<double> sorted = results[i].latencies;
+		double total = 0;
+
+		sort(sorted.begin(),sorted.end());
+
+		for(unsigned int j = 0 ; j < sorted.size() ; j++)
+			total += sorted[j];
+
+		double mean = (sorted.empty() ? 0 : total/sorted.size());
+		double ops = (total > 0 ? sorted.size()*1e6/total : 0);
+
+		if(csv) {
+			fprintf(out,"%s,%d,%d,%.2f,%.2f,%.2f,%.1f\n",results[i].name.c_str(),results[i].samples,results[i].errors,
+				mean,percentile(sorted,0.50),percentile(sorted,0.99),ops);
+		}
+		else {
+			fprintf(out,"    {\"name\": \"%s\", \"samples\": %d, \"errors\": %d, \"mean_us\": %.2f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"ops_per_s\": %.1f}%s\n",
+				results[i].name.c_str(),results[i].samples,results[i].errors,
+				mean,percentile(sorted,0.50),percentile(sorted,0.99),ops,(i+1 < results.size() ? "," : ""));
+		}
+	}
+
+	if(!csv)
+		fprintf(out,"  ]\n}\n");
+}
+
+static void print_help() {
+	cout << endl;
+	cout << "Command: bench_caloe.run <options>" << endl << endl;
+	cout << "-n <samples>: Samples of each benchmark (default " << BENCH_SAMPLES << ")." << endl;
+	cout << "-w <runs>: Warm-up runs of each benchmark (default " << BENCH_WARMUP << ")." << endl;
+	cout << "-c: CSV output (default JSON)." << endl;
+	cout << "-o <file>: Output file (default stdout)." << endl;
+	cout << "-i <ip>: Use a board instead of the local simulator (e.g. udp/192.168.1.10)." << endl;
+	cout << "-l <us>: Latency of the local simulator." << endl;
+	cout << "-d <percent>: Packet loss of the local simulator." << endl;
+	cout << "-M: Use the in-process memory transport (no sockets, SDB scan is skipped)." << endl;
+	cout << "-s <operations>: Operations of the synthetic configuration file (default " << BENCH_CFG_OPERATIONS << ", 0: skip)." << endl;
+	cout << "-h: Show this help." << endl << endl;
+}
+
+int main(int argc, char ** argv)
+{
+	int samples = BENCH_SAMPLES;
+	int warmup = BENCH_WARMUP;
+	bool csv = false;
+	bool local = true;
+	bool memory = false;
+	string ip("udp/127.0.0.1");
+	FILE * out = stdout;
+	long latency = 0;
+	int loss = 0;
+	int cfg_operations = BENCH_CFG_OPERATIONS;
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:w:co:i:l:d:Ms:h")) != -1) {
+		switch(opt) {
+			case 'n': samples = atoi(optarg);
+			break;
+			case 'w': warmup = atoi(optarg);
+			break;
+			case 'c': csv = true;
+			break;
+			case 'o':
+				if((out = fopen(optarg,"w")) == NULL) {
+					cout << "ERROR: Could not open " << optarg << endl;
+					return -1;
+				}
+			break;
+			case 'i': ip = optarg; local = false;
+			break;
+			case 'l': latency = atol(optarg);
+			break;
+			case 'd': loss = atoi(optarg);
+			break;
+			case 'M': memory = true; local = false;
+			break;
+			case 's': cfg_operations = atoi(optarg);
+			break;
+			default:
+				print_help();
+				return (opt == 'h' ? 0 : -1);
+		}
+	}
+
+	// Start the local simulator (configuration files use the default Etherbone port)
+	sim_map_caloe map;
+	sim_server_caloe server;
+	pthread_t sim_thread;
+	transport_caloe transport;
+
+	// The memory transport serves the same map without Etherbone
+	if(memory) {
+		default_sim_map_caloe(&map);
+		init_memory_transport_caloe(&transport,&map);
+		set_transport_caloe(&transport);
+	}
+
+	if(local) {
+		default_sim_map_caloe(&map);
+
+		if(open_sim_server_caloe(&server,&map,0,SIM_DEFAULT_PORT) != ALL_OK)
+			return -1;
+
+		server.latency = latency;
+		server.loss = loss;
+		server.seed = 1;
+
+		pthread_create(&sim_thread,NULL,&sim_server_thread_caloe,&server);
+	}
+
+	vector<BenchResult> results;
+	network_connection nc;
+	access_caloe access;
+	char aux[50];
+
+	// Startup: parse of a large configuration file, a load served by the table cache and one from the compiled file
+	if(cfg_operations > 0) {
+		string cfg = write_synthetic_cfg(cfg_operations);
+
+		if(cfg.empty()) {
+			cout << "ERROR: Could not write the synthetic configuration file" << endl;
+		}
+		else {
+			string compiled = OperationTable::compiledPath(cfg);
+
+			OperationTable::setAutoCompile(false);
+			results.push_back(bench_cfg_load("cfg_parse",cfg,cfg_operations,false,BENCH_CFG_SAMPLES));
+			results.push_back(bench_cfg_load("cfg_load_cached",cfg,cfg_operations,true,BENCH_CFG_SAMPLES));
+
+			// Cold start from the compiled file (mapped, validated against the source contents)
+			if(OperationTable::compile(cfg,compiled))
+				results.push_back(bench_cfg_load("cfg_load_compiled",cfg,cfg_operations,false,BENCH_CFG_SAMPLES));
+
+			unlink(compiled.c_str());
+			unlink(cfg.c_str());
+		}
+	}
+
+	strcpy(aux,ip.c_str());
+	build_network_con_full_caloe(aux,SIM_DEFAULT_PORT,&nc);
+
+	// Single register accesses
+	build_access_caloe(BENCH_REGISTER,0,0,0,MASK_OR,0,READ,SIZE_4B,&nc,&access);
+	results.push_back(bench_access("read",(memory ? &execute_caloe : &read_caloe),&access,samples,warmup));
+	free_access_caloe(&access);
+
+	build_access_caloe(BENCH_REGISTER,0,0x5a5a5a5a,0,MASK_OR,0,WRITE,SIZE_4B,&nc,&access);
+	results.push_back(bench_access("write",(memory ? &execute_caloe : &write_caloe),&access,samples,warmup));
+	free_access_caloe(&access);
+
+	build_access_caloe(BENCH_REGISTER,0,0,0x1,MASK_OR,0,READ_WRITE,SIZE_4B,&nc,&access);
+	results.push_back(bench_access("read_modify_write",(memory ? &execute_caloe : &write_after_read_caloe),&access,samples,warmup));
+
+	// SDB scan of the whole endpoint
+	if(!memory)
+		results.push_back(bench_sdb_scan(&access,samples));
+	free_access_caloe(&access);
+
+	free_network_con_caloe(&nc);
+
+	// Every operation of the DIO and VUART configuration files
+	Device dio;
+	Device vuart;
+
+	dio.loadCfgFile("../devices/dio/dio.cfg","dio");
+	vuart.loadCfgFile("../devices/vuart/vuart.cfg","vuart");
+
+	Device * devs[] = { &dio, &vuart };
+
+	for(int d = 0 ; d < 2 ; d++) {
+		vector<string> names = devs[d]->getOperationNames();
+
+		for(unsigned int i = 0 ; i < names.size() ; i++)
+			results.push_back(bench_operation(*devs[d],names[i],ip,samples,warmup));
+	}
+
+	print_results(results,csv,out);
+
+	if(out != stdout)
+		fclose(out);
+
+	// Close sessions before the simulator goes away
+	System sys;
+	sys.shutdown();
+
+	if(local) {
+		stop_sim_server_caloe(&server);
+		pthread_join(sim_thread,NULL);
+		close_sim_server_caloe(&server);
+		free_sim_map_caloe(&map);
+	}
+
+	if(memory) {
+		set_transport_caloe(NULL);
+		free_sim_map_caloe(&map);
+	}
+
+	return 0;
+}
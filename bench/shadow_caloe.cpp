@@ -0,0 +1,115 @@
+/**
+ *******************************************************************************
+ * @file shadow_caloe.cpp
+ *  @brief Shadow cache regression test (against the memory transport)
+ *
+ *  Cacheable and volatile accesses of the same register are interleaved: the value left on the
+ *  board must be the one it would have without the shadow cache.
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "../lib/System.h"
+#include "../lib/sim_internals.h"
+#include "../lib/shadow_internals.h"
+#include "../lib/transport_internals.h"
+
+using namespace std;
+using namespace caloe;
+
+/// Register of the test (first register of the VUART block)
+#define SHADOW_REGISTER SIM_VUART_ADDRESS
+
+/** @brief Execute an access of the test register
+ *
+ *  @param mode READ, WRITE or READ_WRITE
+ *
+ *  @param value Written value (OR mask of a read-modify-write)
+ *
+ *  @param cacheable Cacheable (true) or volatile (false) access
+ *
+ *  @return Error code of the access
+ **/
+
+static int run_access(access_type_caloe mode, eb_data_t value, bool cacheable) {
+	Netcon endpoint("udp/127.0.0.1",SIM_DEFAULT_PORT);
+	eb_data_t mask = (mode == READ_WRITE ? value : 0);
+	Access access(SHADOW_REGISTER,SHADOW_REGISTER,0,(mode == WRITE ? value : 0),mask,MASK_OR,false,mode,SIZE_4B,0,endpoint);
+
+	access.setCacheable(cacheable);
+
+	return access.execute();
+}
+
+/** @brief Run one interleaving and check the register on the board
+ *
+ *  @return 0 if the register has the expected value or -1 otherwise
+ **/
+
+static int check(sim_map_caloe * map, const char * name, access_type_caloe middle, eb_data_t expected) {
+	uint64_t value = 0;
+	int rcode;
+
+	write_sim_caloe(map,SHADOW_REGISTER,4,0xf,0);
+	clear_shadow_cache_caloe(default_shadow_cache_caloe());
+
+	// Cached RMW, volatile write of the same register and cached RMW again
+	rcode = run_access(READ_WRITE,0x1,true);
+
+	if(rcode == ALL_OK)
+		rcode = run_access(middle,0x100,false);
+
+	if(rcode == ALL_OK)
+		rcode = run_access(READ_WRITE,0x2,true);
+
+	read_sim_caloe(map,SHADOW_REGISTER,4,&value);
+
+	cout << name << ": register 0x" << hex << value << " (expected 0x" << expected << ")" << dec;
+
+	if(rcode != ALL_OK || value != expected) {
+		cout << " FAILED (error code " << rcode << ")" << endl;
+		return -1;
+	}
+
+	cout << " OK" << endl;
+
+	return 0;
+}
+
+int main()
+{
+	sim_map_caloe map;
+	transport_caloe transport;
+	int failed = 0;
+
+	default_sim_map_caloe(&map);
+	init_memory_transport_caloe(&transport,&map);
+	set_transport_caloe(&transport);
+
+	failed += check(&map,"cached RMW, volatile RMW, cached RMW",READ_WRITE,0x103);
+	failed += check(&map,"cached RMW, volatile WRITE, cached RMW",WRITE,0x102);
+
+	set_transport_caloe(NULL);
+	free_sim_map_caloe(&map);
+
+	return (failed == 0 ? 0 : -1);
+}
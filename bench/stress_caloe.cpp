@@ -0,0 +1,261 @@
+/**
+ *******************************************************************************
+ * @file stress_caloe.cpp
+ *  @brief Threaded read/write stress test (against the local simulator or the memory transport)
+ *
+ *  Every thread writes its own register and reads it back, reads a register shared by all
+ *  threads and executes an operation of its own Dio device (all devices share one table).
+ *  Build it with ThreadSanitizer with "make stress-tsan".
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "../lib/System.h"
+#include "../lib/sim_internals.h"
+#include "../lib/transport_internals.h"
+
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+using namespace std;
+using namespace caloe;
+
+/// Default number of threads
+#define STRESS_THREADS 8
+
+/// Max number of threads (one register of the VUART block each)
+#define STRESS_MAX_THREADS (SIM_VUART_SIZE/4 - 1)
+
+/// Default number of iterations of each thread
+#define STRESS_ITERATIONS 1000
+
+/// Register read by all threads (last register of the VUART block)
+#define STRESS_SHARED_REGISTER (SIM_VUART_ADDRESS + SIM_VUART_SIZE - 4)
+
+/// Value of the shared register
+#define STRESS_SHARED_VALUE 0xc0ffee
+
+/// Operation of the Dio device executed by every thread (it only reads)
+#define STRESS_OPERATION "show_config_channels"
+
+/** @brief Work and results of one thread **/
+
+struct StressThread {
+	/// Thread index (it selects the register of the thread)
+	int index;
+
+	/// Number of iterations
+	int iterations;
+
+	/// Endpoint of the accesses
+	Netcon endpoint;
+
+	/// Expected result of STRESS_OPERATION
+	eb_data_t expected;
+
+	/// Number of failed accesses or operations
+	int errors;
+
+	/// Number of values read back that do not match
+	int mismatches;
+};
+
+static double now_us() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1e6 + ts.tv_nsec/1e3;
+}
+
+/** @brief Execute STRESS_OPERATION of a Dio device
+ *
+ *  @return Read value or -1 if the operation failed
+ **/
+
+static long long run_operation(Device & dio, const Netcon & endpoint) {
+	ParamOperation params;
+	ParamAccess param;
+	RetryPolicy policy;
+	OperationResult res;
+
+	param.setIP(endpoint.getIP());
+	params.addParameter(param);
+
+	res = dio.execute(STRESS_OPERATION,params,policy);
+
+	if(res.rcode != ALL_OK || res.values.empty())
+		return -1;
+
+	return (long long) res.values[0];
+}
+
+static void * stress_thread(void * arg) {
+	StressThread * st = (StressThread *) arg;
+	eb_address_t reg = SIM_VUART_ADDRESS + 4*st->index;
+	Device dio;
+
+	// Every thread loads the file, the table is parsed once and shared
+	dio.loadCfgFile("../devices/dio/dio.cfg","dio");
+
+	Access write(reg,reg,0,0,0,MASK_OR,false,WRITE,SIZE_4B,0,st->endpoint);
+	Access read(reg,reg,0,0,0,MASK_OR,false,READ,SIZE_4B,0,st->endpoint);
+	Access shared(STRESS_SHARED_REGISTER,STRESS_SHARED_REGISTER,0,0,0,MASK_OR,false,READ,SIZE_4B,0,st->endpoint);
+
+	for(int i = 0 ; i < st->iterations ; i++) {
+		eb_data_t value = ((eb_data_t) st->index << 24) | (i & 0xffffff);
+
+		write.setValue(value);
+
+		if(write.execute() != ALL_OK || read.execute() != ALL_OK || shared.execute() != ALL_OK) {
+			st->errors++;
+			continue;
+		}
+
+		if(read.getValue() != value || shared.getValue() != STRESS_SHARED_VALUE)
+			st->mismatches++;
+
+		if(run_operation(dio,st->endpoint) != (long long) st->expected)
+			st->errors++;
+	}
+
+	return NULL;
+}
+
+static void print_help() {
+	cout << endl;
+	cout << "Command: stress_caloe.run <options>" << endl << endl;
+	cout << "-t <threads>: Number of threads (default " << STRESS_THREADS << ", max " << STRESS_MAX_THREADS << ")." << endl;
+	cout << "-n <iterations>: Iterations of each thread (default " << STRESS_ITERATIONS << ")." << endl;
+	cout << "-M: Use the in-process memory transport instead of the local simulator (no sockets)." << endl;
+	cout << "-h: Show this help." << endl << endl;
+}
+
+int main(int argc, char ** argv)
+{
+	int nthreads = STRESS_THREADS;
+	int iterations = STRESS_ITERATIONS;
+	bool memory = false;
+	int opt;
+
+	while((opt = getopt(argc, argv, "t:n:Mh")) != -1) {
+		switch(opt) {
+			case 't': nthreads = atoi(optarg);
+			break;
+			case 'n': iterations = atoi(optarg);
+			break;
+			case 'M': memory = true;
+			break;
+			default:
+				print_help();
+				return (opt == 'h' ? 0 : -1);
+		}
+	}
+
+	if(nthreads < 1 || nthreads > STRESS_MAX_THREADS) {
+		cout << "ERROR: Number of threads must be between 1 and " << STRESS_MAX_THREADS << endl;
+		return -1;
+	}
+
+	sim_map_caloe map;
+	sim_server_caloe server;
+	pthread_t sim_thread;
+	transport_caloe transport;
+
+	default_sim_map_caloe(&map);
+	write_sim_caloe(&map,STRESS_SHARED_REGISTER,4,0xf,STRESS_SHARED_VALUE);
+
+	// Threads use different registers, so the map of the memory transport needs no lock
+	if(memory) {
+		init_memory_transport_caloe(&transport,&map);
+		set_transport_caloe(&transport);
+	}
+	else {
+		if(open_sim_server_caloe(&server,&map,0,SIM_DEFAULT_PORT) != ALL_OK)
+			return -1;
+
+		pthread_create(&sim_thread,NULL,&sim_server_thread_caloe,&server);
+	}
+
+	Netcon endpoint("udp/127.0.0.1",SIM_DEFAULT_PORT);
+	vector<StressThread> work(nthreads);
+	vector<pthread_t> threads(nthreads);
+	int errors = 0, mismatches = 0;
+
+	// Expected result of the operation (nobody writes its register)
+	Device dio;
+
+	dio.loadCfgFile("../devices/dio/dio.cfg","dio");
+
+	long long expected = run_operation(dio,endpoint);
+
+	for(int i = 0 ; i < nthreads ; i++) {
+		work[i].index = i;
+		work[i].iterations = iterations;
+		work[i].endpoint = endpoint;
+		work[i].expected = (eb_data_t) expected;
+		work[i].errors = 0;
+		work[i].mismatches = 0;
+	}
+
+	double t0 = now_us();
+
+	if(expected < 0) {
+		cout << "ERROR: Operation " << STRESS_OPERATION << " failed before the threads start" << endl;
+		errors++;
+	}
+	else {
+		for(int i = 0 ; i < nthreads ; i++)
+			pthread_create(&threads[i],NULL,&stress_thread,&work[i]);
+
+		for(int i = 0 ; i < nthreads ; i++)
+			pthread_join(threads[i],NULL);
+	}
+
+	double elapsed = now_us() - t0;
+
+	for(int i = 0 ; i < nthreads ; i++) {
+		errors += work[i].errors;
+		mismatches += work[i].mismatches;
+	}
+
+	cout << nthreads << " threads x " << iterations << " iterations (" << (memory ? "memory transport" : "local simulator") << "): ";
+	cout << errors << " errors, " << mismatches << " mismatches, " << (int) (nthreads*iterations*4*1e6/elapsed) << " accesses/s" << endl;
+
+	// Close sessions before the simulator goes away
+	System sys;
+	sys.shutdown();
+
+	if(memory) {
+		set_transport_caloe(NULL);
+	}
+	else {
+		stop_sim_server_caloe(&server);
+		pthread_join(sim_thread,NULL);
+		close_sim_server_caloe(&server);
+	}
+
+	free_sim_map_caloe(&map);
+
+	return (errors == 0 && mismatches == 0 ? 0 : -1);
+}
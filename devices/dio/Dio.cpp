@@ -26,10 +26,11 @@
  */
  
 #include "Dio.h"
+#include "dio_cfg.h"
 
 Dio::Dio() {
-	// It loads Dio operations from configuration file
-	dio.loadCfgFile("dio.cfg","dio");
+	// It loads Dio operations built into the program (generated from dio.cfg)
+	dio_cfg::load(dio,"dio");
 }
 
 Dio::Dio(const Dio & dio) {
@@ -50,6 +51,21 @@ void Dio::print() {
 	cout << dio;
 }
 
+vector<eb_data_t> Dio::executeChecked(const string & name, ParamOperation & params, unsigned int nvalues) {
+	RetryPolicy policy;
+	OperationResult res;
+
+	res = dio.execute(name,params,policy);
+
+	// A failed operation returns the values read before the failure, so they can not be used
+	if(res.rcode != ALL_OK || res.values.size() < nvalues) {
+		cout << "ERROR: Operation " << name << " failed (" << res.rcode << ")" << endl;
+		res.values.clear();
+	}
+
+	return res.values;
+}
+
 void Dio::scan(string ip) {
 	ParamOperation params;
 	ParamAccess param;
@@ -59,7 +75,7 @@ void Dio::scan(string ip) {
     params.addParameter(param);
     
     // Execute scan_root operation to show device memory map
-    dio.execute("scan_root",params);
+    executeChecked("scan_root",params,0);
 }
 
 void Dio::configChOutput(string ip, int ch) {
@@ -75,7 +91,7 @@ void Dio::configChOutput(string ip, int ch) {
 	params.addParameter(param);
 	
 	// Execute config_channel_O to configure channel as Output
-	dio.execute("config_channel_O",params);
+	executeChecked("config_channel_O",params,0);
 }
 
 void Dio::configChInput(string ip, int ch) {
@@ -91,7 +107,7 @@ void Dio::configChInput(string ip, int ch) {
 	params.addParameter(param);
 	
 	// Execute config_channel_I to configure channel as Input
-	dio.execute("config_channel_I",params);
+	executeChecked("config_channel_I",params,0);
 }
 
 void Dio::configChResistor(string ip, int ch) {
@@ -105,7 +121,7 @@ void Dio::configChResistor(string ip, int ch) {
 	params.addParameter(param);
 	
 	// Execute config_channel_R to configure channel with resistor termination
-	dio.execute("config_channel_R",params);
+	executeChecked("config_channel_R",params,0);
 }
 
 void Dio::configChnResistor(string ip, int ch) {
@@ -119,7 +135,7 @@ void Dio::configChnResistor(string ip, int ch) {
 	params.addParameter(param);
 	
 	// Execute config_channel_without_R to configure channel without resistor termination
-	dio.execute("config_channel_without_R",params);
+	executeChecked("config_channel_without_R",params,0);
 }
 
 void Dio::configCh(string ip,int ch, char mode) {
@@ -184,7 +200,10 @@ void Dio::showConfigChs(string ip) {
 	params.addParameter(param);
 
 	// Execute show_config_channels to check channel configuration
-	res = dio.execute("show_config_channels",params);
+	res = executeChecked("show_config_channels",params,1);
+	
+	if(res.empty())
+		return;
 	
 	// Get channel configurations and print them
 	 
@@ -389,7 +408,7 @@ void Dio::pulseImm(string ip, int ch, int len_pulse) {
 	
 	// Execute dio_pulse_imm to generate inmediate pulse
 	
-	dio.execute("dio_pulse_imm",params);
+	executeChecked("dio_pulse_imm",params,0);
 }
 
 bool Dio::isDioReady(string ip, int ch) {
@@ -407,9 +426,10 @@ bool Dio::isDioReady(string ip, int ch) {
 	
 	// Execute dio_trig_ready to check if Dio is ready
 	
-	res = dio.execute("dio_trig_ready",params);
+	res = executeChecked("dio_trig_ready",params,1);
 	
-	if(res.at(0) != 0) {
+	// Not ready if the operation failed
+	if(!res.empty() && res.at(0) != 0) {
 		ready = true;
 	}
 	else {
@@ -420,11 +440,17 @@ bool Dio::isDioReady(string ip, int ch) {
 }
 
 void Dio::pulseProg(string ip, int ch, int len_pulse, timespec t_trig) {
-	ParamOperation params;
-	ParamAccess param;
+	ParamOperation params, ready_params;
+	ParamAccess param, ready_param;
+	
+	// Wait until Dio is ready (a previous pulse may not be generated yet)
+	
+	ready_param.setMask(ch);
+	ready_param.setIP(ip);
 	
-	// Check if Dio is ready
-	bool ready = isDioReady(ip,ch);
+	ready_params.addParameter(ready_param);
+	
+	bool ready = (dio.waitUntil("dio_trig_ready",ready_params,(1 << ch),DIO_READY_TIMEOUT) == ALL_OK);
 	
 	// If Dio is ready...
 	if(ready) {
@@ -480,7 +506,7 @@ void Dio::pulseProg(string ip, int ch, int len_pulse, timespec t_trig) {
 		params.addParameter(param);
 		
 		// Execute dio_pulse_prog to generate programmable pulse
-		dio.execute("dio_pulse_prog",params);
+		executeChecked("dio_pulse_prog",params,0);
 	}
 	else { // If Dio is not ready, print an message...
 		cout <<"Dio is not ready yet!"<<endl;
@@ -500,9 +526,10 @@ bool Dio::isFifoFull(string ip, int ch) {
 	params.addParameter(param);
 	
 	// Execute fifo_isfull to check if Fifo is full
-	res = dio.execute("fifo_isfull",params);
+	res = executeChecked("fifo_isfull",params,1);
 	
-	if(res.at(0) != 0)
+	// Not full if the operation failed
+	if(!res.empty() && res.at(0) != 0)
 		full = true;
 	else
 		full = false;
@@ -523,9 +550,10 @@ bool Dio::isFifoEmpty(string ip, int ch) {
 	params.addParameter(param);
 	
 	// Execute fifo_isempty to check if Fifo is empty
-	res = dio.execute("fifo_isempty",params);
+	res = executeChecked("fifo_isempty",params,1);
 	
-	if(res.at(0) != 0) {
+	// Empty if the operation failed (so loops reading the Fifo stop)
+	if(res.empty() || res.at(0) != 0) {
 		empty = true;
 	}
 	else {
@@ -548,9 +576,10 @@ int Dio::fifoSize(string ip, int ch) {
 	params.addParameter(param);
 	
 	// Execute fifo_nfilled to get number of elements in Fifo
-	res = dio.execute("fifo_nfilled",params);
+	res = executeChecked("fifo_nfilled",params,1);
 	
-	nused = (int) res.at(0);
+	// No elements if the operation failed
+	nused = res.empty() ? 0 : (int) res.at(0);
 	
 	return nused;
 }
@@ -561,6 +590,9 @@ timespec Dio::fifoTop(string ip, int ch, bool & empty) {
 	vector<eb_data_t> res;
 	timespec t;
 	
+	t.tv_sec = 0;
+	t.tv_nsec = 0;
+	
 	// Check if fifo is empty
 	empty = isFifoEmpty(ip,ch);
 
@@ -576,7 +608,13 @@ timespec Dio::fifoTop(string ip, int ch, bool & empty) {
 		params.addParameter(param);
 		
 		// Execute fifo_value to get top element of Fifo
-		res = dio.execute("fifo_value",params);
+		res = executeChecked("fifo_value",params,3);
+		
+		// Stop as an empty Fifo if the value can not be read
+		if(res.empty()) {
+			empty = true;
+			return t;
+		}
 		
 		// Parse result to timespec struct
 		
@@ -29,6 +29,9 @@
 
 #include <iostream>
 
+/// Max time (us) to wait for a programmable pulse channel
+#define DIO_READY_TIMEOUT 1000000
+
 using namespace std;
 using namespace caloe;
 
@@ -40,6 +43,19 @@ class Dio {
 		/// Device for Dio (contains low-level operations)
 		Device dio;
 
+		/** @brief Execute a Dio operation and check its result
+		 *
+		 *  @param name Operation name
+		 * 
+		 *  @param params User parameters for the operation
+		 * 
+		 *  @param nvalues Number of values the operation must read
+		 * 
+		 *  @return Read values, empty if the operation failed or read fewer values (the error is printed)
+		 */
+		 
+		vector<eb_data_t> executeChecked(const string & name, ParamOperation & params, unsigned int nvalues);
+
 		/** @brief Configure a Dio channel as output
 		 *
 		 *  @param ip IP netaddress
@@ -78,7 +94,7 @@ class Dio {
 
 	public:
 		
-		/**@brief Dio default constructor **/
+		/**@brief Dio default constructor (operations built into the program, see dio_cfg.h) **/
 		
 		Dio();
 		
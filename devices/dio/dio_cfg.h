@@ -0,0 +1,597 @@
+/**
+ *******************************************************************************
+ * @file dio_cfg.h
+ *  @brief Operations of dio.cfg built into the program (generated by cfgc_spec.run, do not edit)
+ *
+ *  The tables have the layout of a compiled configuration file (see cfgcache_internals.h). They are
+ *  constant data: loading a device reads and parses nothing. Operations whose accesses have constant
+ *  addresses and widths (no AUTO, BLOCK or SCAN) get wrappers that build their accesses on the stack
+ *  and run them with Operation::executeAccesses, without a device; the rest run through a Device
+ *  loaded with load. Regenerate this file with:
+ *
+ *    cfgc_spec.run -g dio_cfg.h -n dio_cfg dio.cfg
+ *******************************************************************************
+ */
+
+#ifndef DIO_CFG_H
+#define DIO_CFG_H
+
+#include "../../lib/Device.h"
+#include "../../lib/endpoint_internals.h"
+
+using namespace caloe;
+
+namespace dio_cfg {
+
+/// Operation indices (valid in a device loaded only with load)
+enum operation_index {
+	OP_DIO_PULSE_IMM = 0,
+	OP_DIO_TRIG_READY = 1,
+	OP_DIO_PULSE_PROG = 2,
+	OP_SCAN_ROOT = 3,
+	OP_FIFO_ISFULL = 4,
+	OP_FIFO_ISEMPTY = 5,
+	OP_FIFO_NFILLED = 6,
+	OP_FIFO_VALUE = 7,
+	OP_CONFIG_CHANNEL_I = 8,
+	OP_CONFIG_CHANNEL_O = 9,
+	OP_CONFIG_CHANNEL_R = 10,
+	OP_CONFIG_CHANNEL_WITHOUT_R = 11,
+	OP_SHOW_CONFIG_CHANNELS = 12,
+	OPERATIONS = 13
+};
+
+/// Accesses: address_init, address, offset, value, mask, autoincr, block, ip, port, offsets, noffsets,
+/// masks, nmasks, mode, align, mask_oper, parameters, flags
+static const cfg_cache_access_caloe accesses[] = {
+	/* dio_pulse_imm */
+	{ 0x62348ull, 0x62348ull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 0u, 5u, 5u, 0u, 1, 2, 1, 14, 0, { 0, 0, 0 } },
+	{ 0x6235cull, 0x6235cull, 0x0ull, 0xffffffffull, 0x0ull, 0, 1, 0u, 60368u, 5u, 0u, 5u, 5u, 1, 2, 0, 18, 0, { 0, 0, 0 } },
+	/* dio_trig_ready */
+	{ 0x62344ull, 0x62344ull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 10u, 0u, 10u, 5u, 0, 2, 0, 18, 0, { 0, 0, 0 } },
+	/* dio_pulse_prog */
+	{ 0x62300ull, 0x62300ull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 15u, 5u, 20u, 0u, 1, 2, 1, 14, 0, { 0, 0, 0 } },
+	{ 0x62304ull, 0x62304ull, 0x0ull, 0x0ull, 0xffull, 0, 1, 0u, 60368u, 20u, 5u, 25u, 0u, 1, 2, 0, 14, 0, { 0, 0, 0 } },
+	{ 0x62308ull, 0x62308ull, 0x0ull, 0x0ull, 0xfffffffull, 0, 1, 0u, 60368u, 25u, 5u, 30u, 0u, 1, 2, 0, 14, 0, { 0, 0, 0 } },
+	{ 0x62348ull, 0x62348ull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 30u, 5u, 35u, 0u, 1, 2, 1, 14, 0, { 0, 0, 0 } },
+	{ 0x62340ull, 0x62340ull, 0x0ull, 0xffffffffull, 0x0ull, 0, 1, 0u, 60368u, 35u, 0u, 35u, 5u, 1, 2, 0, 18, 0, { 0, 0, 0 } },
+	/* scan_root */
+	{ 0x0ull, 0x0ull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 40u, 0u, 40u, 0u, 2, 2, 1, 2, 0, { 0, 0, 0 } },
+	/* fifo_isfull */
+	{ 0x6237cull, 0x6237cull, 0x0ull, 0x0ull, 0x10000ull, 0, 1, 0u, 60368u, 40u, 5u, 45u, 0u, 0, 2, 0, 10, 0, { 0, 0, 0 } },
+	/* fifo_isempty */
+	{ 0x6237cull, 0x6237cull, 0x0ull, 0x0ull, 0x20000ull, 0, 1, 0u, 60368u, 45u, 5u, 50u, 0u, 0, 2, 0, 10, 0, { 0, 0, 0 } },
+	/* fifo_nfilled */
+	{ 0x6237cull, 0x6237cull, 0x0ull, 0x0ull, 0xffull, 0, 1, 0u, 60368u, 50u, 5u, 55u, 0u, 0, 2, 0, 10, 0, { 0, 0, 0 } },
+	/* fifo_value */
+	{ 0x62370ull, 0x62370ull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 55u, 5u, 60u, 0u, 0, 2, 1, 10, 2, { 0, 0, 0 } },
+	{ 0x62374ull, 0x62374ull, 0x0ull, 0x0ull, 0xffull, 0, 1, 0u, 60368u, 60u, 5u, 65u, 0u, 0, 2, 0, 10, 2, { 0, 0, 0 } },
+	{ 0x62378ull, 0x62378ull, 0x0ull, 0x0ull, 0xfffffffull, 0, 1, 0u, 60368u, 65u, 5u, 70u, 0u, 0, 2, 0, 10, 2, { 0, 0, 0 } },
+	/* config_channel_I */
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 70u, 0u, 70u, 5u, 3, 2, 0, 18, 0, { 0, 0, 0 } },
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 75u, 0u, 75u, 5u, 3, 2, 1, 18, 0, { 0, 0, 0 } },
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 80u, 0u, 80u, 5u, 3, 2, 1, 18, 0, { 0, 0, 0 } },
+	/* config_channel_O */
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 85u, 0u, 85u, 5u, 3, 2, 0, 18, 0, { 0, 0, 0 } },
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 90u, 0u, 90u, 5u, 3, 2, 1, 18, 0, { 0, 0, 0 } },
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 95u, 0u, 95u, 5u, 3, 2, 0, 18, 0, { 0, 0, 0 } },
+	/* config_channel_R */
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 100u, 0u, 100u, 5u, 3, 2, 1, 18, 0, { 0, 0, 0 } },
+	/* config_channel_without_R */
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 105u, 0u, 105u, 5u, 3, 2, 0, 18, 0, { 0, 0, 0 } },
+	/* show_config_channels */
+	{ 0x6233cull, 0x6233cull, 0x0ull, 0x0ull, 0xfffffull, 0, 1, 0u, 60368u, 110u, 0u, 110u, 0u, 0, 2, 0, 2, 0, { 0, 0, 0 } },
+};
+
+/// Operations: name, doc, hash, first, naccesses
+static const cfg_cache_operation_caloe operations[] = {
+	{ 1u, 15u, 0x64a952fu, 0u, 2u },
+	{ 77u, 92u, 0x9513dcau, 2u, 1u },
+	{ 154u, 169u, 0xb6e20556u, 3u, 5u },
+	{ 234u, 244u, 0x7074e015u, 8u, 1u },
+	{ 275u, 287u, 0xc4fb0815u, 9u, 1u },
+	{ 310u, 323u, 0x81abb2e1u, 10u, 1u },
+	{ 347u, 360u, 0xb175da7eu, 11u, 1u },
+	{ 397u, 408u, 0xbc61f1e9u, 12u, 3u },
+	{ 439u, 456u, 0x6fdb0f67u, 15u, 3u },
+	{ 490u, 507u, 0x6ddb0c41u, 18u, 3u },
+	{ 542u, 559u, 0x58daeb32u, 21u, 1u },
+	{ 609u, 634u, 0x356e15ddu, 22u, 1u },
+	{ 687u, 708u, 0x73dacc64u, 23u, 1u },
+};
+
+/// Name index (operation index or -1)
+static const int32_t slots[] = {
+	-1, 5, 9, -1, 12, -1, -1, 8, -1, 7, 1, -1, -1, -1, -1, 0,
+	-1, -1, 10, -1, -1, 3, 2, 4, -1, -1, -1, -1, -1, 11, 6, -1
+};
+
+/// Offsets and masks of the accesses
+static const int32_t values[] = {
+	0, 4, 8, 12, 16, 1, 2, 4,
+	8, 16, 1, 2, 4, 8, 16, 0,
+	12, 24, 36, 48, 0, 12, 24, 36,
+	48, 0, 12, 24, 36, 48, 0, 4,
+	8, 12, 16, 1, 2, 4, 8, 16,
+	0, 16, 32, 48, 64, 0, 16, 32,
+	48, 64, 0, 16, 32, 48, 64, 0,
+	16, 32, 48, 64, 0, 16, 32, 48,
+	64, 0, 16, 32, 48, 64, -4, -49,
+	-769, -12289, -196609, 1, 16, 256, 4096, 65536,
+	4, 64, 1024, 16384, 262144, -4, -49, -769,
+	-12289, -196609, 1, 16, 256, 4096, 65536, -5,
+	-65, -1025, -16385, -262145, 8, 128, 2048, 32768,
+	524288, -9, -129, -2049, -32769, -524289
+};
+
+/// String pool
+static const char strings[] =
+	"\0"
+	"dio_pulse_imm\0"
+	"Generate one immediate pulse by one channel of DIO fmc board.\0"
+	"dio_trig_ready\0"
+	"Check if DIO is ready to generate another programmable pulse.\0"
+	"dio_pulse_prog\0"
+	"Generate one programmable pulse by one channel of DIO fmc board.\0"
+	"scan_root\0"
+	"Scans SDB block in SPEC board.\0"
+	"fifo_isfull\0"
+	"Check if fifo is full.\0"
+	"fifo_isempty\0"
+	"Check if fifo is empty.\0"
+	"fifo_nfilled\0"
+	"Returns number of timestamp in fifo.\0"
+	"fifo_value\0"
+	"Returns a timestamp from FIFO.\0"
+	"config_channel_I\0"
+	"Configures a channel as an Input.\0"
+	"config_channel_O\0"
+	"Configures a channel as an Output.\0"
+	"config_channel_R\0"
+	"Configures a channel with a resistor termination.\0"
+	"config_channel_without_R\0"
+	"Configures a channel without a resistor termination.\0"
+	"show_config_channels\0"
+	"Return configuration of each channel.\0"
+	;
+
+static const cfg_cache_header_caloe header = {
+	{ 'C', 'A', 'L', 'O', 'E', 'C', 'F', 'G' }, CFG_CACHE_VERSION, CFG_CACHE_ENDIAN, 0x8ce52840f4d310fcull, 5305ull,
+	0, 13, 24, 32, 110, 746, 0, 0, 0, 0, 0, 0
+};
+
+static const cfg_cache_caloe image = {
+	(void *) &header, 0, &header, operations, accesses, slots, values, strings
+};
+
+/** @brief Load the operations of dio_cfg.h into a device (nothing is read or parsed)
+ *
+ * @param dev Device
+ *
+ * @param name Device name
+ */
+
+static inline void load(Device & dev, const string & name) {
+	dev.loadImage(&image,name);
+}
+
+/** @brief Result of a wrapper called with an offset or mask index out of range **/
+
+static inline OperationResult invalid_index(int access) {
+	OperationResult res;
+
+	res.rcode = INVALID_OPERATION;
+	res.failed_access = access;
+	res.retries = 0;
+	res.elapsed = 0;
+
+	return res;
+}
+
+/** @brief Generate one immediate pulse by one channel of DIO fmc board.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param offset0 Offset of access 0 (index of {0,4,8,c,10})
+ *
+ * @param value0 Value of access 0
+ *
+ * @param mask1 Mask of access 1 (index of {1,2,4,8,10})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult dio_pulse_imm(const string & ip, unsigned int offset0, eb_data_t value0, unsigned int mask1, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(offset0 >= 5u)
+		return invalid_index(0);
+
+	if(mask1 >= 5u)
+		return invalid_index(1);
+
+	access_caloe batch[] = {
+		{ 0x62348ull, (eb_address_t) values[0 + offset0], value0, 0x0ull, MASK_OR, 0, WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x6235cull, 0x0ull, 0xffffffffull, (eb_data_t) values[5 + mask1], MASK_AND, 0, WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,2,policy);
+}
+
+/** @brief Check if DIO is ready to generate another programmable pulse.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param mask0 Mask of access 0 (index of {1,2,4,8,10})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult dio_trig_ready(const string & ip, unsigned int mask0, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(mask0 >= 5u)
+		return invalid_index(0);
+
+	access_caloe batch[] = {
+		{ 0x62344ull, 0x0ull, 0x0ull, (eb_data_t) values[10 + mask0], MASK_AND, 0, READ, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+/** @brief Generate one programmable pulse by one channel of DIO fmc board.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param offset0 Offset of access 0 (index of {0,c,18,24,30})
+ *
+ * @param value0 Value of access 0
+ *
+ * @param offset1 Offset of access 1 (index of {0,c,18,24,30})
+ *
+ * @param value1 Value of access 1
+ *
+ * @param offset2 Offset of access 2 (index of {0,c,18,24,30})
+ *
+ * @param value2 Value of access 2
+ *
+ * @param offset3 Offset of access 3 (index of {0,4,8,c,10})
+ *
+ * @param value3 Value of access 3
+ *
+ * @param mask4 Mask of access 4 (index of {1,2,4,8,10})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult dio_pulse_prog(const string & ip, unsigned int offset0, eb_data_t value0, unsigned int offset1, eb_data_t value1, unsigned int offset2, eb_data_t value2, unsigned int offset3, eb_data_t value3, unsigned int mask4, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(offset0 >= 5u)
+		return invalid_index(0);
+
+	if(offset1 >= 5u)
+		return invalid_index(1);
+
+	if(offset2 >= 5u)
+		return invalid_index(2);
+
+	if(offset3 >= 5u)
+		return invalid_index(3);
+
+	if(mask4 >= 5u)
+		return invalid_index(4);
+
+	access_caloe batch[] = {
+		{ 0x62300ull, (eb_address_t) values[15 + offset0], value0, 0x0ull, MASK_OR, 0, WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x62304ull, (eb_address_t) values[20 + offset1], value1, 0xffull, MASK_AND, 0, WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x62308ull, (eb_address_t) values[25 + offset2], value2, 0xfffffffull, MASK_AND, 0, WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x62348ull, (eb_address_t) values[30 + offset3], value3, 0x0ull, MASK_OR, 0, WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x62340ull, 0x0ull, 0xffffffffull, (eb_data_t) values[35 + mask4], MASK_AND, 0, WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,5,policy);
+}
+
+/** @brief Scans SDB block in SPEC board.
+ *
+ * @param dev Device loaded with load
+ *
+ * @param ip IP netaddress
+ *
+ * @return Read values
+ */
+
+static inline vector<eb_data_t> scan_root(Device & dev, const string & ip) {
+	OperationHandle handle = { -1, OP_SCAN_ROOT };
+	ParamOperation params;
+	ParamAccess p;
+
+	p.reset();
+	p.setIP(ip);
+	params.addParameter(p);
+
+	return dev.execute(handle,params);
+}
+
+/** @brief Check if fifo is full.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param offset0 Offset of access 0 (index of {0,10,20,30,40})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult fifo_isfull(const string & ip, unsigned int offset0, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(offset0 >= 5u)
+		return invalid_index(0);
+
+	access_caloe batch[] = {
+		{ 0x6237cull, (eb_address_t) values[40 + offset0], 0x0ull, 0x10000ull, MASK_AND, 0, READ, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+/** @brief Check if fifo is empty.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param offset0 Offset of access 0 (index of {0,10,20,30,40})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult fifo_isempty(const string & ip, unsigned int offset0, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(offset0 >= 5u)
+		return invalid_index(0);
+
+	access_caloe batch[] = {
+		{ 0x6237cull, (eb_address_t) values[45 + offset0], 0x0ull, 0x20000ull, MASK_AND, 0, READ, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+/** @brief Returns number of timestamp in fifo.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param offset0 Offset of access 0 (index of {0,10,20,30,40})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult fifo_nfilled(const string & ip, unsigned int offset0, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(offset0 >= 5u)
+		return invalid_index(0);
+
+	access_caloe batch[] = {
+		{ 0x6237cull, (eb_address_t) values[50 + offset0], 0x0ull, 0xffull, MASK_AND, 0, READ, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+/** @brief Returns a timestamp from FIFO.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param offset0 Offset of access 0 (index of {0,10,20,30,40})
+ *
+ * @param offset1 Offset of access 1 (index of {0,10,20,30,40})
+ *
+ * @param offset2 Offset of access 2 (index of {0,10,20,30,40})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult fifo_value(const string & ip, unsigned int offset0, unsigned int offset1, unsigned int offset2, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(offset0 >= 5u)
+		return invalid_index(0);
+
+	if(offset1 >= 5u)
+		return invalid_index(1);
+
+	if(offset2 >= 5u)
+		return invalid_index(2);
+
+	access_caloe batch[] = {
+		{ 0x62370ull, (eb_address_t) values[55 + offset0], 0x0ull, 0x0ull, MASK_OR, 0, READ, SIZE_4B, 0, 1, { endpoint0 } },
+		{ 0x62374ull, (eb_address_t) values[60 + offset1], 0x0ull, 0xffull, MASK_AND, 0, READ, SIZE_4B, 0, 1, { endpoint0 } },
+		{ 0x62378ull, (eb_address_t) values[65 + offset2], 0x0ull, 0xfffffffull, MASK_AND, 0, READ, SIZE_4B, 0, 1, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,3,policy);
+}
+
+/** @brief Configures a channel as an Input.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param mask0 Mask of access 0 (index of {fffffffc,ffffffcf,fffffcff,ffffcfff,fffcffff})
+ *
+ * @param mask1 Mask of access 1 (index of {1,10,100,1000,10000})
+ *
+ * @param mask2 Mask of access 2 (index of {4,40,400,4000,40000})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult config_channel_I(const string & ip, unsigned int mask0, unsigned int mask1, unsigned int mask2, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(mask0 >= 5u)
+		return invalid_index(0);
+
+	if(mask1 >= 5u)
+		return invalid_index(1);
+
+	if(mask2 >= 5u)
+		return invalid_index(2);
+
+	access_caloe batch[] = {
+		{ 0x6233cull, 0x0ull, 0x0ull, (eb_data_t) values[70 + mask0], MASK_AND, 0, READ_WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x6233cull, 0x0ull, 0x0ull, (eb_data_t) values[75 + mask1], MASK_OR, 0, READ_WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x6233cull, 0x0ull, 0x0ull, (eb_data_t) values[80 + mask2], MASK_OR, 0, READ_WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,3,policy);
+}
+
+/** @brief Configures a channel as an Output.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param mask0 Mask of access 0 (index of {fffffffc,ffffffcf,fffffcff,ffffcfff,fffcffff})
+ *
+ * @param mask1 Mask of access 1 (index of {1,10,100,1000,10000})
+ *
+ * @param mask2 Mask of access 2 (index of {fffffffb,ffffffbf,fffffbff,ffffbfff,fffbffff})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult config_channel_O(const string & ip, unsigned int mask0, unsigned int mask1, unsigned int mask2, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(mask0 >= 5u)
+		return invalid_index(0);
+
+	if(mask1 >= 5u)
+		return invalid_index(1);
+
+	if(mask2 >= 5u)
+		return invalid_index(2);
+
+	access_caloe batch[] = {
+		{ 0x6233cull, 0x0ull, 0x0ull, (eb_data_t) values[85 + mask0], MASK_AND, 0, READ_WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x6233cull, 0x0ull, 0x0ull, (eb_data_t) values[90 + mask1], MASK_OR, 0, READ_WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+		{ 0x6233cull, 0x0ull, 0x0ull, (eb_data_t) values[95 + mask2], MASK_AND, 0, READ_WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,3,policy);
+}
+
+/** @brief Configures a channel with a resistor termination.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param mask0 Mask of access 0 (index of {8,80,800,8000,80000})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult config_channel_R(const string & ip, unsigned int mask0, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(mask0 >= 5u)
+		return invalid_index(0);
+
+	access_caloe batch[] = {
+		{ 0x6233cull, 0x0ull, 0x0ull, (eb_data_t) values[100 + mask0], MASK_OR, 0, READ_WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+/** @brief Configures a channel without a resistor termination.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param mask0 Mask of access 0 (index of {fffffff7,ffffff7f,fffff7ff,ffff7fff,fff7ffff})
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult config_channel_without_R(const string & ip, unsigned int mask0, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	if(mask0 >= 5u)
+		return invalid_index(0);
+
+	access_caloe batch[] = {
+		{ 0x6233cull, 0x0ull, 0x0ull, (eb_data_t) values[105 + mask0], MASK_AND, 0, READ_WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+/** @brief Return configuration of each channel.
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult show_config_channels(const string & ip, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	access_caloe batch[] = {
+		{ 0x6233cull, 0x0ull, 0x0ull, 0xfffffull, MASK_AND, 0, READ, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+}
+
+#endif
@@ -28,26 +28,53 @@
  */
  
 #include "Vuart.h"
+#include "vuart_cfg.h"
 
 Vuart::Vuart() {
-	// it loads vuart configuration file
-	vuart.loadCfgFile("vuart.cfg","vuart");
+	// it loads vuart operations built into the program (generated from vuart.cfg)
+	vuart_cfg::load(vuart,"vuart");
+	resolveHandles();
 }
 
 Vuart::Vuart(const Vuart & vuart) {
 	this->vuart = vuart.vuart;
+	resolveHandles();
 }
 
 Vuart::Vuart(string config_path) {
 	vuart.loadCfgFile(config_path,"vuart");
+	resolveHandles();
 }
 
 Vuart & Vuart::operator=(const Vuart & vuart) {
 	this->vuart = vuart.vuart;
+	resolveHandles();
 	
 	return *this;
 }
 
+void Vuart::resolveHandles() {
+	// Reads and writes of characters skip the operation name lookup
+	op_ready = vuart.getHandle("vuart_ready");
+	op_read = vuart.getHandle("vuart_read");
+	op_write = vuart.getHandle("vuart_write");
+}
+
+vector<eb_data_t> Vuart::executeChecked(const OperationHandle & handle, ParamOperation & params, unsigned int nvalues) {
+	RetryPolicy policy;
+	OperationResult res;
+	
+	res = vuart.execute(handle,params,policy);
+	
+	// A failed operation returns the values read before the failure, so they can not be used
+	if(res.rcode != ALL_OK || res.values.size() < nvalues) {
+		cout << "ERROR: Vuart operation failed (" << res.rcode << ")" << endl;
+		res.values.clear();
+	}
+	
+	return res.values;
+}
+
 void Vuart::print() {
 	// it prints operation table of vuart device
 	cout << vuart;
@@ -72,15 +99,13 @@ bool Vuart::isReady(string ip) {
 	 * Search and execute vuart_ready operation to check if vuart is ready
 	 */
 	 
-	res = vuart.execute("vuart_ready",params);
+	res = executeChecked(op_ready,params,1);
 	
 	/*
-	 * Read operation result and set flag 
+	 * Read operation result and set flag (not ready if the operation failed)
 	 */
 	 
-	int data = res.at(0);
-
-	if (data == 0) {
+	if (!res.empty() && res.at(0) == 0) {
 		ready = true;
 	}
 	else {
@@ -114,9 +139,10 @@ char Vuart::read(string ip, bool & valid) {
 	 * Search and execute vuart_read to get a character from vuart
 	 */
 	 
-	res = vuart.execute("vuart_read",params);
+	res = executeChecked(op_read,params,1);
 
-	value = res.at(0);
+	// No valid data if the operation failed
+	value = res.empty() ? 0 : res.at(0);
 
 	/*
 	 * Read operation result and set flag (to confirm a valid data or not)
@@ -152,7 +178,7 @@ void Vuart::write(string ip, char value) {
 	 * Search and execute vuart_write to write a character to vuart
 	 */
 	 
-	vuart.execute("vuart_write",params);
+	executeChecked(op_write,params,0);
 }
 
 string Vuart::readString(string ip, unsigned long period) {
@@ -180,11 +206,20 @@ string Vuart::readString(string ip, unsigned long period) {
 		 
 void Vuart::writeString(string ip, string s, unsigned long period) {
 	string::iterator it;
+	ParamOperation params;
+	ParamAccess param;
+	
+	param.setIP(ip);
+	params.addParameter(param);
 	
 	// For each character in string
 	for(it = s.begin() ; it != s.end() ; it++) {
-		// Wait until vuart is ready
-		while(!isReady(ip)) {}
+		// Wait until vuart is ready (busy bit cleared), a dead board must not hang the caller
+		if(vuart.waitUntil(op_ready,params,0,VUART_READY_TIMEOUT) != ALL_OK) {
+			cout << "ERROR: Vuart is not ready, " << (s.end() - it) << " characters not written" << endl;
+			return;
+		}
+		
 		// Write character
 		write(ip,*it);
 			
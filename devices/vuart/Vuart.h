@@ -32,6 +32,9 @@
 #include <iostream>
 #include <unistd.h>
 
+/// Max time (us) to wait for the vuart to be ready to write a character
+#define VUART_READY_TIMEOUT 1000000
+
 using namespace std;
 using namespace caloe;
 
@@ -43,9 +46,29 @@ class Vuart {
 	private:
 		/// Device operations
 		Device vuart;
+		
+		/// Handles of the operations used by reads and writes (resolved once)
+		OperationHandle op_ready, op_read, op_write;
+		
+		/** @brief Resolve the handles of the vuart operations **/
+		
+		void resolveHandles();
+		
+		/** @brief Execute a vuart operation and check its result
+		 *
+		 *  @param handle Operation handle
+		 *
+		 *  @param params User parameters for the operation
+		 *
+		 *  @param nvalues Number of values the operation must read
+		 *
+		 *  @return Read values, empty if the operation failed or read fewer values (the error is printed)
+		 **/
+		
+		vector<eb_data_t> executeChecked(const OperationHandle & handle, ParamOperation & params, unsigned int nvalues);
 
 	public:
-		/** @brief Vuart Default constructor **/
+		/** @brief Vuart Default constructor (operations built into the program, see vuart_cfg.h) **/
 		
 		Vuart();
 		
@@ -119,7 +142,8 @@ class Vuart {
 		 
 		string readString(string ip,unsigned long period);
 		
-		/**  @brief Write a data string to vuart
+		/**  @brief Write a data string to vuart. It stops (and prints an error) if the vuart is not ready
+		 *   to write a character within VUART_READY_TIMEOUT.
 		 * 
 		 *   @param ip Etherbone server Netaddress IP 
 		 * 
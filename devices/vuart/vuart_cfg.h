@@ -0,0 +1,173 @@
+/**
+ *******************************************************************************
+ * @file vuart_cfg.h
+ *  @brief Operations of vuart.cfg built into the program (generated by cfgc_spec.run, do not edit)
+ *
+ *  The tables have the layout of a compiled configuration file (see cfgcache_internals.h). They are
+ *  constant data: loading a device reads and parses nothing. Operations whose accesses have constant
+ *  addresses and widths (no AUTO, BLOCK or SCAN) get wrappers that build their accesses on the stack
+ *  and run them with Operation::executeAccesses, without a device; the rest run through a Device
+ *  loaded with load. Regenerate this file with:
+ *
+ *    cfgc_spec.run -g vuart_cfg.h -n vuart_cfg vuart.cfg
+ *******************************************************************************
+ */
+
+#ifndef VUART_CFG_H
+#define VUART_CFG_H
+
+#include "../../lib/Device.h"
+#include "../../lib/endpoint_internals.h"
+
+using namespace caloe;
+
+namespace vuart_cfg {
+
+/// Operation indices (valid in a device loaded only with load)
+enum operation_index {
+	OP_VUART_READ = 0,
+	OP_VUART_READY = 1,
+	OP_VUART_WRITE = 2,
+	OPERATIONS = 3
+};
+
+/// Accesses: address_init, address, offset, value, mask, autoincr, block, ip, port, offsets, noffsets,
+/// masks, nmasks, mode, align, mask_oper, parameters, flags
+static const cfg_cache_access_caloe accesses[] = {
+	/* vuart_read */
+	{ 0x20514ull, 0x20514ull, 0x0ull, 0x0ull, 0x0ull, 0, 1, 0u, 60368u, 0u, 0u, 0u, 0u, 0, 2, 1, 2, 2, { 0, 0, 0 } },
+	/* vuart_ready */
+	{ 0x20500ull, 0x20500ull, 0x0ull, 0x0ull, 0x2ull, 0, 1, 0u, 60368u, 0u, 0u, 0u, 0u, 0, 2, 0, 2, 0, { 0, 0, 0 } },
+	/* vuart_write */
+	{ 0x20510ull, 0x20510ull, 0x0ull, 0x0ull, 0xffull, 0, 1, 0u, 60368u, 0u, 0u, 0u, 0u, 1, 2, 0, 6, 0, { 0, 0, 0 } },
+};
+
+/// Operations: name, doc, hash, first, naccesses
+static const cfg_cache_operation_caloe operations[] = {
+	{ 1u, 12u, 0xac6caccau, 0u, 1u },
+	{ 36u, 48u, 0x2213ddc9u, 1u, 1u },
+	{ 79u, 91u, 0x7353164du, 2u, 1u },
+};
+
+/// Name index (operation index or -1)
+static const int32_t slots[] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 0, -1, -1, 2, -1, -1
+};
+
+/// Offsets and masks of the accesses
+static const int32_t values[] = {
+	0
+};
+
+/// String pool
+static const char strings[] =
+	"\0"
+	"vuart_read\0"
+	"Read a value from vuart\0"
+	"vuart_ready\0"
+	"Ask if vuart is ready to write\0"
+	"vuart_write\0"
+	"Write a value to vuart\0"
+	;
+
+static const cfg_cache_header_caloe header = {
+	{ 'C', 'A', 'L', 'O', 'E', 'C', 'F', 'G' }, CFG_CACHE_VERSION, CFG_CACHE_ENDIAN, 0x4cbd1b139f2fda71ull, 1602ull,
+	0, 3, 3, 16, 0, 114, 0, 0, 0, 0, 0, 0
+};
+
+static const cfg_cache_caloe image = {
+	(void *) &header, 0, &header, operations, accesses, slots, values, strings
+};
+
+/** @brief Load the operations of vuart_cfg.h into a device (nothing is read or parsed)
+ *
+ * @param dev Device
+ *
+ * @param name Device name
+ */
+
+static inline void load(Device & dev, const string & name) {
+	dev.loadImage(&image,name);
+}
+
+/** @brief Result of a wrapper called with an offset or mask index out of range **/
+
+static inline OperationResult invalid_index(int access) {
+	OperationResult res;
+
+	res.rcode = INVALID_OPERATION;
+	res.failed_access = access;
+	res.retries = 0;
+	res.elapsed = 0;
+
+	return res;
+}
+
+/** @brief Read a value from vuart
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult vuart_read(const string & ip, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	access_caloe batch[] = {
+		{ 0x20514ull, 0x0ull, 0x0ull, 0x0ull, MASK_OR, 0, READ, SIZE_4B, 0, 1, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+/** @brief Ask if vuart is ready to write
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult vuart_ready(const string & ip, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	access_caloe batch[] = {
+		{ 0x20500ull, 0x0ull, 0x0ull, 0x2ull, MASK_AND, 0, READ, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+/** @brief Write a value to vuart
+ *
+ *  Its accesses are constant (addresses, masks, widths): they run directly, without a device.
+ *
+ * @param ip IP netaddress
+ *
+ * @param value0 Value of access 0
+ *
+ * @param policy Retry policy
+ *
+ * @return Read values and error code
+ */
+
+static inline OperationResult vuart_write(const string & ip, eb_data_t value0, const RetryPolicy & policy = RetryPolicy()) {
+	int endpoint0 = register_endpoint_caloe(ip.c_str(),60368u);
+
+	access_caloe batch[] = {
+		{ 0x20510ull, 0x0ull, value0, 0xffull, MASK_AND, 0, WRITE, SIZE_4B, 0, 0, { endpoint0 } },
+	};
+
+	return Operation::executeAccesses(batch,1,policy);
+}
+
+}
+
+#endif
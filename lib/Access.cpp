@@ -41,6 +41,9 @@ Access::Access() {
 	mode = SCAN;
 	align = SIZE_4B;
 	autoincr = 0;
+	block = 1;
+	cacheable = false;
+	side_effects = false;
 }
 
 Access::Access(eb_address_t address, eb_address_t address_init, eb_address_t offset, eb_data_t value, eb_data_t mask, mask_oper_caloe mask_oper, bool is_config, access_type_caloe mode, align_access_caloe align,int autoincr, Netcon networkc) {
@@ -54,6 +57,9 @@ Access::Access(eb_address_t address, eb_address_t address_init, eb_address_t off
 	this->mode = mode;
 	this->align = align;
 	this->autoincr = autoincr;
+	this->block = 1;
+	this->cacheable = false;
+	this->side_effects = false;
 	this->networkc = networkc;
 }
 
@@ -68,6 +74,9 @@ Access::Access(const Access & access) {
 	mode = access.mode;
 	align = access.align;
 	autoincr = access.autoincr;
+	block = access.block;
+	cacheable = access.cacheable;
+	side_effects = access.side_effects;
 	networkc = access.networkc;
 }
 
@@ -82,6 +91,9 @@ Access Access::operator=(const Access & access) {
 	mode = access.mode;
 	align = access.align;
 	autoincr = access.autoincr;
+	block = access.block;
+	cacheable = access.cacheable;
+	side_effects = access.side_effects;
 	networkc = access.networkc;
 
 	return *this;
@@ -127,10 +139,26 @@ int Access::getAutoincr() const {
 	return autoincr;
 }
 
+int Access::getBlock() const {
+	return block;
+}
+
+bool Access::getCacheable() const {
+	return cacheable;
+}
+
+bool Access::getSideEffects() const {
+	return side_effects;
+}
+
 Netcon Access::getNetcon() const {
 	return networkc;
 }
 
+const Netcon & Access::getNetconRef() const {
+	return networkc;
+}
+
 void Access::setAddress(eb_address_t address) {
 	this->address = address;
 }
@@ -171,6 +199,18 @@ void Access::setAutoincr(int autoincr) {
 	this->autoincr = autoincr;
 }
 
+void Access::setBlock(int block) {
+	this->block = block;
+}
+
+void Access::setCacheable(bool cacheable) {
+	this->cacheable = cacheable;
+}
+
+void Access::setSideEffects(bool side_effects) {
+	this->side_effects = side_effects;
+}
+
 void Access::setNetCon(Netcon networkc) {
 	this->networkc = networkc;
 }
@@ -179,19 +219,12 @@ void Access::reset() {
 	address = address_init;
 }
 
-int Access::execute() {
-	access_caloe access;
+void Access::toAccessCaloe(access_caloe * access) const {
 	network_connection nc;
 	int is_config_int;
-	int rcode = ALL_OK;
-
-	char aux[50];
 
-	// Copy IP address to an aux string
-	strcpy(aux,networkc.getIP().c_str());
-
-	// Build an network_connection struct of access_internals
-	build_network_con_full_caloe(aux,networkc.getPort(),&nc);
+	// Endpoint handle of IP address and port (they are only parsed once)
+	nc.endpoint = networkc.getEndpoint();
 
 	// Parsing boolean value to integer
 	if(is_config) {
@@ -201,19 +234,19 @@ int Access::execute() {
 		is_config_int = 0;
 	}
 
-	// Build an access_caloe struct of access_internals
-	build_access_caloe(address,offset,value,mask,mask_oper,is_config_int,mode,align,&nc,&access);
-	
-	// Execute the access_caloe struct
-	rcode = execute_caloe(&access);
+	// Build an access_caloe struct of access_internals (it keeps its own copy of nc)
+	build_access_caloe(address,offset,value,mask,mask_oper,is_config_int,mode,align,&nc,access);
+	access->cacheable = (cacheable ? 1 : 0);
+	access->side_effects = (side_effects ? 1 : 0);
 
+	free_network_con_caloe(&nc);
+}
+
+void Access::fromAccessCaloe(const access_caloe * access, int count) {
 	// If access type is READ, store read value
 	if(mode == READ) {
-		value = access.value;
+		value = access->value;
 	}
-
-	// Free access_caloe and network_connection memory
-	free_access_caloe(&access);
 	
 	// Parsing alignment to integer
 	int align_v;
@@ -230,208 +263,44 @@ int Access::execute() {
 	};
 	
 	// Update address with autoincr value 
-	address += (autoincr*align_v);
-
-	return rcode;
+	address += (autoincr*align_v*count);
 }
 
-ParamConfig Access::loadAccessCfgFile(ifstream & file) {
-	ParamConfig param;
-	
-	string line;
-	int found;
-	
-	string EACT("EACTION");
-	string NET("NET");
-	string PORT("PORT");
-	string MASK("MASK");
-	string MSKNEG("MSKNEG");
-	string MSKPOS("MSKPOS");
-	string ALIGN("ALIGN");
-	string MODE("MODE");
-	string ADDRESS("ADDRESS");
-	string VALUE("VALUE");
-	string OFFSET("OFFSET");
-	string AUTO("AUTO");
-	
-	bool end = false;
-	char lc;
-	char fc;
-	
-	while (file.good() && !file.eof() && !end) {
-		
-		line = "";
+int Access::execute() {
+	access_caloe access;
+	int rcode = ALL_OK;
 
-		file >> line;
+	toAccessCaloe(&access);
 	
-		lc = *(line.end()-1);
-		fc = *(line.begin());
-		
-		if(!line.empty() && fc != '#') {
-			if((found = line.find(EACT)) != -1) {
-				end = true;
-			}
-			
-			if((found = line.find(NET)) != -1) {
-				
-				if(lc == 'P') {
-					param.setIPParam();
-					//cout << "NETP found!"<<endl;
-				}
-				else {
-					file >> line;
-					networkc.setIP(line);
-					//cout << "NET found! "<<line<<endl;
-				}
-			}
-			
-			if((found = line.find(PORT)) != -1) {
-				if(lc == 'P') {
-					param.setPortParam();
-					//cout << "PORTP found!"<<endl;
-				}
-				else {
-					unsigned int port;
-					file >> line;
-					sscanf (line.c_str(),"%u",&port);
-					networkc.setPort(port);
-					//cout << "PORT found! "<<port<<endl;
-				}
-			}
-			
-			if((found = line.find(MASK)) != -1) {
-				if(lc == 'P') {
-					file >> line;
-					line.erase(line.begin());
-					line.erase(line.end()-1);
-					param.setMasksString(line);
-					//cout << "MASKP found! "<<line<<endl;
-				}
-				else {
-					int mask;
-					file >> line;
-					sscanf (line.c_str(),"%x",&mask);
-					this->mask = mask;
-					//cout << "MASK found! "<<hex<<mask<<endl;
-				}
-			}
-			
-			if((found = line.find(MSKNEG)) != -1) {
-				this->mask_oper = MASK_AND;
-				//cout << "MASK AND found! "<<endl;
-			}
-			
-			if((found = line.find(MSKPOS)) != -1) {
-				this->mask_oper = MASK_OR;
-				//cout << "MASK OR found! "<<endl;
-			}
-			
-			if((found = line.find(ALIGN)) != -1) {
-				unsigned int align;
-				align_access_caloe align_v;
-				
-				file >> line;
-				
-				sscanf (line.c_str(),"%u",&align);
-				
-				switch(align) {
-					case 1: align_v = SIZE_1B;
-					break;
-					
-					case 2: align_v = SIZE_2B;
-					break;
-					
-					case 4: align_v = SIZE_4B;
-					break;
-					
-					case 8: align_v = SIZE_8B;
-					break;
-					
-					default: align_v = SIZE_4B;
-					break;
-				}
-				
-				this->align = align_v;
-				//cout << "ALIGN found! "<<align<<endl;
-			}
-			
-			if((found = line.find(MODE)) != -1) {
-				char mode;
-				access_type_caloe mode_v;
-				
-				file >> line;
-				
-				mode = line.at(0);
-				
-				switch(mode) {
-					case 'R': mode_v = READ;
-					break;
-					case 'W': mode_v = WRITE;
-					break;
-					case 'S': mode_v = SCAN;
-					break;
-					case 'C': mode_v = READ_WRITE;
-					break;
-					default: mode_v = SCAN;
-					break;
-				}
-				
-				this->mode = mode_v;
-				//cout << "MODE found! "<<mode<<endl;
-			}
-			
-			if((found = line.find(ADDRESS)) != -1) {
-				int address;
-				file >> line;
-				sscanf (line.c_str(),"%x",&address);
-				
-				this->address = address;
-				this->address_init = address;
-				//cout << "ADDRESS found! "<<hex<<address<<endl;
-			}
-			
-			if((found = line.find(VALUE)) != -1) {
-				if(lc == 'P') {
-					param.setValueParam();
-					//cout << "VALUEP found! "<<endl;
-				}
-				else {
-					int value;
-					file >> line;
-					sscanf (line.c_str(),"%x",&value);
-					
-					this->value = value;
-					//cout << "VALUE found! "<<hex<<value<<endl;
-				}
-			}
-			
-			if((found = line.find(OFFSET)) != -1) {
-					file >> line;
-					line.erase(line.begin());
-					line.erase(line.end()-1);
-					
-					param.setOffsetsString(line);
-					//cout << "OFFSET found! "<<line<<endl;
-			}
-			
-			if((found = line.find(AUTO)) != -1) {
-				int autoincr;
-				file >> line;
-				sscanf (line.c_str(),"%d",&autoincr);
-				this->autoincr = autoincr;
-				//cout << "AUTO found! "<<autoincr<<endl;
-			}
-			
-		}
-		else {
-			if (fc == '#')
-				getline(file,line);
-		}
-	}
-	
-	return param;
+	// Execute the access_caloe struct
+	rcode = execute_caloe(&access);
+
+	fromAccessCaloe(&access);
+
+	// Free access_caloe memory
+	free_access_caloe(&access);
+
+	return rcode;
 }
 
+int Access::readBlock(eb_data_t * buffer) {
+	access_caloe access;
+	int rcode;
+
+	toAccessCaloe(&access);
+
+	rcode = read_block_caloe(&access,autoincr,block,buffer);
+
+	// The last word is kept as the access value
+	if(rcode == ALL_OK)
+		access.value = buffer[block-1];
+
+	fromAccessCaloe(&access,block);
+
+	free_access_caloe(&access);
+
+	return rcode;
+}
 
 ostream & operator<<(ostream & os, Access & access) {
 	os << "Address: 0x"<< hex << access.address<<endl;
@@ -482,6 +351,15 @@ ostream & operator<<(ostream & os, Access & access) {
 		break;
 	}
 
+	if(access.block > 1)
+		os << "Block: " << dec << access.block << " words"<<endl;
+
+	if(access.cacheable)
+		os << "=> Cacheable register"<<endl;
+
+	if(access.side_effects)
+		os << "=> Reads with side effects"<<endl;
+
 	os << access.networkc;
 
 	return os;
@@ -83,6 +83,18 @@ class Access {
 		
 		int autoincr;
 		
+		/// Number of words of a block read (1: single access)
+		
+		int block;
+		
+		/// Register only changes through this library (it can be served from the shadow cache) or it is volatile
+		
+		bool cacheable;
+		
+		/// Reads change the register (e.g. FIFO pops): they are never coalesced
+		
+		bool side_effects;
+		
 		/// Network connection parameters
 		
 		Netcon networkc;
@@ -153,10 +165,26 @@ class Access {
 		
 		int getAutoincr() const;
 		
+		/** @brief Get number of words of a block read (1: single access) **/
+		
+		int getBlock() const;
+		
+		/** @brief Get if the register is cacheable (true) or volatile (false) **/
+		
+		bool getCacheable() const;
+		
+		/** @brief Get if reads of the register have side effects (they are never coalesced) **/
+		
+		bool getSideEffects() const;
+		
 		/** @brief Get network connection parameters **/
 		
 		Netcon getNetcon() const;
 		
+		/** @brief Get network connection parameters (without copy) **/
+		
+		const Netcon & getNetconRef() const;
+		
 		/** @brief Set init memory address
 		 * 
 		 * @param address_init Init Memory address 
@@ -227,6 +255,30 @@ class Access {
 		 
 		void setAutoincr(int autoincr);
 		
+		/** @brief Set number of words of a block read. Word i is read from address + i*autoincr
+		 *  (AUTO 1 reads consecutive words, AUTO 0 reads the same register block times)
+		 * 
+		 * @param block Number of words (1: single access)
+		 **/
+		 
+		void setBlock(int block);
+		
+		/** @brief Set if the register is cacheable or volatile. Reads and read-modify-writes of a cacheable
+		 *  register are served from the last value written or read, and writes that do not change it are not sent.
+		 * 
+		 * @param cacheable Cacheable (true) or volatile (false, default)
+		 **/
+		 
+		void setCacheable(bool cacheable);
+		
+		/** @brief Set if reads of the register have side effects (e.g. FIFO pops). Other reads of a
+		 *  register are coalesced: it is read once and the mask of each read is applied locally.
+		 * 
+		 * @param side_effects Reads have side effects (true) or not (false, default)
+		 **/
+		 
+		void setSideEffects(bool side_effects);
+		
 		/** @brief Set network connection parameters
 		 * 
 		 * @param networkc Network connection parameters
@@ -247,14 +299,31 @@ class Access {
 		 
 		int execute();
 		
-		/** @brief it loads an access from the input configuration file
+		/** @brief Execute a block read access (see setBlock). Reads are packed in windowed
+		 *  Etherbone cycles and the address is moved forward block times its autoincrement.
+		 * 
+		 * @param buffer Returned values (getBlock() words)
+		 * 
+		 * @return ALL_OK if success or error code otherwise
+		 **/
+		 
+		int readBlock(eb_data_t * buffer);
+		
+		/** @brief Fill an access_caloe struct with the access information (free it with free_access_caloe)
+		 * 
+		 * @param access access_caloe struct to fill
+		 **/
+		 
+		void toAccessCaloe(access_caloe * access) const;
+		
+		/** @brief Update the access after its access_caloe struct has been executed (read value and autoincrement)
 		 * 
-		 * @param file Input stream
+		 * @param access Executed access_caloe struct
 		 * 
-		 * @return Needed parameters for the access
+		 * @param count Number of times the access has been executed (words of a block read)
 		 **/
 		 
-		ParamConfig loadAccessCfgFile(ifstream & file);
+		void fromAccessCaloe(const access_caloe * access, int count = 1);
 		
 		/** @brief Print Access information
 		 * 
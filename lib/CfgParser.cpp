@@ -0,0 +1,481 @@
+/**
+ *******************************************************************************
+ * @file CfgParser.cpp
+ *  @brief Configuration file parser class source file
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "CfgParser.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+namespace caloe {
+
+/// Keyword names (in cfg_keyword_caloe order)
+static const char * keyword_names[] = {
+	"BOPERATION", "EOPERATION", "NAME", "DOC", "BACTION", "EACTION",
+	"NET", "NETP", "PORT", "PORTP", "ADDRESS", "VALUE", "VALUEP",
+	"MASK", "MASKP", "OFFSET", "MSKNEG", "MSKPOS", "ALIGN", "MODE",
+	"AUTO", "BLOCK", "CACHEABLE", "VOLATILE", "SIDEEFFECTS"
+};
+
+static bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static string line_string(int line) {
+	ostringstream os;
+
+	os << line;
+
+	return os.str();
+}
+
+CfgParser::CfgParser(const string & path) {
+	ifstream ifs;
+	ostringstream contents;
+
+	this->path = path;
+	pos = 0;
+	line = 1;
+	token_pos = 0;
+	token_line = 1;
+	errors = 0;
+
+	for(unsigned int i = 0 ; i < sizeof(keyword_names)/sizeof(keyword_names[0]) ; i++)
+		keywords.insert(keyword_names[i],i);
+
+	ifs.open(path.c_str(), ifstream::in);
+
+	if(!ifs.good()) {
+		error(0,"Could not open the file");
+		return;
+	}
+
+	// The whole file is read at once, tokens are taken from memory
+	contents << ifs.rdbuf();
+	text = contents.str();
+
+	ifs.close();
+}
+
+bool CfgParser::nextToken(string & token) {
+	unsigned int begin;
+
+	while(pos < text.size()) {
+		if(text[pos] == '\n') {
+			line++;
+			pos++;
+		}
+		else if(is_blank(text[pos])) {
+			pos++;
+		}
+		else if(text[pos] == '#') {
+			// Comment until the end of the line
+			while(pos < text.size() && text[pos] != '\n')
+				pos++;
+		}
+		else {
+			break;
+		}
+	}
+
+	if(pos >= text.size())
+		return false;
+
+	token_pos = pos;
+	token_line = line;
+
+	begin = pos;
+
+	while(pos < text.size() && !is_blank(text[pos]))
+		pos++;
+
+	token.assign(text,begin,pos-begin);
+
+	return true;
+}
+
+void CfgParser::unread() {
+	pos = token_pos;
+	line = token_line;
+}
+
+string CfgParser::restOfLine() {
+	unsigned int begin;
+	unsigned int end;
+
+	while(pos < text.size() && text[pos] != '\n' && is_blank(text[pos]))
+		pos++;
+
+	begin = pos;
+
+	while(pos < text.size() && text[pos] != '\n')
+		pos++;
+
+	end = pos;
+
+	while(end > begin && is_blank(text[end-1]))
+		end--;
+
+	return text.substr(begin,end-begin);
+}
+
+cfg_keyword_caloe CfgParser::keyword(const string & token) const {
+	return (cfg_keyword_caloe) keywords.find(token);
+}
+
+void CfgParser::error(int line, const string & msg) {
+	errors++;
+
+	cout << "ERROR: " << path << ":" << line << ": " << msg << endl;
+}
+
+bool CfgParser::readValue(const string & name, string & value) {
+	int kw_line = token_line;
+
+	// Values are on the same line as their keyword
+	if(nextToken(value)) {
+		if(token_line == kw_line && keyword(value) == KW_NONE)
+			return true;
+
+		unread();
+	}
+
+	error(kw_line,"Missing value of " + name);
+
+	return false;
+}
+
+bool CfgParser::readHex(const string & name, unsigned long long & value) {
+	string token;
+	char * end;
+
+	if(!readValue(name,token))
+		return false;
+
+	value = strtoull(token.c_str(),&end,16);
+
+	if(*end != '\0') {
+		error(token_line,"Invalid hexadecimal value '" + token + "' of " + name);
+		return false;
+	}
+
+	return true;
+}
+
+bool CfgParser::readInt(const string & name, long & value) {
+	string token;
+	char * end;
+
+	if(!readValue(name,token))
+		return false;
+
+	value = strtol(token.c_str(),&end,10);
+
+	if(*end != '\0') {
+		error(token_line,"Invalid decimal value '" + token + "' of " + name);
+		return false;
+	}
+
+	return true;
+}
+
+bool CfgParser::readList(const string & name, vector<int> & list) {
+	string token;
+	const char * p;
+	char * end;
+
+	if(!readValue(name,token))
+		return false;
+
+	if(token.size() < 2 || token[0] != '{' || token[token.size()-1] != '}') {
+		error(token_line,"Invalid list '" + token + "' of " + name + " ({hex,hex,...} expected)");
+		return false;
+	}
+
+	list.clear();
+
+	p = token.c_str() + 1;
+
+	while(*p != '}') {
+		list.push_back((int) strtoul(p,&end,16));
+
+		if(end == p || (*end != ',' && *end != '}')) {
+			error(token_line,"Invalid list '" + token + "' of " + name + " ({hex,hex,...} expected)");
+			return false;
+		}
+
+		p = (*end == ',' ? end + 1 : end);
+	}
+
+	return true;
+}
+
+bool CfgParser::parseAccess(Access & access, ParamConfig & param, int begin) {
+	string token;
+	string value;
+	Netcon nc;
+	unsigned long long hex;
+	long num;
+	vector<int> list;
+
+	while(nextToken(token)) {
+		switch(keyword(token)) {
+			case KW_EACTION:
+				access.setNetCon(nc);
+				return true;
+
+			case KW_NET:
+				if(!readValue(token,value))
+					return false;
+				nc.setIP(value);
+			break;
+
+			case KW_NETP: param.setIPParam();
+			break;
+
+			case KW_PORT:
+				if(!readInt(token,num))
+					return false;
+				nc.setPort(num);
+			break;
+
+			case KW_PORTP: param.setPortParam();
+			break;
+
+			case KW_ADDRESS:
+				if(!readHex(token,hex))
+					return false;
+				access.setAddress(hex);
+				access.setAddressInit(hex);
+			break;
+
+			case KW_VALUE:
+				if(!readHex(token,hex))
+					return false;
+				access.setValue(hex);
+			break;
+
+			case KW_VALUEP: param.setValueParam();
+			break;
+
+			case KW_MASK:
+				if(!readHex(token,hex))
+					return false;
+				access.setMask(hex);
+			break;
+
+			case KW_MASKP:
+				if(!readList(token,list))
+					return false;
+				param.setMasksParam(list);
+			break;
+
+			case KW_OFFSET:
+				if(!readList(token,list))
+					return false;
+				param.setOffsetsParam(list);
+			break;
+
+			case KW_MSKNEG: access.setMaskOper(MASK_AND);
+			break;
+
+			case KW_MSKPOS: access.setMaskOper(MASK_OR);
+			break;
+
+			case KW_ALIGN:
+				if(!readInt(token,num))
+					return false;
+
+				switch(num) {
+					case 1: access.setAlign(SIZE_1B);
+					break;
+					case 2: access.setAlign(SIZE_2B);
+					break;
+					case 4: access.setAlign(SIZE_4B);
+					break;
+					case 8: access.setAlign(SIZE_8B);
+					break;
+					default:
+						error(token_line,"Invalid ALIGN (1, 2, 4 or 8 expected)");
+						return false;
+				}
+			break;
+
+			case KW_MODE:
+				if(!readValue(token,value))
+					return false;
+
+				if(value == "R")
+					access.setMode(READ);
+				else if(value == "W")
+					access.setMode(WRITE);
+				else if(value == "S")
+					access.setMode(SCAN);
+				else if(value == "C")
+					access.setMode(READ_WRITE);
+				else {
+					error(token_line,"Invalid MODE '" + value + "' (R, W, S or C expected)");
+					return false;
+				}
+			break;
+
+			case KW_AUTO:
+				if(!readInt(token,num))
+					return false;
+				access.setAutoincr(num);
+			break;
+
+			case KW_BLOCK:
+				if(!readInt(token,num))
+					return false;
+				access.setBlock(num > 0 ? num : 1);
+			break;
+
+			case KW_CACHEABLE: access.setCacheable(true);
+			break;
+
+			case KW_VOLATILE: access.setCacheable(false);
+			break;
+
+			case KW_SIDEEFFECTS: access.setSideEffects(true);
+			break;
+
+			case KW_BOPERATION:
+			case KW_EOPERATION:
+			case KW_BACTION:
+				unread();
+				error(begin,"EACTION expected before " + token + " (line " + line_string(token_line) + ")");
+				return false;
+
+			default:
+				error(token_line,"Unknown keyword '" + token + "' in BACTION");
+				return false;
+		}
+	}
+
+	error(begin,"EACTION expected before the end of the file");
+
+	return false;
+}
+
+bool CfgParser::parseOperation(Operation & op, int begin) {
+	string token;
+	string value;
+	bool named = false;
+
+	while(nextToken(token)) {
+		switch(keyword(token)) {
+			case KW_EOPERATION:
+				if(!named) {
+					error(begin,"Operation without NAME");
+					return false;
+				}
+				return true;
+
+			case KW_NAME:
+				if(!readValue(token,value))
+					return false;
+				op.setName(value);
+				named = true;
+			break;
+
+			case KW_DOC: op.setDoc(restOfLine());
+			break;
+
+			case KW_BACTION: {
+				Access a;
+				ParamConfig p;
+
+				if(!parseAccess(a,p,token_line))
+					return false;
+
+				op.addAccess(a,p);
+			}
+			break;
+
+			case KW_BOPERATION:
+				unread();
+				error(begin,"EOPERATION expected before BOPERATION (line " + line_string(token_line) + ")");
+				return false;
+
+			default:
+				error(token_line,"Unknown keyword '" + token + "' in BOPERATION");
+				return false;
+		}
+	}
+
+	error(begin,"EOPERATION expected before the end of the file");
+
+	return false;
+}
+
+void CfgParser::recover() {
+	string token;
+
+	while(nextToken(token)) {
+		cfg_keyword_caloe kw = keyword(token);
+
+		if(kw == KW_EOPERATION)
+			return;
+
+		if(kw == KW_BOPERATION) {
+			unread();
+			return;
+		}
+	}
+}
+
+bool CfgParser::next(Operation & op) {
+	string token;
+
+	while(nextToken(token)) {
+		if(keyword(token) != KW_BOPERATION) {
+			error(token_line,"BOPERATION expected, found '" + token + "'");
+			recover();
+			continue;
+		}
+
+		// The operation is filled in place (no copy of its accesses)
+		op = Operation();
+
+		if(parseOperation(op,token_line))
+			return true;
+
+		cout << "IGNORING..." << endl;
+		recover();
+	}
+
+	return false;
+}
+
+int CfgParser::getErrors() const {
+	return errors;
+}
+
+CfgParser::~CfgParser() {}
+
+}
@@ -0,0 +1,237 @@
+/**
+ *******************************************************************************
+ * @file CfgParser.h
+ *  @brief Configuration file parser class header file
+ *
+ *  Grammar of the configuration files (# starts a comment until the end of the line):
+ *
+ *    file      := { BOPERATION operation EOPERATION }
+ *    operation := { NAME word | DOC text | BACTION access EACTION }
+ *    access    := { NET ip | NETP | PORT n | PORTP | ADDRESS hex | VALUE hex | VALUEP |
+ *                   MASK hex | MASKP {hex,...} | OFFSET {hex,...} | MSKNEG | MSKPOS |
+ *                   ALIGN 1|2|4|8 | MODE R|W|S|C | AUTO n | BLOCK n |
+ *                   CACHEABLE | VOLATILE | SIDEEFFECTS }
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef CFG_PARSER_CALOE_H
+#define CFG_PARSER_CALOE_H
+
+#include "Operation.h"
+#include "NameIndex.h"
+
+using namespace std;
+
+namespace caloe {
+
+/// Keywords of the configuration files
+enum cfg_keyword_caloe {
+	KW_NONE = -1,
+	KW_BOPERATION,
+	KW_EOPERATION,
+	KW_NAME,
+	KW_DOC,
+	KW_BACTION,
+	KW_EACTION,
+	KW_NET,
+	KW_NETP,
+	KW_PORT,
+	KW_PORTP,
+	KW_ADDRESS,
+	KW_VALUE,
+	KW_VALUEP,
+	KW_MASK,
+	KW_MASKP,
+	KW_OFFSET,
+	KW_MSKNEG,
+	KW_MSKPOS,
+	KW_ALIGN,
+	KW_MODE,
+	KW_AUTO,
+	KW_BLOCK,
+	KW_CACHEABLE,
+	KW_VOLATILE,
+	KW_SIDEEFFECTS
+};
+
+/** @brief Single pass parser of a configuration file. The file is read once and split into tokens,
+ *  keywords are matched as whole tokens. Errors are printed with the file name and line number.
+ **/
+
+class CfgParser {
+	private:
+
+		/// Path of the configuration file
+
+		string path;
+
+		/// Contents of the file
+
+		string text;
+
+		/// Position of the next character
+
+		unsigned int pos;
+
+		/// Line of the next character
+
+		int line;
+
+		/// Position of the last token (see unread)
+
+		unsigned int token_pos;
+
+		/// Line of the last token
+
+		int token_line;
+
+		/// Number of errors found
+
+		int errors;
+
+		/// Hashed index of the keywords
+
+		NameIndex keywords;
+
+		/** @brief Parsers are not copied nor assigned (declared but not defined) **/
+
+		CfgParser(const CfgParser & parser);
+
+		CfgParser operator=(const CfgParser & parser);
+
+		/** @brief Read the next token (comments are skipped)
+		 *
+		 * @param token Token read
+		 *
+		 * @return true if a token is read or false at the end of the file
+		 */
+
+		bool nextToken(string & token);
+
+		/** @brief Put back the last token (it will be read again) **/
+
+		void unread();
+
+		/** @brief Read the rest of the current line (without surrounding blanks) **/
+
+		string restOfLine();
+
+		/** @brief Get the keyword of a token
+		 *
+		 * @param token Token
+		 *
+		 * @return Keyword or KW_NONE if the token is not a keyword
+		 */
+
+		cfg_keyword_caloe keyword(const string & token) const;
+
+		/** @brief Print an error of the file
+		 *
+		 * @param line Line of the error
+		 *
+		 * @param msg Error message
+		 */
+
+		void error(int line, const string & msg);
+
+		/** @brief Read the value of a keyword (it must be on the same line)
+		 *
+		 * @param name Keyword
+		 *
+		 * @param value Value read
+		 *
+		 * @return true if the value is read or false otherwise (the error is printed)
+		 */
+
+		bool readValue(const string & name, string & value);
+
+		/** @brief Read a hexadecimal value of a keyword **/
+
+		bool readHex(const string & name, unsigned long long & value);
+
+		/** @brief Read a decimal value of a keyword **/
+
+		bool readInt(const string & name, long & value);
+
+		/** @brief Read a list of hexadecimal values of a keyword ({hex,hex,...}) **/
+
+		bool readList(const string & name, vector<int> & list);
+
+		/** @brief Parse an access (after BACTION)
+		 *
+		 * @param access Access to fill
+		 *
+		 * @param param Needed parameters of the access
+		 *
+		 * @param begin Line of BACTION
+		 *
+		 * @return true if the access is valid or false otherwise
+		 */
+
+		bool parseAccess(Access & access, ParamConfig & param, int begin);
+
+		/** @brief Parse an operation (after BOPERATION)
+		 *
+		 * @param op Operation to fill
+		 *
+		 * @param begin Line of BOPERATION
+		 *
+		 * @return true if the operation is valid or false otherwise
+		 */
+
+		bool parseOperation(Operation & op, int begin);
+
+		/** @brief Skip the rest of a wrong operation (until EOPERATION or the next BOPERATION) **/
+
+		void recover();
+
+	public:
+
+		/** @brief CfgParser constructor. It reads the whole file.
+		 *
+		 * @param path Absolute/relative path of the configuration file
+		 */
+
+		CfgParser(const string & path);
+
+		/** @brief Parse the next operation of the file. Wrong operations are reported and skipped.
+		 *
+		 * @param op Operation read
+		 *
+		 * @return true if an operation is read or false at the end of the file
+		 */
+
+		bool next(Operation & op);
+
+		/** @brief Get the number of errors found so far **/
+
+		int getErrors() const;
+
+		/** @brief CfgParser destructor **/
+
+		~CfgParser();
+};
+
+}
+
+#endif
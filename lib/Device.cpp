@@ -30,20 +30,120 @@
 namespace caloe {
 
 Device::Device() {
+	table = new OperationTable();
+	watched = NULL;
+	generation = 0;
 }
 
 Device::Device(const Device & dev) {
 	name = dev.name;
-	list_operation = dev.list_operation;
+
+	// The table is shared, only the operations used by dev are copied
+	table = dev.table->acquire();
+	copyBound(dev);
+
+	watched = dev.watched;
+	generation = dev.generation;
 }
 
 Device Device::operator=(const Device & dev) {
+	OperationTable * old = table;
+
+	if(this == &dev)
+		return *this;
+
 	name = dev.name;
-	list_operation = dev.list_operation;
+
+	table = dev.table->acquire();
+	old->release();
+
+	clearBound();
+	copyBound(dev);
+
+	watched = dev.watched;
+	generation = dev.generation;
 
 	return *this;
 }
 
+void Device::sync() const {
+	if(!retired.empty())
+		const_cast<Device *>(this)->freeRetired();
+
+	if(watched != NULL && __sync_fetch_and_add(&watched->generation,0) != generation)
+		const_cast<Device *>(this)->follow();
+}
+
+void Device::freeRetired() {
+	unsigned int kept = 0;
+
+	for(unsigned int i = 0 ; i < retired.size() ; i++) {
+		if(retired[i]->isPending())
+			retired[kept++] = retired[i];
+		else
+			delete retired[i];
+	}
+
+	retired.resize(kept);
+}
+
+void Device::follow() {
+	unsigned int last;
+	OperationTable * fresh = OperationTable::current(watched,last);
+
+	generation = last;
+
+	if(fresh == table) {
+		fresh->release();
+		return;
+	}
+
+	// Asynchronous executions may still use the own operations, they are freed when they finish
+	for(unsigned int i = 0 ; i < bound.size() ; i++) {
+		if(bound[i] != NULL)
+			retired.push_back(bound[i]);
+	}
+
+	bound.clear();
+
+	table->release();
+	table = fresh;
+}
+
+Operation * Device::bind(int i) {
+	if(bound.size() < table->size())
+		bound.resize(table->size(),NULL);
+
+	// First use of the operation by this device
+	if(bound[i] == NULL)
+		bound[i] = new Operation(table->getOperation(i));
+
+	return bound[i];
+}
+
+const Operation & Device::peek(int i) const {
+	if(i < (int) bound.size() && bound[i] != NULL)
+		return *bound[i];
+
+	return table->getOperation(i);
+}
+
+void Device::copyBound(const Device & dev) {
+	bound.assign(dev.bound.size(),NULL);
+
+	for(unsigned int i = 0 ; i < dev.bound.size() ; i++) {
+		if(dev.bound[i] != NULL)
+			bound[i] = new Operation(*dev.bound[i]);
+	}
+}
+
+void Device::clearBound() {
+	for(unsigned int i = 0 ; i < bound.size() ; i++)
+		delete bound[i];
+
+	bound.clear();
+}
+
 string Device::getName() const {
 	return name;
 }
@@ -52,105 +152,249 @@ void Device::setName(string name) {
 	this->name = name;
 }
 
+vector<string> Device::getOperationNames() const {
+	vector<string> names;
+
+	sync();
+
+	for(unsigned int i = 0 ; i < table->size() ; i++)
+		names.push_back(table->getName(i));
+
+	sort(names.begin(),names.end());
+
+	return names;
+}
+
+vector<char> Device::getNeededParameters(const string & name) const {
+	vector<char> needed;
+	int i;
+
+	sync();
+
+	i = table->find(name);
+
+	if(i >= 0)
+		needed = peek(i).getNeededParameters();
+
+	return needed;
+}
+
 void Device::addOperation(const Operation & op) {
-	pair< map<string,Operation>::iterator, bool > ret;
-	
+	sync();
+
+	// The operations of the device are not the ones of the file anymore
+	watched = NULL;
+
+	// The table may be shared with other devices, change a private copy
+	table = table->detach();
+
 	// Try to insert operation in device
-	ret = list_operation.insert(make_pair(op.getName(),op));
-	
-	// If operation exists, print an error message...
-	if(! (ret.second)) {
+	if(!table->addOperation(op)) { // If operation exists, print an error message...
 		cout << "ERROR: Operation "<< op.getName() <<" already exists!"<<endl;
 		cout << "IGNORING..."<<endl;
 	}
 }
 
-void Device::reset(string name) {
-	map<string,Operation>::iterator it;
-	
+Operation * Device::findOperation(const string & name) {
+	int i;
+
+	sync();
+
 	// Search operation in device
-	it = list_operation.find(name);
+	i = table->find(name);
 
-	// If operation is found...
-	if(it != list_operation.end()) {
-		//cout << "OPERATION "<<name<<" found!"<<endl;
-		
-		// Execute operation
-		(it->second).reset();
-	}
-	else { // If operation is not found, print an error message...
+	// If operation is not found, print an error message...
+	if(i < 0) {
 		cout << "ERROR: Operation "<<name<<" not found!"<<endl;
+		return NULL;
 	}
+
+	return bind(i);
+}
+
+Operation * Device::getOperation(const OperationHandle & handle) {
+	sync();
+
+	if(handle.operation < 0 || handle.operation >= (int) table->size()) {
+		cout << "ERROR: Invalid operation handle!"<<endl;
+		return NULL;
+	}
+
+	return bind(handle.operation);
+}
+
+OperationHandle Device::getHandle(const string & name) const {
+	OperationHandle handle;
+
+	sync();
+
+	handle.device = -1;
+	handle.operation = table->find(name);
+
+	return handle;
 }
 
-vector<eb_data_t> Device::execute(string name, ParamOperation & params) {
-	map<string,Operation>::iterator it;
+void Device::reset(const string & name) {
+	Operation * op = findOperation(name);
+
+	// If operation is found, reset it
+	if(op != NULL)
+		op->reset();
+}
+
+vector<eb_data_t> Device::execute(const string & name, ParamOperation & params) {
+	Operation * op = findOperation(name);
 	vector<eb_data_t> res;
 
-	// Search operation in device
-	it = list_operation.find(name);
+	// If operation is found, execute it
+	if(op != NULL)
+		res = op->execute(params);
+	
+	return res;
+}
 
-	// If operation is found...
-	if(it != list_operation.end()) {
-		//cout << "OPERATION "<<name<<" found!"<<endl;
-		
-		// Execute operation
-		res = (it->second).execute(params);
+vector<eb_data_t> Device::execute(const OperationHandle & handle, ParamOperation & params) {
+	Operation * op = getOperation(handle);
+	vector<eb_data_t> res;
+
+	if(op != NULL)
+		res = op->execute(params);
+
+	return res;
+}
+
+OperationResult Device::execute(const string & name, ParamOperation & params, const RetryPolicy & policy) {
+	return execute(getHandle(name),params,policy);
+}
+
+OperationResult Device::execute(const OperationHandle & handle, ParamOperation & params, const RetryPolicy & policy) {
+	Operation * op = getOperation(handle);
+	OperationResult res;
+
+	if(op != NULL) {
+		res = op->execute(params,policy);
 	}
-	else { // If operation is not found, print an error message...
-		cout << "ERROR: Operation "<<name<<" not found!"<<endl;
+	else {
+		res.rcode = INVALID_OPERATION;
+		res.failed_access = -1;
+		res.retries = 0;
+		res.elapsed = 0;
 	}
 	
 	return res;
 }
 
+int Device::waitUntil(const string & name, ParamOperation & params, eb_data_t expected, long timeout, volatile int * cancel) {
+	Operation * op = findOperation(name);
+
+	if(op == NULL)
+		return INVALID_OPERATION;
+
+	return op->waitUntil(params,expected,timeout,cancel);
+}
+
+int Device::waitUntil(const OperationHandle & handle, ParamOperation & params, eb_data_t expected, long timeout, volatile int * cancel) {
+	Operation * op = getOperation(handle);
+
+	if(op == NULL)
+		return INVALID_OPERATION;
+
+	return op->waitUntil(params,expected,timeout,cancel);
+}
+
+long Device::executeAsync(const string & name, ParamOperation & params, operation_callback_caloe callback, void * user) {
+	Operation * op = findOperation(name);
+
+	if(op == NULL)
+		return INVALID_OPERATION;
+
+	return op->executeAsync(params,callback,user);
+}
+
+long Device::executeAsync(const OperationHandle & handle, ParamOperation & params, operation_callback_caloe callback, void * user) {
+	Operation * op = getOperation(handle);
+
+	if(op == NULL)
+		return INVALID_OPERATION;
+
+	return op->executeAsync(params,callback,user);
+}
+
+long Device::executeAsync(const string & name, const Netcon & endpoint, ParamOperation & params, int * claim, operation_callback_caloe callback, void * user) {
+	Operation * op = findOperation(name);
+
+	if(op == NULL)
+		return INVALID_OPERATION;
+
+	return op->executeAsync(endpoint,params,claim,callback,user);
+}
+
+long Device::executeAsync(const OperationHandle & handle, const Netcon & endpoint, ParamOperation & params, int * claim, operation_callback_caloe callback, void * user) {
+	Operation * op = getOperation(handle);
+
+	if(op == NULL)
+		return INVALID_OPERATION;
+
+	return op->executeAsync(endpoint,params,claim,callback,user);
+}
+
 void Device::loadCfgFile(string path,string name_dev) {
-	ifstream ifs;
-	string line;
-	int found;
-	string BOPER("BOPERATION");
-	
-	char fc;
+	this->name = name_dev;
 
+	// The file is parsed once, devices loaded from it share its operations
+	addTable(OperationTable::load(path));
+}
+
+void Device::loadImage(const cfg_cache_caloe * image, string name_dev) {
 	this->name = name_dev;
-	
-	ifs.open (path.c_str(), ifstream::in);
-	
-	while (ifs.good() && !ifs.eof()) {	
-		
-		line = "";
 
-		ifs >> line;
-		
-		fc = *(line.begin());
-		
-		if(!line.empty() && fc != '#') {
-			if((found = line.find(BOPER)) != -1) {
-				Operation o;
-				o.loadOperationCfgFile(ifs);
-				addOperation(o);
-			}
-		}
-		else {
-			if(fc == '#')
-				getline(ifs,line);
-		}
-		
+	addTable(OperationTable::fromImage(image));
+}
+
+bool Device::watchCfgFile() {
+	WatchedTable * file = OperationTable::watch(table);
+
+	if(file == NULL) {
+		cout << "ERROR: Configuration file of device "<< name <<" can not be watched!"<<endl;
+		return false;
 	}
 
-	ifs.close();
+	// The table may have been reloaded already
+	watched = file;
+	follow();
+
+	return true;
+}
+
+void Device::addTable(OperationTable * loaded) {
+	// Operations of the table are added to the ones the device has already
+	if(table->size() == 0) {
+		table->release();
+		clearBound();
+		table = loaded;
+		watched = NULL;
+	}
+	else {
+		for(unsigned int i = 0 ; i < loaded->size() ; i++)
+			addOperation(loaded->getOperation(i));
+
+		loaded->release();
+	}
 }
 
 ostream & operator<<(ostream & os, Device & dev) {
 	
-	map <string,Operation>::iterator it;
+	vector<string> names = dev.getOperationNames();
 	
 	os <<endl<<"+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++"<<endl;
 	
 	os <<"Device Name: "<< dev.name<<endl;
 	
-	for(it = dev.list_operation.begin() ; it != dev.list_operation.end() ; it++) {
-		os << it->second <<endl;
+	// Operations sorted by name
+	for(unsigned int i = 0 ; i < names.size() ; i++) {
+		Operation op = dev.peek(dev.table->find(names[i]));
+
+		os << op <<endl;
 	}
 	
 	os <<endl<<"+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++"<<endl;
@@ -185,6 +429,13 @@ istream & operator>>(istream & is, Device & dev) {
 	return is;
 }
 
-Device::~Device() {}
+Device::~Device() {
+	clearBound();
+
+	for(unsigned int i = 0 ; i < retired.size() ; i++)
+		delete retired[i];
+
+	table->release();
+}
 
 }
@@ -29,15 +29,38 @@
 #define DEVICE_CALOE_H
  
 #include "Operation.h"
+#include "OperationTable.h"
 
-#include <map>
-#include <utility> //pair
+#include <algorithm>
 
 using namespace std;
 
 namespace caloe {
 
-/** @brief Contains an hash table of the operation asociated with the device **/
+/** @brief Operation resolved once by name (see Device::getHandle and System::getHandle). Operations
+ *  and devices are never removed, so a handle stays valid for the device (or system) that gave it
+ *  and for its copies.
+ **/
+
+struct OperationHandle {
+	/// Device index in the System (-1: handle of a Device or device not found)
+	int device;
+	
+	/// Operation index in the Device (-1: not found)
+	int operation;
+};
+
+/** @brief Device of a System resolved once by name (see System::getDeviceHandle) **/
+
+struct DeviceHandle {
+	/// Device index in the System (-1: not found)
+	int device;
+};
+
+/** @brief Contains an hash table of the operation asociated with the device. The table is shared with
+ *  every device loaded from the same configuration file; a device only keeps its own copy of the
+ *  operations it has executed (their accesses hold state such as read values and autoincrement).
+ **/
 
 class Device {
 	private:
@@ -46,9 +69,94 @@ class Device {
 		
 		string name;
 		
-		/// Operation hash table
+		/// Shared operation table (copy-on-write)
+		
+		OperationTable * table;
+		
+		/// Own copy of each operation of the table (NULL: the shared operation has not been used yet)
+		
+		vector<Operation *> bound;
+		
+		/// Configuration file followed by the device (NULL: not watched, see watchCfgFile)
+		
+		WatchedTable * watched;
+		
+		/// Generation of the watched file the table belongs to
+		
+		unsigned int generation;
+		
+		/// Own operations of previous tables (asynchronous executions may still use them)
+		
+		vector<Operation *> retired;
+		
+		/** @brief Free the retired operations without asynchronous executions in flight **/
+		
+		void freeRetired();
+		
+		/** @brief Take the new table of the watched file if it has been reloaded. It only reads the
+		 *  generation of the file when nothing has changed (no locks). Retired operations are freed
+		 *  once their asynchronous executions have finished.
+		 **/
+		 
+		void sync() const;
+		
+		/** @brief Take the last table of the watched file (own operations are retired) **/
+		
+		void follow();
+		
+		/** @brief Get the own copy of an operation (it is copied from the table the first time)
+		 * 
+		 * @param i Operation index
+		 * 
+		 * @return Operation of this device
+		 */
+		 
+		Operation * bind(int i);
+		
+		/** @brief Get an operation for reading (own copy if there is one or shared operation otherwise)
+		 * 
+		 * @param i Operation index
+		 * 
+		 * @return Operation
+		 */
+		 
+		const Operation & peek(int i) const;
+		
+		/** @brief Copy the own operations of another device
+		 * 
+		 * @param dev Device to copy
+		 */
+		 
+		void copyBound(const Device & dev);
+		
+		/** @brief Free the own operations of the device **/
 		
-		map<string,Operation> list_operation;
+		void clearBound();
+		
+		/** @brief Add the operations of a table to the device (the device takes the reference of the caller)
+		 * 
+		 * @param loaded Table of a configuration file
+		 */
+		 
+		void addTable(OperationTable * loaded);
+		
+		/** @brief Search an operation by name (it prints an error if it is not found)
+		 * 
+		 * @param name Operation name
+		 * 
+		 * @return Operation or NULL if it is not found
+		 */
+		 
+		Operation * findOperation(const string & name);
+		
+		/** @brief Get the operation of a handle (it prints an error if the handle is not valid)
+		 * 
+		 * @param handle Operation handle
+		 * 
+		 * @return Operation or NULL if the handle is not valid
+		 */
+		 
+		Operation * getOperation(const OperationHandle & handle);
 
 	public:
 	
@@ -90,25 +198,194 @@ class Device {
 		 
 		void addOperation(const Operation & op);
 		
+		/** @brief Get the names of all operations of the device
+		 * 
+		 * @return Operation names (sorted)
+		 */
+		 
+		vector<string> getOperationNames() const;
+		
+		/** @brief Get needed parameters of each access of an operation
+		 * 
+		 * @param name Operation name
+		 * 
+		 * @return Needed parameters mask of each access (empty if the operation is not found)
+		 */
+		 
+		vector<char> getNeededParameters(const string & name) const;
+		
 		/** @brief Reset an operation asociated to the device
  		 * 
  		 * @param name Operation name
  		 * 
 		 */
 		 
-		void reset(string name);
+		void reset(const string & name);
+		
+		/** @brief Execute an operation asociated to the device (see Operation::execute: on failure
+ 		 *  the error is printed and the values read before it are returned, check the error code with the RetryPolicy overload)
+ 		 * 
+ 		 * @param name Operation name
+ 		 * 
+ 		 * @param params User parameters for the operation
+ 		 * 
+ 		 * @return a vector with read values by operation (may be incomplete or empty on failure)
+ 		 * 
+		 */
+		 
+		vector<eb_data_t> execute(const string & name, ParamOperation & params);
 		
-		/** @brief Execute an operation asociated to the device
+		/** @brief Execute an operation asociated to the device with a retry policy (see Operation::execute)
  		 * 
  		 * @param name Operation name
  		 * 
  		 * @param params User parameters for the operation
  		 * 
- 		 * @return a vector with read values by operation
+ 		 * @param policy Retry policy
+ 		 * 
+ 		 * @return Operation result (INVALID_OPERATION if the operation is not found)
+ 		 * 
+		 */
+		 
+		OperationResult execute(const string & name, ParamOperation & params, const RetryPolicy & policy);
+		
+		/** @brief Wait until an operation (a read) returns an expected value (see Operation::waitUntil)
+		 * 
+		 * @param name Operation name
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param expected Expected value of the read
+		 * 
+		 * @param timeout Max waiting time (us, -1: NOT LIMITED)
+		 * 
+		 * @param cancel Flag that cancels the wait when it is set by another thread (it can be NULL)
+		 * 
+		 * @return ALL_OK if the value is read, ERROR_TIMEOUT, ERROR_CANCELLED or error code
+		 */
+		 
+		int waitUntil(const string & name, ParamOperation & params, eb_data_t expected, long timeout, volatile int * cancel = NULL);
+		
+		/** @brief Execute an operation without blocking (see Operation::executeAsync)
+		 * 
+		 * @param name Operation name
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param callback Completion callback
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute or error code
+		 */
+		 
+		long executeAsync(const string & name, ParamOperation & params, operation_callback_caloe callback, void * user);
+		
+		/** @brief Execute an operation without blocking against a given endpoint (see Operation::executeAsync)
+		 * 
+		 * @param name Operation name
+		 * 
+		 * @param endpoint Endpoint of all accesses
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param claim Update token of a fan-out (see Operation::executeAsync)
+		 * 
+		 * @param callback Completion callback
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute or error code
+		 */
+		 
+		long executeAsync(const string & name, const Netcon & endpoint, ParamOperation & params, int * claim, operation_callback_caloe callback, void * user);
+		
+		/** @brief Get the handle of an operation. Executing through the handle skips the name lookup.
+		 * 
+		 * @param name Operation name
+		 * 
+		 * @return Operation handle (its operation field is -1 if the operation is not found)
+		 */
+		 
+		OperationHandle getHandle(const string & name) const;
+		
+		/** @brief Execute an operation of the device by its handle (see Operation::execute: on failure
+ 		 *  the error is printed and the values read before it are returned, check the error code with the RetryPolicy overload)
+ 		 * 
+ 		 * @param handle Operation handle (see getHandle)
+ 		 * 
+ 		 * @param params User parameters for the operation
+ 		 * 
+ 		 * @return a vector with read values by operation (may be incomplete or empty on failure)
  		 * 
 		 */
 		 
-		vector<eb_data_t> execute(string name,ParamOperation & params);
+		vector<eb_data_t> execute(const OperationHandle & handle, ParamOperation & params);
+		
+		/** @brief Execute an operation of the device by its handle with a retry policy
+ 		 * 
+ 		 * @param handle Operation handle (see getHandle)
+ 		 * 
+ 		 * @param params User parameters for the operation
+ 		 * 
+ 		 * @param policy Retry policy
+ 		 * 
+ 		 * @return Operation result (INVALID_OPERATION if the handle is not valid)
+ 		 * 
+		 */
+		 
+		OperationResult execute(const OperationHandle & handle, ParamOperation & params, const RetryPolicy & policy);
+		
+		/** @brief Wait until an operation (a read) returns an expected value, by its handle
+		 * 
+		 * @param handle Operation handle (see getHandle)
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param expected Expected value of the read
+		 * 
+		 * @param timeout Max waiting time (us, -1: NOT LIMITED)
+		 * 
+		 * @param cancel Flag that cancels the wait when it is set by another thread (it can be NULL)
+		 * 
+		 * @return ALL_OK if the value is read, ERROR_TIMEOUT, ERROR_CANCELLED or error code
+		 */
+		 
+		int waitUntil(const OperationHandle & handle, ParamOperation & params, eb_data_t expected, long timeout, volatile int * cancel = NULL);
+		
+		/** @brief Execute an operation without blocking, by its handle
+		 * 
+		 * @param handle Operation handle (see getHandle)
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param callback Completion callback
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute or error code
+		 */
+		 
+		long executeAsync(const OperationHandle & handle, ParamOperation & params, operation_callback_caloe callback, void * user);
+		
+		/** @brief Execute an operation without blocking against a given endpoint, by its handle
+		 * 
+		 * @param handle Operation handle (see getHandle)
+		 * 
+		 * @param endpoint Endpoint of all accesses
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param claim Update token of a fan-out (see Operation::executeAsync)
+		 * 
+		 * @param callback Completion callback
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute or error code
+		 */
+		 
+		long executeAsync(const OperationHandle & handle, const Netcon & endpoint, ParamOperation & params, int * claim, operation_callback_caloe callback, void * user);
 		
 		/** @brief Load a device from the input configuration file
 		 *  
@@ -120,6 +397,31 @@ class Device {
 		 
 		void loadCfgFile(string path,string name_dev);
 		
+		/** @brief Load a device from an image built into the program (see cfgc_spec -g). Nothing is
+		 *  read or parsed at run time.
+		 *  
+		 * @param image Static image of the operations
+		 * 
+		 * @param name_dev Device name
+		 * 
+		 */
+		 
+		void loadImage(const cfg_cache_caloe * image, string name_dev);
+		
+		/** @brief Follow the changes of the configuration file the device was loaded from. The file is
+		 *  watched (inotify) and parsed again in the background when it changes; the next execution uses
+		 *  the new operations while executions in flight finish with the old ones. Operations keep their
+		 *  index (handles stay valid) and files with errors are not used (see OperationTable::reload).
+		 *  A device that adds operations stops following the file. Operations built into the program
+		 *  (loadImage, e.g. the default Dio and Vuart constructors) never change: load the device from its
+		 *  configuration file to follow it.
+		 * 
+		 * @return true if the file is watched or false if the device does not come from one configuration
+		 *  file (copies and operations built into the program) or it can not be watched
+		 */
+		 
+		bool watchCfgFile();
+		
 		/** @brief Print Device information
 		 * 
 		 *  @param os Output stream
@@ -0,0 +1,135 @@
+/**
+ ******************************************************************************* 
+ * @file NameIndex.cpp
+ *  @brief Name index class source file
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+ 
+#include "NameIndex.h"
+
+namespace caloe {
+
+NameIndex::NameIndex() {
+	slots.assign(NAME_INDEX_SLOTS,-1);
+}
+
+NameIndex::NameIndex(const NameIndex & index) {
+	names = index.names;
+	hashes = index.hashes;
+	values = index.values;
+	slots = index.slots;
+}
+
+NameIndex NameIndex::operator=(const NameIndex & index) {
+	names = index.names;
+	hashes = index.hashes;
+	values = index.values;
+	slots = index.slots;
+
+	return *this;
+}
+
+unsigned int NameIndex::hash(const string & name) {
+	unsigned int h = 2166136261u;
+
+	for(unsigned int i = 0 ; i < name.size() ; i++)
+		h = (h ^ (unsigned char) name[i]) * 16777619u;
+
+	return h;
+}
+
+void NameIndex::rehash(unsigned int nslots) {
+	unsigned int mask = nslots - 1;
+
+	slots.assign(nslots,-1);
+
+	for(unsigned int n = 0 ; n < names.size() ; n++) {
+		unsigned int i = hashes[n] & mask;
+
+		// Linear probing
+		while(slots[i] >= 0)
+			i = (i + 1) & mask;
+
+		slots[i] = n;
+	}
+}
+
+bool NameIndex::insert(const string & name, int value) {
+	unsigned int mask;
+	unsigned int i;
+
+	if(find(name) >= 0)
+		return false;
+
+	names.push_back(name);
+	hashes.push_back(hash(name));
+	values.push_back(value);
+
+	// Keep the table at most half full
+	if(names.size()*2 > slots.size()) {
+		rehash(slots.size()*2);
+	}
+	else {
+		mask = slots.size() - 1;
+		i = hashes.back() & mask;
+
+		while(slots[i] >= 0)
+			i = (i + 1) & mask;
+
+		slots[i] = names.size() - 1;
+	}
+
+	return true;
+}
+
+int NameIndex::find(const string & name) const {
+	unsigned int mask = slots.size() - 1;
+	unsigned int h = hash(name);
+	unsigned int i = h & mask;
+
+	while(slots[i] >= 0) {
+		int n = slots[i];
+
+		if(hashes[n] == h && names[n] == name)
+			return values[n];
+
+		i = (i + 1) & mask;
+	}
+
+	return -1;
+}
+
+unsigned int NameIndex::size() const {
+	return names.size();
+}
+
+void NameIndex::clear() {
+	names.clear();
+	hashes.clear();
+	values.clear();
+	slots.assign(NAME_INDEX_SLOTS,-1);
+}
+
+NameIndex::~NameIndex() {}
+
+}
@@ -0,0 +1,135 @@
+/**
+ ******************************************************************************* 
+ * @file NameIndex.h
+ *  @brief Name index class header file
+ * 
+ *  Hashed index (open addressing) from names to positions of a vector. It is used
+ *  to resolve device and operation names.
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef NAME_INDEX_CALOE_H
+#define NAME_INDEX_CALOE_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace caloe {
+
+/// Initial number of slots of a name index (power of two)
+#define NAME_INDEX_SLOTS 16
+
+/** @brief Hashed index from names to positions. The table is kept at most half full, so a lookup
+ *  usually compares one name.
+ **/
+
+class NameIndex {
+	private:
+	
+		/// Indexed names
+		
+		vector<string> names;
+		
+		/// Hash of each name
+		
+		vector<unsigned int> hashes;
+		
+		/// Position of each name
+		
+		vector<int> values;
+		
+		/// Slots of the table (name number or -1 if the slot is empty)
+		
+		vector<int> slots;
+		
+		/** @brief Hash of a name (FNV-1a) **/
+		
+		static unsigned int hash(const string & name);
+		
+		/** @brief Build the table again with a number of slots
+		 * 
+		 * @param nslots Number of slots (power of two)
+		 */
+		 
+		void rehash(unsigned int nslots);
+
+	public:
+	
+		/** @brief NameIndex default constructor **/
+		
+		NameIndex();
+		
+		/** @brief NameIndex constructor from another NameIndex instance 
+		 *
+		 *  @param index Instance to copy
+		 **/
+		 
+		NameIndex(const NameIndex & index);
+		
+		/** @brief NameIndex Asignment operator 
+		 *
+		 *  @param index Intance to copy
+		 * 
+		 *  @return New NameIndex instance 
+		 **/
+		 
+		NameIndex operator=(const NameIndex & index);
+		
+		/** @brief Add a name to the index
+		 * 
+		 * @param name Name
+		 * 
+		 * @param value Position of the name
+		 * 
+		 * @return true if it is added or false if the name exists already
+		 */
+		 
+		bool insert(const string & name, int value);
+		
+		/** @brief Search a name
+		 * 
+		 * @param name Name
+		 * 
+		 * @return Position of the name or -1 if it is not found
+		 */
+		 
+		int find(const string & name) const;
+		
+		/** @brief Get the number of names **/
+		
+		unsigned int size() const;
+		
+		/** @brief Remove all names **/
+		
+		void clear();
+		
+		/** @brief NameIndex destructor **/
+		
+		~NameIndex();
+};
+
+}
+
+#endif
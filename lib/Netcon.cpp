@@ -26,27 +26,32 @@
  */
  
 #include "Netcon.h"
+#include "access_internals.h"
 
 namespace caloe {
 
 Netcon::Netcon() {
 	// Default Etherbone port
-	port = 60368;
+	port = ENDPOINT_DEFAULT_PORT;
+	endpoint = 0;
 }
 
 Netcon::Netcon(string ip, unsigned int port) {
 	this->ip = ip;
 	this->port = port;
+	resolveEndpoint();
 }
 
 Netcon::Netcon(const Netcon & nc) {
 	ip = nc.ip;
 	port = nc.port;
+	endpoint = nc.endpoint;
 }
 
 Netcon Netcon::operator=(const Netcon & nc) {
 	ip = nc.ip;
 	port = nc.port;
+	endpoint = nc.endpoint;
 	
 	return *this;
 }
@@ -59,12 +64,29 @@ unsigned int Netcon::getPort() const {
 	return port;
 }
 
+void Netcon::resolveEndpoint() {
+	// No address yet (e.g. it is given by the user on each execution)
+	if(ip.empty())
+		endpoint = 0;
+	else
+		endpoint = register_endpoint_caloe(ip.c_str(),port);
+}
+
+int Netcon::getEndpoint() const {
+	if(endpoint == 0)
+		return ERROR_ENDPOINT;
+
+	return endpoint;
+}
+
 void Netcon::setIP(string ip) {
 	this->ip = ip;
+	resolveEndpoint();
 }
 
 void Netcon::setPort(unsigned int port) {
 	this->port = port;
+	resolveEndpoint();
 }
 
 ostream & operator<<(ostream & os, Netcon & nc) {
@@ -79,6 +101,7 @@ istream & operator>>(istream & is, Netcon & nc) {
 	is >> nc.ip;
 	cout << "port: ";
 	is >> nc.port;
+	nc.resolveEndpoint();
 
 	return is;
 }
@@ -34,6 +34,8 @@
 #include <iostream>
 #include <string>
 
+#include "endpoint_internals.h"
+
 using namespace std;
 
 namespace caloe {
@@ -50,6 +52,14 @@ class Netcon {
 		/// Network port
 		
 		unsigned int port;
+		
+		/// Endpoint handle (registered when IP or port change, 0: no IP)
+		
+		int endpoint;
+		
+		/** @brief Register IP and port and keep their endpoint handle (see register_endpoint_caloe) **/
+		
+		void resolveEndpoint();
 
 	public:
 	
@@ -91,6 +101,13 @@ class Netcon {
 		
 		unsigned int getPort() const;
 		
+		/** @brief Get endpoint handle. IP and port are registered when they are set, so it only reads the handle
+		 * 
+		 * @return Endpoint handle or ERROR_ENDPOINT if IP or port are not valid
+		 */
+		 
+		int getEndpoint() const;
+		
 		/** @brief Set IP netaddress
 		 * 
 		 * @param ip IP netaddress
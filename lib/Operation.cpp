@@ -30,12 +30,17 @@
 namespace caloe {
 
 Operation::Operation() {
-	
+	compiled_accesses = NULL;
+	compiled_reads = 0;
+	pending = 0;
 }
 
 Operation::Operation(string name, string doc) {
 	this->name = name;
 	this->doc = doc;
+	compiled_accesses = NULL;
+	compiled_reads = 0;
+	pending = 0;
 }
 
 Operation::Operation(const Operation & op) {
@@ -43,9 +48,16 @@ Operation::Operation(const Operation & op) {
 	doc = op.doc;
 	list_access = op.list_access;
 	list_param = op.list_param;
+	
+	// The plan points to the accesses of op, it is compiled again on first execute
+	compiled_accesses = NULL;
+	compiled_reads = 0;
+	pending = 0;
 }
 
 Operation Operation::operator=(const Operation & op) {
+	uncompile();
+	
 	name = op.name;
 	doc = op.doc;
 	list_access = op.list_access;
@@ -58,10 +70,35 @@ string Operation::getName() const {
 	return name;
 }
 
+bool Operation::isPending() const {
+	return __sync_fetch_and_add(const_cast<int *>(&pending),0) > 0;
+}
+
 string Operation::getDoc() const {
 	return doc;
 }
 
+vector<char> Operation::getNeededParameters() const {
+	vector<char> needed;
+
+	for(unsigned int i = 0 ; i < list_param.size() ; i++)
+		needed.push_back(list_param[i].getParametersMask());
+
+	return needed;
+}
+
+unsigned int Operation::getNumAccesses() const {
+	return list_access.size();
+}
+
+const Access & Operation::getAccess(unsigned int index) const {
+	return list_access.at(index);
+}
+
+const ParamConfig & Operation::getParamConfig(unsigned int index) const {
+	return list_param.at(index);
+}
+
 void Operation::setName(string name) {
 	this->name = name;
 }
@@ -71,6 +108,9 @@ void Operation::setDoc(string doc) {
 }
 
 void Operation::addAccess(const Access & access, const ParamConfig & param) {
+	// The compiled plan points to the accesses of the vector
+	uncompile();
+	
 	// Add new access to vector end
 	list_access.push_back(access);
 	// Add needed parameters to vector end
@@ -85,11 +125,11 @@ void Operation::reset() {
 		it_access->reset();
 }
 
-vector<eb_data_t> Operation::execute(ParamOperation & params) {
+vector<Access *> Operation::prepare(ParamOperation & params) {
 	vector< Access >::iterator it_access;
 	vector< ParamConfig>::iterator it_param;
 	vector<ParamAccess>::iterator it_user;
-	vector<eb_data_t> res;
+	vector<Access *> to_execute;
 
 	// Extracts user parameters of ParamOperation
 	vector<ParamAccess> user_params = params.getParamAccess();
@@ -134,81 +174,377 @@ vector<eb_data_t> Operation::execute(ParamOperation & params) {
 
 			it_access->setNetCon(nc);
 
-			// Execute access
-			int ok;
-			int retry = 0;
-			
-			do {
-				ok = it_access->execute();
-				retry++;
-				
-				if(MAX_RETRY > 0 && retry > MAX_RETRY)
-					exit(-1);
-			} while(ok != ALL_OK);
-			
-			// If access type is READ, get read value to return it
-			
-			if(it_access->getMode() == READ)
-				res.push_back(it_access->getValue());
+			to_execute.push_back(&(*it_access));
 		}
 		//cout <<endl<<"--------------------------------------------------------------------------------"<<endl;
 	}
-	
+
+	return to_execute;
+}
+
+access_caloe * Operation::buildAccessesCaloe(vector<Access *> & to_execute) {
+	int naccess = to_execute.size();
+	access_caloe * accesses = new access_caloe[naccess];
+
+	for(int i = 0 ; i < naccess ; i++)
+		to_execute[i]->toAccessCaloe(&accesses[i]);
+
+	return accesses;
+}
+
+vector<eb_data_t> Operation::complete(vector<Access *> & to_execute, access_caloe * accesses, bool update) {
+	vector<eb_data_t> res;
+	int naccess = to_execute.size();
+
+	for(int i = 0 ; i < naccess ; i++) {
+		if(update)
+			to_execute[i]->fromAccessCaloe(&accesses[i]);
+
+		// If access type is READ, get read value to return it
+		if(accesses[i].mode == READ)
+			res.push_back(accesses[i].value);
+
+		free_access_caloe(&accesses[i]);
+	}
+
+	delete [] accesses;
+
 	return res;
 }
 
-void Operation::loadOperationCfgFile(ifstream & file) {
-	string BOPER("BOPERATION");
-	string EOPER("EOPERATION");
-	string BACT("BACTION");
-	string NAME("NAME");
-	string DOC("DOC");
-	
-	string line;
-	int found;
-	bool end = false;
-	
-	char fc;
-	
-	while (file.good() && !file.eof() && !end) {
-		line = "";
+void Operation::compile() {
+	uncompile();
 
-		file >> line;
-		
-		fc = *(line.begin());
-		
-		if(!line.empty() && fc != '#') {
+	compiled_accesses = new access_caloe[list_access.size()];
 
-			if((found = line.find(NAME)) != -1) {
-				file >> line;
-				
-				this->name = line;
-				//cout << "Operation name "<<line<<endl;
-			}
-		
-			if((found = line.find(DOC)) != -1) {
-				getline(file,line);
-				
-				this->doc = line;
-				//cout << "Operation doc "<<line<<endl;
-			}
-		
-			if((found = line.find(BACT)) != -1) {
-					Access a;
-					ParamConfig p = a.loadAccessCfgFile(file);
-					addAccess(a,p);
+	for(unsigned int i = 0 ; i < list_access.size() ; i++) {
+		CompiledAccess slot;
+
+		slot.access = &list_access[i];
+		slot.config = &list_param[i];
+		slot.needed = list_param[i].getParametersMask();
+
+		// Network parameters are allocated here once
+		list_access[i].toAccessCaloe(&compiled_accesses[i]);
+
+		if(list_access[i].getMode() == READ)
+			compiled_reads += list_access[i].getBlock();
+
+		compiled_slots.push_back(slot);
+	}
+}
+
+void Operation::uncompile() {
+	if(compiled_accesses != NULL) {
+		for(unsigned int i = 0 ; i < compiled_slots.size() ; i++)
+			free_access_caloe(&compiled_accesses[i]);
+
+		delete [] compiled_accesses;
+	}
+
+	compiled_accesses = NULL;
+	compiled_slots.clear();
+	compiled_reads = 0;
+}
+
+int Operation::runBatch(access_caloe * accesses, int count, const RetryPolicy & policy, long long start, int & done, int & retries) {
+	// Execute accesses (a failed batch is retried from the first access not completed)
+	int ok = ALL_OK;
+	int ndone;
+
+	done = 0;
+	retries = 0;
+
+	if(policy.expired(start))
+		ok = ERROR_TIMEOUT;
+
+	while(ok == ALL_OK) {
+		ok = execute_batch_caloe(accesses+done,count-done,&ndone);
+		done += ndone;
+
+		if(ok == ALL_OK || !policy.waitRetry(accesses[done].networkc.endpoint,retries,start))
+			break;
+
+		ok = ALL_OK;
+		retries++;
+	}
+
+	return ok;
+}
+
+OperationResult Operation::executeAccesses(access_caloe * accesses, int naccess, const RetryPolicy & policy) {
+	OperationResult result;
+	int done;
+
+	result.failed_access = -1;
+	result.elapsed = now_us_caloe();
+	result.rcode = runBatch(accesses,naccess,policy,result.elapsed,done,result.retries);
+
+	for(int i = 0 ; i < done ; i++) {
+		if(accesses[i].mode == READ)
+			result.values.push_back(accesses[i].value);
+	}
+
+	if(result.rcode != ALL_OK)
+		result.failed_access = done;
+
+	result.elapsed = now_us_caloe() - result.elapsed;
+
+	return result;
+}
+
+int Operation::executeCompiled(int first, int count, const RetryPolicy & policy, long long start, OperationResult & result) {
+	int retry;
+	int done;
+	int ok = runBatch(compiled_accesses+first,count,policy,start,done,retry);
+
+	result.retries += retry;
+
+	for(int i = first ; i < first+done ; i++) {
+		compiled_slots[i].access->fromAccessCaloe(&compiled_accesses[i]);
+
+		// If access type is READ, get read value to return it
+		if(compiled_accesses[i].mode == READ)
+			result.values.push_back(compiled_accesses[i].value);
+	}
+
+	if(ok != ALL_OK) {
+		result.rcode = ok;
+		result.failed_access = first+done;
+	}
+
+	return ok;
+}
+
+int Operation::executeBlock(int index, const RetryPolicy & policy, long long start, OperationResult & result) {
+	access_caloe * access = &compiled_accesses[index];
+	Access * a = compiled_slots[index].access;
+	int base = result.values.size();
+	int retry = 0;
+	int ok = ALL_OK;
+
+	if(policy.expired(start))
+		ok = ERROR_TIMEOUT;
+
+	// Words land straight into the result vector
+	result.values.resize(base+a->getBlock());
+
+	while(ok == ALL_OK) {
+		ok = read_block_caloe(access,a->getAutoincr(),a->getBlock(),&result.values[base]);
+
+		if(ok == ALL_OK || !policy.waitRetry(access->networkc.endpoint,retry,start))
+			break;
+
+		ok = ALL_OK;
+		retry++;
+	}
+
+	result.retries += retry;
+
+	if(ok != ALL_OK) {
+		result.values.resize(base);
+		result.rcode = ok;
+		result.failed_access = index;
+		return ok;
+	}
+
+	access->value = result.values.back();
+	a->fromAccessCaloe(access,a->getBlock());
+
+	return ALL_OK;
+}
+
+vector<eb_data_t> Operation::execute(ParamOperation & params) {
+	RetryPolicy policy;
+	OperationResult result = execute(params,policy);
+
+	// The values can not tell a failure, report it
+	if(result.rcode != ALL_OK)
+		cout << "ERROR: Operation "<<name<<" failed on access "<<result.failed_access<<" (error code "<<result.rcode<<", "<<result.retries<<" retries)"<<endl;
+
+	return result.values;
+}
+
+OperationResult Operation::execute(ParamOperation & params, const RetryPolicy & policy) {
+	OperationResult result;
+	unsigned int naccess;
+	int first = -1;
+
+	result.rcode = ALL_OK;
+	result.failed_access = -1;
+	result.retries = 0;
+	result.elapsed = now_us_caloe();
+
+	if(compiled_accesses == NULL)
+		compile();
+
+	naccess = compiled_slots.size();
+
+	if(params.getNumParams() < naccess)
+		naccess = params.getNumParams();
+
+	result.values.reserve(compiled_reads);
+
+	// For each access in operation (until one of them fails)...
+	for(unsigned int i = 0 ; i < naccess && result.rcode == ALL_OK ; i++) {
+		const ParamAccess & param = params.getParam(i);
+		CompiledAccess & slot = compiled_slots[i];
+		access_caloe * access = &compiled_accesses[i];
+
+		// If user gave all parameters, update the access in place
+		if(slot.needed == param.getParametersMask()) {
+			Access * a = slot.access;
+
+			access->address = a->getAddress();
+			access->offset = (slot.needed & PARAM_OFFSET) ? slot.config->getOffsetParam(param.getOffset()) : a->getOffset();
+			access->mask = (slot.needed & PARAM_MASK) ? slot.config->getMaskParam(param.getMask()) : a->getMask();
+			access->value = (slot.needed & PARAM_VALUE) ? param.getValue() : a->getValue();
+
+			// Endpoint handle of user netaddress/port (cached by the parameter)
+			if(slot.needed & (PARAM_NETADDRESS | PARAM_PORT))
+				access->networkc.endpoint = param.getEndpoint(a->getNetconRef());
+
+			if(a->getBlock() > 1 && access->mode == READ) {
+				// Block reads run on their own cycles, execute the previous run first
+				if(first >= 0 && executeCompiled(first,i-first,policy,result.elapsed,result) != ALL_OK)
+					break;
+
+				first = -1;
+
+				executeBlock(i,policy,result.elapsed,result);
 			}
-			
-			if((found = line.find(EOPER)) != -1) {
-				end = true;
+			else if(first < 0) {
+				first = i;
 			}
 		}
-		else {
-			if (fc == '#')
-				getline(file,line);
+		else if(first >= 0) {
+			// Accesses without parameters are skipped, execute the previous run
+			executeCompiled(first,i-first,policy,result.elapsed,result);
+			first = -1;
 		}
 	}
-	
+
+	if(first >= 0 && result.rcode == ALL_OK)
+		executeCompiled(first,naccess-first,policy,result.elapsed,result);
+
+	result.elapsed = now_us_caloe() - result.elapsed;
+
+	return result;
+}
+
+int Operation::waitUntil(ParamOperation & params, eb_data_t expected, long timeout, volatile int * cancel) {
+	vector<Access *> to_execute = prepare(params);
+	access_caloe access;
+	eb_data_t mask;
+	int rcode;
+
+	if(to_execute.empty() || to_execute[0]->getMode() != READ)
+		return INVALID_OPERATION;
+
+	to_execute[0]->toAccessCaloe(&access);
+
+	// MSKNEG selects the compared bits, MSKPOS forces some bits so they are not compared
+	mask = (access.mask_oper == MASK_AND ? access.mask : ~(access.mask));
+	expected &= mask;
+
+	rcode = wait_until_caloe(&access,mask,expected,timeout,cancel);
+
+	free_access_caloe(&access);
+
+	return rcode;
+}
+
+/// State of an asynchronous operation until its callback is called
+
+struct AsyncOperation {
+	vector<Access *> to_execute;
+	access_caloe * accesses;
+	bool update;
+	int * claim;
+	operation_callback_caloe callback;
+	void * user;
+	int * pending;
+};
+
+static void async_operation_completed(void * user, int rcode, access_caloe * accesses, int naccess) {
+	AsyncOperation * ctx = (AsyncOperation *) user;
+
+	// The accesses are ctx->accesses
+	(void) accesses;
+	(void) naccess;
+
+	bool update = ctx->update;
+
+	// Only the first board of a fan-out that succeeds updates the accesses
+	if(ctx->claim != NULL)
+		update = (rcode == ALL_OK && __sync_bool_compare_and_swap(ctx->claim,0,1));
+
+	vector<eb_data_t> res = Operation::complete(ctx->to_execute,ctx->accesses,update);
+
+	if(ctx->callback != NULL)
+		ctx->callback(rcode,res,ctx->user);
+
+	// The accesses of the Operation are not used any more
+	__sync_fetch_and_sub(ctx->pending,1);
+
+	delete ctx;
+}
+
+long Operation::executeAsync(ParamOperation & params, operation_callback_caloe callback, void * user) {
+	return submitAsync(params,NULL,true,NULL,callback,user);
+}
+
+long Operation::executeAsync(const Netcon & endpoint, ParamOperation & params, int * claim, operation_callback_caloe callback, void * user) {
+	return submitAsync(params,&endpoint,false,claim,callback,user);
+}
+
+long Operation::submitAsync(ParamOperation & params, const Netcon * endpoint, bool update, int * claim, operation_callback_caloe callback, void * user) {
+	vector<Access *> to_execute = prepare(params);
+	vector<eb_data_t> res;
+	long id;
+
+	// Block reads are not supported by the event loop
+	for(unsigned int i = 0 ; i < to_execute.size() ; i++) {
+		if(to_execute[i]->getBlock() > 1 && to_execute[i]->getMode() == READ)
+			return INVALID_OPERATION;
+	}
+
+	// Nothing to send, complete right now
+	if(to_execute.empty()) {
+		if(callback != NULL)
+			callback(ALL_OK,res,user);
+
+		return 0;
+	}
+
+	AsyncOperation * ctx = new AsyncOperation;
+
+	ctx->to_execute = to_execute;
+	ctx->accesses = buildAccessesCaloe(to_execute);
+	ctx->update = update;
+	ctx->claim = claim;
+	ctx->callback = callback;
+
+	// Redirect all accesses to the given endpoint
+	if(endpoint != NULL) {
+		for(unsigned int i = 0 ; i < to_execute.size() ; i++)
+			ctx->accesses[i].networkc.endpoint = endpoint->getEndpoint();
+	}
+	ctx->user = user;
+	ctx->pending = &pending;
+
+	// Counted before submit: transports without Etherbone cycles call the callback at once
+	__sync_fetch_and_add(&pending,1);
+
+	id = submit_async_caloe(default_async_loop_caloe(),ctx->accesses,to_execute.size(),&async_operation_completed,ctx);
+
+	if(id < 0) {
+		complete(ctx->to_execute,ctx->accesses,false);
+		__sync_fetch_and_sub(&pending,1);
+		delete ctx;
+	}
+
+	return id;
 }
 
 ostream & operator<<(ostream & os, Operation & op) {
@@ -269,6 +605,8 @@ istream & operator>>(istream & is, Operation & op) {
 	return is;	
 }
 
-Operation::~Operation() {}
+Operation::~Operation() {
+	uncompile();
+}
 
 }
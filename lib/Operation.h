@@ -31,14 +31,50 @@
 #define OPERATION_CALOE_H
  
 #include "Access.h"
+#include "RetryPolicy.h"
+#include "async_internals.h"
+#include "transport_internals.h"
 
 #include <vector>
 
 using namespace std;
 
 namespace caloe {
+
+/// Completion callback of an asynchronous operation (result code, read values, user data)
+typedef void (*operation_callback_caloe)(int rcode, vector<eb_data_t> & values, void * user);
+
+/** @brief Result of a synchronous Operation executed with a RetryPolicy **/
+
+struct OperationResult {
+	/// ALL_OK if success or error code of the failed access otherwise
+	int rcode;
+	
+	/// Read operation values (the ones read before the failure)
+	vector<eb_data_t> values;
+	
+	/// Index of the access that failed (-1: none)
+	int failed_access;
+	
+	/// Number of retries done
+	int retries;
+	
+	/// Execution time (us)
+	long long elapsed;
+};
+
+/** @brief Parameter slot of one access in a compiled Operation **/
+
+struct CompiledAccess {
+	/// Access of the operation
+	Access * access;
+	
+	/// Needed parameters of the access
+	const ParamConfig * config;
 	
-#define MAX_RETRY -1
+	/// Needed parameters mask (see PARAM_* macros)
+	char needed;
+};
 
 /** @brief Contains a list of Access **/
 
@@ -60,9 +96,132 @@ class Operation {
 		/// Needed parameter of each access
 		
 		vector < ParamConfig > list_param;
-
+		
+		/// Compiled plan: one access_caloe per access, network parameters allocated once (NULL: not compiled)
+		
+		access_caloe * compiled_accesses;
+		
+		/// Parameter slot of each access of the compiled plan
+		
+		vector < CompiledAccess > compiled_slots;
+		
+		/// Number of read accesses of the compiled plan
+		
+		int compiled_reads;
+		
+		/// Number of asynchronous executions in flight (changed with atomic builtins)
+		
+		int pending;
+		
+		/** @brief Free the compiled plan (it is built again on next execute) **/
+		 
+		void uncompile();
+		
+		/** @brief Execute a run of accesses of the compiled plan. A failed batch is retried from the
+		 *  first access not completed while the policy allows it.
+		 * 
+		 * @param first First access
+		 * 
+		 * @param count Number of accesses
+		 * 
+		 * @param policy Retry policy
+		 * 
+		 * @param start Start timestamp (us) of the operation
+		 * 
+		 * @param result Operation result (read values are added, failed access and retries are updated)
+		 * 
+		 * @return ALL_OK if success or error code otherwise
+		 */
+		 
+		int executeCompiled(int first, int count, const RetryPolicy & policy, long long start, OperationResult & result);
+		
+		/** @brief Execute a list of accesses in one batch. A failed batch is retried from the first
+		 *  access not completed while the policy allows it.
+		 * 
+		 * @param accesses Accesses
+		 * 
+		 * @param count Number of accesses
+		 * 
+		 * @param policy Retry policy
+		 * 
+		 * @param start Start timestamp (us) of the operation
+		 * 
+		 * @param done Number of accesses completed
+		 * 
+		 * @param retries Number of retries done
+		 * 
+		 * @return ALL_OK if success or error code otherwise
+		 */
+		 
+		static int runBatch(access_caloe * accesses, int count, const RetryPolicy & policy, long long start, int & done, int & retries);
+		
+		/** @brief Execute a block read access of the compiled plan (see Access::setBlock)
+		 * 
+		 * @param index Index of the access
+		 * 
+		 * @param policy Retry policy
+		 * 
+		 * @param start Start timestamp (us) of the operation
+		 * 
+		 * @param result Operation result (read values are added, failed access and retries are updated)
+		 * 
+		 * @return ALL_OK if success or error code otherwise
+		 */
+		 
+		int executeBlock(int index, const RetryPolicy & policy, long long start, OperationResult & result);
+		
+		/** @brief Apply user parameters to the accesses of the operation
+		 * 
+		 * @param params Needed user parameters
+		 * 
+		 * @return Accesses to execute (the ones whose parameters have been given)
+		 */
+		 
+		vector<Access *> prepare(ParamOperation & params);
+		
+		/** @brief Build the access_caloe structs of a list of accesses
+		 * 
+		 * @param to_execute Accesses to execute
+		 * 
+		 * @return New array of access_caloe structs (free it with complete)
+		 */
+		 
+		static access_caloe * buildAccessesCaloe(vector<Access *> & to_execute);
+		
+		/** @brief Submit an Operation to the default event loop
+		 * 
+		 * @param params Needed user parameters
+		 * 
+		 * @param endpoint Endpoint of all accesses (NULL: the ones of the accesses)
+		 * 
+		 * @param update Update the accesses on completion (true) or only return read values (false)
+		 * 
+		 * @param claim Update token shared by the boards of a fan-out (if not NULL, it replaces update)
+		 * 
+		 * @param callback Completion callback
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute or error code
+		 */
+		 
+		long submitAsync(ParamOperation & params, const Netcon * endpoint, bool update, int * claim, operation_callback_caloe callback, void * user);
+		
 	public:
 		
+		/** @brief Update the accesses after execution and free their access_caloe structs
+		 * 
+		 * @param to_execute Executed accesses
+		 * 
+		 * @param accesses access_caloe structs returned by buildAccessesCaloe
+		 * 
+		 * @param update Update the accesses (read values, autoincrement) or only return read values
+		 * 
+		 * @return Read operation values
+		 */
+		 
+		static vector<eb_data_t> complete(vector<Access *> & to_execute, access_caloe * accesses, bool update = true);
+		
 		/**@brief Operation default constructor **/
 		
 		Operation();
@@ -100,6 +259,13 @@ class Operation {
 		 
 		string getName() const;
 		
+		/** @brief Check if asynchronous executions of the Operation are in flight
+		 * 
+		 *  @return true if the callback of an asynchronous execution has not been called yet
+		 */
+		 
+		bool isPending() const;
+		
 		/** @brief Get Operation docstring
 		 * 
 		 *  @return Operation docstring
@@ -107,6 +273,31 @@ class Operation {
 		 
 		string getDoc() const;
 		
+		/** @brief Get needed parameters of each access (see PARAM_* macros)
+		 * 
+		 *  @return Needed parameters mask of each access
+		 */
+		 
+		vector<char> getNeededParameters() const;
+		
+		/** @brief Get the number of accesses of the operation **/
+		
+		unsigned int getNumAccesses() const;
+		
+		/** @brief Get one access of the operation (without copy)
+		 * 
+		 *  @param index Access index
+		 */
+		 
+		const Access & getAccess(unsigned int index) const;
+		
+		/** @brief Get the needed parameters of one access (without copy)
+		 * 
+		 *  @param index Access index
+		 */
+		 
+		const ParamConfig & getParamConfig(unsigned int index) const;
+		
 		/** @brief Set Operation name 
 		 * 
 		 * @param name Operation name
@@ -137,22 +328,100 @@ class Operation {
 		 
 		void reset();
 		
-		/** @brief Execute an Operation 
+		/** @brief Compile the Operation into a flat plan of access_caloe structs. Execute applies user
+		 *  parameters in place, so it needs no heap allocation per access. It is called by execute
+		 *  the first time, and the plan is dropped whenever an access is added.
+		 * 
+		 **/
+		 
+		void compile();
+		
+		/** @brief Execute an Operation with the default RetryPolicy. On failure the operation stops and
+		 *  the error code is printed, so fewer values than the reads of the Operation (or none) are returned:
+		 *  callers that need every value must use the overload with a RetryPolicy and check the result error code.
 		 * 
 		 * @param params Needed user parameters
 		 * 
-		 * @return Read operation values
+		 * @return Read operation values (only the ones read before a failure)
 		 */
 		 
 		vector<eb_data_t> execute(ParamOperation & params);
 		
-		/** @brief Load an Operation from input configuration file
+		/** @brief Execute accesses built by the caller in one batch, as execute does with the accesses of an
+		 *  Operation. The wrappers generated by cfgc_spec.run -g use it: their accesses have constant
+		 *  addresses, masks and widths, so no Operation, Device or parameter is involved.
 		 * 
-		 * @param file Input stream asociated to configuration file
-		 *
+		 * @param accesses Accesses (read values are stored in them)
+		 * 
+		 * @param naccess Number of accesses
+		 * 
+		 * @param policy Retry policy
+		 * 
+		 * @return Read values, error code, failed access and number of retries
+		 */
+		 
+		static OperationResult executeAccesses(access_caloe * accesses, int naccess, const RetryPolicy & policy);
+		
+		/** @brief Execute an Operation with a retry policy. Failed accesses are retried with backoff
+		 *  until the policy gives up (retries, deadline or endpoint budget); then the operation stops.
+		 * 
+		 * @param params Needed user parameters
+		 * 
+		 * @param policy Retry policy
+		 * 
+		 * @return Result (error code, read values, failed access, retries and execution time)
+		 */
+		 
+		OperationResult execute(ParamOperation & params, const RetryPolicy & policy);
+		
+		/** @brief Wait until the first access of the Operation (a read) returns an expected value. The register
+		 *  is polled with growing intervals on the open session of the endpoint (see wait_until_caloe).
+		 * 
+		 * @param params Needed user parameters
+		 * 
+		 * @param expected Expected value of the read (after its MASK/MSKNEG)
+		 * 
+		 * @param timeout Max waiting time (us, -1: NOT LIMITED)
+		 * 
+		 * @param cancel Flag that cancels the wait when it is set by another thread (it can be NULL)
+		 * 
+		 * @return ALL_OK if the value is read, ERROR_TIMEOUT, ERROR_CANCELLED or error code
+		 */
+		 
+		int waitUntil(ParamOperation & params, eb_data_t expected, long timeout, volatile int * cancel = NULL);
+		
+		/** @brief Execute an Operation without blocking. Its cycles are driven by the default event loop
+		 *  (see System::poll and System::wait). Accesses are updated (read values, autoincrement) on completion.
+		 * 
+		 * @param params Needed user parameters
+		 * 
+		 * @param callback Completion callback (it is called from the event loop)
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute (callback already called) or error code
+		 */
+		 
+		long executeAsync(ParamOperation & params, operation_callback_caloe callback, void * user);
+		
+		/** @brief Execute an Operation without blocking against a given endpoint (network parameters of the
+		 *  accesses are ignored). It is used to run the same operation on many boards at once.
+		 * 
+		 * @param endpoint Endpoint of all accesses
+		 * 
+		 * @param params Needed user parameters
+		 * 
+		 * @param claim Update token shared by the boards of a fan-out (initially zero). The first board that
+		 *  completes without error takes it and updates the accesses (read values, autoincrement). NULL never updates.
+		 * 
+		 * @param callback Completion callback (it is called from the event loop)
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute (callback already called) or error code
 		 */
 		 
-		void loadOperationCfgFile(ifstream & file);
+		long executeAsync(const Netcon & endpoint, ParamOperation & params, int * claim, operation_callback_caloe callback, void * user);
 		
 		/** @brief Print Operation information
 		 * 
@@ -0,0 +1,802 @@
+/**
+ ******************************************************************************* 
+ * @file OperationTable.cpp
+ *  @brief Operation table class source file
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+ 
+#include "OperationTable.h"
+#include "CfgParser.h"
+#include "session_internals.h"
+#include "watch_internals.h"
+
+#include <map>
+#include <sstream>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+namespace caloe {
+
+/// Tables of the configuration files already parsed (by canonical path)
+static map<string,OperationTable *> tables;
+
+/// It protects the reference counters, the file cache and the decoded operations
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// Parsed configuration files are compiled next to the source file (off: the source tree is not written)
+static bool auto_compile = false;
+
+/// Watched configuration files (by canonical path, they are never removed)
+static map<string,WatchedTable *> watched_tables;
+
+/// Watcher of the configuration files (its thread is started by the first watch)
+static watch_caloe watcher;
+
+static bool watcher_started = false;
+
+/// Reloads are done one at a time
+static pthread_mutex_t reload_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static reload_callback_caloe reload_callback = NULL;
+
+static void * reload_user = NULL;
+
+/** @brief Reload a configuration file changed on disk (called from the thread of the watcher) **/
+
+static void cfg_file_changed(const char * path, void * user) {
+	(void) user;
+
+	OperationTable::reload(path);
+}
+
+/** @brief Add a string to a string pool (the empty string is always at offset 0) **/
+
+static uint32_t add_string(string & pool, const string & s) {
+	uint32_t offset = pool.size();
+
+	if(s.empty())
+		return 0;
+
+	pool.append(s);
+	pool.push_back('\0');
+
+	return offset;
+}
+
+/** @brief Add a section to an image (sections are aligned to 8 bytes)
+ *
+ *  @return Offset of the section
+ **/
+
+static uint32_t add_section(string & image, const void * data, size_t size) {
+	uint32_t offset;
+
+	image.resize((image.size() + 7) & ~((size_t) 7),'\0');
+	offset = image.size();
+	image.append((const char *) data,size);
+
+	return offset;
+}
+
+OperationTable::OperationTable() {
+	refs = 1;
+	mtime = 0;
+	file_size = 0;
+	mapped = false;
+	memset(&image,0,sizeof(image));
+}
+
+void OperationTable::copyOperations(const OperationTable & table) {
+	if(table.image.base == NULL) {
+		list_operation = table.list_operation;
+		index_operation = table.index_operation;
+	}
+	else {
+		for(unsigned int i = 0 ; i < table.size() ; i++)
+			addOperation(table.getOperation(i));
+	}
+}
+
+int OperationTable::parse(const string & path) {
+	CfgParser parser(path);
+	Operation o;
+	int errors = 0;
+
+	while(parser.next(o)) {
+		if(!addOperation(o)) {
+			cout << "ERROR: Operation "<< o.getName() <<" already exists!"<<endl;
+			cout << "IGNORING..."<<endl;
+			errors++;
+		}
+	}
+
+	return errors + parser.getErrors();
+}
+
+int OperationTable::open(const string & path) {
+	string compiled = compiledPath(path);
+	uint64_t hash;
+	uint64_t size;
+
+	// A compiled file given directly is used as it is
+	int errors;
+
+	if(compiled == path) {
+		if(map_cfg_cache_caloe(path.c_str(),&image) != ALL_OK) {
+			cout << "ERROR: Could not load compiled configuration file "<< path <<endl;
+			return 1;
+		}
+
+		mapped = true;
+
+		return 0;
+	}
+
+	if(hash_cfg_file_caloe(path.c_str(),&hash,&size) != ALL_OK)
+		return parse(path);
+
+	// The compiled file is only used if it was compiled from the same contents
+	if(map_cfg_cache_caloe(compiled.c_str(),&image) == ALL_OK) {
+		if(image.header->source_hash == hash && image.header->source_size == size) {
+			mapped = true;
+			return 0;
+		}
+
+		unmap_cfg_cache_caloe(&image);
+	}
+
+	// Files with errors are not compiled (errors are reported on each load)
+	if((errors = parse(path)) == 0 && auto_compile)
+		save(compiled,hash,size);
+
+	return errors;
+}
+
+bool OperationTable::save(const string & path, uint64_t hash, uint64_t size) const {
+	string image;
+
+	build(image,hash,size);
+
+	return write_cfg_cache_caloe(path.c_str(),image.data(),image.size()) == ALL_OK;
+}
+
+void OperationTable::build(string & image, uint64_t hash, uint64_t size) const {
+	cfg_cache_header_caloe header;
+	vector<cfg_cache_operation_caloe> operations(this->size());
+	vector<cfg_cache_access_caloe> accesses;
+	vector<int32_t> values;
+	vector<int32_t> slots;
+	string strings(1,'\0');
+	uint32_t nslots = NAME_INDEX_SLOTS;
+
+	// The name index is at most half full (the same as NameIndex)
+	while(nslots < 2*operations.size())
+		nslots *= 2;
+
+	slots.assign(nslots,-1);
+
+	for(unsigned int i = 0 ; i < operations.size() ; i++) {
+		const Operation & op = getOperation(i);
+		cfg_cache_operation_caloe & rec = operations[i];
+		uint32_t slot;
+
+		rec.name = add_string(strings,op.getName());
+		rec.doc = add_string(strings,op.getDoc());
+		rec.hash = hash_cfg_name_caloe(op.getName().c_str());
+		rec.first = accesses.size();
+		rec.naccesses = op.getNumAccesses();
+
+		for(unsigned int j = 0 ; j < op.getNumAccesses() ; j++) {
+			const Access & a = op.getAccess(j);
+			ParamConfig param = op.getParamConfig(j);
+			vector<int> offsets = param.getOffsetsParam();
+			vector<int> masks = param.getMasksParam();
+			Netcon nc = a.getNetcon();
+			cfg_cache_access_caloe r;
+
+			memset(&r,0,sizeof(r));
+
+			r.address_init = a.getAddressInit();
+			r.address = a.getAddress();
+			r.offset = a.getOffset();
+			r.value = a.getValue();
+			r.mask = a.getMask();
+			r.autoincr = a.getAutoincr();
+			r.block = a.getBlock();
+			r.ip = add_string(strings,nc.getIP());
+			r.port = nc.getPort();
+			r.offsets = values.size();
+			r.noffsets = offsets.size();
+			values.insert(values.end(),offsets.begin(),offsets.end());
+			r.masks = values.size();
+			r.nmasks = masks.size();
+			values.insert(values.end(),masks.begin(),masks.end());
+			r.mode = a.getMode();
+			r.align = a.getAlign();
+			r.mask_oper = a.getMaskOper();
+			r.parameters = param.getParametersMask();
+			r.flags = (a.getCacheable() ? CFG_ACCESS_CACHEABLE : 0) | (a.getSideEffects() ? CFG_ACCESS_SIDE_EFFECTS : 0) |
+				(a.getIsConfig() ? CFG_ACCESS_CONFIG : 0);
+
+			accesses.push_back(r);
+		}
+
+		// Linear probing (see find_cfg_operation_caloe)
+		for(slot = rec.hash & (nslots-1) ; slots[slot] >= 0 ; slot = (slot + 1) & (nslots-1));
+
+		slots[slot] = i;
+	}
+
+	memset(&header,0,sizeof(header));
+	image.assign(sizeof(header),'\0');
+
+	header.accesses = add_section(image,(accesses.empty() ? NULL : &accesses[0]),accesses.size()*sizeof(cfg_cache_access_caloe));
+	header.operations = add_section(image,(operations.empty() ? NULL : &operations[0]),operations.size()*sizeof(cfg_cache_operation_caloe));
+	header.slots = add_section(image,&slots[0],slots.size()*sizeof(int32_t));
+	header.values = add_section(image,(values.empty() ? NULL : &values[0]),values.size()*sizeof(int32_t));
+	header.strings = add_section(image,strings.data(),strings.size());
+
+	memcpy(header.magic,CFG_CACHE_MAGIC,8);
+	header.version = CFG_CACHE_VERSION;
+	header.endian = CFG_CACHE_ENDIAN;
+	header.source_hash = hash;
+	header.source_size = size;
+	header.size = image.size();
+	header.noperations = operations.size();
+	header.naccesses = accesses.size();
+	header.nslots = nslots;
+	header.nvalues = values.size();
+	header.strings_size = strings.size();
+
+	image.replace(0,sizeof(header),(const char *) &header,sizeof(header));
+}
+
+const Operation & OperationTable::decode(int i) const {
+	pthread_mutex_lock(&table_lock);
+
+	if(decoded.empty())
+		decoded.assign(image.header->noperations,NULL);
+
+	if(decoded[i] == NULL) {
+		const cfg_cache_operation_caloe * rec = &image.operations[i];
+		Operation * op = new Operation(image.strings + rec->name,image.strings + rec->doc);
+
+		for(unsigned int j = 0 ; j < rec->naccesses ; j++) {
+			const cfg_cache_access_caloe * r = &image.accesses[rec->first + j];
+			const int32_t * values = image.values;
+			Access a;
+			ParamConfig param;
+
+			a.setAddressInit(r->address_init);
+			a.setAddress(r->address);
+			a.setOffset(r->offset);
+			a.setValue(r->value);
+			a.setMask(r->mask);
+			a.setMaskOper((mask_oper_caloe) r->mask_oper);
+			a.setIsConfig(r->flags & CFG_ACCESS_CONFIG);
+			a.setMode((access_type_caloe) r->mode);
+			a.setAlign((align_access_caloe) r->align);
+			a.setAutoincr(r->autoincr);
+			a.setBlock(r->block);
+			a.setCacheable(r->flags & CFG_ACCESS_CACHEABLE);
+			a.setSideEffects(r->flags & CFG_ACCESS_SIDE_EFFECTS);
+			a.setNetCon(Netcon(image.strings + r->ip,r->port));
+
+			if(r->parameters & PARAM_NETADDRESS)
+				param.setIPParam();
+			if(r->parameters & PARAM_PORT)
+				param.setPortParam();
+			if(r->parameters & PARAM_VALUE)
+				param.setValueParam();
+			if(r->parameters & PARAM_OFFSET)
+				param.setOffsetsParam(vector<int>(values + r->offsets,values + r->offsets + r->noffsets));
+			if(r->parameters & PARAM_MASK)
+				param.setMasksParam(vector<int>(values + r->masks,values + r->masks + r->nmasks));
+
+			op->addAccess(a,param);
+		}
+
+		decoded[i] = op;
+	}
+
+	pthread_mutex_unlock(&table_lock);
+
+	return *decoded[i];
+}
+
+void OperationTable::dropImage() {
+	if(mapped)
+		unmap_cfg_cache_caloe(&image);
+	else
+		memset(&image,0,sizeof(image));
+
+	mapped = false;
+}
+
+void OperationTable::unmap() {
+	vector<Operation> operations;
+
+	for(unsigned int i = 0 ; i < size() ; i++)
+		operations.push_back(getOperation(i));
+
+	for(unsigned int i = 0 ; i < decoded.size() ; i++)
+		delete decoded[i];
+
+	decoded.clear();
+	dropImage();
+
+	for(unsigned int i = 0 ; i < operations.size() ; i++)
+		addOperation(operations[i]);
+}
+
+OperationTable * OperationTable::load(const string & path) {
+	map<string,OperationTable *>::iterator it;
+	OperationTable * table;
+	char real[PATH_MAX];
+	struct stat st;
+	string key;
+
+	// The same file may be given with different paths
+	key = (realpath(path.c_str(),real) != NULL ? string(real) : path);
+
+	if(stat(key.c_str(),&st) != 0) {
+		st.st_mtime = 0;
+		st.st_size = 0;
+	}
+
+	pthread_mutex_lock(&table_lock);
+
+	it = tables.find(key);
+
+	// Parsed already and not changed on disk
+	if(it != tables.end() && it->second->mtime == st.st_mtime && it->second->file_size == st.st_size) {
+		table = it->second;
+		table->refs++;
+
+		pthread_mutex_unlock(&table_lock);
+
+		return table;
+	}
+
+	pthread_mutex_unlock(&table_lock);
+
+	table = new OperationTable();
+	table->open(path);
+	table->path = key;
+	table->mtime = st.st_mtime;
+	table->file_size = st.st_size;
+
+	pthread_mutex_lock(&table_lock);
+
+	// One reference for the cache and one for the caller
+	table->refs++;
+
+	it = tables.find(key);
+
+	if(it != tables.end()) {
+		if(--(it->second->refs) == 0)
+			delete it->second;
+
+		it->second = table;
+	}
+	else {
+		tables.insert(make_pair(key,table));
+	}
+
+	pthread_mutex_unlock(&table_lock);
+
+	return table;
+}
+
+void OperationTable::clearCache() {
+	map<string,OperationTable *>::iterator it;
+
+	pthread_mutex_lock(&table_lock);
+
+	for(it = tables.begin() ; it != tables.end() ; it++) {
+		if(--(it->second->refs) == 0)
+			delete it->second;
+	}
+
+	tables.clear();
+
+	pthread_mutex_unlock(&table_lock);
+}
+
+WatchedTable * OperationTable::watch(OperationTable * table) {
+	map<string,WatchedTable *>::iterator it;
+	WatchedTable * watched;
+
+	pthread_mutex_lock(&table_lock);
+
+	// Copies have no file and images built into the program never change
+	if(table->path.empty() || (table->image.base != NULL && !table->mapped)) {
+		pthread_mutex_unlock(&table_lock);
+		return NULL;
+	}
+
+	if(!watcher_started) {
+		if(init_watch_caloe(&watcher,cfg_file_changed,NULL) != ALL_OK) {
+			pthread_mutex_unlock(&table_lock);
+			return NULL;
+		}
+
+		watcher_started = true;
+
+		// Files watched before stopWatching are watched again
+		for(it = watched_tables.begin() ; it != watched_tables.end() ; it++)
+			add_watch_caloe(&watcher,it->first.c_str());
+	}
+
+	it = watched_tables.find(table->path);
+
+	if(it != watched_tables.end()) {
+		watched = it->second;
+	}
+	else {
+		if(add_watch_caloe(&watcher,table->path.c_str()) != ALL_OK) {
+			pthread_mutex_unlock(&table_lock);
+			return NULL;
+		}
+
+		watched = new WatchedTable();
+		watched->path = table->path;
+		watched->table = table;
+		watched->generation = 0;
+
+		table->refs++;
+
+		watched_tables.insert(make_pair(table->path,watched));
+	}
+
+	pthread_mutex_unlock(&table_lock);
+
+	return watched;
+}
+
+OperationTable * OperationTable::current(WatchedTable * watched, unsigned int & generation) {
+	OperationTable * table;
+
+	pthread_mutex_lock(&table_lock);
+
+	table = watched->table;
+	table->refs++;
+	generation = watched->generation;
+
+	pthread_mutex_unlock(&table_lock);
+
+	return table;
+}
+
+OperationTable * OperationTable::arrange(OperationTable * fresh, const OperationTable * old, int & errors) {
+	OperationTable * arranged;
+	bool same = (fresh->size() >= old->size());
+
+	errors = 0;
+
+	for(unsigned int i = 0 ; i < old->size() ; i++) {
+		if(fresh->find(old->getName(i)) < 0) {
+			cout << "ERROR: Operation "<< old->getName(i) <<" removed from "<< old->path <<" (operations can not be removed while the file is watched)"<<endl;
+			errors++;
+		}
+		else if(same && fresh->getName(i) != old->getName(i)) {
+			same = false;
+		}
+	}
+
+	// Usually the operations keep their order and the table is used as it is (a mapped table stays mapped)
+	if(errors > 0 || same)
+		return fresh;
+
+	arranged = new OperationTable();
+
+	for(unsigned int i = 0 ; i < old->size() ; i++)
+		arranged->addOperation(fresh->getOperation(fresh->find(old->getName(i))));
+
+	for(unsigned int i = 0 ; i < fresh->size() ; i++) {
+		if(old->find(fresh->getName(i)) < 0)
+			arranged->addOperation(fresh->getOperation(i));
+	}
+
+	fresh->release();
+
+	return arranged;
+}
+
+bool OperationTable::reload(const string & path) {
+	map<string,WatchedTable *>::iterator it;
+	map<string,OperationTable *>::iterator cached;
+	WatchedTable * watched = NULL;
+	OperationTable * fresh;
+	OperationTable * old;
+	ReloadStatus status;
+	long long start = now_us_caloe();
+	struct stat st;
+
+	pthread_mutex_lock(&reload_lock);
+
+	pthread_mutex_lock(&table_lock);
+
+	it = watched_tables.find(path);
+
+	if(it != watched_tables.end())
+		watched = it->second;
+
+	pthread_mutex_unlock(&table_lock);
+
+	if(watched == NULL) {
+		pthread_mutex_unlock(&reload_lock);
+		return false;
+	}
+
+	if(stat(path.c_str(),&st) != 0) {
+		st.st_mtime = 0;
+		st.st_size = 0;
+	}
+
+	// Only reloads change the published table, it can be read without the table lock here
+	old = watched->table;
+
+	fresh = new OperationTable();
+	status.errors = fresh->open(path);
+
+	if(status.errors == 0)
+		fresh = arrange(fresh,old,status.errors);
+
+	if(status.errors == 0) {
+		fresh->path = path;
+		fresh->mtime = st.st_mtime;
+		fresh->file_size = st.st_size;
+
+		pthread_mutex_lock(&table_lock);
+
+		// The table is published before its generation: a holder that sees the new generation gets it
+		watched->table = fresh;
+		__sync_fetch_and_add(&watched->generation,1);
+
+		// Later loads of the file get the same table (one more reference for the cache)
+		fresh->refs++;
+
+		cached = tables.find(path);
+
+		if(cached != tables.end()) {
+			if(--(cached->second->refs) == 0)
+				delete cached->second;
+
+			cached->second = fresh;
+		}
+		else {
+			tables.insert(make_pair(path,fresh));
+		}
+
+		pthread_mutex_unlock(&table_lock);
+
+		// Holders of the old table go on with it until they take the new one
+		old->release();
+	}
+	else {
+		cout << "ERROR: Configuration file "<< path <<" not reloaded ("<< status.errors <<" errors), the previous operations are kept"<<endl;
+		fresh->release();
+	}
+
+	status.path = path;
+	status.elapsed = now_us_caloe() - start;
+	status.generation = watched->generation;
+
+	pthread_mutex_unlock(&reload_lock);
+
+	if(reload_callback != NULL)
+		reload_callback(status,reload_user);
+
+	return status.errors == 0;
+}
+
+void OperationTable::stopWatching() {
+	bool started;
+
+	pthread_mutex_lock(&table_lock);
+
+	started = watcher_started;
+	watcher_started = false;
+
+	pthread_mutex_unlock(&table_lock);
+
+	// The thread may be reloading a file (it takes the table lock)
+	if(started)
+		stop_watch_caloe(&watcher);
+}
+
+void OperationTable::setReloadCallback(reload_callback_caloe callback, void * user) {
+	reload_callback = callback;
+	reload_user = user;
+}
+
+OperationTable * OperationTable::fromImage(const cfg_cache_caloe * image) {
+	map<string,OperationTable *>::iterator it;
+	OperationTable * table;
+	ostringstream key;
+
+	// Devices built from the same image share its table
+	key << "<image " << (const void *) image << ">";
+
+	pthread_mutex_lock(&table_lock);
+
+	it = tables.find(key.str());
+
+	if(it != tables.end()) {
+		table = it->second;
+	}
+	else {
+		table = new OperationTable();
+		table->image = *image;
+		table->path = key.str();
+
+		tables.insert(make_pair(key.str(),table));
+	}
+
+	// One reference for the cache and one for the caller
+	table->refs++;
+
+	pthread_mutex_unlock(&table_lock);
+
+	return table;
+}
+
+bool OperationTable::compileImage(const string & path, string & image) {
+	OperationTable * table;
+	uint64_t hash;
+	uint64_t size;
+	bool ok;
+
+	if(hash_cfg_file_caloe(path.c_str(),&hash,&size) != ALL_OK) {
+		cout << "ERROR: Could not read configuration file "<< path <<endl;
+		return false;
+	}
+
+	table = new OperationTable();
+
+	if((ok = (table->parse(path) == 0)))
+		table->build(image,hash,size);
+
+	table->release();
+
+	return ok;
+}
+
+bool OperationTable::compile(const string & path, const string & output) {
+	string image;
+
+	if(!compileImage(path,image))
+		return false;
+
+	if(write_cfg_cache_caloe(output.c_str(),image.data(),image.size()) != ALL_OK) {
+		cout << "ERROR: Could not write compiled configuration file "<< output <<endl;
+		return false;
+	}
+
+	return true;
+}
+
+string OperationTable::compiledPath(const string & path) {
+	string suffix = string(".cfg") + CFG_CACHE_SUFFIX;
+
+	if(path.size() >= suffix.size() && path.compare(path.size()-suffix.size(),suffix.size(),suffix) == 0)
+		return path;
+
+	return path + CFG_CACHE_SUFFIX;
+}
+
+void OperationTable::setAutoCompile(bool enable) {
+	auto_compile = enable;
+}
+
+OperationTable * OperationTable::acquire() {
+	pthread_mutex_lock(&table_lock);
+	refs++;
+	pthread_mutex_unlock(&table_lock);
+
+	return this;
+}
+
+void OperationTable::release() {
+	bool last;
+
+	pthread_mutex_lock(&table_lock);
+	last = (--refs == 0);
+	pthread_mutex_unlock(&table_lock);
+
+	if(last)
+		delete this;
+}
+
+OperationTable * OperationTable::detach() {
+	OperationTable * table;
+	bool shared;
+
+	pthread_mutex_lock(&table_lock);
+	shared = (refs > 1);
+	pthread_mutex_unlock(&table_lock);
+
+	if(!shared)
+		return this;
+
+	// Copy-on-write: the caller moves its reference to a private copy
+	table = new OperationTable();
+	table->copyOperations(*this);
+	release();
+
+	return table;
+}
+
+bool OperationTable::addOperation(const Operation & op) {
+	// A mapped table is turned into a plain one before it is changed
+	if(image.base != NULL)
+		unmap();
+
+	if(!index_operation.insert(op.getName(),list_operation.size()))
+		return false;
+
+	list_operation.push_back(op);
+
+	return true;
+}
+
+int OperationTable::find(const string & name) const {
+	if(image.base != NULL)
+		return find_cfg_operation_caloe(&image,name.c_str());
+
+	return index_operation.find(name);
+}
+
+unsigned int OperationTable::size() const {
+	if(image.base != NULL)
+		return image.header->noperations;
+
+	return list_operation.size();
+}
+
+string OperationTable::getName(int i) const {
+	if(image.base != NULL)
+		return image.strings + image.operations[i].name;
+
+	return list_operation[i].getName();
+}
+
+const Operation & OperationTable::getOperation(int i) const {
+	if(image.base != NULL)
+		return decode(i);
+
+	return list_operation[i];
+}
+
+OperationTable::~OperationTable() {
+	for(unsigned int i = 0 ; i < decoded.size() ; i++)
+		delete decoded[i];
+
+	dropImage();
+}
+
+}
@@ -0,0 +1,399 @@
+/**
+ ******************************************************************************* 
+ * @file OperationTable.h
+ *  @brief Operation table class header file
+ * 
+ *  Operations parsed from a configuration file. Tables are reference counted and
+ *  shared by all devices loaded from the same file (each file is parsed once).
+ *  A configuration file can be compiled (see cfgcache_internals.h and cfgc_spec.run): the compiled
+ *  file is mapped in memory and its operations are decoded the first time they are used.
+ *  A configuration file can be watched (see watch_internals.h): when it changes, it is
+ *  parsed again in the background and the new table replaces the old one as a whole.
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef OPERATION_TABLE_CALOE_H
+#define OPERATION_TABLE_CALOE_H
+
+#include "Operation.h"
+#include "NameIndex.h"
+#include "cfgcache_internals.h"
+
+#include <sys/types.h>
+#include <time.h>
+
+using namespace std;
+
+namespace caloe {
+
+class OperationTable;
+
+/** @brief Result of a reload of a watched configuration file **/
+
+struct ReloadStatus {
+	/// Configuration file (canonical path)
+	string path;
+	
+	/// Errors found (the previous operations are kept if there is any)
+	int errors;
+	
+	/// Time (us) to parse the file and publish its operations
+	long elapsed;
+	
+	/// Number of tables published for the file (it does not change if there are errors)
+	unsigned int generation;
+};
+
+/** @brief Function called after each reload (from the thread of the watcher) **/
+
+typedef void (*reload_callback_caloe)(const ReloadStatus & status, void * user);
+
+/** @brief Last operations of a watched configuration file (see OperationTable::watch). A reload
+ *  publishes a new table and then a new generation (read-copy-update): holders compare the generation
+ *  without locks and take the new table when it changes, the old one is freed by its last holder.
+ **/
+
+struct WatchedTable {
+	/// Configuration file (canonical path)
+	string path;
+	
+	/// Last published table (the watched file holds one reference)
+	OperationTable * table;
+	
+	/// Number of tables published
+	volatile unsigned int generation;
+};
+
+/** @brief Immutable list of operations shared by several devices. A device that changes the
+ *  table (e.g. adds an operation) gets its own copy first (copy-on-write).
+ **/
+
+class OperationTable {
+	private:
+	
+		/// Operations (in the order they were added)
+		
+		vector<Operation> list_operation;
+		
+		/// Hashed index of operation names
+		
+		NameIndex index_operation;
+		
+		/// Number of holders of the table (devices and the file cache)
+		
+		int refs;
+		
+		/// Configuration file of the table (empty if it is not cached)
+		
+		string path;
+		
+		/// Modification time of the file when it was parsed
+		
+		time_t mtime;
+		
+		/// Size of the file when it was parsed
+		
+		off_t file_size;
+		
+		/// Compiled configuration file the operations come from (none if base is NULL)
+		
+		cfg_cache_caloe image;
+		
+		/// The image is a mapping owned by the table (false: static image, see fromImage)
+		
+		bool mapped;
+		
+		/// Operations of the compiled file already decoded (NULL: not used yet)
+		
+		mutable vector<Operation *> decoded;
+		
+		/** @brief Tables are not copied nor assigned, they are shared (declared but not defined) **/
+		 
+		OperationTable(const OperationTable & table);
+		
+		OperationTable operator=(const OperationTable & table);
+		
+		/** @brief Copy the operations of another table into this empty one (see detach)
+		 *
+		 *  @param table Table to copy
+		 **/
+		 
+		void copyOperations(const OperationTable & table);
+		
+		/** @brief Parse the operations of a configuration file
+		 * 
+		 * @param path Absolute/relative path of the configuration file
+		 * 
+		 * @return Number of errors found
+		 */
+		 
+		int parse(const string & path);
+		
+		/** @brief Get the operations of a configuration file. The compiled file is used if it was compiled
+		 *  from the same contents, otherwise the file is parsed (and compiled if auto compilation is enabled).
+		 * 
+		 * @param path Absolute/relative path of the configuration file (or of a compiled file)
+		 * 
+		 * @return Number of errors found
+		 */
+		 
+		int open(const string & path);
+		
+		/** @brief Get a reloaded table that keeps the operation indices of the previous one (handles
+		 *  stay valid). New operations are added after the old ones; removed operations are errors.
+		 * 
+		 * @param fresh Reloaded table (the reference of the caller moves to the returned table)
+		 * 
+		 * @param old Previous table
+		 * 
+		 * @param errors Number of removed operations
+		 * 
+		 * @return Table with the operations of fresh
+		 */
+		 
+		static OperationTable * arrange(OperationTable * fresh, const OperationTable * old, int & errors);
+		
+		/** @brief Write the operations of the table as a compiled configuration file
+		 * 
+		 * @param path Path of the compiled file
+		 * 
+		 * @param hash Hash of the source configuration file
+		 * 
+		 * @param size Size of the source configuration file
+		 * 
+		 * @return true if it is written or false otherwise
+		 */
+		 
+		bool save(const string & path, uint64_t hash, uint64_t size) const;
+		
+		/** @brief Build the compiled image of the operations of the table (see cfgcache_internals.h)
+		 * 
+		 * @param image Image
+		 * 
+		 * @param hash Hash of the source configuration file
+		 * 
+		 * @param size Size of the source configuration file
+		 */
+		 
+		void build(string & image, uint64_t hash, uint64_t size) const;
+		
+		/** @brief Build an operation of the compiled file
+		 * 
+		 * @param i Operation index
+		 * 
+		 * @return Operation (kept until the table is freed)
+		 */
+		 
+		const Operation & decode(int i) const;
+		
+		/** @brief Decode every operation of the compiled file and drop the mapping (the table can be changed) **/
+		
+		void unmap();
+		
+		/** @brief Forget the image (a mapping owned by the table is unmapped) **/
+		
+		void dropImage();
+		
+		/** @brief OperationTable destructor (tables are freed by release) **/
+		
+		~OperationTable();
+
+	public:
+	
+		/** @brief OperationTable default constructor (empty table with one holder) **/
+		
+		OperationTable();
+		
+		/** @brief Get the table of a configuration file. The file is parsed the first time and again only if
+		 *  it has changed on disk; later calls share the same table.
+		 * 
+		 * @param path Absolute/relative path of the configuration file
+		 * 
+		 * @return Shared table (the caller holds one reference, see release)
+		 */
+		 
+		static OperationTable * load(const string & path);
+		
+		/** @brief Get the table of an image built into the program (see cfgc_spec -g). Nothing is read or
+		 *  parsed; operations are decoded from the image the first time they are used.
+		 * 
+		 * @param image Static image (it must live until the program ends)
+		 * 
+		 * @return Shared table (the caller holds one reference, see release)
+		 */
+		 
+		static OperationTable * fromImage(const cfg_cache_caloe * image);
+		
+		/** @brief Get the compiled image of a configuration file
+		 * 
+		 * @param path Absolute/relative path of the configuration file
+		 * 
+		 * @param image Image (see cfgcache_internals.h)
+		 * 
+		 * @return true if the file has no errors or false otherwise
+		 */
+		 
+		static bool compileImage(const string & path, string & image);
+		
+		/** @brief Drop the cached tables (devices keep the tables they hold) **/
+		
+		static void clearCache();
+		
+		/** @brief Watch the configuration file of a table. The file is parsed again in the background
+		 *  each time it changes (see reload).
+		 * 
+		 * @param table Table loaded from a configuration file (see load)
+		 * 
+		 * @return Watched file or NULL if the table does not come from a configuration file (copies and
+		 *  images built into the program, see cfgc_spec.run -g) or the file can not be watched
+		 */
+		 
+		static WatchedTable * watch(OperationTable * table);
+		
+		/** @brief Get the last table of a watched file
+		 * 
+		 * @param watched Watched file
+		 * 
+		 * @param generation Generation of the table
+		 * 
+		 * @return Shared table (the caller holds one reference, see release)
+		 */
+		 
+		static OperationTable * current(WatchedTable * watched, unsigned int & generation);
+		
+		/** @brief Parse a watched configuration file again and publish its operations. If the file has
+		 *  errors, the previous operations are kept. It is called by the watcher when the file changes.
+		 * 
+		 * @param path Configuration file (canonical path, see WatchedTable)
+		 * 
+		 * @return true if the new operations are published or false otherwise
+		 */
+		 
+		static bool reload(const string & path);
+		
+		/** @brief Set the function called after each reload (timing and errors, see ReloadStatus)
+		 * 
+		 * @param callback Reload callback (NULL: none)
+		 * 
+		 * @param user User pointer passed to callback
+		 */
+		 
+		static void setReloadCallback(reload_callback_caloe callback, void * user);
+		
+		/** @brief Stop the thread that watches the configuration files. Devices keep their last operations;
+		 *  the files are watched again by the next watch.
+		 **/
+		 
+		static void stopWatching();
+		
+		/** @brief Compile a configuration file
+		 * 
+		 * @param path Absolute/relative path of the configuration file
+		 * 
+		 * @param output Path of the compiled file
+		 * 
+		 * @return true if the file has no errors and the compiled file is written or false otherwise
+		 */
+		 
+		static bool compile(const string & path, const string & output);
+		
+		/** @brief Get the path of the compiled file of a configuration file (dio.cfg: dio.cfgc)
+		 * 
+		 * @param path Path of the configuration file
+		 * 
+		 * @return Path of the compiled file (the same path if it is already a compiled file)
+		 */
+		 
+		static string compiledPath(const string & path);
+		
+		/** @brief Enable or disable the compilation of configuration files when they are parsed (disabled by
+		 *  default). A compiled file that is already there (see cfgc_spec.run) is used either way.
+		 * 
+		 * @param enable true to write the compiled file next to each parsed configuration file
+		 */
+		 
+		static void setAutoCompile(bool enable);
+		
+		/** @brief Take one more reference of the table
+		 * 
+		 * @return The table
+		 */
+		 
+		OperationTable * acquire();
+		
+		/** @brief Drop one reference of the table (it is freed with the last one) **/
+		
+		void release();
+		
+		/** @brief Get a table that can be changed by one holder. If the table is shared, it is copied and the
+		 *  reference of the caller moves to the copy.
+		 * 
+		 * @return Table only held by the caller
+		 */
+		 
+		OperationTable * detach();
+		
+		/** @brief Add a new operation to the table (the table must not be shared, see detach)
+		 * 
+		 * @param op New operation
+		 * 
+		 * @return true if it is added or false if the operation exists already
+		 */
+		 
+		bool addOperation(const Operation & op);
+		
+		/** @brief Search an operation
+		 * 
+		 * @param name Operation name
+		 * 
+		 * @return Operation index or -1 if it is not found
+		 */
+		 
+		int find(const string & name) const;
+		
+		/** @brief Get the number of operations **/
+		
+		unsigned int size() const;
+		
+		/** @brief Get the name of an operation (the operation is not decoded)
+		 * 
+		 * @param i Operation index
+		 * 
+		 * @return Operation name
+		 */
+		 
+		string getName(int i) const;
+		
+		/** @brief Get an operation
+		 * 
+		 * @param i Operation index
+		 * 
+		 * @return Operation
+		 */
+		 
+		const Operation & getOperation(int i) const;
+};
+
+}
+
+#endif
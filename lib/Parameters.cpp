@@ -40,6 +40,8 @@ ParamAccess::ParamAccess() {
 	offset = 0;
 	value = 0x00;
 	mask = 0;
+	endpoint = 0;
+	endpoint_base = 0;
 }
 
 ParamAccess::ParamAccess(const ParamAccess & pa) {
@@ -49,6 +51,8 @@ ParamAccess::ParamAccess(const ParamAccess & pa) {
 	offset = pa.offset;
 	mask = pa.mask;
 	value = pa.value;
+	endpoint = pa.endpoint;
+	endpoint_base = pa.endpoint_base;
 }
 
 ParamAccess ParamAccess::operator=(const ParamAccess & pa) {
@@ -58,6 +62,8 @@ ParamAccess ParamAccess::operator=(const ParamAccess & pa) {
 	offset = pa.offset;
 	mask = pa.mask;
 	value = pa.value;
+	endpoint = pa.endpoint;
+	endpoint_base = pa.endpoint_base;
 
 	return *this;
 }
@@ -67,6 +73,7 @@ void ParamAccess::setIP(string netaddress) {
 	parameters |= PARAM_NETADDRESS;
 	// Copy netaddress
 	this->netaddress = netaddress;
+	resolveEndpoint();
 }
 
 void ParamAccess::setPort(unsigned int port) {
@@ -74,6 +81,7 @@ void ParamAccess::setPort(unsigned int port) {
 	parameters |= PARAM_PORT;
 	// Copy port
 	this->port = port;
+	resolveEndpoint();
 }
 
 void ParamAccess::setOffset(unsigned int offset) {
@@ -101,6 +109,10 @@ string ParamAccess::getIP() const {
 	return netaddress;
 }
 
+const string & ParamAccess::getIPRef() const {
+	return netaddress;
+}
+
 unsigned int ParamAccess::getPort() const {
 	return port;
 }
@@ -117,6 +129,41 @@ int ParamAccess::getValue() const {
 	return value;
 }
 
+void ParamAccess::resolveEndpoint() {
+	char given = parameters & (PARAM_NETADDRESS | PARAM_PORT);
+
+	endpoint = 0;
+	endpoint_base = 0;
+
+	if(given == (PARAM_NETADDRESS | PARAM_PORT)) {
+		endpoint = register_endpoint_caloe(netaddress.c_str(),port);
+	}
+	else if(given == PARAM_NETADDRESS) {
+		endpoint = register_endpoint_caloe(netaddress.c_str(),ENDPOINT_DEFAULT_PORT);
+		endpoint_base = ENDPOINT_DEFAULT_PORT;
+	}
+}
+
+int ParamAccess::getEndpoint(const Netcon & nc) const {
+	char given = parameters & (PARAM_NETADDRESS | PARAM_PORT);
+
+	if(given == PARAM_NONE)
+		return nc.getEndpoint();
+
+	if(given == (PARAM_NETADDRESS | PARAM_PORT))
+		return endpoint;
+
+	// Missing port or netaddress come from the access
+	if(given == PARAM_NETADDRESS) {
+		if(endpoint != 0 && endpoint_base == nc.getPort())
+			return endpoint;
+
+		return register_endpoint_caloe(netaddress.c_str(),nc.getPort());
+	}
+
+	return register_endpoint_caloe(nc.getIP().c_str(),port);
+}
+
 char ParamAccess::getParametersMask() const {
 	return parameters;
 }
@@ -160,6 +207,8 @@ istream & operator>>(istream & is, ParamAccess & pa) {
 	cout << "Value: ";
 	is >> pa.value;
 
+	pa.resolveEndpoint();
+
 	return is;
 }
 
@@ -188,6 +237,14 @@ vector<ParamAccess> ParamOperation::getParamAccess() const {
 	return parameter_values;
 }
 
+unsigned int ParamOperation::getNumParams() const {
+	return parameter_values.size();
+}
+
+const ParamAccess & ParamOperation::getParam(unsigned int index) const {
+	return parameter_values.at(index);
+}
+
 ostream & operator<<(ostream & os, ParamOperation & po) {
 	vector<ParamAccess>::iterator it;
 
@@ -325,6 +382,14 @@ vector<int> ParamConfig::getMasksParam() {
 	return masks;
 }
 
+int ParamConfig::getOffsetParam(unsigned int index) const {
+	return offsets.at(index);
+}
+
+int ParamConfig::getMaskParam(unsigned int index) const {
+	return masks.at(index);
+}
+
 ostream & operator<<(ostream & os, ParamConfig & pc) {
 	vector<int>::iterator it;
 	int par = pc.parameters;
@@ -39,6 +39,7 @@
 #include <stdio.h>
 
 #include "Utils.h"
+#include "Netcon.h"
 
 using namespace std;
 
@@ -98,6 +99,20 @@ class ParamAccess {
 		/// User value
 		
 		int value;
+		
+		/// Endpoint handle of netaddress and port, registered when they are set (0: user does not give netaddress)
+		
+		int endpoint;
+		
+		/// Port used to register endpoint when user only gives netaddress (the default one)
+		
+		unsigned int endpoint_base;
+		
+		/** @brief Register user netaddress and port and keep their endpoint handle. If user only gives
+		 *  netaddress, it is registered with the default port (the usual port of the accesses).
+		 */
+		 
+		void resolveEndpoint();
 
 	public:
 	
@@ -160,6 +175,10 @@ class ParamAccess {
 		 
 		string getIP() const;
 		
+		/** @brief Get user IP netaddress parameter (without copy) **/
+		 
+		const string & getIPRef() const;
+		
 		/** @brief Get user port parameter **/
 		
 		unsigned int getPort() const;
@@ -172,6 +191,16 @@ class ParamAccess {
 		
 		unsigned int getMask() const;
 		
+		/** @brief Get endpoint handle of user netaddress and port. The handle registered by the setters is
+		 *  used when it matches the access, otherwise the registry is searched (see register_endpoint_caloe).
+		 * 
+		 *  @param nc Network parameters of the access (used for netaddress or port if user does not give them)
+		 * 
+		 *  @return Endpoint handle or ERROR_ENDPOINT if netaddress or port are not valid
+		 */
+		 
+		int getEndpoint(const Netcon & nc) const;
+		
 		/** @brief Get parameter metadata (param mask)  **/
 		
 		char getParametersMask() const;
@@ -257,6 +286,17 @@ class ParamOperation {
 		 
 		vector<ParamAccess> getParamAccess() const;
 		
+		/** @brief Get number of ParamAccess in ParamOperation **/
+		 
+		unsigned int getNumParams() const;
+		
+		/** @brief Get one ParamAccess (without copy)
+		 * 
+		 *  @param index Access index
+		 */
+		 
+		const ParamAccess & getParam(unsigned int index) const;
+		
 		/** @brief Print ParamOperation information
 		 * 
 		 *  @param os Output stream
@@ -377,6 +417,20 @@ class ParamConfig {
 		
 		vector<int> getMasksParam();
 		
+		/** @brief Get one offset of the Offset vector (without copy)
+		 * 
+		 *  @param index Offset index
+		 */
+		 
+		int getOffsetParam(unsigned int index) const;
+		
+		/** @brief Get one mask of the Mask vector (without copy)
+		 * 
+		 *  @param index Mask index
+		 */
+		 
+		int getMaskParam(unsigned int index) const;
+		
 		/** @brief Print ParamConfig information
 		 * 
 		 *  @param os Output stream
@@ -0,0 +1,228 @@
+/**
+ ******************************************************************************* 
+ * @file RetryPolicy.cpp
+ *  @brief Retry policy class source file
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+ 
+#include "RetryPolicy.h"
+#include "session_internals.h"
+
+#include <map>
+#include <pthread.h>
+
+namespace caloe {
+
+/// Retries left of one endpoint (token bucket)
+
+struct RetryBudget {
+	double tokens;
+	long long last;
+};
+
+/// Budgets of all endpoints by handle (shared by every policy)
+static map<int,RetryBudget> budgets;
+
+/// It protects budgets and the jitter generator
+static pthread_mutex_t budget_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// Seed of the jitter generator
+static unsigned int jitter_seed = 1;
+
+RetryPolicy::RetryPolicy() {
+	max_retries = MAX_RETRY;
+	deadline = RETRY_DEADLINE;
+	backoff_min = RETRY_BACKOFF_MIN;
+	backoff_max = RETRY_BACKOFF_MAX;
+	jitter = RETRY_JITTER;
+	budget = RETRY_BUDGET;
+	budget_period = RETRY_BUDGET_PERIOD;
+}
+
+RetryPolicy::RetryPolicy(int max_retries, long deadline) {
+	this->max_retries = max_retries;
+	this->deadline = deadline;
+	backoff_min = RETRY_BACKOFF_MIN;
+	backoff_max = RETRY_BACKOFF_MAX;
+	jitter = RETRY_JITTER;
+	budget = RETRY_BUDGET;
+	budget_period = RETRY_BUDGET_PERIOD;
+}
+
+RetryPolicy::RetryPolicy(const RetryPolicy & policy) {
+	max_retries = policy.max_retries;
+	deadline = policy.deadline;
+	backoff_min = policy.backoff_min;
+	backoff_max = policy.backoff_max;
+	jitter = policy.jitter;
+	budget = policy.budget;
+	budget_period = policy.budget_period;
+}
+
+RetryPolicy RetryPolicy::operator=(const RetryPolicy & policy) {
+	max_retries = policy.max_retries;
+	deadline = policy.deadline;
+	backoff_min = policy.backoff_min;
+	backoff_max = policy.backoff_max;
+	jitter = policy.jitter;
+	budget = policy.budget;
+	budget_period = policy.budget_period;
+
+	return *this;
+}
+
+int RetryPolicy::getMaxRetries() const {
+	return max_retries;
+}
+
+long RetryPolicy::getDeadline() const {
+	return deadline;
+}
+
+long RetryPolicy::getBackoffMin() const {
+	return backoff_min;
+}
+
+long RetryPolicy::getBackoffMax() const {
+	return backoff_max;
+}
+
+double RetryPolicy::getJitter() const {
+	return jitter;
+}
+
+int RetryPolicy::getBudget() const {
+	return budget;
+}
+
+long RetryPolicy::getBudgetPeriod() const {
+	return budget_period;
+}
+
+void RetryPolicy::setMaxRetries(int max_retries) {
+	this->max_retries = max_retries;
+}
+
+void RetryPolicy::setDeadline(long deadline) {
+	this->deadline = deadline;
+}
+
+void RetryPolicy::setBackoff(long backoff_min, long backoff_max, double jitter) {
+	this->backoff_min = backoff_min;
+	this->backoff_max = backoff_max;
+	this->jitter = jitter;
+}
+
+void RetryPolicy::setBudget(int budget, long budget_period) {
+	this->budget = budget;
+	this->budget_period = budget_period;
+}
+
+bool RetryPolicy::expired(long long start) const {
+	return deadline >= 0 && now_us_caloe() - start >= deadline;
+}
+
+long RetryPolicy::nextDelay(int retry) const {
+	long delay = backoff_min;
+	double r;
+
+	// Exponential backoff capped to backoff_max
+	for(int i = 0 ; i < retry && delay < backoff_max ; i++)
+		delay *= 2;
+
+	if(delay > backoff_max)
+		delay = backoff_max;
+
+	// Spread retries of many callers (a part of the delay is random)
+	pthread_mutex_lock(&budget_lock);
+	r = (double) rand_r(&jitter_seed)/RAND_MAX;
+	pthread_mutex_unlock(&budget_lock);
+
+	return (long) (delay*(1.0 - jitter*r));
+}
+
+bool RetryPolicy::takeBudget(int endpoint) const {
+	long long now = now_us_caloe();
+	bool ok;
+
+	if(budget < 0)
+		return true;
+
+	pthread_mutex_lock(&budget_lock);
+
+	map<int,RetryBudget>::iterator it = budgets.find(endpoint);
+
+	if(it == budgets.end()) {
+		RetryBudget b;
+
+		b.tokens = budget;
+		b.last = now;
+
+		it = budgets.insert(make_pair(endpoint,b)).first;
+	}
+
+	// Refill the budget in proportion to the elapsed time
+	if(budget_period > 0)
+		it->second.tokens += (double) (now - it->second.last)*budget/budget_period;
+
+	if(it->second.tokens > budget)
+		it->second.tokens = budget;
+
+	it->second.last = now;
+
+	ok = (it->second.tokens >= 1);
+
+	if(ok)
+		it->second.tokens -= 1;
+
+	pthread_mutex_unlock(&budget_lock);
+
+	return ok;
+}
+
+bool RetryPolicy::allowRetry(int endpoint, int retry, long long start, long delay) const {
+	if(max_retries >= 0 && retry >= max_retries)
+		return false;
+
+	// The retry would end after the deadline
+	if(deadline >= 0 && now_us_caloe() + delay - start >= deadline)
+		return false;
+
+	return takeBudget(endpoint);
+}
+
+bool RetryPolicy::waitRetry(int endpoint, int retry, long long start) const {
+	long delay = nextDelay(retry);
+
+	if(!allowRetry(endpoint,retry,start,delay))
+		return false;
+
+	if(delay > 0)
+		usleep(delay);
+
+	return true;
+}
+
+RetryPolicy::~RetryPolicy() {}
+
+}
@@ -0,0 +1,253 @@
+/**
+ ******************************************************************************* 
+ * @file RetryPolicy.h
+ *  @brief Retry policy class header file
+ * 
+ *  - Deadline of an operation
+ *  - Capped exponential backoff with jitter between retries
+ *  - Retry budget per endpoint
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef RETRY_POLICY_CALOE_H
+#define RETRY_POLICY_CALOE_H
+
+#include <string>
+
+using namespace std;
+
+namespace caloe {
+
+/// Default max number of retries of a failed access (-1: NOT LIMITED)
+#define MAX_RETRY -1
+
+/// Default deadline (us) of an operation, retries included (-1: NOT LIMITED)
+#define RETRY_DEADLINE 5000000
+
+/// Default delay (us) before the first retry
+#define RETRY_BACKOFF_MIN 1000
+
+/// Default max delay (us) between retries
+#define RETRY_BACKOFF_MAX 200000
+
+/// Default fraction of the delay chosen at random (0: no jitter, 1: full jitter)
+#define RETRY_JITTER 0.5
+
+/// Default retries allowed per endpoint in each budget period (-1: NOT LIMITED)
+#define RETRY_BUDGET 50
+
+/// Default budget period (us)
+#define RETRY_BUDGET_PERIOD 1000000
+
+/** @brief Decides if (and when) a failed access is retried. Budgets are shared by all policies:
+ *  once an endpoint has spent its retries, every operation on it fails fast until the budget refills.
+ **/
+
+class RetryPolicy {
+	private:
+	
+		/// Max number of retries of a failed access (-1: NOT LIMITED)
+		
+		int max_retries;
+		
+		/// Deadline (us) of an operation (-1: NOT LIMITED)
+		
+		long deadline;
+		
+		/// Delay (us) before the first retry (doubled on each retry)
+		
+		long backoff_min;
+		
+		/// Max delay (us) between retries
+		
+		long backoff_max;
+		
+		/// Fraction of the delay chosen at random
+		
+		double jitter;
+		
+		/// Retries allowed per endpoint in each budget period (-1: NOT LIMITED)
+		
+		int budget;
+		
+		/// Budget period (us)
+		
+		long budget_period;
+		
+		/** @brief Spend one retry of the budget of an endpoint
+		 * 
+		 * @param endpoint Endpoint handle
+		 * 
+		 * @return true if the budget had retries left or false otherwise
+		 */
+		 
+		bool takeBudget(int endpoint) const;
+	
+	public:
+	
+		/** @brief RetryPolicy default constructor (RETRY_* macros) **/
+		
+		RetryPolicy();
+		
+		/** @brief RetryPolicy constructor with arguments (default backoff and budget)
+		 * 
+		 * @param max_retries Max number of retries of a failed access (-1: NOT LIMITED)
+		 * 
+		 * @param deadline Deadline (us) of an operation (-1: NOT LIMITED)
+		 */
+		 
+		RetryPolicy(int max_retries, long deadline);
+		
+		/** @brief RetryPolicy constructor from another RetryPolicy instance 
+		 *
+		 *  @param policy Instance to copy
+		 **/
+		 
+		RetryPolicy(const RetryPolicy & policy);
+		
+		/** @brief RetryPolicy Asignment operator 
+		 *
+		 *  @param policy Intance to copy
+		 * 
+		 *  @return New RetryPolicy instance 
+		 **/
+		 
+		RetryPolicy operator=(const RetryPolicy & policy);
+		
+		/** @brief Get max number of retries **/
+		
+		int getMaxRetries() const;
+		
+		/** @brief Get deadline (us) **/
+		
+		long getDeadline() const;
+		
+		/** @brief Get delay (us) before the first retry **/
+		
+		long getBackoffMin() const;
+		
+		/** @brief Get max delay (us) between retries **/
+		
+		long getBackoffMax() const;
+		
+		/** @brief Get jitter fraction **/
+		
+		double getJitter() const;
+		
+		/** @brief Get retries allowed per endpoint in each budget period **/
+		
+		int getBudget() const;
+		
+		/** @brief Get budget period (us) **/
+		
+		long getBudgetPeriod() const;
+		
+		/** @brief Set max number of retries
+		 * 
+		 * @param max_retries Max number of retries of a failed access (-1: NOT LIMITED)
+		 */
+		 
+		void setMaxRetries(int max_retries);
+		
+		/** @brief Set deadline
+		 * 
+		 * @param deadline Deadline (us) of an operation (-1: NOT LIMITED)
+		 */
+		 
+		void setDeadline(long deadline);
+		
+		/** @brief Set backoff
+		 * 
+		 * @param backoff_min Delay (us) before the first retry
+		 * 
+		 * @param backoff_max Max delay (us) between retries
+		 * 
+		 * @param jitter Fraction of the delay chosen at random (0..1)
+		 */
+		 
+		void setBackoff(long backoff_min, long backoff_max, double jitter);
+		
+		/** @brief Set retry budget of each endpoint
+		 * 
+		 * @param budget Retries allowed per endpoint in each period (-1: NOT LIMITED)
+		 * 
+		 * @param budget_period Budget period (us)
+		 */
+		 
+		void setBudget(int budget, long budget_period);
+		
+		/** @brief Check if the deadline of an operation has expired
+		 * 
+		 * @param start Start timestamp (us, see now_us_caloe)
+		 * 
+		 * @return true if it has expired or false otherwise
+		 */
+		 
+		bool expired(long long start) const;
+		
+		/** @brief Get the delay before a retry (capped exponential backoff with jitter)
+		 * 
+		 * @param retry Number of retries already done
+		 * 
+		 * @return Delay (us)
+		 */
+		 
+		long nextDelay(int retry) const;
+		
+		/** @brief Check if a retry is allowed (retries left, deadline not reached after the delay and
+		 *  budget of the endpoint). It spends one retry of the budget.
+		 * 
+		 * @param endpoint Endpoint handle (see register_endpoint_caloe)
+		 * 
+		 * @param retry Number of retries already done
+		 * 
+		 * @param start Start timestamp (us) of the operation
+		 * 
+		 * @param delay Delay (us) before the retry
+		 * 
+		 * @return true if the access can be retried or false otherwise
+		 */
+		 
+		bool allowRetry(int endpoint, int retry, long long start, long delay) const;
+		
+		/** @brief Check if a retry is allowed and sleep its backoff delay
+		 * 
+		 * @param endpoint Endpoint handle (see register_endpoint_caloe)
+		 * 
+		 * @param retry Number of retries already done
+		 * 
+		 * @param start Start timestamp (us) of the operation
+		 * 
+		 * @return true if the access must be retried or false if it has to fail
+		 */
+		 
+		bool waitRetry(int endpoint, int retry, long long start) const;
+		
+		/** @brief RetryPolicy destructor **/
+		
+		~RetryPolicy();
+};
+
+}
+
+#endif
@@ -35,66 +35,277 @@ System::System() {}
 
 System::System(const System & sys) {
 	list_device = sys.list_device;
+	index_device = sys.index_device;
 }
 
 System System::operator=(const System & sys) {
 	list_device = sys.list_device;
+	index_device = sys.index_device;
 	
 	return *this;
 }
 
 void System::addDevice(const Device & dev) {
-	pair< map<string,Device>::iterator, bool > ret;
-	
 	// Try to insert a device into the system
-	ret = list_device.insert(make_pair(dev.getName(),dev));
-	
-	// If the device exists already in the system, print an error and return
-	if(! (ret.second)) {
+	if(index_device.insert(dev.getName(),list_device.size())) {
+		list_device.push_back(dev);
+	}
+	else { // If the device exists already in the system, print an error and return
 		cout << "ERROR: Device "<< dev.getName() <<" already exists!"<<endl;
 		cout << "IGNORING..."<<endl;
 	}
 }
 
-void System::reset(string name_dev, string name_oper) {
-	map<string,Device>::iterator it;
-	
+Device * System::findDevice(const string & name_dev) {
 	// Search a device for its name
-	it = list_device.find(name_dev);
+	int i = index_device.find(name_dev);
 
-	// If the device is found...
-	if(it != list_device.end()) {
-		//cout << "DEVICE "<<name_dev<<" found!"<<endl;
-		
-		// Reset the operation
-		(it->second).reset(name_oper);
-	}
-	else { // If it is not found, print an error and return
+	// If it is not found, print an error and return
+	if(i < 0) {
 		cout << "ERROR: Device "<<name_dev<<" not found!"<<endl;
+		return NULL;
+	}
+
+	return &list_device[i];
+}
+
+Device * System::getDevice(int device) {
+	if(device < 0 || device >= (int) list_device.size()) {
+		cout << "ERROR: Invalid device handle!"<<endl;
+		return NULL;
+	}
+
+	return &list_device[device];
+}
+
+DeviceHandle System::getDeviceHandle(const string & name_dev) const {
+	DeviceHandle handle;
+
+	handle.device = index_device.find(name_dev);
+
+	return handle;
+}
+
+OperationHandle System::getHandle(const string & name_dev, const string & name_oper) const {
+	return getHandle(getDeviceHandle(name_dev),name_oper);
+}
+
+OperationHandle System::getHandle(const DeviceHandle & dev, const string & name_oper) const {
+	OperationHandle handle;
+
+	handle.device = -1;
+	handle.operation = -1;
+
+	if(dev.device >= 0 && dev.device < (int) list_device.size()) {
+		handle = list_device[dev.device].getHandle(name_oper);
+		handle.device = dev.device;
 	}
+
+	return handle;
+}
+
+void System::reset(const string & name_dev, const string & name_oper) {
+	Device * dev = findDevice(name_dev);
+
+	// If the device is found, reset the operation
+	if(dev != NULL)
+		dev->reset(name_oper);
 }
 
-vector<eb_data_t> System::execute(string name_dev, string name_oper, ParamOperation & params) {
-	map<string,Device>::iterator it;
+vector<eb_data_t> System::execute(const string & name_dev, const string & name_oper, ParamOperation & params) {
+	Device * dev = findDevice(name_dev);
 	vector<eb_data_t> res;
 
-	// Search a device for its name
-	it = list_device.find(name_dev);
+	// If the device is found, execute an operation
+	if(dev != NULL)
+		res = dev->execute(name_oper,params);
+	
+	return res;
+}
 
-	// If the device is found...
-	if(it != list_device.end()) {
-		//cout << "DEVICE "<<name_dev<<" found!"<<endl;
-		
-		// Execute an operation
-		res = (it->second).execute(name_oper,params);
+vector<eb_data_t> System::execute(const OperationHandle & handle, ParamOperation & params) {
+	Device * dev = getDevice(handle.device);
+	vector<eb_data_t> res;
+
+	if(dev != NULL)
+		res = dev->execute(handle,params);
+
+	return res;
+}
+
+OperationResult System::execute(const string & name_dev, const string & name_oper, ParamOperation & params, const RetryPolicy & policy) {
+	Device * dev = findDevice(name_dev);
+	OperationResult res;
+
+	// If the device is found, execute an operation
+	if(dev != NULL) {
+		res = dev->execute(name_oper,params,policy);
 	}
-	else { // If it is not found, print an error and return
-		cout << "ERROR: Device "<<name_dev<<" not found!"<<endl;
+	else {
+		res.rcode = INVALID_OPERATION;
+		res.failed_access = -1;
+		res.retries = 0;
+		res.elapsed = 0;
 	}
 	
 	return res;
 }
 
+OperationResult System::execute(const OperationHandle & handle, ParamOperation & params, const RetryPolicy & policy) {
+	Device * dev = getDevice(handle.device);
+	OperationResult res;
+
+	if(dev != NULL) {
+		res = dev->execute(handle,params,policy);
+	}
+	else {
+		res.rcode = INVALID_OPERATION;
+		res.failed_access = -1;
+		res.retries = 0;
+		res.elapsed = 0;
+	}
+
+	return res;
+}
+
+long System::executeAsync(const string & name_dev, const string & name_oper, ParamOperation & params, operation_callback_caloe callback, void * user) {
+	Device * dev = findDevice(name_dev);
+
+	if(dev == NULL)
+		return INVALID_OPERATION;
+
+	return dev->executeAsync(name_oper,params,callback,user);
+}
+
+long System::executeAsync(const OperationHandle & handle, ParamOperation & params, operation_callback_caloe callback, void * user) {
+	Device * dev = getDevice(handle.device);
+
+	if(dev == NULL)
+		return INVALID_OPERATION;
+
+	return dev->executeAsync(handle,params,callback,user);
+}
+
+int System::poll(long timeout) {
+	return run_async_loop_caloe(default_async_loop_caloe(),timeout);
+}
+
+void System::wait(long handle) {
+	if(handle > 0)
+		wait_async_caloe(default_async_loop_caloe(),handle);
+}
+
+/// Slot of one board during a fan-out
+
+struct FanoutSlot {
+	EndpointResult * result;
+	int * running;
+};
+
+static void fanout_completed(int rcode, vector<eb_data_t> & values, void * user) {
+	FanoutSlot * slot = (FanoutSlot *) user;
+
+	slot->result->rcode = rcode;
+	slot->result->values = values;
+	(*(slot->running))--;
+}
+
+void System::fanout(Device & dev, const OperationHandle & handle, const vector<Netcon> & endpoints, const vector<int> & boards, ParamOperation & params, vector<EndpointResult> & res, int * claim) {
+	vector<FanoutSlot> slots(boards.size());
+	int running = 0;
+	long id;
+
+	for(unsigned int k = 0 ; k < boards.size() ; k++) {
+		int i = boards[k];
+
+		// Keep a bounded number of boards in flight
+		while(running >= MAX_FANOUT_INFLIGHT)
+			poll(TIMEOUT_LIMIT);
+
+		slots[k].result = &res[i];
+		slots[k].running = &running;
+
+		running++;
+
+		// Only the first board that succeeds updates the accesses (read values, autoincrement)
+		id = dev.executeAsync(handle,endpoints[i],params,claim,&fanout_completed,&slots[k]);
+
+		if(id < 0) {
+			res[i].rcode = (int) id;
+			running--;
+		}
+	}
+
+	// Wait for the last boards
+	while(running > 0)
+		poll(TIMEOUT_LIMIT);
+}
+
+vector<EndpointResult> System::executeAll(const string & name_dev, const string & name_oper, const vector<Netcon> & endpoints, ParamOperation & params) {
+	// One attempt per board
+	RetryPolicy policy(0,-1);
+
+	return executeAll(name_dev,name_oper,endpoints,params,policy);
+}
+
+vector<EndpointResult> System::executeAll(const string & name_dev, const string & name_oper, const vector<Netcon> & endpoints, ParamOperation & params, const RetryPolicy & policy) {
+	Device * dev;
+	OperationHandle handle;
+	vector<EndpointResult> res(endpoints.size());
+	vector<int> boards;
+	long long start = now_us_caloe();
+	int retry = 0;
+	int claim = 0;
+	long delay;
+
+	for(unsigned int i = 0 ; i < endpoints.size() ; i++) {
+		res[i].endpoint = endpoints[i];
+		res[i].rcode = ALL_OK;
+		res[i].retries = 0;
+		boards.push_back(i);
+	}
+
+	// Search the device and the operation once for all boards
+	dev = findDevice(name_dev);
+
+	if(dev != NULL && (handle = dev->getHandle(name_oper)).operation < 0)
+		cout << "ERROR: Operation "<<name_oper<<" not found!"<<endl;
+
+	// If they are not found, return
+	if(dev == NULL || handle.operation < 0) {
+		for(unsigned int i = 0 ; i < res.size() ; i++)
+			res[i].rcode = INVALID_OPERATION;
+
+		return res;
+	}
+
+	while(!boards.empty()) {
+		vector<int> failed;
+
+		fanout(*dev,handle,endpoints,boards,params,res,&claim);
+
+		delay = policy.nextDelay(retry);
+
+		// Failed boards go again if the policy allows it (the rest of the fleet is not held back)
+		for(unsigned int k = 0 ; k < boards.size() ; k++) {
+			EndpointResult & r = res[boards[k]];
+
+			if(r.rcode != ALL_OK && r.rcode != INVALID_OPERATION && policy.allowRetry(r.endpoint.getEndpoint(),retry,start,delay)) {
+				r.retries++;
+				failed.push_back(boards[k]);
+			}
+		}
+
+		if(!failed.empty() && delay > 0)
+			usleep(delay);
+
+		boards = failed;
+		retry++;
+	}
+
+	return res;
+}
+
 void System::loadCfgFile(string path,string name_dev) {
 	Device dev;
 	
@@ -105,16 +316,146 @@ void System::loadCfgFile(string path,string name_dev) {
 	addDevice(dev);
 }
 
+int System::watchCfgFiles() {
+	int nwatched = 0;
+
+	for(unsigned int i = 0 ; i < list_device.size() ; i++) {
+		if(list_device[i].watchCfgFile())
+			nwatched++;
+	}
+
+	return nwatched;
+}
+
+void System::setReloadCallback(reload_callback_caloe callback, void * user) {
+	OperationTable::setReloadCallback(callback,user);
+}
+
+int System::readBlock(const Netcon & endpoint, eb_address_t address, int count, align_access_caloe width, eb_data_t * buffer) {
+	Access access(address,address,0,0,0,MASK_OR,false,READ,width,1,endpoint);
+
+	access.setBlock(count);
+
+	return access.readBlock(buffer);
+}
+
+int System::writeBlock(const Netcon & endpoint, eb_address_t address, int count, align_access_caloe width, const eb_data_t * data, bool verify, block_stats_caloe * stats) {
+	Access access(address,address,0,0,0,MASK_OR,false,WRITE,width,1,endpoint);
+	access_caloe block;
+	int rcode;
+
+	access.toAccessCaloe(&block);
+
+	rcode = write_block_caloe(&block,1,count,data,(verify ? 1 : 0),stats);
+
+	free_access_caloe(&block);
+
+	return rcode;
+}
+
+int System::waitUntil(const Netcon & endpoint, eb_address_t address, eb_data_t mask, eb_data_t expected, long timeout, volatile int * cancel) {
+	Access access(address,address,0,0,0,MASK_OR,false,READ,SIZE_4B,1,endpoint);
+	access_caloe poll;
+	int rcode;
+
+	access.toAccessCaloe(&poll);
+
+	rcode = wait_until_caloe(&poll,mask,expected & mask,timeout,cancel);
+
+	free_access_caloe(&poll);
+
+	return rcode;
+}
+
+/// Register polled by waitUntilAsync
+
+struct AsyncWait {
+	access_caloe access;
+	operation_callback_caloe callback;
+	void * user;
+};
+
+static void async_wait_completed(void * user, int rcode, access_caloe * accesses, int naccess) {
+	AsyncWait * ctx = (AsyncWait *) user;
+	vector<eb_data_t> res(1,accesses[0].value);
+
+	(void) naccess;
+
+	if(ctx->callback != NULL)
+		ctx->callback(rcode,res,ctx->user);
+
+	free_access_caloe(&ctx->access);
+	delete ctx;
+}
+
+long System::waitUntilAsync(const Netcon & endpoint, eb_address_t address, eb_data_t mask, eb_data_t expected, long timeout, operation_callback_caloe callback, void * user, volatile int * cancel) {
+	Access access(address,address,0,0,0,MASK_OR,false,READ,SIZE_4B,1,endpoint);
+	AsyncWait * ctx = new AsyncWait;
+
+	access.toAccessCaloe(&ctx->access);
+	ctx->callback = callback;
+	ctx->user = user;
+
+	// The context is released by the completion callback
+	return submit_wait_async_caloe(default_async_loop_caloe(),&ctx->access,mask,expected & mask,timeout,cancel,&async_wait_completed,ctx);
+}
+
+int System::shutdown() {
+	int rcode, rcode_async;
+
+	// Finish asynchronous operations and close the event loop socket
+	rcode_async = close_async_loop_caloe(default_async_loop_caloe());
+
+	// Close every socket/device kept open by the session pool
+	rcode = close_session_pool_caloe(default_session_pool_caloe());
+
+	// Stop the thread of the watched configuration files
+	OperationTable::stopWatching();
+
+	return (rcode != ALL_OK ? rcode : rcode_async);
+}
+
+void System::invalidateSdbCache() {
+	invalidate_sdb_caches_caloe(default_session_pool_caloe());
+	invalidate_sdb_caches_caloe(&(default_async_loop_caloe()->pool));
+}
+
+void System::setTransport(transport_caloe * transport) {
+	set_transport_caloe(transport);
+}
+
+shadow_stats_caloe System::getShadowStats(bool reset) {
+	shadow_stats_caloe stats;
+
+	get_shadow_stats_caloe(default_shadow_cache_caloe(),&stats,(reset ? 1 : 0));
+
+	return stats;
+}
+
+void System::clearShadowCache() {
+	clear_shadow_cache_caloe(default_shadow_cache_caloe());
+}
+
+void System::setCoalesceWindow(long window) {
+	set_coalesce_window_caloe(default_shadow_cache_caloe(),window);
+}
+
+int System::startCapture(string path) {
+	return start_capture_caloe(path.c_str());
+}
+
+int System::stopCapture() {
+	return stop_capture_caloe();
+}
+
 ostream & operator<<(ostream & os, System & sys) {
-	map <string,Device>::iterator it;
-	
 	os <<endl<<"-----------------------------------------------------------------------"<<endl;
 	os <<"System "<<endl<<endl;
 	
 	// For each device in the system...
-	for(it = sys.list_device.begin() ; it != sys.list_device.end() ; it++) {
+	for(unsigned int i = 0 ; i < sys.list_device.size() ; i++) {
 		// Print its information
-		os << it->second <<endl;
+		os << sys.list_device[i] <<endl;
 	}
 	
 	os <<endl<<"-----------------------------------------------------------------------"<<endl;
@@ -31,19 +31,81 @@
 #define SYSTEM_CALOE_H
  
 #include "Device.h"
+#include "session_internals.h"
+#include "transport_internals.h"
+#include "shadow_internals.h"
 
 using namespace std;
 
 namespace caloe {
 
+/// Max number of boards with an operation in flight during a fan-out
+#define MAX_FANOUT_INFLIGHT 64
+
+/** @brief Result of an operation on one endpoint of a fan-out **/
+
+struct EndpointResult {
+	/// Endpoint of the board
+	Netcon endpoint;
+	
+	/// ALL_OK if success or error code otherwise
+	int rcode;
+	
+	/// Read operation values
+	vector<eb_data_t> values;
+	
+	/// Number of retries done on the board
+	int retries;
+};
+
 /**
  * @brief Top class in CALoE library. It contains an hash table with all devices in your system. You must load their operation tables from input configuration files. 
  */
 
 class System {
 	private:
-		/// Device hash table
-		map<string,Device> list_device;
+		/// Devices (in the order they were added)
+		vector<Device> list_device;
+		
+		/// Hashed index of device names
+		NameIndex index_device;
+		
+		/** @brief Search a device by name (it prints an error if it is not found)
+		 * 
+		 * @param name_dev Device name
+		 * 
+		 * @return Device or NULL if it is not found
+		 */
+		 
+		Device * findDevice(const string & name_dev);
+		
+		/** @brief Get the device of a handle (it prints an error if the handle is not valid)
+		 * 
+		 * @param device Device index of the handle
+		 * 
+		 * @return Device or NULL if the handle is not valid
+		 */
+		 
+		Device * getDevice(int device);
+		
+		/** @brief Execute an operation on some boards of a fan-out (one attempt each) and wait for them
+		 * 
+		 * @param dev Device
+		 * 
+		 * @param handle Operation handle
+		 * 
+		 * @param endpoints Boards of the fan-out
+		 * 
+		 * @param boards Indexes of the boards to run
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param res Result of each board of the fan-out
+		 * 
+		 * @param claim Update token of the whole fan-out, over all its rounds (see Operation::executeAsync)
+		 */
+		 
+		void fanout(Device & dev, const OperationHandle & handle, const vector<Netcon> & endpoints, const vector<int> & boards, ParamOperation & params, vector<EndpointResult> & res, int * claim);
 
 	public:
 	
@@ -83,9 +145,10 @@ class System {
 		 *
 		 */
 		 
-		void reset(string name_dev,string name_oper);
+		void reset(const string & name_dev, const string & name_oper);
 		
-		/** @brief Execute an operation of one registered device in the system table
+		/** @brief Execute an operation of one registered device in the system table (see Operation::execute:
+		 *  on failure the error is printed and the values read before it are returned, check the error code with the RetryPolicy overload)
 		 * 
 		 * @param name_dev Device name
 		 * 
@@ -93,10 +156,251 @@ class System {
 		 * 
 		 * @param params User needed parameters for Operation
 		 * 
-		 * @return A vector with all read data by the operation
+		 * @return A vector with the data read by the operation (may be incomplete or empty on failure)
+		 */
+		 
+		vector<eb_data_t> execute(const string & name_dev, const string & name_oper, ParamOperation & params);
+		
+		/** @brief Get the handle of a device. It resolves the device name once (see getHandle).
+		 * 
+		 * @param name_dev Device name
+		 * 
+		 * @return Device handle (its device field is -1 if the device is not found)
+		 */
+		 
+		DeviceHandle getDeviceHandle(const string & name_dev) const;
+		
+		/** @brief Get the handle of an operation of one registered device. Executing through the handle
+		 *  skips the device and operation name lookups.
+		 * 
+		 * @param name_dev Device name
+		 * 
+		 * @param name_oper Operation name
+		 * 
+		 * @return Operation handle (its fields are -1 if the device or the operation is not found)
 		 */
 		 
-		vector<eb_data_t> execute(string name_dev, string name_oper, ParamOperation & params);
+		OperationHandle getHandle(const string & name_dev, const string & name_oper) const;
+		
+		/** @brief Get the handle of an operation of a device given by its handle
+		 * 
+		 * @param dev Device handle
+		 * 
+		 * @param name_oper Operation name
+		 * 
+		 * @return Operation handle (its fields are -1 if the device or the operation is not found)
+		 */
+		 
+		OperationHandle getHandle(const DeviceHandle & dev, const string & name_oper) const;
+		
+		/** @brief Execute an operation by its handle (see Operation::execute: on failure the error is
+		 *  printed and the values read before it are returned, check the error code with the RetryPolicy overload)
+		 * 
+		 * @param handle Operation handle (see getHandle)
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @return A vector with the data read by the operation (may be incomplete or empty on failure)
+		 */
+		 
+		vector<eb_data_t> execute(const OperationHandle & handle, ParamOperation & params);
+		
+		/** @brief Execute an operation by its handle with a retry policy
+		 * 
+		 * @param handle Operation handle (see getHandle)
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param policy Retry policy
+		 * 
+		 * @return Operation result (INVALID_OPERATION if the handle is not valid)
+		 */
+		 
+		OperationResult execute(const OperationHandle & handle, ParamOperation & params, const RetryPolicy & policy);
+		
+		/** @brief Execute an operation by its handle without blocking (see executeAsync)
+		 * 
+		 * @param handle Operation handle (see getHandle)
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param callback Completion callback (result code, read values, user data). It is called from poll/wait
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute or error code
+		 */
+		 
+		long executeAsync(const OperationHandle & handle, ParamOperation & params, operation_callback_caloe callback, void * user);
+		
+		/** @brief Execute an operation of one registered device with a retry policy (see Operation::execute)
+		 * 
+		 * @param name_dev Device name
+		 * 
+		 * @param name_oper Operation name
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param policy Retry policy
+		 * 
+		 * @return Operation result (INVALID_OPERATION if the device or the operation is not found)
+		 */
+		 
+		OperationResult execute(const string & name_dev, const string & name_oper, ParamOperation & params, const RetryPolicy & policy);
+		
+		/** @brief Execute an operation of one registered device without blocking. Many operations can be
+		 *  in flight at once; their cycles share one socket driven by poll/wait.
+		 * 
+		 * @param name_dev Device name
+		 * 
+		 * @param name_oper Operation name
+		 * 
+		 * @param params User needed parameters for Operation
+		 * 
+		 * @param callback Completion callback (result code, read values, user data). It is called from poll/wait
+		 * 
+		 * @param user User data of the callback
+		 * 
+		 * @return Operation handle, zero if there was nothing to execute or error code
+		 */
+		 
+		long executeAsync(const string & name_dev, const string & name_oper, ParamOperation & params, operation_callback_caloe callback, void * user);
+		
+		/** @brief Run the event loop of asynchronous operations once
+		 * 
+		 * @param timeout Max time (us) to wait for the devices
+		 * 
+		 * @return Number of asynchronous operations not finished yet
+		 */
+		 
+		int poll(long timeout);
+		
+		/** @brief Run the event loop until an asynchronous operation has finished
+		 * 
+		 * @param handle Operation handle returned by executeAsync
+		 */
+		 
+		void wait(long handle);
+		
+		/** @brief Execute an operation of one registered device on a list of boards concurrently (fan-out).
+		 *  Up to MAX_FANOUT_INFLIGHT boards are in flight at once, so the whole list takes about the time
+		 *  of the slowest board. Network parameters of the operation are replaced by each endpoint.
+		 * 
+		 * @param name_dev Device name
+		 * 
+		 * @param name_oper Operation name
+		 * 
+		 * @param endpoints Boards to configure
+		 * 
+		 * @param params User needed parameters for Operation (the same for all boards)
+		 * 
+		 * @return Result of each board (in the order of endpoints)
+		 */
+		 
+		vector<EndpointResult> executeAll(const string & name_dev, const string & name_oper, const vector<Netcon> & endpoints, ParamOperation & params);
+		
+		/** @brief Execute an operation on a list of boards concurrently (fan-out) with a retry policy.
+		 *  Failed boards are submitted again after a backoff while the policy allows it (retries,
+		 *  deadline of the whole fan-out and budget of each board); dead boards only cost their budget.
+		 * 
+		 * @param name_dev Device name
+		 * 
+		 * @param name_oper Operation name
+		 * 
+		 * @param endpoints Boards to configure
+		 * 
+		 * @param params User needed parameters for Operation (the same for all boards)
+		 * 
+		 * @param policy Retry policy
+		 * 
+		 * @return Result of each board (in the order of endpoints)
+		 */
+		 
+		vector<EndpointResult> executeAll(const string & name_dev, const string & name_oper, const vector<Netcon> & endpoints, ParamOperation & params, const RetryPolicy & policy);
+		
+		/** @brief Read a block of consecutive words of one board (burst). Reads are packed in MTU sized
+		 *  Etherbone cycles and several cycles are in flight at once.
+		 * 
+		 * @param endpoint Board to read
+		 * 
+		 * @param address Address of the first word
+		 * 
+		 * @param count Number of words
+		 * 
+		 * @param width Word width
+		 * 
+		 * @param buffer Returned values (count words)
+		 * 
+		 * @return ALL_OK if success or error code otherwise
+		 */
+		 
+		int readBlock(const Netcon & endpoint, eb_address_t address, int count, align_access_caloe width, eb_data_t * buffer);
+		
+		/** @brief Write a block of consecutive words of one board (memory upload). Writes are pipelined
+		 *  with a window sized by the measured round trip time.
+		 * 
+		 * @param endpoint Board to write
+		 * 
+		 * @param address Address of the first word
+		 * 
+		 * @param count Number of words
+		 * 
+		 * @param width Word width
+		 * 
+		 * @param data Values to write (count words)
+		 * 
+		 * @param verify Read back the block and compare it (ERROR_VERIFY if it does not match)
+		 * 
+		 * @param stats Returned transfer statistics (bytes, time, RTT, window, MB/s). It can be NULL
+		 * 
+		 * @return ALL_OK if success or error code otherwise
+		 */
+		 
+		int writeBlock(const Netcon & endpoint, eb_address_t address, int count, align_access_caloe width, const eb_data_t * data, bool verify = false, block_stats_caloe * stats = NULL);
+		
+		/** @brief Wait until a register of one board returns an expected value. The register is polled
+		 *  with growing intervals (WAIT_POLL_MIN to WAIT_POLL_MAX) on the open session of the board.
+		 * 
+		 * @param endpoint Board to poll
+		 * 
+		 * @param address Register address
+		 * 
+		 * @param mask Compared bits of the register
+		 * 
+		 * @param expected Expected value of the compared bits
+		 * 
+		 * @param timeout Max waiting time (us, -1: NOT LIMITED)
+		 * 
+		 * @param cancel Flag that cancels the wait when it is set by another thread (it can be NULL)
+		 * 
+		 * @return ALL_OK if the value is read, ERROR_TIMEOUT, ERROR_CANCELLED or error code
+		 */
+		 
+		int waitUntil(const Netcon & endpoint, eb_address_t address, eb_data_t mask, eb_data_t expected, long timeout, volatile int * cancel = NULL);
+		
+		/** @brief Wait until a register of one board returns an expected value without blocking. The polls
+		 *  are scheduled by the event loop (see poll and wait), so other operations go on meanwhile.
+		 * 
+		 * @param endpoint Board to poll
+		 * 
+		 * @param address Register address
+		 * 
+		 * @param mask Compared bits of the register
+		 * 
+		 * @param expected Expected value of the compared bits
+		 * 
+		 * @param timeout Max waiting time (us, -1: NOT LIMITED)
+		 * 
+		 * @param callback Function called with the return code and the last read value
+		 * 
+		 * @param user User pointer passed to callback
+		 * 
+		 * @param cancel Flag that cancels the wait when it is set (it can be NULL)
+		 * 
+		 * @return Operation handle (0 if it has finished already) or error code
+		 */
+		 
+		long waitUntilAsync(const Netcon & endpoint, eb_address_t address, eb_data_t mask, eb_data_t expected, long timeout, operation_callback_caloe callback, void * user, volatile int * cancel = NULL);
 		
 		/** @brief Load a device from an input configuration file and add it to the system table
 		 * 
@@ -108,6 +412,81 @@ class System {
 		 
 		void loadCfgFile(string path,string name_dev);
 		
+		/** @brief Follow the changes of the configuration files of all devices (see Device::watchCfgFile).
+		 *  Long-running programs pick up the edited files without stopping. Devices with operations built
+		 *  into the program (e.g. default Dio and Vuart) are not watched; load them from their cfg file.
+		 * 
+		 * @return Number of watched devices
+		 */
+		 
+		int watchCfgFiles();
+		
+		/** @brief Set the function called after each reload of a watched configuration file with its
+		 *  timing and errors (see OperationTable::setReloadCallback)
+		 * 
+		 * @param callback Reload callback (NULL: none). It is called from the thread of the watcher.
+		 * 
+		 * @param user User pointer passed to callback
+		 */
+		 
+		void setReloadCallback(reload_callback_caloe callback, void * user);
+		
+		/** @brief Close all open Etherbone sessions (sockets and devices kept open between accesses) and
+		 *  stop watching the configuration files (see watchCfgFiles)
+		 * 
+		 * @return ALL_OK if success or error code otherwise
+		 */
+		 
+		int shutdown();
+		
+		/** @brief Drop the cached SDB records of all open sessions (next accesses scan the devices again) **/
+		 
+		void invalidateSdbCache();
+		
+		/** @brief Select the transport of all synchronous accesses (Etherbone, eb-tools, memory, record or replay)
+		 * 
+		 *  @param transport Transport to use (NULL: default one, see EXECUTE_CALOE_MODE)
+		 */
+		 
+		void setTransport(transport_caloe * transport);
+		
+		/** @brief Get the shadow cache counters (see Access::setCacheable)
+		 * 
+		 *  @param reset Reset the counters after reading them
+		 * 
+		 *  @return Hits, misses, suppressed writes and coalesced reads
+		 */
+		 
+		shadow_stats_caloe getShadowStats(bool reset = false);
+		
+		/** @brief Drop all shadow values of cacheable registers (e.g. after a board reset) **/
+		 
+		void clearShadowCache();
+		
+		/** @brief Set the read coalescing window: a read of a register within this time after another read
+		 *  of it gets the value of that read (registers whose reads have side effects are always read)
+		 * 
+		 *  @param window Time (us, 0: reads are only coalesced within one operation)
+		 */
+		 
+		void setCoalesceWindow(long window);
+		
+		/** @brief Log every access to a binary trace file until stopCapture (see tools/replay_spec)
+		 * 
+		 *  @param path Trace file
+		 * 
+		 *  @return ALL_OK if success or error code otherwise
+		 */
+		 
+		int startCapture(string path);
+		
+		/** @brief Stop logging accesses and write the trace file
+		 * 
+		 *  @return ALL_OK if success or error code otherwise
+		 */
+		 
+		int stopCapture();
+		
 		/** @brief Print the system information
 		 * 
 		 *  @param os Output stream
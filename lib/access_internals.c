@@ -26,6 +26,19 @@
  */
  
 #include "access_internals.h"
+#include "session_internals.h"
+#include "wire_internals.h"
+
+/**
+* @brief State of one read/write cycle. It is the user data of read/write callbacks (one per call, so
+* several threads can perform accesses at the same time).
+*/
+
+struct cycle_context_caloe {
+	int stop; /**< It indicates if the cycle has finished */
+	int error; /**< It indicates if the cycle has failed */
+	eb_data_t data; /**< Read data */
+};
 
 /**
 * read callback function. It is necessary to Etherbone library.
@@ -36,22 +49,23 @@
 // Please, see http://www.ohwr.org/projects/etherbone-core if you want to get more information
 
 static void read_callback_caloe(eb_user_data_t user, eb_device_t dev, eb_operation_t op, eb_status_t status) {
-	int* stop = (int*)user;
-	*stop = 1;
+	struct cycle_context_caloe * ctx = (struct cycle_context_caloe *) user;
+	ctx->stop = 1;
 
 	if (status != EB_OK) {
 		
 			if(VERBOSE_CALOE)
 				fprintf(stderr, "ERROR: Etherbone cycle failed! \n");
     		
+    		ctx->error = 1;
     		return;
 		//exit(1);
 	}
 	else {
-			data = 0;
+			ctx->data = 0;
 			for (; op != EB_NULL; op = eb_operation_next(op)) {
-				data <<= (eb_operation_format(op) & EB_DATAX) * 8;
-				data |= eb_operation_data(op);
+				ctx->data <<= (eb_operation_format(op) & EB_DATAX) * 8;
+				ctx->data |= eb_operation_data(op);
 
 				if (eb_operation_had_error(op)) {
         			
@@ -74,19 +88,19 @@ static void read_callback_caloe(eb_user_data_t user, eb_device_t dev, eb_operati
 // Please, see http://www.ohwr.org/projects/etherbone-core if you want to get more information
 
 static void write_callback_caloe(eb_user_data_t user, eb_device_t dev, eb_operation_t op, eb_status_t status) {
-	int* stop = (int*)user;
-	*stop = 1;
+	struct cycle_context_caloe * ctx = (struct cycle_context_caloe *) user;
+	ctx->stop = 1;
 
 	if (status != EB_OK) {
 		if(VERBOSE_CALOE) 
 			fprintf(stderr, "ERROR: Etherbone cycle failed! \n");
 
+		ctx->error = 1;
 		return;
     		
 		//exit(1);
 	}
 	else {
-		data = 0;
 		for (; op != EB_NULL; op = eb_operation_next(op)) {
 
 			if (eb_operation_had_error(op)) {
@@ -307,59 +321,34 @@ static void scan_callback_caloe(eb_user_data_t user, eb_device_t dev, const stru
 	}
 }
 
-void build_network_con_caloe(char * ipname_server, network_connection *nc) {
-	nc->netaddress = malloc(sizeof(char)*strlen(ipname_server));
-	strcpy(nc->netaddress,ipname_server);
-	nc->port = NULL;
+int build_network_con_caloe(const char * ipname_server, network_connection *nc) {
+	return build_network_con_full_caloe(ipname_server,ENDPOINT_DEFAULT_PORT,nc);
 }
 
-void build_network_con_full_caloe(char * ipname_server, unsigned int port, network_connection *nc) {
-	build_network_con_caloe(ipname_server,nc);
-	nc->port = malloc(sizeof(unsigned int));
-	*(nc->port) = port;
+int build_network_con_full_caloe(const char * ipname_server, unsigned int port, network_connection *nc) {
+	// The address is parsed only the first time it is seen
+	nc->endpoint = register_endpoint_caloe(ipname_server,port);
 
+	return (nc->endpoint > 0 ? ALL_OK : ERROR_ENDPOINT);
 }
 
 void copy_network_con_caloe(network_connection * dest, network_connection * src) {
-	if(src->netaddress != NULL) {
-		int len = strlen(src->netaddress);
-		dest->netaddress = malloc(sizeof(char)*len);
-		strcpy(dest->netaddress, src->netaddress);
-	}
-	else {
-		dest->netaddress = NULL;
-	}
-
-	if(src->port == NULL) {
-		dest->port = NULL;
-	}
-	else {
-		dest->port = malloc(sizeof(unsigned int));
-		*(dest->port) = *(src->port);
-	}
+	dest->endpoint = src->endpoint;
 }
 
 void free_network_con_caloe(network_connection * nc) {
-	if(nc->netaddress != NULL)
-		free(nc->netaddress);
-
-	if(nc->port != NULL)
-		free(nc->port);
+	nc->endpoint = ERROR_ENDPOINT;
 }
 
 void print_network_con_caloe(network_connection * nc) {
-	if(nc->netaddress == NULL) {
-		printf("Network address: Not address yet!!\n");
-	}
-	else {
-		printf("Network address: %s\n",nc->netaddress);
-	}
+	const endpoint_caloe * endpoint = get_endpoint_caloe(nc->endpoint);
 
-	if(nc->port == NULL) {
-		printf("Port: 60368 (DEFAULT)\n");
+	if(endpoint == NULL) {
+		printf("Network address: Not address yet!!\n");
 	}
 	else {
-		printf("Port: %d \n",*(nc->port));
+		printf("Network address: %s\n",endpoint->netaddress);
+		printf("Port: %u \n",endpoint->port);
 	}
 }
 
@@ -372,6 +361,8 @@ void build_access_caloe(unsigned long int address, int offset, long int value,lo
 	access->is_config = is_config;
 	access->mode = mode;
 	access->align = align;
+	access->cacheable = 0;
+	access->side_effects = 0;
 	copy_network_con_caloe(&access->networkc,net);
 }
 
@@ -447,353 +438,180 @@ void print_access_caloe(access_caloe * access) {
 	printf("\n--------------------------------------\n");
 }
 
+static int run_cycle_caloe(eb_socket_t socket, int * stop) {
+	int timeout;
+
+	timeout = TIMEOUT_LIMIT;
+
+	while(timeout > 0) {
+		int telapsed = eb_socket_run(socket,timeout);
+
+		if(*stop)
+			break;
+
+		timeout -= telapsed;
+	}
+
+	if(!(*stop)) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Timeout expired! \n");
+
+		return ERROR_TIMEOUT;
+	}
+
+	return ALL_OK;
+}
+
 // The code of this function is based on eb-read tool code (its comments has also been included)
 // Please, see http://www.ohwr.org/projects/etherbone-core if you want to get more information
 
-int read_caloe(access_caloe * access) {
-	int stop;
-  
-	eb_width_t address_width, data_width;
-	eb_format_t endian;
-  
-	eb_socket_t socket;
+static int read_session_caloe(session_caloe * session, access_caloe * access) {
+	struct cycle_context_caloe ctx;
 	eb_status_t status;
-	eb_device_t device;
-	eb_width_t line_width;
-	eb_format_t line_widths;
-	eb_format_t device_support;
-	eb_format_t read_sizes;
-	eb_format_t format;
 	eb_cycle_t cycle;
-	eb_data_t mask;
-	int shift;
+	wire_access_caloe plan;
+	int rcode;
 
-	int timeout;
-  
-	if(access->mode != READ) {
+	if ((rcode = plan_access_caloe(session, access, &plan)) != ALL_OK)
+		return rcode;
+
+	/* Begin the cycle */
+	if ((status = eb_cycle_open(session->device, &ctx, &read_callback_caloe, &cycle)) != EB_OK) {
 	  
 		if(VERBOSE_CALOE)
-			fprintf(stderr,"ERROR: Invalid read operation \n");
-      
-		return INVALID_OPERATION;
+			fprintf(stderr, "ERROR %d: Could not create a new Etherbone operation cycle \n",(int) status);
+    
+		return ERROR_OPEN_CYCLE;
 	}
-  
-	eb_format_t size;
-	int attempts, probe, config;
-
-	address_width = EB_ADDRX;
-	data_width = EB_DATAX;
-	size = EB_DATAX;
-	endian = 0; /* auto-detect */
-	attempts = 3;
-	probe = 1;
-	config = access->is_config;
-	eb_address_t address = access->address + access->offset;
-
-	char * netaddress = (access->networkc).netaddress;
-	int port = ((access->networkc).port == NULL ? 60368 : *((access->networkc).port));
-  
-	char net[50];
-  
-	sprintf(net,"%s/%d",netaddress,port);
 
-	switch(access->align) {
-		case SIZE_1B: size = 1;
-		break;
+	queue_read_caloe(cycle, access, &plan);
 
-		case SIZE_2B: size = 2;
-		break;
+	eb_cycle_close(cycle);
 
-		case SIZE_4B: size = 4;
-		break;
+	ctx.stop = 0;
+	ctx.error = 0;
 
-		case SIZE_8B: size = 8;
-		break;
-	}
-  
-	/* How big can the data be? */
-	mask = ~(eb_data_t)0;
-	mask >>= (sizeof(eb_data_t)-size)*8;
+	if ((rcode = run_cycle_caloe(session->socket, &ctx.stop)) != ALL_OK)
+		return rcode;
 
-	if ((status = eb_socket_open(EB_ABI_CODE, 0, address_width|data_width, &socket)) != EB_OK) {
-	
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: Could not connect Etherbone socket \n",(int) status);
-    
-		return ERROR_OPEN_SOCKET;
-	}
-  
-	if ((status = eb_device_open(socket, net, EB_ADDRX|EB_DATAX, attempts, &device)) != EB_OK) {
+	if (ctx.error)
+		return ERROR_OPERATION_RUN;
+
+	ctx.data >>= plan.shift*8;
+	ctx.data &= plan.mask;
+
+	access->value = apply_mask_caloe(access, ctx.data);
+
+	return ALL_OK;
+}
+
+int read_caloe(access_caloe * access) {
+	session_caloe * session;
+	int rcode;
+
+	if(access->mode != READ) {
 	  
 		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: Could not connect Etherbone device \n", (int) status);
-    
-		return ERROR_OPEN_DEVICE;
-	}
-  
-	line_width = eb_device_width(device);
-	
-	if (probe) {
-   
-		struct sdb_device info;
-	
-		if ((status = eb_sdb_find_by_address(device, address, &info)) != EB_OK) {
-		
-			if(VERBOSE_CALOE)
-				fprintf(stderr, "ERROR %d: SDB scan failed! \n",(int) status);
+			fprintf(stderr,"ERROR: Invalid read operation \n");
       
-			return ERROR_SDB_SCAN;
-		}
-    
-		if ((info.bus_specific & SDB_WISHBONE_LITTLE_ENDIAN) != 0)
-			device_support = EB_LITTLE_ENDIAN;
-		else
-			device_support = EB_BIG_ENDIAN;
-		
-		device_support |= info.bus_specific & EB_DATAX;
-	} else {
-		device_support = endian | EB_DATAX;
-	}
-  
-	if (endian == 0) {
-		/* Select the probed endian. May still be 0 if device not found. */
-		endian = device_support & EB_ENDIAN_MASK;
-	}
-  
-	/* Final operation endian has been chosen. If 0 the access had better be a full data width access! */
-	format = endian;
-  
-	/* We need to pick the operation width we use.
-	* It must be supported both by the device and the line.
-	*/
-	line_widths = ((line_width & EB_DATAX) << 1) - 1; /* Link can support any access smaller than line_width */
-	read_sizes = line_widths & device_support;
-    
-	/* We cannot work with a device that requires larger access than we support */
-	if (read_sizes == 0) {
-	  
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR: Device could not access with size requested \n");
-    
-		return ERROR_SIZE_NOT_SUPPORTED;
+		return INVALID_OPERATION;
 	}
-  
+
+	if((rcode = acquire_session_caloe(default_session_pool_caloe(),&access->networkc,&session)) != ALL_OK)
+		return rcode;
+
+	rcode = read_session_caloe(session,access);
+
+	release_session_caloe(default_session_pool_caloe(),session,rcode);
+
+	return rcode;
+}
+
+// The code of this function is based on eb-write tool code (its comments has also been included)
+// Please, see http://www.ohwr.org/projects/etherbone-core if you want to get more information
+
+static int write_session_caloe(session_caloe * session, access_caloe * access) {
+	struct cycle_context_caloe ctx;
+	eb_status_t status;
+	eb_cycle_t cycle;
+	wire_access_caloe plan;
+	eb_data_t data;
+	eb_data_t mask;
+	eb_data_t original_data;
+	int rcode;
+
+	data = apply_mask_caloe(access, access->value);
+
+	if ((rcode = plan_access_caloe(session, access, &plan)) != ALL_OK)
+		return rcode;
+
 	/* Begin the cycle */
-	if ((status = eb_cycle_open(device, &stop, &read_callback_caloe, &cycle)) != EB_OK) {
+	if ((status = eb_cycle_open(session->device, &ctx, &write_callback_caloe, &cycle)) != EB_OK) {
 	  
 		if(VERBOSE_CALOE)
 			fprintf(stderr, "ERROR %d: Could not create a new Etherbone operation cycle \n",(int) status);
     
 		return ERROR_OPEN_CYCLE;
 	}
-  
-	/* Can the operation be performed with fidelity? */
-	if ((size & read_sizes) == 0) {
-		eb_format_t fragment_sizes;
-		eb_format_t fragment_size;
-		eb_format_t complete_size;
-   
-		/* What will we do? Prefer to fragment if possible; reading is evil. */
-    
-		/* Fragmented reading is possible if there is a bit in read_sizes smaller than a bit in size */
-		fragment_sizes = size;
-		fragment_sizes |= fragment_sizes >> 1;
-		fragment_sizes |= fragment_sizes >> 2; /* Filled in all sizes under max */
-		
-		if ((fragment_sizes & read_sizes) != 0) {
-			int stride, chunk, count;
-      
-			/* We can do a fragmented read. Pick largest read possible. */
-			complete_size = fragment_sizes ^ (fragment_sizes >> 1); /* This many bytes to read */
-			/* (the above code sets complete_size = size, but works also if size were a mask) */
-      
-			/* Filter out only those which have a good read size */
-			fragment_sizes &= read_sizes;
-			/* Then pick the largest bit */
-			fragment_sizes |= fragment_sizes >> 1;
-			fragment_sizes |= fragment_sizes >> 2;
-			fragment_size = fragment_sizes ^ (fragment_sizes >> 1);
-      
-			/* We read fragments */
-			format |= fragment_size;
-   
-			/* Each operation reads this many bytes */
-			chunk = format & EB_DATAX;
-			count = complete_size / chunk;
-      
-			/* Read the low bits first */
-			switch (format & EB_ENDIAN_MASK) {
-				case EB_BIG_ENDIAN:
-					stride = chunk;
-				break;
-				case EB_LITTLE_ENDIAN:
-					address += chunk*(count-1);
-					stride = -chunk;
-				break;
-				default:
-					if(VERBOSE_CALOE)
-						fprintf(stderr, "ERROR: Must know ENDIAN to fragment read \n");
-					return ERROR_UNKNOWN_ENDIAN;
-			}
-      
-			for (; count > 0; --count) {
-        
-				if (config)
-					eb_cycle_read_config(cycle, address, format, 0);
-				else
-					eb_cycle_read(cycle, address, format, 0);
-				address += stride;
-			}
-      
-			shift = 0;
-		} else {
-			eb_address_t aligned_address;
-      
-			/* All bits in read_sizes are larger than all bits in size */
-			/* We will need to do a larger operation than the read requested. */
-      
-			/* Pick the largest sized read possible. */
-			fragment_size = fragment_sizes ^ (fragment_sizes >> 1);
-			/* (the above code sets fragment_size = size, but works also if size were a mask) */
-      
-			/* Now pick the smallest bit in read_sizes. */
-			complete_size = read_sizes & -read_sizes;
-      
-			/* We have our final operation format. */
-			format |= complete_size;
-  
-			/* Align the address */
-			aligned_address = address & ~(eb_address_t)(complete_size-1);
-      
-			/* How far do we need to shift the offset? */
-			switch (format & EB_ENDIAN_MASK) {
-				case EB_BIG_ENDIAN:
-					shift = (complete_size-fragment_size) - (address - aligned_address);
-				break;
-				case EB_LITTLE_ENDIAN:
-					shift = (address - aligned_address);
-				break;
-				default:
-					if(VERBOSE_CALOE)
-						fprintf(stderr, "ERROR: Must know ENDIAN to fill partial read \n");
-					return ERROR_UNKNOWN_ENDIAN;
-			}
-      
-			/* Issue the read */
-			if (config)
-				eb_cycle_read_config(cycle, aligned_address, format, 0);
-			else
-				eb_cycle_read(cycle, aligned_address, format, 0);
-		}
-	} else {
-		/* There is a size requested that the device and link supports */
-		format |= (size & read_sizes);
-    
-		/* If the access it full width, an endian is needed. Print a friendlier message than EB_ADDRESS. */
-		if ((format & line_width & EB_DATAX) == 0 && (format & EB_ENDIAN_MASK) == 0) {
-		
+
+	if (plan.widen) {
+		/* The device only supports wider accesses: read the word and inject the data */
+		mask = plan.mask << plan.shift*8;
+		data = (data & plan.mask) << plan.shift*8;
+
+		/* Issue the read */
+		if (access->is_config)
+			eb_cycle_read_config(cycle, plan.address, plan.format, &original_data);
+		else
+			eb_cycle_read(cycle, plan.address, plan.format, &original_data);
+
+		eb_cycle_close(cycle);
+
+		ctx.stop = 0;
+		ctx.error = 0;
+
+		if ((rcode = run_cycle_caloe(session->socket, &ctx.stop)) != ALL_OK)
+			return rcode;
+
+		if (ctx.error)
+			return ERROR_OPERATION_RUN;
+
+		/* Restart the cycle */
+		if ((status = eb_cycle_open(session->device, &ctx, &write_callback_caloe, &cycle)) != EB_OK) {
+
 			if(VERBOSE_CALOE)
-				fprintf(stderr, "ERROR: ENDIAN is required \n");
-        
-			return ERROR_UNKNOWN_ENDIAN;
+				fprintf(stderr, "ERROR %d: Could not create a new Etherbone operation cycle \n",(int) status);
+
+			return ERROR_OPEN_CYCLE;
 		}
-    
-		if (config)
-			eb_cycle_read_config(cycle, address, format, 0);
-		else
-			eb_cycle_read(cycle, address, format, 0);
-    
-		shift = 0;
-	}
-  
-	eb_cycle_close(cycle);
-    
-	stop = 0;
-	timeout = TIMEOUT_LIMIT;
-  
-	while(timeout > 0) {
-		int telapsed = eb_socket_run(socket,timeout);
-	
-		if(stop)
-			break;
 
-		timeout -= telapsed;
-	}
-  
-	if(!stop) {	
-	
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR: Timeout expired! \n");
-    
-		return ERROR_TIMEOUT;
-	}
-  
-	data >>= shift*8;
-	data &= mask;
-  
-	if ((status = eb_device_close(device)) != EB_OK) {
-	  
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: failed to close Etherbone device \n", (int) status);
-    
-		return ERROR_CLOSE_DEVICE;
-	}
-  
-	if ((status = eb_socket_close(socket)) != EB_OK) {
-    
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: failed to close Etherbone socket \n", (int) status);
-    
-		return ERROR_CLOSE_SOCKET;
+		/* Inject the data */
+		data |= original_data & ~mask;
 	}
 
-	//printf("Mask: 0x%x\n",access->mask);
+	queue_write_caloe(cycle, access, &plan, data);
 
-	if(access->mask_oper == MASK_OR) {
-		data = access->mask | data;
-		//printf("OR\n");
-	}
-	else {
-		data = access->mask & data;
-		//printf("AND\n");
-	}
+	eb_cycle_close(cycle);
 
-	access->value = data;
+	ctx.stop = 0;
+	ctx.error = 0;
 
-	//fprintf(stdout, "%0*"EB_DATA_FMT"\n", size*2, access->value);
+	if ((rcode = run_cycle_caloe(session->socket, &ctx.stop)) != ALL_OK)
+		return rcode;
 
-	//printf("READ IN 0x%x VALUE 0x%x \n\n",(unsigned int) address,(unsigned int) access->value);
+	if (ctx.error)
+		return ERROR_OPERATION_RUN;
 
+	//printf("WRITE IN 0x%x VALUE 0x%x \n\n",(unsigned int) address,(unsigned int) data);
 
 	return ALL_OK;
 }
 
-// The code of this function is based on eb-write tool code (its comments has also been included)
-// Please, see http://www.ohwr.org/projects/etherbone-core if you want to get more information
-
 int write_caloe(access_caloe * access) {
+	session_caloe * session;
+	int rcode;
 
-	int stop;
-  
-	eb_width_t address_width, data_width;
-	eb_format_t endian;
-  
-	eb_socket_t socket;
-	eb_status_t status;
-	eb_device_t device;
-	eb_width_t line_width;
-	eb_format_t line_widths;
-	eb_format_t device_support;
-	eb_format_t write_sizes;
-	eb_format_t format;
-	eb_cycle_t cycle;
-	eb_data_t mask;
-	int shift, shift_step;
-	eb_address_t address_end;
-	eb_data_t data_mask, partial_data;
-	eb_data_t original_data;
-	eb_address_t aligned_address;
-  
 	if(access->mode != WRITE) {
 	  
 		if(VERBOSE_CALOE)
@@ -801,328 +619,63 @@ int write_caloe(access_caloe * access) {
       
 		return INVALID_OPERATION;
 	}
-  
-	eb_format_t size;
-	int attempts, probe, config;
-
-	/* Default arguments */
-	address_width = EB_ADDRX;
-	data_width = EB_DATAX;
-	size = EB_DATAX;
-	endian = 0; /* auto-detect */
-	attempts = 3;
-	probe = 1;
-	config = access->is_config;
-	eb_address_t address = access->address + access->offset;
-	eb_data_t data = access->value;
-	char * netaddress = access->networkc.netaddress;
-	int port = (access->networkc.port == NULL ? 60368 : *(access->networkc.port));
 
-	int timeout;
-  
-	char net[50];
-  
-	sprintf(net,"%s/%d",netaddress,port);
+	if((rcode = acquire_session_caloe(default_session_pool_caloe(),&access->networkc,&session)) != ALL_OK)
+		return rcode;
 
-	//printf("Mask: 0x%x\n",access->mask);
+	rcode = write_session_caloe(session,access);
 
-	if(access->mask_oper == MASK_OR) {
-		data = access->mask | data;
-		//printf("OR\n");
-	}
-	else {
-		data = access->mask & data;
-		//printf("AND\n");
-	}
+	release_session_caloe(default_session_pool_caloe(),session,rcode);
 
-	switch(access->align) {
-		case SIZE_1B: size = 1;
-		break;
+	return rcode;
+}
 
-		case SIZE_2B: size = 2;
-		break;
+/**
+* Checks if two write after read accesses hit the same register (they can be merged in one read and one write)
+**/
 
-		case SIZE_4B: size = 4;
-		break;
+static int same_register_caloe(access_caloe * a, access_caloe * b) {
+	return a->mode == READ_WRITE && b->mode == READ_WRITE &&
+		a->address + a->offset == b->address + b->offset &&
+		a->align == b->align && a->is_config == b->is_config &&
+		same_endpoint_caloe(&a->networkc, &b->networkc);
+}
 
-		case SIZE_8B: size = 8;
-		break;
-	}
-  
-	/* How big can the data be? */
-	mask = ~(eb_data_t)0;
-	mask >>= (sizeof(eb_data_t)-size)*8;
+/**
+* Runs a list of write after read accesses to the same register with one open device: the register
+* is read once, the masks are merged locally (in order) and the result is written once.
+**/
 
-	if ((status = eb_socket_open(EB_ABI_CODE, 0, address_width|data_width, &socket)) != EB_OK) {
-	  
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: Could not connect Etherbone socket \n", (int) status);
-    
-		return ERROR_OPEN_SOCKET;
-	}
-  
-	if ((status = eb_device_open(socket, net, EB_ADDRX|EB_DATAX, attempts, &device)) != EB_OK) {
-	  
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: Could not connect Etherbone device \n", (int) status);
-    
-		return ERROR_OPEN_DEVICE;
-	}
-  
-	line_width = eb_device_width(device);
- 
-	if (probe) {
-   
-		struct sdb_device info;
-		if ((status = eb_sdb_find_by_address(device, address, &info)) != EB_OK) {
-	  
-			if(VERBOSE_CALOE)
-				fprintf(stderr, "ERROR %d: SDB scan failed! \n", (int) status);
-      
-			return ERROR_SDB_SCAN;
-		}
-    
-		if ((info.bus_specific & SDB_WISHBONE_LITTLE_ENDIAN) != 0)
-			device_support = EB_LITTLE_ENDIAN;
-		else
-			device_support = EB_BIG_ENDIAN;
-    
-		device_support |= info.bus_specific & EB_DATAX;
-	} else {
-		device_support = endian | EB_DATAX;
-	}
-  
-	if (endian == 0) {
-		/* Select the probed endian. May still be 0 if device not found. */
-		endian = device_support & EB_ENDIAN_MASK;
-	}
-  
-	/* Final operation endian has been chosen. If 0 the access had better be a full data width access! */
-	format = endian;
-  
-	/* We need to pick the operation width we use.
-	* It must be supported both by the device and the line.
-	*/
-	line_widths = ((line_width & EB_DATAX) << 1) - 1; /* Link can support any access smaller than line_width */
-	write_sizes = line_widths & device_support;
-    
-	/* We cannot work with a device that requires larger access than we support */
-	if (write_sizes == 0) {
-	
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR: Device could not access with size requested \n");
-    
-		return ERROR_SIZE_NOT_SUPPORTED;
-	}
-  
-	/* Begin the cycle */
-	if ((status = eb_cycle_open(device, &stop, &write_callback_caloe, &cycle)) != EB_OK) {
-	  
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: Could not create a new Etherbone operation cycle \n",(int) status);
-    
-		return ERROR_OPEN_CYCLE;
-	}
-
-	/* Can the operation be performed with fidelity? */
-	if ((size & write_sizes) == 0) {
-		eb_format_t fragment_sizes;
-		eb_format_t fragment_size;
-		eb_format_t complete_size;
-    
-		/* What will we do? Prefer to fragment if possible; reading is evil. */
-    
-		/* Fragmented writing is possible if there is a bit in write_sizes smaller than a bit in size */
-		fragment_sizes = size;
-		fragment_sizes |= fragment_sizes >> 1;
-		fragment_sizes |= fragment_sizes >> 2; /* Filled in all sizes under max */
-		if ((fragment_sizes & write_sizes) != 0) {
-      
-			/* We can do a fragmented write. Pick largest write possible. */
-			complete_size = fragment_sizes ^ (fragment_sizes >> 1); /* This many bytes to write */
-			/* (the above code sets complete_size = size, but works also if size were a mask) */
-      
-			/* Filter out only those which have a good write size */
-			fragment_sizes &= write_sizes;
-			/* Then pick the largest bit */
-			fragment_sizes |= fragment_sizes >> 1;
-			fragment_sizes |= fragment_sizes >> 2;
-			fragment_size = fragment_sizes ^ (fragment_sizes >> 1);
-      
-			/* We write fragments */
-			format |= fragment_size;
-      
-			switch (format & EB_ENDIAN_MASK) {
-				case EB_BIG_ENDIAN:
-					shift = (complete_size - fragment_size)*8;
-					shift_step = -fragment_size*8;
-				break;
-				case EB_LITTLE_ENDIAN:
-					shift = 0;
-					shift_step = fragment_size*8;
-				break;
-				default:
-      
-					if(VERBOSE_CALOE)
-						fprintf(stderr, "ERROR: Must know ENDIAN to fragment read \n");
-        
-					return ERROR_UNKNOWN_ENDIAN;
-			}	
-      
-			data_mask = ~(eb_data_t)0;
-			data_mask >>= (sizeof(eb_data_t)-fragment_size)*8;
-      
-			for (address_end = address + complete_size; address != address_end; address += fragment_size) {
-				partial_data = (data >> shift) & data_mask;
-        
-				if (config)
-					eb_cycle_write_config(cycle, address, format, partial_data);
-				else
-					eb_cycle_write(cycle, address, format, partial_data);
-				shift += shift_step;
-			}
-		} else {
-      
-			/* All bits in write_sizes are larger than all bits in size */
-			/* We will need to do a larger operation than the write requested. */
-      
-			/* Pick the largest sized write possible. */
-			fragment_size = fragment_sizes ^ (fragment_sizes >> 1);
-			/* (the above code sets fragment_size = size, but works also if size were a mask) */
-      
-			/* Now pick the smallest bit in write_sizes. */
-			complete_size = write_sizes & -write_sizes;
-      
-			/* We have our final operation format. */
-			format |= complete_size;
-      
-			/* Align the address */
-			aligned_address = address & ~(eb_address_t)(complete_size-1);
-      
-			/* How far do we need to shift the offset? */
-			switch (format & EB_ENDIAN_MASK) {
-				case EB_BIG_ENDIAN:
-					shift = (complete_size-fragment_size) - (address - aligned_address);
-				break;
-				case EB_LITTLE_ENDIAN:
-					shift = (address - aligned_address);
-				break;
-				default:
-      
-					if(VERBOSE_CALOE)
-						fprintf(stderr, "ERROR: Must know ENDIAN to fill partial read \n");
-        
-					return ERROR_UNKNOWN_ENDIAN;
-			}
-			
-			mask <<= shift*8;
-			data <<= shift*8;
-      
-			/* Issue the read */
-			if (config)
-				eb_cycle_read_config(cycle, aligned_address, format, &original_data);
-			else
-				eb_cycle_read(cycle, aligned_address, format, &original_data);
-      
-			eb_cycle_close(cycle);
-      
-			stop = 0;
-			timeout = TIMEOUT_LIMIT;
-      
-			while(timeout > 0) {
-				int telapsed = eb_socket_run(socket, TIMEOUT_LIMIT);
-		
-				if(stop)
-					break;
-
-				timeout -= telapsed;
-			}
-	  
-
-			if(!stop) {	
-	
-				if(VERBOSE_CALOE)
-					fprintf(stderr, "ERROR: Timeout expired! \n");
-    
-				return ERROR_TIMEOUT;
-			}
-      
-			/* Restart the cycle */
-			eb_cycle_open(device, &stop, &write_callback_caloe, &cycle);
-      
-			/* Inject the data */
-			data |= original_data & ~mask;
-			if (config)
-				eb_cycle_write_config(cycle, aligned_address, format, data);
-			else
-				eb_cycle_write(cycle, aligned_address, format, data);
-		}
-	} else {
-		/* There is a size requested that the device and link supports */
-		format |= (size & write_sizes);
-    
-		/* If the access it full width, an endian is needed. Print a friendlier message than EB_ADDRESS. */
-		if ((format & line_width & EB_DATAX) == 0 && (format & EB_ENDIAN_MASK) == 0) {
-		
-			if(VERBOSE_CALOE)
-				fprintf(stderr, "ERROR: ENDIAN is required \n");
-        
-			return ERROR_UNKNOWN_ENDIAN;
-		}
-
-		if (config)
-			eb_cycle_write_config(cycle, address, format, data);
-		else
-			eb_cycle_write(cycle, address, format, data);
-	}
-  
-	eb_cycle_close(cycle);
-  
-	stop = 0;
-	timeout = TIMEOUT_LIMIT;
-  
-	while(timeout > 0) {
-		int telapsed = eb_socket_run(socket,timeout);
-	
-		if(stop)
-			break;
-
-		timeout -= telapsed;
-	}
-
-	if(!stop) {	
-	
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: Timeout expired! \n",(int) status);
-    
-		return ERROR_TIMEOUT;
-	}
-  
-	if ((status = eb_device_close(device)) != EB_OK) {
-    
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: failed to close Etherbone device \n",(int) status);
-    
-		return ERROR_CLOSE_DEVICE;
-	}
-  
-	if ((status = eb_socket_close(socket)) != EB_OK) {
-    
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: failed to close Etherbone socket \n",(int) status);
-    
-		return ERROR_CLOSE_SOCKET;
+static int write_after_read_session_caloe(session_caloe * session, access_caloe * accesses, int naccess) {
+	access_caloe raw = accesses[0];
+	eb_data_t value;
+	int rcode;
+	int i;
+
+	// Read the whole register without mask
+	raw.mode = READ;
+	raw.mask = 0x00;
+	raw.mask_oper = MASK_OR;
+
+	if((rcode = read_session_caloe(session,&raw)) != ALL_OK)
+		return rcode;
+
+	value = raw.value;
+
+	// Each access sees the value written by the previous one
+	for(i = 0 ; i < naccess ; i++) {
+		value = apply_mask_caloe(&accesses[i], value);
+		accesses[i].value = value;
 	}
 
-	//printf("WRITE IN 0x%x VALUE 0x%x \n\n",(unsigned int) address,(unsigned int) data);
+	raw.mode = WRITE;
+	raw.value = value;
 
-	return ALL_OK;
+	return write_session_caloe(session,&raw);
 }
 
 int write_after_read_caloe(access_caloe * access) {
-	eb_data_t mask = access->mask;
-	mask_oper_caloe mask_oper = access->mask_oper;
-
+	session_caloe * session;
 	int rcode;
 
 	if(access->mode != READ_WRITE) {
@@ -1132,85 +685,35 @@ int write_after_read_caloe(access_caloe * access) {
       		return INVALID_OPERATION;
   	}
 
-	access->mode = READ;
-
-	if((rcode = read_caloe(access)) != ALL_OK)
-		return rcode;
-
-	access->mask = 0x00;
-	access->mask_oper = MASK_OR;
-
-	access->mode = WRITE;
-
-	if((rcode = write_caloe(access)) != ALL_OK)
+	if((rcode = acquire_session_caloe(default_session_pool_caloe(),&access->networkc,&session)) != ALL_OK)
 		return rcode;
 
-	access->mode = READ_WRITE;
+	rcode = write_after_read_session_caloe(session,access,1);
 
-	access->mask = mask;
-	access->mask_oper = mask_oper;
+	release_session_caloe(default_session_pool_caloe(),session,rcode);
 
-	return ALL_OK;
+	return rcode;
 }
 
 // The code of this function is based on eb-ls tool code (its comments has also been included)
 // Please, see http://www.ohwr.org/projects/etherbone-core if you want to get more information
 
-int scan_caloe(access_caloe * access) {
-  
-	if(access->mode != SCAN) {
-		if(VERBOSE_CALOE)
-		fprintf(stderr,"ERROR: Invalid scan operation \n");
-      
-		return INVALID_OPERATION;
-	}
-  
-  
+static int scan_session_caloe(session_caloe * session) {
 	struct bus_record br;
-	eb_socket_t socket;
+	eb_socket_t socket = session->socket;
 	eb_status_t status;
-	eb_device_t device;
+	eb_device_t device = session->device;
 	int verbose = 0;
   
-	int attempts;
-  
 	br.parent = 0;
 	br.i = -1;
 	br.stop = 0;
 	br.addr_first = 0;
 	br.addr_last = ~(eb_address_t)0;
-  
-	eb_width_t address_width = EB_ADDRX;
-	eb_width_t data_width = EB_DATAX;
-	attempts = 3;
-
-	char * netaddress = access->networkc.netaddress;
-  
-	int port = (access->networkc.port == NULL ? 60368 : *(access->networkc.port));
 
 	int timeout;
   
-	char net[50];
-  
-	sprintf(net,"%s/%d",netaddress,port);
-
-	if ((status = eb_socket_open(EB_ABI_CODE, 0, address_width|data_width, &socket)) != EB_OK) {
-	
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR %d: Could not connect Etherbone socket \n",status);
-    
-		return ERROR_OPEN_SOCKET;
-	}
-  
-	if ((status = eb_device_open(socket, net, EB_ADDRX|EB_DATAX, attempts, &device)) != EB_OK) { 
-    
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR: Could not connect Etherbone device \n");
-    
-		return ERROR_OPEN_DEVICE;
-	}
-  
-	br.addr_last >>= (sizeof(eb_address_t) - (eb_device_width(device) >> 4))*8;
+	br.addr_last >>= (sizeof(eb_address_t) - (session->line_width >> 4))*8;
   
 	if ((status = eb_sdb_scan_root(device, &br, &scan_callback_caloe)) != EB_OK) {
     
@@ -1242,25 +745,29 @@ int scan_caloe(access_caloe * access) {
     
 		return ERROR_TIMEOUT;
 	}
-  
-	if ((status = eb_device_close(device)) != EB_OK) {
-	  
-		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR: failed to close Etherbone device \n");
-    
-		return ERROR_CLOSE_DEVICE;
-	}
-  
-	if ((status = eb_socket_close(socket)) != EB_OK) {
-    
+
+	return ALL_OK;
+}
+
+int scan_caloe(access_caloe * access) {
+	session_caloe * session;
+	int rcode;
+
+	if(access->mode != SCAN) {
 		if(VERBOSE_CALOE)
-			fprintf(stderr, "ERROR: failed to close Etherbone socket \n");
-    
-		return ERROR_CLOSE_SOCKET;
+		fprintf(stderr,"ERROR: Invalid scan operation \n");
+      
+		return INVALID_OPERATION;
 	}
-	
 
-	return ALL_OK;
+	if((rcode = acquire_session_caloe(default_session_pool_caloe(),&access->networkc,&session)) != ALL_OK)
+		return rcode;
+
+	rcode = scan_session_caloe(session);
+
+	release_session_caloe(default_session_pool_caloe(),session,rcode);
+
+	return rcode;
 }
 
 int execute_native_caloe(access_caloe * access) {
@@ -1299,19 +806,21 @@ int execute_tools_caloe(access_caloe * access) {
 	char write_cmd[] = "eb-write";
 	char value[50];
 	char addr[50];
-	char net[50];
+	const endpoint_caloe * endpoint = get_endpoint_caloe(access->networkc.endpoint);
 
 	int status, died;
 
 	int pipefd[2];
+
+	if(endpoint == NULL)
+		return ERROR_ENDPOINT;
+
 	pipe(pipefd);
 	
 	
 	eb_data_t mask_aux = access->mask;
 	mask_oper_caloe mask_oper_aux = access->mask_oper;
 	
-	char * netaddress = access->networkc.netaddress;
-	int port = (access->networkc.port == NULL ? 60368 : *(access->networkc.port));
 	eb_data_t v = access->value;
 	int align_v;
 	
@@ -1342,7 +851,6 @@ int execute_tools_caloe(access_caloe * access) {
 	
 	sprintf(value,"0x%x",v);
 	sprintf(addr,"0x%x/%d",access->address,align_v);
-	sprintf(net,"%s/%d",netaddress,port);
 
 	switch(pid=fork()){
 		case -1:
@@ -1363,20 +871,20 @@ int execute_tools_caloe(access_caloe * access) {
 				case SCAN: 
 					strcpy(cmd,scan_cmd);
 					sprintf(cmd_l,"%s%s",etherbone_dir,cmd);
-					//fprintf(stderr,"exec() %s %s\n",cmd,net);
-					execl(cmd_l,cmd,net,NULL);
+					//fprintf(stderr,"exec() %s %s\n",cmd,endpoint->key);
+					execl(cmd_l,cmd,endpoint->key,NULL);
 					break;
 				case READ: 
 					strcpy(cmd,read_cmd);
 					sprintf(cmd_l,"%s%s",etherbone_dir,cmd);
-					//fprintf(stderr,"exec() %s %s %s\n",cmd,net,addr);
-					execl(cmd_l,cmd,net,addr,NULL);
+					//fprintf(stderr,"exec() %s %s %s\n",cmd,endpoint->key,addr);
+					execl(cmd_l,cmd,endpoint->key,addr,NULL);
 					break;
 				case WRITE:
 					strcpy(cmd,write_cmd);
 					sprintf(cmd_l,"%s%s",etherbone_dir,cmd);
-					//fprintf(stderr,"exec() %s %s %s %s\n",cmd,net,addr,value);
-					execl(cmd_l,cmd,net,addr,value,NULL);
+					//fprintf(stderr,"exec() %s %s %s %s\n",cmd,endpoint->key,addr,value);
+					execl(cmd_l,cmd,endpoint->key,addr,value,NULL);
 					break;
 				default:
 					exit(-1);
@@ -1427,17 +935,482 @@ int execute_tools_caloe(access_caloe * access) {
      return status;
 }
 
-int execute_caloe(access_caloe * access) {
+/**
+* @brief Accesses packed into one Etherbone cycle. It is the user data of batch_callback_caloe.
+*/
+
+struct batch_cycle_caloe {
+	access_caloe * accesses; /**< Accesses of the cycle */
+	wire_access_caloe * plans; /**< Wire layout of each access */
+	int naccess; /**< Number of accesses */
+	int stop; /**< It indicates if the cycle has finished */
+	int error; /**< It indicates if the cycle has failed */
+};
+
+/**
+* batch callback function. It scatters read values back into the accesses of the cycle.
+* You can get more information in http://www.ohwr.org/projects/etherbone-core
+**/
+
+static void batch_callback_caloe(eb_user_data_t user, eb_device_t dev, eb_operation_t op, eb_status_t status) {
+	struct batch_cycle_caloe * bc = (struct batch_cycle_caloe *) user;
+
+	bc->stop = 1;
+
+	if (status != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Etherbone cycle failed! \n");
+
+		bc->error = 1;
+		return;
+	}
+
+	collect_cycle_caloe(op, bc->accesses, bc->plans, bc->naccess);
+}
+
+static int run_batch_cycle_caloe(session_caloe * session, access_caloe * accesses, wire_access_caloe * plans, int naccess) {
+	struct batch_cycle_caloe bc;
+	eb_status_t status;
+	eb_cycle_t cycle;
 	int rcode;
-	
-	if (! EXECUTE_CALOE_MODE)
-		rcode = execute_native_caloe(access);
-	else {
-		rcode = execute_tools_caloe(access);
+	int i;
+
+	bc.accesses = accesses;
+	bc.plans = plans;
+	bc.naccess = naccess;
+	bc.error = 0;
+
+	/* Begin the cycle */
+	if ((status = eb_cycle_open(session->device, &bc, &batch_callback_caloe, &cycle)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR %d: Could not create a new Etherbone operation cycle \n",(int) status);
+
+		return ERROR_OPEN_CYCLE;
 	}
-	
-	if(SLEEP_ACCESS != 0)
-		usleep(SLEEP_ACCESS);
-	
+
+	for (i = 0; i < naccess; ++i) {
+		if (accesses[i].mode == READ)
+			queue_read_caloe(cycle, &accesses[i], &plans[i]);
+		else
+			queue_write_caloe(cycle, &accesses[i], &plans[i], apply_mask_caloe(&accesses[i], accesses[i].value));
+	}
+
+	eb_cycle_close(cycle);
+
+	bc.stop = 0;
+
+	if ((rcode = run_cycle_caloe(session->socket, &bc.stop)) != ALL_OK)
+		return rcode;
+
+	if (bc.error)
+		return ERROR_OPERATION_RUN;
+
+	return ALL_OK;
+}
+
+int execute_native_batch_caloe(access_caloe * accesses, int naccess, int * ndone) {
+	session_pool_caloe * pool = default_session_pool_caloe();
+	session_caloe * session;
+	wire_access_caloe * plans;
+	int rcode = ALL_OK;
+	int i, j;
+
+	plans = malloc(sizeof(wire_access_caloe)*(naccess > 0 ? naccess : 1));
+
+	i = 0;
+
+	while (i < naccess && rcode == ALL_OK) {
+
+		// Successive write after read accesses to one register are merged (one read and one write)
+		if (accesses[i].mode == READ_WRITE) {
+			for (j = i+1; j < naccess && same_register_caloe(&accesses[i], &accesses[j]); ++j);
+
+			if ((rcode = acquire_session_caloe(pool, &accesses[i].networkc, &session)) != ALL_OK)
+				break;
+
+			rcode = write_after_read_session_caloe(session, &accesses[i], j-i);
+
+			release_session_caloe(pool, session, rcode);
+
+			if (rcode == ALL_OK)
+				i = j;
+			continue;
+		}
+
+		// Scan accesses can not share a cycle
+		if (accesses[i].mode != READ && accesses[i].mode != WRITE) {
+			if ((rcode = execute_native_caloe(&accesses[i])) == ALL_OK)
+				i++;
+			continue;
+		}
+
+		if ((rcode = acquire_session_caloe(pool, &accesses[i].networkc, &session)) != ALL_OK)
+			break;
+
+		// Pack all following reads/writes to the same endpoint in one cycle
+		for (j = i; j < naccess; ++j) {
+			if (accesses[j].mode != READ && accesses[j].mode != WRITE)
+				break;
+
+			if (!same_endpoint_caloe(&accesses[i].networkc, &accesses[j].networkc))
+				break;
+
+			if (plan_access_caloe(session, &accesses[j], &plans[j]) != ALL_OK)
+				break;
+
+			// Narrow writes need a read of the whole word first
+			if (accesses[j].mode == WRITE && plans[j].widen)
+				break;
+		}
+
+		if (j == i) {
+			// The first access can not be packed, run it alone
+			release_session_caloe(pool, session, ALL_OK);
+
+			if ((rcode = execute_native_caloe(&accesses[i])) == ALL_OK)
+				i++;
+			continue;
+		}
+
+		rcode = run_batch_cycle_caloe(session, &accesses[i], &plans[i], j-i);
+
+		release_session_caloe(pool, session, rcode);
+
+		if (rcode == ALL_OK)
+			i = j;
+	}
+
+	free(plans);
+
+	if (ndone != NULL)
+		*ndone = i;
+
+	return rcode;
+}
+
+/**
+* @brief State shared by the cycles of a block transfer.
+**/
+
+struct block_state_caloe {
+	int inflight; /**< Number of cycles in flight */
+	int error; /**< It indicates if any cycle has failed */
+	long long min_rtt; /**< Lowest round trip time (us) seen (-1: not measured yet) */
+	int window; /**< Cycles allowed in flight */
+	int abandoned; /**< It indicates if the transfer has timed out (the last callback frees it) */
+};
+
+/**
+* @brief One cycle of a block transfer.
+**/
+
+struct block_cycle_caloe {
+	access_caloe * access; /**< Access of the block (mask) */
+	eb_data_t * buffer; /**< Values of the cycle words (NULL for writes) */
+	const eb_data_t * data; /**< Values to write (NULL for reads) */
+	wire_access_caloe * plans; /**< Wire layout of each word */
+	int nwords; /**< Number of words */
+	int busy; /**< It indicates if the cycle is in flight */
+	long long sent; /**< Timestamp (us) of the cycle */
+	struct block_state_caloe * state; /**< Transfer state */
+};
+
+/**
+* @brief Block transfer. It is allocated at once so that a transfer that times out can be freed by the
+* callback of its last cycle in flight (the caller's frame and buffer are gone by then).
+**/
+
+struct block_transfer_caloe {
+	struct block_state_caloe state; /**< Transfer state (first member, see block_callback_caloe) */
+	struct block_cycle_caloe cycles[BLOCK_WINDOW]; /**< Cycles */
+	wire_access_caloe plans[BLOCK_WINDOW*BLOCK_CYCLE_OPS]; /**< Wire layouts of the cycles */
+};
+
+/**
+* block callback function. It measures the round trip time of the cycle and lands read values
+* in the block buffer. You can get more information in http://www.ohwr.org/projects/etherbone-core
+**/
+
+static void block_callback_caloe(eb_user_data_t user, eb_device_t dev, eb_operation_t op, eb_status_t status) {
+	struct block_cycle_caloe * bc = (struct block_cycle_caloe *) user;
+	struct block_state_caloe * bs = bc->state;
+	long long rtt = now_us_caloe() - bc->sent;
+	eb_data_t value;
+	int i;
+
+	(void) dev;
+
+	bc->busy = 0;
+	bs->inflight--;
+
+	// The caller gave up on the transfer: nothing is landed, the last cycle frees it
+	if (bs->abandoned) {
+		if (bs->inflight == 0)
+			free((struct block_transfer_caloe *) bs);
+
+		return;
+	}
+
+	// Keep one round trip worth of packets in flight (queueing delay is filtered with the lowest RTT)
+	if (bs->min_rtt < 0 || rtt < bs->min_rtt)
+		bs->min_rtt = rtt;
+
+	bs->window = 1 + bs->min_rtt/BLOCK_PACKET_US;
+
+	if (bs->window > BLOCK_WINDOW)
+		bs->window = BLOCK_WINDOW;
+
+	if (status != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Etherbone cycle failed! \n");
+
+		bs->error = 1;
+		return;
+	}
+
+	if (bc->buffer == NULL)
+		return;
+
+	for (i = 0; i < bc->nwords; ++i) {
+		op = gather_data_caloe(op, bc->plans[i].count, &value);
+
+		value >>= bc->plans[i].shift*8;
+		value &= bc->plans[i].mask;
+
+		bc->buffer[i] = apply_mask_caloe(bc->access, value);
+	}
+}
+
+static int open_block_cycle_caloe(session_caloe * session, struct block_cycle_caloe * bc, access_caloe * word, eb_address_t step) {
+	eb_status_t status;
+	eb_cycle_t cycle;
+	eb_address_t offset = word->offset;
+	int rcode;
+	int i;
+
+	for (i = 0; i < bc->nwords; ++i, word->offset += step) {
+		if ((rcode = plan_access_caloe(session, word, &bc->plans[i])) != ALL_OK)
+			return rcode;
+
+		// Narrow writes would need a read of each word first
+		if (bc->data != NULL && bc->plans[i].widen) {
+
+			if(VERBOSE_CALOE)
+				fprintf(stderr, "ERROR: Block writes narrower than the device width are not supported \n");
+
+			return ERROR_SIZE_NOT_SUPPORTED;
+		}
+	}
+
+	/* Begin the cycle */
+	if ((status = eb_cycle_open(session->device, bc, &block_callback_caloe, &cycle)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR %d: Could not create a new Etherbone operation cycle \n",(int) status);
+
+		return ERROR_OPEN_CYCLE;
+	}
+
+	for (i = 0; i < bc->nwords; ++i) {
+		if (bc->data != NULL)
+			queue_write_caloe(cycle, word, &bc->plans[i], apply_mask_caloe(bc->access, bc->data[i]));
+		else
+			queue_read_caloe(cycle, word, &bc->plans[i]);
+	}
+
+	eb_cycle_close(cycle);
+
+	word->offset = offset + step*bc->nwords;
+
+	bc->busy = 1;
+	bc->sent = now_us_caloe();
+	bc->state->inflight++;
+
+	return ALL_OK;
+}
+
+/**
+* Runs a block read (data is NULL) or write (buffer is NULL) on one open device. The first cycle
+* goes alone to measure the round trip time; then the window grows to cover it.
+**/
+
+static int block_session_caloe(session_caloe * session, access_caloe * access, int stride, int count, eb_data_t * buffer, const eb_data_t * data, block_stats_caloe * stats) {
+	struct block_transfer_caloe * transfer;
+	struct block_cycle_caloe * cycles;
+	struct block_state_caloe * bs;
+	access_caloe word = *access;
+	eb_address_t step = align_bytes_caloe(access->align)*stride;
+	long long start = now_us_caloe();
+	int next = 0;
+	int rcode = ALL_OK;
+	int timeout;
+	int before;
+	int i;
+
+	// One allocation for the whole block (state, cycles and wire layouts of the cycles in flight)
+	transfer = malloc(sizeof(struct block_transfer_caloe));
+	cycles = transfer->cycles;
+	bs = &transfer->state;
+
+	bs->inflight = 0;
+	bs->error = 0;
+	bs->min_rtt = -1;
+	bs->window = 1;
+	bs->abandoned = 0;
+
+	for (i = 0; i < BLOCK_WINDOW; ++i) {
+		cycles[i].access = access;
+		cycles[i].plans = transfer->plans + i*BLOCK_CYCLE_OPS;
+		cycles[i].busy = 0;
+		cycles[i].state = bs;
+	}
+
+	if (stats != NULL)
+		stats->window = 1;
+
+	while ((next < count && rcode == ALL_OK && !bs->error) || bs->inflight > 0) {
+
+		// Fill the window
+		for (i = 0; i < BLOCK_WINDOW && bs->inflight < bs->window && next < count && rcode == ALL_OK && !bs->error; ++i) {
+			if (cycles[i].busy)
+				continue;
+
+			cycles[i].buffer = (buffer != NULL ? buffer + next : NULL);
+			cycles[i].data = (data != NULL ? data + next : NULL);
+			cycles[i].nwords = (count - next < BLOCK_CYCLE_OPS ? count - next : BLOCK_CYCLE_OPS);
+
+			if ((rcode = open_block_cycle_caloe(session, &cycles[i], &word, step)) == ALL_OK)
+				next += cycles[i].nwords;
+		}
+
+		if (stats != NULL && bs->inflight > stats->window)
+			stats->window = bs->inflight;
+
+		if (bs->inflight == 0)
+			break;
+
+		// Wait until at least one cycle completes
+		before = bs->inflight;
+		timeout = TIMEOUT_LIMIT;
+
+		while (timeout > 0 && bs->inflight == before)
+			timeout -= eb_socket_run(session->socket, timeout);
+
+		if (bs->inflight == before) {
+
+			if(VERBOSE_CALOE)
+				fprintf(stderr, "ERROR: Timeout expired! \n");
+
+			// The session is dropped by the caller; late callbacks only count down and free the transfer
+			bs->abandoned = 1;
+
+			return ERROR_TIMEOUT;
+		}
+	}
+
+	if (stats != NULL) {
+		stats->bytes = (long long) next*align_bytes_caloe(access->align);
+		stats->elapsed = now_us_caloe() - start;
+		stats->rtt = bs->min_rtt;
+		stats->throughput = (stats->elapsed > 0 ? (double) stats->bytes/stats->elapsed : 0);
+	}
+
+	if (rcode == ALL_OK && bs->error)
+		rcode = ERROR_OPERATION_RUN;
+
+	free(transfer);
+
+	return rcode;
+}
+
+/**
+* Reads back a written block and compares it with the written values
+**/
+
+static int verify_block_session_caloe(session_caloe * session, access_caloe * access, int stride, int count, const eb_data_t * data) {
+	access_caloe raw = *access;
+	eb_data_t * readback;
+	eb_data_t width_mask;
+	int rcode;
+	int i;
+
+	raw.mode = READ;
+	raw.mask = 0x00;
+	raw.mask_oper = MASK_OR;
+
+	width_mask = ~(eb_data_t)0;
+	width_mask >>= (sizeof(eb_data_t)-align_bytes_caloe(access->align))*8;
+
+	readback = malloc(sizeof(eb_data_t)*(count > 0 ? count : 1));
+
+	if ((rcode = block_session_caloe(session, &raw, stride, count, readback, NULL, NULL)) == ALL_OK) {
+		for (i = 0; i < count; ++i) {
+			if (readback[i] != (apply_mask_caloe(access, data[i]) & width_mask)) {
+
+				if(VERBOSE_CALOE)
+					fprintf(stderr, "ERROR: Verify failed at word %d (0x%"EB_DATA_FMT" instead of 0x%"EB_DATA_FMT") \n",
+						i, readback[i], apply_mask_caloe(access, data[i]) & width_mask);
+
+				rcode = ERROR_VERIFY;
+				break;
+			}
+		}
+	}
+
+	free(readback);
+
+	return rcode;
+}
+
+int read_block_native_caloe(access_caloe * access, int stride, int count, eb_data_t * buffer) {
+	session_pool_caloe * pool = default_session_pool_caloe();
+	session_caloe * session;
+	int rcode;
+
+	if(access->mode != READ) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr,"ERROR: Invalid block read operation \n");
+
+		return INVALID_OPERATION;
+	}
+
+	if((rcode = acquire_session_caloe(pool,&access->networkc,&session)) != ALL_OK)
+		return rcode;
+
+	rcode = block_session_caloe(session,access,stride,count,buffer,NULL,NULL);
+
+	release_session_caloe(pool,session,rcode);
+
+	return rcode;
+}
+
+int write_block_native_caloe(access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats) {
+	session_pool_caloe * pool = default_session_pool_caloe();
+	session_caloe * session;
+	int rcode;
+
+	if(access->mode != WRITE) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr,"ERROR: Invalid block write operation \n");
+
+		return INVALID_OPERATION;
+	}
+
+	if((rcode = acquire_session_caloe(pool,&access->networkc,&session)) != ALL_OK)
+		return rcode;
+
+	rcode = block_session_caloe(session,access,stride,count,NULL,data,stats);
+
+	if(rcode == ALL_OK && verify)
+		rcode = verify_block_session_caloe(session,access,stride,count,data);
+
+	// A verify mismatch does not leave the device in an unknown state
+	release_session_caloe(pool,session,(rcode == ERROR_VERIFY ? ALL_OK : rcode));
+
 	return rcode;
 }
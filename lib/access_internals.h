@@ -37,6 +37,7 @@
 #include <sys/wait.h>
 #include "../etherbone/api/etherbone.h"
 #include "../etherbone/api/glue/version.h"
+#include "endpoint_internals.h"
 
 /// Defines execute caloe execution mode (0: Use Etherbone API, 1: Use eb-tools in Etherbone repo)
 #define EXECUTE_CALOE_MODE 0
@@ -69,6 +70,16 @@
 #define ERROR_OPERATION_RUN -12
 /// It fails when parser can not understand configuration file corretly
 #define ERROR_PARSE_CONFIG_FILE -13
+/// It fails when a written block does not match its readback
+#define ERROR_VERIFY -14
+/// It fails when a trace file can not be read or written
+#define ERROR_TRACE_FILE -15
+/// It fails when a wait is cancelled by the user
+#define ERROR_CANCELLED -16
+/// It fails when an endpoint address is not valid (<tcp|udp>/<ip>/<port>)
+#define ERROR_ENDPOINT -17
+/// It fails when a configuration file can not be watched for changes
+#define ERROR_WATCH_FILE -18
 
 /// Timeout (us) to read/write operations (-1: NOT LIMITED)
 #define TIMEOUT_LIMIT 1000000
@@ -79,16 +90,21 @@
 /// Verbose mode (0: disabled, 1: enabled)
 #define VERBOSE_CALOE 1
 
-/// Data buffer to read/write operations with Etherbone library
-static eb_data_t data;
+/// Max wire reads in one cycle of a block read (128 addresses of 8 bytes fit in one Ethernet MTU)
+#define BLOCK_CYCLE_OPS 128
+
+/// Max cycles of a block transfer in flight at once
+#define BLOCK_WINDOW 16
+
+/// Time (us) to send one MTU sized packet (1 Gb/s). The window of a block transfer covers one RTT of packets
+#define BLOCK_PACKET_US 12
 
 /**
-* @brief Stores network connection parameters.
+* @brief Stores network connection parameters (a handle of the endpoint registry).
 */
 
 typedef struct network_connection {
-	char * netaddress; /**< IP network address */
-	unsigned int * port;	/**< Etherbone port */
+	int endpoint; /**< Endpoint handle (see register_endpoint_caloe, ERROR_ENDPOINT if it is not valid) */
 } network_connection;
 
 /**
@@ -134,10 +150,24 @@ typedef struct access_caloe {
 	int is_config; /**< It indicates if memory address is refered to Etherbone configuration space with 1 or not with 0 */
 	access_type_caloe mode; /**< Access type to perform */
 	align_access_caloe align;/**< Memory width */
+	int cacheable; /**< It indicates if the register only changes through this library (1: it can be served from the shadow cache, see shadow_internals.h) or it is volatile (0) */
+	int side_effects; /**< It indicates if reads change the register (1: e.g. FIFO pops, they are never coalesced) or not (0) */
 	network_connection networkc; /**< Network parameters */
 } access_caloe;
 
 
+/**
+* @brief Statistics of a block transfer.
+*/
+
+typedef struct block_stats_caloe {
+	long long bytes; /**< Bytes transferred */
+	long long elapsed; /**< Transfer time (us) */
+	long long rtt; /**< Lowest round trip time (us) of a cycle */
+	int window; /**< Max cycles in flight */
+	double throughput; /**< Throughput (MB/s) */
+} block_stats_caloe;
+
 /** This struct has got from Etherbone repository. You can get more information in http://www.ohwr.org/projects/etherbone-core.
 */
 
@@ -159,13 +189,15 @@ struct bus_record {
 * @param ipname_server Server IP name (it must be preceded of udp/ or tcp/ prefix)
 * @param nc Network connection instance to create
 *
+* @return ALL_OK or ERROR_ENDPOINT if the address is not valid
+*
 * @notes This function asumes port is default for Etherbone protocol
 * @warning Format of Net address: <tcp|udp>/<ip>/<port>
 *
 *
 **/
 
-void build_network_con_caloe(char * ipname_server, network_connection *nc);
+int build_network_con_caloe(const char * ipname_server, network_connection *nc);
 
 /**
 *
@@ -175,11 +207,13 @@ void build_network_con_caloe(char * ipname_server, network_connection *nc);
 * @param port Server port
 * @param nc Network connection instance to create
 *
+* @return ALL_OK or ERROR_ENDPOINT if the address is not valid
+*
 * @warning Format of Net address: <tcp|udp>/<ip>/<port>
 *
 **/
 
-void build_network_con_full_caloe(char * ipname_server, unsigned int port, network_connection *nc);
+int build_network_con_full_caloe(const char * ipname_server, unsigned int port, network_connection *nc);
 
 /**
 *
@@ -199,6 +233,7 @@ void copy_network_con_caloe(network_connection * dest, network_connection * src)
 *
 * @param nc Network connection to destroy
 *
+* @notes Endpoint handles are never released, so it only clears the handle
 *
 **/
 
@@ -297,7 +332,7 @@ int write_caloe(access_caloe * access);
 *
 * It implements write after read access over Etherbone library. write after read 
 * is a special kind of write that reads actual value in register, apply a mask to it and write 
-* result into register again.
+* result into register again. The read and the write are performed with the same open device.
 *
 * @param access It contains all information about access (value field contains value to write after read operation is performed)
 *
@@ -353,8 +388,8 @@ int execute_tools_caloe(access_caloe * access);
 
 /**
 *
-* It implements one access (read, write, write after read or scan). This function calls etherbone tools (eb-read, eb-write and eb-ls) or use Etherbone API library
-* instead of EXECUTE_CALOE_MODE macro (1 = with eb-tools, 0 = with Etherbone API directly)
+* It implements one access (read, write, write after read or scan) with the current transport (see transport_internals.h).
+* The default transport depends on EXECUTE_CALOE_MODE macro (1 = with eb-tools, 0 = with Etherbone API directly)
 *
 * @param access It contains all information about access
 * 
@@ -365,8 +400,108 @@ int execute_tools_caloe(access_caloe * access);
 
 int execute_caloe(access_caloe * access);
 
-#endif
+/**
+*
+* It implements a list of accesses over Etherbone library. Consecutive reads and writes to the same
+* endpoint are packed into one Etherbone cycle (one packet, atomic on the wire). Consecutive write after
+* read accesses to the same register are merged into one read and one write. Scan accesses are executed alone.
+*
+* @param accesses Accesses to perform (value field of read accesses contains returned value)
+* @param naccess Number of accesses
+* @param ndone Returned number of accesses completed successfully (it can be NULL)
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int execute_native_batch_caloe(access_caloe * accesses, int naccess, int * ndone);
+
+/**
+*
+* It implements a list of accesses with the current transport (see transport_internals.h). Transports
+* without batch support run the accesses one by one.
+*
+* @param accesses Accesses to perform
+* @param naccess Number of accesses
+* @param ndone Returned number of accesses completed successfully (it can be NULL)
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int execute_batch_caloe(access_caloe * accesses, int naccess, int * ndone);
+
+/**
+*
+* It implements a block read (burst) over Etherbone library. Word i is read from address + offset + i*stride*width
+* (stride 0 reads the same register count times). Reads are packed in cycles of BLOCK_CYCLE_OPS operations.
+* The cycles in flight cover one round trip time (up to BLOCK_WINDOW). Values land straight into the buffer.
+*
+* @param access Read access of the first word (mask is applied to every word)
+* @param stride Address step between words (in words, as the AUTO field of configuration files)
+* @param count Number of words to read
+* @param buffer Returned values (count words)
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int read_block_native_caloe(access_caloe * access, int stride, int count, eb_data_t * buffer);
+
+/**
+*
+* It implements a block read with the current transport (see read_block_native_caloe). Transports
+* without block support read the words one by one.
+*
+* @param access Read access of the first word (mask is applied to every word)
+* @param stride Address step between words (in words, as the AUTO field of configuration files)
+* @param count Number of words to read
+* @param buffer Returned values (count words)
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int read_block_caloe(access_caloe * access, int stride, int count, eb_data_t * buffer);
+
+/**
+*
+* It implements a block write (memory upload) over Etherbone library. Word i is written to address + offset + i*stride*width.
+* Writes are pipelined as in read_block_native_caloe. The written range can be read back and compared.
+*
+* @param access Write access of the first word (mask is applied to every word, words must not be narrower than the device)
+* @param stride Address step between words (in words)
+* @param count Number of words to write
+* @param data Values to write (count words)
+* @param verify Read back the block after writing it (1) or not (0)
+* @param stats Returned transfer statistics of the write (it can be NULL)
+*
+* @return Error code if error (ERROR_VERIFY if readback does not match) or zero otherwise
+*
+**/
+
+int write_block_native_caloe(access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats);
+
+/**
+*
+* It implements a block write with the current transport (see write_block_native_caloe). Transports
+* without block support write (and verify) the words one by one.
+*
+* @param access Write access of the first word
+* @param stride Address step between words (in words)
+* @param count Number of words to write
+* @param data Values to write (count words)
+* @param verify Read back the block after writing it (1) or not (0)
+* @param stats Returned transfer statistics of the write (it can be NULL)
+*
+* @return Error code if error (ERROR_VERIFY if readback does not match) or zero otherwise
+*
+**/
+
+int write_block_caloe(access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats);
 
 #ifdef __cplusplus
 }
 #endif
+
+#endif
@@ -0,0 +1,503 @@
+/**
+ *******************************************************************************
+ * @file async_internals.c
+ *  @brief Implements the asynchronous event loop
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "async_internals.h"
+#include "transport_internals.h"
+#include "shadow_internals.h"
+
+static async_loop_caloe default_loop;
+static pthread_once_t default_loop_once = PTHREAD_ONCE_INIT;
+
+static void async_callback_caloe_eb(eb_user_data_t user, eb_device_t dev, eb_operation_t op, eb_status_t status);
+
+static void init_default_loop_caloe(void) {
+	init_async_loop_caloe(&default_loop);
+}
+
+async_loop_caloe * default_async_loop_caloe(void) {
+	pthread_once(&default_loop_once, &init_default_loop_caloe);
+
+	return &default_loop;
+}
+
+int init_async_loop_caloe(async_loop_caloe * loop) {
+	init_shared_session_pool_caloe(&loop->pool);
+
+	loop->jobs = NULL;
+	loop->next_id = 1;
+	loop->timeout = ASYNC_TIMEOUT_LIMIT;
+
+	return ALL_OK;
+}
+
+static void finish_job_caloe(async_job_caloe * job, int rcode) {
+	job->done = 1;
+	job->rcode = rcode;
+
+	// A session with a cycle in flight is released when the cycle comes back
+	if(!job->inflight && job->session != NULL) {
+		release_session_caloe(&job->loop->pool, job->session, rcode);
+		job->session = NULL;
+	}
+}
+
+static int open_job_cycle_caloe(async_job_caloe * job, eb_cycle_t * cycle) {
+	eb_status_t status;
+
+	if ((status = eb_cycle_open(job->session->device, job, &async_callback_caloe_eb, cycle)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR %d: Could not create a new Etherbone operation cycle \n",(int) status);
+
+		return ERROR_OPEN_CYCLE;
+	}
+
+	return ALL_OK;
+}
+
+static void send_job_cycle_caloe(async_job_caloe * job, eb_cycle_t cycle) {
+	eb_cycle_close(cycle);
+
+	job->inflight = 1;
+	job->deadline = now_us_caloe() + job->loop->timeout;
+}
+
+// A poll has finished: the wait ends or the next poll is scheduled
+
+static void check_poll_caloe(async_job_caloe * job) {
+	long long now = now_us_caloe();
+
+	if((job->accesses[0].value & job->poll_mask) == job->poll_expected) {
+		finish_job_caloe(job, ALL_OK);
+		return;
+	}
+
+	if(job->cancel != NULL && *(job->cancel)) {
+		finish_job_caloe(job, ERROR_CANCELLED);
+		return;
+	}
+
+	if(job->poll_deadline >= 0 && now >= job->poll_deadline) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Timeout expired! \n");
+
+		finish_job_caloe(job, ERROR_TIMEOUT);
+		return;
+	}
+
+	job->next = 0;
+	job->poll_at = now + job->poll_interval;
+
+	if(job->poll_deadline >= 0 && job->poll_at > job->poll_deadline)
+		job->poll_at = job->poll_deadline;
+
+	job->poll_interval = (job->poll_interval*2 > WAIT_POLL_MAX ? WAIT_POLL_MAX : job->poll_interval*2);
+}
+
+// It sends the next cycle of a job (or finishes it if there are no more accesses)
+
+static void issue_job_caloe(async_job_caloe * job) {
+	access_caloe * access;
+	eb_cycle_t cycle;
+	int rcode;
+	int j;
+
+	if(job->next == job->naccess) {
+		if(job->polling)
+			check_poll_caloe(job);
+		else
+			finish_job_caloe(job, ALL_OK);
+
+		return;
+	}
+
+	access = &job->accesses[job->next];
+
+	if(access->mode != READ && access->mode != WRITE && access->mode != READ_WRITE) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr,"ERROR: Invalid asynchronous operation \n");
+
+		finish_job_caloe(job, INVALID_OPERATION);
+		return;
+	}
+
+	if((rcode = acquire_session_caloe(&job->loop->pool, &access->networkc, &job->session)) != ALL_OK) {
+		job->session = NULL;
+		finish_job_caloe(job, rcode);
+		return;
+	}
+
+	if((rcode = plan_access_caloe(job->session, access, &job->plans[job->next])) != ALL_OK) {
+		finish_job_caloe(job, rcode);
+		return;
+	}
+
+	if((rcode = open_job_cycle_caloe(job, &cycle)) != ALL_OK) {
+		finish_job_caloe(job, rcode);
+		return;
+	}
+
+	// Write after read and narrow writes read the word before writing it
+	if(access->mode == READ_WRITE || (access->mode == WRITE && job->plans[job->next].widen)) {
+		queue_read_caloe(cycle, access, &job->plans[job->next]);
+
+		job->rmw = 1;
+		job->ncycle = 1;
+
+		send_job_cycle_caloe(job, cycle);
+		return;
+	}
+
+	// Pack all following reads/writes to the same endpoint in the cycle
+	for(j = job->next + 1; j < job->naccess; ++j) {
+		if(job->accesses[j].mode != READ && job->accesses[j].mode != WRITE)
+			break;
+
+		if(!same_endpoint_caloe(&access->networkc, &job->accesses[j].networkc))
+			break;
+
+		if(plan_access_caloe(job->session, &job->accesses[j], &job->plans[j]) != ALL_OK)
+			break;
+
+		if(job->accesses[j].mode == WRITE && job->plans[j].widen)
+			break;
+	}
+
+	job->rmw = 0;
+	job->ncycle = j - job->next;
+
+	for(j = job->next; j < job->next + job->ncycle; ++j) {
+		if(job->accesses[j].mode == READ)
+			queue_read_caloe(cycle, &job->accesses[j], &job->plans[j]);
+		else
+			queue_write_caloe(cycle, &job->accesses[j], &job->plans[j], apply_mask_caloe(&job->accesses[j], job->accesses[j].value));
+	}
+
+	send_job_cycle_caloe(job, cycle);
+}
+
+// Second phase of a read-modify-write access: merge and write the word just read
+
+static void issue_job_write_caloe(async_job_caloe * job, eb_operation_t op) {
+	access_caloe * access = &job->accesses[job->next];
+	wire_access_caloe * plan = &job->plans[job->next];
+	eb_cycle_t cycle;
+	eb_data_t original_data;
+	eb_data_t data;
+	int rcode;
+
+	gather_data_caloe(op, plan->count, &original_data);
+
+	if(access->mode == READ_WRITE) {
+		// Read value with the mask applied is written back
+		access->value = apply_mask_caloe(access, (original_data >> plan->shift*8) & plan->mask);
+		data = access->value;
+	}
+	else {
+		data = apply_mask_caloe(access, access->value);
+	}
+
+	if(plan->widen) {
+		/* Inject the data */
+		data = ((data & plan->mask) << plan->shift*8) | (original_data & ~(plan->mask << plan->shift*8));
+	}
+
+	if((rcode = open_job_cycle_caloe(job, &cycle)) != ALL_OK) {
+		finish_job_caloe(job, rcode);
+		return;
+	}
+
+	queue_write_caloe(cycle, access, plan, data);
+
+	job->rmw = 2;
+
+	send_job_cycle_caloe(job, cycle);
+}
+
+static void async_callback_caloe_eb(eb_user_data_t user, eb_device_t dev, eb_operation_t op, eb_status_t status) {
+	async_job_caloe * job = (async_job_caloe *) user;
+
+	(void) dev;
+
+	job->inflight = 0;
+
+	// The job expired while the cycle was in flight
+	if(job->done) {
+		finish_job_caloe(job, job->rcode);
+		return;
+	}
+
+	if(status != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Etherbone cycle failed! \n");
+
+		finish_job_caloe(job, ERROR_OPERATION_RUN);
+		return;
+	}
+
+	if(job->rmw == 1) {
+		issue_job_write_caloe(job, op);
+		return;
+	}
+
+	if(job->rmw == 0)
+		collect_cycle_caloe(op, &job->accesses[job->next], &job->plans[job->next], job->ncycle);
+
+	job->next += job->ncycle;
+
+	release_session_caloe(&job->loop->pool, job->session, ALL_OK);
+	job->session = NULL;
+
+	issue_job_caloe(job);
+}
+
+long submit_async_caloe(async_loop_caloe * loop, access_caloe * accesses, int naccess, async_callback_caloe callback, void * user) {
+	async_job_caloe * job;
+	int rcode;
+	int i;
+
+	if(naccess <= 0) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr,"ERROR: Empty asynchronous operation \n");
+
+		return INVALID_OPERATION;
+	}
+
+	// Transports without Etherbone cycles run the operation at once
+	if(!get_transport_caloe()->async) {
+		rcode = execute_batch_caloe(accesses, naccess, NULL);
+
+		if(callback != NULL)
+			callback(user, rcode, accesses, naccess);
+
+		return 0;
+	}
+
+	// Asynchronous accesses do not go through the shadow cache
+	for(i = 0 ; i < naccess ; i++)
+		invalidate_shadow_caloe(default_shadow_cache_caloe(),&accesses[i]);
+
+	job = malloc(sizeof(async_job_caloe));
+	memset(job,0,sizeof(async_job_caloe));
+
+	job->id = loop->next_id++;
+	job->loop = loop;
+	job->accesses = accesses;
+	job->plans = malloc(sizeof(wire_access_caloe)*naccess);
+	job->naccess = naccess;
+	job->callback = callback;
+	job->user = user;
+	job->start = now_us_caloe();
+
+	job->next_job = loop->jobs;
+	loop->jobs = job;
+
+	// Errors are reported through the callback, like any other result
+	issue_job_caloe(job);
+
+	return job->id;
+}
+
+long submit_wait_async_caloe(async_loop_caloe * loop, access_caloe * access, eb_data_t mask, eb_data_t expected, long timeout, volatile int * cancel, async_callback_caloe callback, void * user) {
+	async_job_caloe * job;
+	int rcode;
+
+	// Transports without Etherbone cycles wait at once
+	if(!get_transport_caloe()->async) {
+		rcode = wait_until_caloe(access, mask, expected, timeout, cancel);
+
+		if(callback != NULL)
+			callback(user, rcode, access, 1);
+
+		return 0;
+	}
+
+	// The whole register is read every time
+	access->mode = READ;
+	access->mask = 0x00;
+	access->mask_oper = MASK_OR;
+
+	job = malloc(sizeof(async_job_caloe));
+	memset(job,0,sizeof(async_job_caloe));
+
+	job->id = loop->next_id++;
+	job->loop = loop;
+	job->accesses = access;
+	job->plans = malloc(sizeof(wire_access_caloe));
+	job->naccess = 1;
+	job->callback = callback;
+	job->user = user;
+	job->start = now_us_caloe();
+
+	job->polling = 1;
+	job->poll_mask = mask;
+	job->poll_expected = expected;
+	job->poll_interval = WAIT_POLL_MIN;
+	job->poll_deadline = (timeout >= 0 ? now_us_caloe() + timeout : -1);
+	job->cancel = cancel;
+
+	job->next_job = loop->jobs;
+	loop->jobs = job;
+
+	issue_job_caloe(job);
+
+	return job->id;
+}
+
+static void notify_job_caloe(async_job_caloe * job) {
+	job->notified = 1;
+
+	// Capture mode records the operation once it has ended
+	record_async_caloe(get_transport_caloe(), job->accesses, job->naccess, job->next, job->rcode, job->start);
+
+	if(job->callback != NULL)
+		job->callback(job->user, job->rcode, job->accesses, job->naccess);
+}
+
+static void free_job_caloe(async_job_caloe * job) {
+	free(job->plans);
+	free(job);
+}
+
+int run_async_loop_caloe(async_loop_caloe * loop, long timeout) {
+	async_job_caloe ** it;
+	async_job_caloe * job;
+	async_job_caloe * ready = NULL;
+	long long now;
+	int pending = 0;
+
+	if(loop->jobs == NULL)
+		return 0;
+
+	// Do not wait past the next scheduled poll
+	now = now_us_caloe();
+
+	for(job = loop->jobs; job != NULL; job = job->next_job) {
+		// Jobs finished without a cycle in flight (e.g. failed connection) are taken out right away
+		if(job->done && !job->inflight)
+			timeout = 0;
+		else if(!job->done && job->poll_at > 0 && (timeout < 0 || job->poll_at - now < timeout))
+			timeout = (job->poll_at > now ? job->poll_at - now : 0);
+	}
+
+	if(loop->pool.socket_open)
+		eb_socket_run(loop->pool.socket, timeout);
+	else if(timeout > 0)
+		usleep(timeout);
+
+	now = now_us_caloe();
+
+	// Send scheduled polls (or end cancelled waits)
+	for(job = loop->jobs; job != NULL; job = job->next_job) {
+		if(job->done || job->poll_at == 0)
+			continue;
+
+		if(job->cancel != NULL && *(job->cancel)) {
+			job->poll_at = 0;
+			finish_job_caloe(job, ERROR_CANCELLED);
+		}
+		else if(now >= job->poll_at) {
+			job->poll_at = 0;
+			issue_job_caloe(job);
+		}
+	}
+
+	// Expire late cycles and take out finished jobs (callbacks may submit new jobs)
+	it = &loop->jobs;
+
+	while(*it != NULL) {
+		job = *it;
+
+		if(!job->done && job->inflight && now > job->deadline) {
+
+			if(VERBOSE_CALOE)
+				fprintf(stderr, "ERROR: Timeout expired! \n");
+
+			finish_job_caloe(job, ERROR_TIMEOUT);
+		}
+
+		if(job->done && !job->inflight) {
+			*it = job->next_job;
+
+			job->next_job = ready;
+			ready = job;
+		}
+		else {
+			if(!job->done)
+				pending++;
+
+			it = &job->next_job;
+		}
+	}
+
+	// Expired jobs with a cycle still in flight stay in the loop, but they are notified now
+	for(job = loop->jobs; job != NULL; job = job->next_job) {
+		if(job->done && !job->notified)
+			notify_job_caloe(job);
+	}
+
+	while(ready != NULL) {
+		job = ready;
+		ready = job->next_job;
+
+		if(!job->notified)
+			notify_job_caloe(job);
+
+		free_job_caloe(job);
+	}
+
+	return pending;
+}
+
+int pending_async_caloe(async_loop_caloe * loop, long id) {
+	async_job_caloe * job;
+
+	for(job = loop->jobs; job != NULL; job = job->next_job) {
+		if(job->id == id)
+			return !job->notified;
+	}
+
+	return 0;
+}
+
+int wait_async_caloe(async_loop_caloe * loop, long id) {
+	while(pending_async_caloe(loop, id))
+		run_async_loop_caloe(loop, loop->timeout);
+
+	return ALL_OK;
+}
+
+int close_async_loop_caloe(async_loop_caloe * loop) {
+	while(loop->jobs != NULL)
+		run_async_loop_caloe(loop, loop->timeout);
+
+	return close_session_pool_caloe(&loop->pool);
+}
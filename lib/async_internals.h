@@ -0,0 +1,213 @@
+/**
+ *******************************************************************************
+ * @file async_internals.h
+ *  @brief Asynchronous accesses: many cycles in flight on one socket driven by one event loop
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef ASYNC_INTERNALS_CALOE_H
+#define ASYNC_INTERNALS_CALOE_H
+
+#include "access_internals.h"
+#include "session_internals.h"
+#include "wire_internals.h"
+
+/// Timeout (us) of each asynchronous cycle
+#define ASYNC_TIMEOUT_LIMIT TIMEOUT_LIMIT
+
+/**
+* @brief Completion callback of an asynchronous job.
+*
+* @param user User data given on submit
+* @param rcode Result of the job (ALL_OK or error code)
+* @param accesses Accesses of the job (value field of read accesses contains returned value)
+* @param naccess Number of accesses
+*/
+
+typedef void (*async_callback_caloe)(void * user, int rcode, access_caloe * accesses, int naccess);
+
+/**
+* @brief List of accesses executed without blocking (one cycle in flight at a time, in order).
+*/
+
+typedef struct async_job_caloe {
+	long id; /**< Job handle */
+	struct async_loop_caloe * loop; /**< Loop that drives the job */
+	access_caloe * accesses; /**< Accesses to perform (owned by the caller until the callback) */
+	wire_access_caloe * plans; /**< Wire layout of each access */
+	int naccess; /**< Number of accesses */
+	int next; /**< First access not completed */
+	int ncycle; /**< Number of accesses in the cycle in flight */
+	int rmw; /**< Read-modify-write phase of the access in flight (0: none, 1: read, 2: write) */
+	session_caloe * session; /**< Session of the cycle in flight */
+	int inflight; /**< It indicates if a cycle of the job is in flight (1) or not (0) */
+	int done; /**< It indicates if the job has finished (1) or not (0) */
+	int notified; /**< It indicates if the callback has been called (1) or not (0) */
+	int rcode; /**< Result of the job */
+	long long deadline; /**< Timestamp (us) when the cycle in flight expires */
+	int polling; /**< It indicates if the job polls a register until a condition is met (1) or not (0) */
+	eb_data_t poll_mask; /**< Bits of the polled register to compare */
+	eb_data_t poll_expected; /**< Expected value of the bits */
+	long poll_interval; /**< Time (us) before the next poll */
+	long long poll_at; /**< Timestamp (us) of the next poll (0: no poll scheduled) */
+	long long poll_deadline; /**< Timestamp (us) when the wait expires (-1: NOT LIMITED) */
+	volatile int * cancel; /**< Flag that cancels the wait (it can be NULL) */
+	async_callback_caloe callback; /**< Completion callback */
+	void * user; /**< User data of the callback */
+	long long start; /**< Timestamp (us) when the job was submitted */
+	struct async_job_caloe * next_job; /**< Next job of the loop */
+} async_job_caloe;
+
+/**
+* @brief Event loop: a shared-socket session pool and the jobs in flight. A loop must be driven
+* (submit/run/wait) by one thread at a time.
+*/
+
+typedef struct async_loop_caloe {
+	session_pool_caloe pool; /**< Sessions of the loop (one socket) */
+	async_job_caloe * jobs; /**< Submitted jobs */
+	long next_id; /**< Handle of the next job */
+	long timeout; /**< Timeout (us) of each cycle */
+} async_loop_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Gets the event loop used by the asynchronous API of the library
+*
+* @return Default event loop
+*
+**/
+
+async_loop_caloe * default_async_loop_caloe(void);
+
+/**
+*
+* Initializes an event loop without jobs
+*
+* @param loop Event loop
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int init_async_loop_caloe(async_loop_caloe * loop);
+
+/**
+*
+* Submits a list of accesses to the event loop. It returns without waiting for the device;
+* the first cycle is sent right away and the callback is called from run_async_loop_caloe.
+* Consecutive reads/writes to the same endpoint share a cycle. Scan accesses are not supported.
+*
+* @param loop Event loop
+* @param accesses Accesses to perform (they must be valid until the callback is called)
+* @param naccess Number of accesses
+* @param callback Completion callback (it can be NULL)
+* @param user User data of the callback
+*
+* @return Job handle (positive) or error code
+*
+**/
+
+long submit_async_caloe(async_loop_caloe * loop, access_caloe * accesses, int naccess, async_callback_caloe callback, void * user);
+
+/**
+*
+* Submits a wait to the event loop: the register of an access is polled until (value & mask) ==
+* expected, with growing intervals (see wait_until_caloe). Other jobs go on while it waits.
+*
+* @param loop Event loop
+* @param access Register to poll (it must be valid until the callback; its value is the last one read)
+* @param mask Bits to compare
+* @param expected Expected value of the bits
+* @param timeout Max waiting time (us, -1: NOT LIMITED)
+* @param cancel Flag that cancels the wait when it is set (it can be NULL)
+* @param callback Completion callback (ALL_OK, ERROR_TIMEOUT, ERROR_CANCELLED or error code of a read)
+* @param user User data of the callback
+*
+* @return Job handle (positive), zero if the wait has already finished (callback called) or error code
+*
+**/
+
+long submit_wait_async_caloe(async_loop_caloe * loop, access_caloe * access, eb_data_t mask, eb_data_t expected, long timeout, volatile int * cancel, async_callback_caloe callback, void * user);
+
+/**
+*
+* Runs the event loop once: it waits for socket activity (or the next poll of a wait), expires late
+* cycles, sends scheduled polls and calls the callbacks of finished jobs
+*
+* @param loop Event loop
+* @param timeout Max time (us) to wait for socket activity
+*
+* @return Number of jobs not finished yet
+*
+**/
+
+int run_async_loop_caloe(async_loop_caloe * loop, long timeout);
+
+/**
+*
+* Checks if a job has not been notified yet
+*
+* @param loop Event loop
+* @param id Job handle
+*
+* @return 1 if the job is pending or zero otherwise
+*
+**/
+
+int pending_async_caloe(async_loop_caloe * loop, long id);
+
+/**
+*
+* Runs the event loop until a job has been notified
+*
+* @param loop Event loop
+* @param id Job handle
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int wait_async_caloe(async_loop_caloe * loop, long id);
+
+/**
+*
+* Runs the event loop until every job has been notified and closes its sessions
+*
+* @param loop Event loop
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int close_async_loop_caloe(async_loop_caloe * loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
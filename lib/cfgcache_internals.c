@@ -0,0 +1,254 @@
+/**
+ *******************************************************************************
+ * @file cfgcache_internals.c
+ *  @brief Compiled configuration files source file
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "cfgcache_internals.h"
+#include "access_internals.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static int invalid_cfg_cache_caloe(const char * path, const char * reason) {
+	if(VERBOSE_CALOE)
+		fprintf(stderr, "ERROR: Compiled configuration file %s is not valid (%s)\n", path, reason);
+
+	return ERROR_PARSE_CONFIG_FILE;
+}
+
+/** Check that a section of count items of item_size bytes fits in the image **/
+
+static int section_fits_caloe(uint32_t offset, uint32_t count, size_t item_size, size_t size) {
+	return (offset % 8) == 0 && (uint64_t) offset + (uint64_t) count*item_size <= size;
+}
+
+static int check_cfg_cache_caloe(const char * path, cfg_cache_caloe * cache) {
+	const cfg_cache_header_caloe * h = cache->header;
+	uint32_t used = 0;
+	uint32_t i;
+
+	if(cache->size < sizeof(cfg_cache_header_caloe) || memcmp(h->magic,CFG_CACHE_MAGIC,8) != 0)
+		return invalid_cfg_cache_caloe(path,"bad magic number");
+
+	if(h->version != CFG_CACHE_VERSION || h->endian != CFG_CACHE_ENDIAN)
+		return invalid_cfg_cache_caloe(path,"other version or byte order");
+
+	if(h->size != cache->size)
+		return invalid_cfg_cache_caloe(path,"truncated");
+
+	if(!section_fits_caloe(h->operations,h->noperations,sizeof(cfg_cache_operation_caloe),cache->size) ||
+		!section_fits_caloe(h->accesses,h->naccesses,sizeof(cfg_cache_access_caloe),cache->size) ||
+		!section_fits_caloe(h->slots,h->nslots,sizeof(int32_t),cache->size) ||
+		!section_fits_caloe(h->values,h->nvalues,sizeof(int32_t),cache->size) ||
+		!section_fits_caloe(h->strings,h->strings_size,1,cache->size))
+		return invalid_cfg_cache_caloe(path,"section out of bounds");
+
+	cache->operations = (const cfg_cache_operation_caloe *) ((const char *) cache->base + h->operations);
+	cache->accesses = (const cfg_cache_access_caloe *) ((const char *) cache->base + h->accesses);
+	cache->slots = (const int32_t *) ((const char *) cache->base + h->slots);
+	cache->values = (const int32_t *) ((const char *) cache->base + h->values);
+	cache->strings = (const char *) cache->base + h->strings;
+
+	// Every string ends inside the pool
+	if(h->strings_size == 0 || cache->strings[h->strings_size-1] != '\0')
+		return invalid_cfg_cache_caloe(path,"bad string pool");
+
+	// The name index always has free slots (searches end)
+	if(h->nslots == 0 || (h->nslots & (h->nslots-1)) != 0 || h->nslots < 2*(uint64_t) h->noperations)
+		return invalid_cfg_cache_caloe(path,"bad name index");
+
+	for(i = 0 ; i < h->nslots ; i++) {
+		if(cache->slots[i] < -1 || cache->slots[i] >= (int32_t) h->noperations)
+			return invalid_cfg_cache_caloe(path,"bad name index");
+
+		if(cache->slots[i] >= 0)
+			used++;
+	}
+
+	if(used > h->noperations)
+		return invalid_cfg_cache_caloe(path,"bad name index");
+
+	for(i = 0 ; i < h->noperations ; i++) {
+		const cfg_cache_operation_caloe * op = &cache->operations[i];
+
+		if(op->name >= h->strings_size || op->doc >= h->strings_size ||
+			(uint64_t) op->first + op->naccesses > h->naccesses)
+			return invalid_cfg_cache_caloe(path,"bad operation");
+	}
+
+	for(i = 0 ; i < h->naccesses ; i++) {
+		const cfg_cache_access_caloe * a = &cache->accesses[i];
+
+		if(a->ip >= h->strings_size ||
+			(uint64_t) a->offsets + a->noffsets > h->nvalues ||
+			(uint64_t) a->masks + a->nmasks > h->nvalues)
+			return invalid_cfg_cache_caloe(path,"bad access");
+	}
+
+	return ALL_OK;
+}
+
+uint32_t hash_cfg_name_caloe(const char * name) {
+	uint32_t h = 2166136261u;
+
+	while(*name != '\0')
+		h = (h ^ (unsigned char) *name++) * 16777619u;
+
+	return h;
+}
+
+int hash_cfg_file_caloe(const char * path, uint64_t * hash, uint64_t * size) {
+	uint64_t h = 14695981039346656037ull;
+	const unsigned char * data;
+	uint64_t w;
+	struct stat st;
+	size_t i;
+	int fd;
+
+	if((fd = open(path,O_RDONLY)) < 0)
+		return ERROR_PARSE_CONFIG_FILE;
+
+	if(fstat(fd,&st) != 0) {
+		close(fd);
+		return ERROR_PARSE_CONFIG_FILE;
+	}
+
+	*size = st.st_size;
+
+	if(st.st_size > 0) {
+		data = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+
+		if(data == MAP_FAILED) {
+			close(fd);
+			return ERROR_PARSE_CONFIG_FILE;
+		}
+
+		// FNV-1a over 64 bit words (the shift mixes high bits into the next word)
+		for(i = 0 ; i + 8 <= (size_t) st.st_size ; i += 8) {
+			memcpy(&w,data + i,8);
+			h = (h ^ w) * 1099511628211ull;
+			h ^= h >> 32;
+		}
+
+		for( ; i < (size_t) st.st_size ; i++)
+			h = (h ^ data[i]) * 1099511628211ull;
+
+		munmap((void *) data,st.st_size);
+	}
+
+	close(fd);
+
+	*hash = h;
+
+	return ALL_OK;
+}
+
+int map_cfg_cache_caloe(const char * path, cfg_cache_caloe * cache) {
+	struct stat st;
+	int fd;
+	int rcode;
+
+	memset(cache,0,sizeof(cfg_cache_caloe));
+
+	if((fd = open(path,O_RDONLY)) < 0)
+		return ERROR_PARSE_CONFIG_FILE;
+
+	if(fstat(fd,&st) != 0 || st.st_size < (off_t) sizeof(cfg_cache_header_caloe)) {
+		close(fd);
+		return invalid_cfg_cache_caloe(path,"truncated");
+	}
+
+	cache->base = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+
+	// The mapping stays valid after the descriptor is closed
+	close(fd);
+
+	if(cache->base == MAP_FAILED) {
+		cache->base = NULL;
+		return ERROR_PARSE_CONFIG_FILE;
+	}
+
+	cache->size = st.st_size;
+	cache->header = (const cfg_cache_header_caloe *) cache->base;
+
+	if((rcode = check_cfg_cache_caloe(path,cache)) != ALL_OK)
+		unmap_cfg_cache_caloe(cache);
+
+	return rcode;
+}
+
+void unmap_cfg_cache_caloe(cfg_cache_caloe * cache) {
+	if(cache->base != NULL)
+		munmap(cache->base,cache->size);
+
+	memset(cache,0,sizeof(cfg_cache_caloe));
+}
+
+int find_cfg_operation_caloe(const cfg_cache_caloe * cache, const char * name) {
+	uint32_t h = hash_cfg_name_caloe(name);
+	uint32_t mask;
+	uint32_t i;
+	int32_t op;
+
+	if(cache->base == NULL)
+		return -1;
+
+	mask = cache->header->nslots - 1;
+
+	// Linear probing (the index is never full)
+	for(i = h & mask ; (op = cache->slots[i]) >= 0 ; i = (i + 1) & mask) {
+		if(cache->operations[op].hash == h && strcmp(cache->strings + cache->operations[op].name,name) == 0)
+			return op;
+	}
+
+	return -1;
+}
+
+int write_cfg_cache_caloe(const char * path, const void * image, size_t size) {
+	char tmp[PATH_MAX];
+	FILE * f;
+	int ok;
+
+	if(snprintf(tmp,sizeof(tmp),"%s.%d",path,(int) getpid()) >= (int) sizeof(tmp))
+		return ERROR_PARSE_CONFIG_FILE;
+
+	if((f = fopen(tmp,"wb")) == NULL)
+		return ERROR_PARSE_CONFIG_FILE;
+
+	ok = (fwrite(image,1,size,f) == size);
+
+	if(fclose(f) != 0)
+		ok = 0;
+
+	// Readers map either the old file or the new one
+	if(!ok || rename(tmp,path) != 0) {
+		unlink(tmp);
+		return ERROR_PARSE_CONFIG_FILE;
+	}
+
+	return ALL_OK;
+}
@@ -0,0 +1,223 @@
+/**
+ *******************************************************************************
+ * @file cfgcache_internals.h
+ *  @brief Compiled configuration files: operation tables stored in a binary image that is mapped
+ *  in memory (mmap) and used in place
+ *
+ *  Layout of the image (native byte order, every section aligned to 8 bytes):
+ *
+ *    header | accesses | operations | slots | values | strings
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef CFGCACHE_INTERNALS_CALOE_H
+#define CFGCACHE_INTERNALS_CALOE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Magic number of a compiled configuration file
+#define CFG_CACHE_MAGIC "CALOECFG"
+
+/// Version of the image layout (images of other versions are rejected)
+#define CFG_CACHE_VERSION 1
+
+/// Byte order mark (images written on a machine with another byte order are rejected)
+#define CFG_CACHE_ENDIAN 0x01020304
+
+/// Suffix of compiled configuration files (dio.cfg is compiled into dio.cfgc)
+#define CFG_CACHE_SUFFIX "c"
+
+/// Access flag: the access can be served by the shadow cache
+#define CFG_ACCESS_CACHEABLE 0x1
+
+/// Access flag: reading the register has side effects
+#define CFG_ACCESS_SIDE_EFFECTS 0x2
+
+/// Access flag: configuration access
+#define CFG_ACCESS_CONFIG 0x4
+
+/**
+* @brief Header of a compiled configuration file. Offsets are in bytes from the start of the image.
+*/
+
+typedef struct cfg_cache_header_caloe {
+	char magic[8]; /**< CFG_CACHE_MAGIC (not null terminated) */
+	uint32_t version; /**< CFG_CACHE_VERSION */
+	uint32_t endian; /**< CFG_CACHE_ENDIAN */
+	uint64_t source_hash; /**< Hash of the source configuration file (see hash_cfg_file_caloe) */
+	uint64_t source_size; /**< Size of the source configuration file */
+	uint32_t size; /**< Size of the image */
+	uint32_t noperations; /**< Number of operations */
+	uint32_t naccesses; /**< Number of accesses (of all operations) */
+	uint32_t nslots; /**< Slots of the name index (power of two, at most half full) */
+	uint32_t nvalues; /**< Number of offsets and masks of the value pool */
+	uint32_t strings_size; /**< Size of the string pool */
+	uint32_t operations; /**< Offset of the operations */
+	uint32_t accesses; /**< Offset of the accesses */
+	uint32_t slots; /**< Offset of the name index */
+	uint32_t values; /**< Offset of the value pool */
+	uint32_t strings; /**< Offset of the string pool (null terminated strings) */
+	uint32_t reserved; /**< Zero */
+} cfg_cache_header_caloe;
+
+/**
+* @brief Access of a compiled configuration file
+*/
+
+typedef struct cfg_cache_access_caloe {
+	uint64_t address_init; /**< Initial address */
+	uint64_t address; /**< Address */
+	uint64_t offset; /**< Offset */
+	uint64_t value; /**< Value */
+	uint64_t mask; /**< Mask */
+	int32_t autoincr; /**< Address increment of a block */
+	int32_t block; /**< Number of words of a block */
+	uint32_t ip; /**< IP netaddress (offset in the string pool) */
+	uint32_t port; /**< Port */
+	uint32_t offsets; /**< First offset parameter (index in the value pool) */
+	uint32_t noffsets; /**< Number of offset parameters */
+	uint32_t masks; /**< First mask parameter (index in the value pool) */
+	uint32_t nmasks; /**< Number of mask parameters */
+	uint8_t mode; /**< access_type_caloe */
+	uint8_t align; /**< align_access_caloe */
+	uint8_t mask_oper; /**< mask_oper_caloe */
+	uint8_t parameters; /**< Needed parameters (PARAM_* macros) */
+	uint8_t flags; /**< CFG_ACCESS_* flags */
+	uint8_t reserved[3]; /**< Zero */
+} cfg_cache_access_caloe;
+
+/**
+* @brief Operation of a compiled configuration file
+*/
+
+typedef struct cfg_cache_operation_caloe {
+	uint32_t name; /**< Name (offset in the string pool) */
+	uint32_t doc; /**< Docstring (offset in the string pool) */
+	uint32_t hash; /**< Hash of the name (see hash_cfg_name_caloe) */
+	uint32_t first; /**< First access (index in the accesses) */
+	uint32_t naccesses; /**< Number of accesses */
+} cfg_cache_operation_caloe;
+
+/**
+* @brief Compiled configuration file mapped in memory. Sections point into the mapping.
+*/
+
+typedef struct cfg_cache_caloe {
+	void * base; /**< Start of the mapping (NULL: not mapped) */
+	size_t size; /**< Size of the mapping */
+	const cfg_cache_header_caloe * header; /**< Header */
+	const cfg_cache_operation_caloe * operations; /**< Operations */
+	const cfg_cache_access_caloe * accesses; /**< Accesses */
+	const int32_t * slots; /**< Name index (operation index or -1) */
+	const int32_t * values; /**< Offsets and masks of the accesses */
+	const char * strings; /**< String pool */
+} cfg_cache_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Hash of an operation name (FNV-1a, the same one used by the name index of the library)
+*
+* @param name Operation name
+*
+* @return Hash
+*
+**/
+
+uint32_t hash_cfg_name_caloe(const char * name);
+
+/**
+*
+* Hash the contents of a configuration file (FNV-1a 64 bits over words). The file is mapped, not copied.
+*
+* @param path Path of the file
+* @param hash Hash of the contents
+* @param size Size of the file
+*
+* @return ALL_OK or ERROR_PARSE_CONFIG_FILE if the file cannot be read
+*
+**/
+
+int hash_cfg_file_caloe(const char * path, uint64_t * hash, uint64_t * size);
+
+/**
+*
+* Map a compiled configuration file and check it (layout, bounds of every offset and index). The image
+* is used in place: nothing is allocated or copied.
+*
+* @param path Path of the compiled file
+* @param cache Mapped image
+*
+* @return ALL_OK or ERROR_PARSE_CONFIG_FILE if the file cannot be mapped or it is not valid
+*
+**/
+
+int map_cfg_cache_caloe(const char * path, cfg_cache_caloe * cache);
+
+/**
+*
+* Unmap a compiled configuration file
+*
+* @param cache Mapped image
+*
+**/
+
+void unmap_cfg_cache_caloe(cfg_cache_caloe * cache);
+
+/**
+*
+* Search an operation of a compiled configuration file
+*
+* @param cache Mapped image
+* @param name Operation name
+*
+* @return Operation index or -1 if it is not found
+*
+**/
+
+int find_cfg_operation_caloe(const cfg_cache_caloe * cache, const char * name);
+
+/**
+*
+* Write a compiled configuration file. The image is written to a temporary file that replaces the
+* old one at once (readers never see a partial file).
+*
+* @param path Path of the compiled file
+* @param image Image (see cfg_cache_header_caloe)
+* @param size Size of the image
+*
+* @return ALL_OK or ERROR_PARSE_CONFIG_FILE if the file cannot be written
+*
+**/
+
+int write_cfg_cache_caloe(const char * path, const void * image, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,194 @@
+/**
+ *******************************************************************************
+ * @file endpoint_internals.c
+ *  @brief Endpoint registry: every board address is parsed once and used through a small handle
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+
+#include "endpoint_internals.h"
+#include "access_internals.h"
+
+/// Endpoints of all accesses of the library
+static endpoint_registry_caloe registry = { PTHREAD_MUTEX_INITIALIZER, { NULL }, 0, { NULL } };
+
+static int invalid_endpoint_caloe(const char * netaddress) {
+	if(VERBOSE_CALOE)
+		fprintf(stderr, "ERROR: Invalid endpoint %s (<tcp|udp>/<ip>/<port>)\n", netaddress);
+
+	return ERROR_ENDPOINT;
+}
+
+int parse_endpoint_caloe(const char * netaddress, unsigned int port, endpoint_caloe * endpoint) {
+	const char * host;
+	const char * end;
+	char * last;
+	unsigned long value;
+	int len;
+
+	memset(endpoint, 0, sizeof(endpoint_caloe));
+
+	if (strncmp(netaddress, "udp/", 4) == 0)
+		endpoint->tcp = 0;
+	else if (strncmp(netaddress, "tcp/", 4) == 0)
+		endpoint->tcp = 1;
+	else
+		return invalid_endpoint_caloe(netaddress);
+
+	host = netaddress + 4;
+
+	// IP address or host name
+	for (end = host; *end != '\0' && *end != '/'; ++end) {
+		if (!isalnum((unsigned char) *end) && strchr(".-_:", *end) == NULL)
+			return invalid_endpoint_caloe(netaddress);
+	}
+
+	len = end - host;
+
+	// Room for the protocol and the port in the key
+	if (len == 0 || len >= ENDPOINT_HOST_LEN)
+		return invalid_endpoint_caloe(netaddress);
+
+	// The port of the address has priority
+	if (*end == '/') {
+		if (!isdigit((unsigned char) end[1]))
+			return invalid_endpoint_caloe(netaddress);
+
+		value = strtoul(end + 1, &last, 10);
+
+		if (*last != '\0' || value > 65535)
+			return invalid_endpoint_caloe(netaddress);
+
+		port = (unsigned int) value;
+	}
+
+	if (port == 0 || port > 65535)
+		return invalid_endpoint_caloe(netaddress);
+
+	memcpy(endpoint->host, host, len);
+	endpoint->host[len] = '\0';
+	endpoint->port = port;
+
+	snprintf(endpoint->netaddress, sizeof(endpoint->netaddress), "%s/%s", (endpoint->tcp ? "tcp" : "udp"), endpoint->host);
+	snprintf(endpoint->key, sizeof(endpoint->key), "%s/%u", endpoint->netaddress, port);
+
+	return ALL_OK;
+}
+
+static unsigned int alias_bucket_caloe(const char * netaddress, unsigned int port) {
+	unsigned int hash = 2166136261u;
+
+	while (*netaddress != '\0')
+		hash = (hash ^ (unsigned char) *netaddress++) * 16777619u;
+
+	return (hash ^ port) % ENDPOINT_BUCKETS;
+}
+
+// Lock of the registry must be held
+static int add_endpoint_caloe(endpoint_caloe * parsed) {
+	endpoint_caloe * entry;
+	int i;
+
+	// Same endpoint with another spelling
+	for (i = 0; i < registry.nentries; ++i) {
+		if (strcmp(registry.entries[i]->key, parsed->key) == 0)
+			return registry.entries[i]->id;
+	}
+
+	if (registry.nentries == MAX_ENDPOINTS) {
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Too many endpoints (%d)\n", MAX_ENDPOINTS);
+
+		return ERROR_ENDPOINT;
+	}
+
+	entry = malloc(sizeof(endpoint_caloe));
+	*entry = *parsed;
+	entry->id = registry.nentries + 1;
+
+	registry.entries[registry.nentries] = entry;
+	registry.nentries++;
+
+	return entry->id;
+}
+
+int register_endpoint_caloe(const char * netaddress, unsigned int port) {
+	endpoint_alias_caloe * alias;
+	endpoint_caloe parsed;
+	unsigned int bucket;
+	int id = ERROR_ENDPOINT;
+
+	if (netaddress == NULL || strlen(netaddress) >= ENDPOINT_KEY_LEN)
+		return ERROR_ENDPOINT;
+
+	bucket = alias_bucket_caloe(netaddress, port);
+
+	pthread_mutex_lock(&registry.lock);
+
+	for (alias = registry.buckets[bucket]; alias != NULL; alias = alias->next) {
+		if (alias->port == port && strcmp(alias->netaddress, netaddress) == 0) {
+			id = alias->id;
+			pthread_mutex_unlock(&registry.lock);
+
+			return id;
+		}
+	}
+
+	// First time this spelling is seen
+	if (parse_endpoint_caloe(netaddress, port, &parsed) == ALL_OK && (id = add_endpoint_caloe(&parsed)) > 0) {
+		alias = malloc(sizeof(endpoint_alias_caloe));
+		strcpy(alias->netaddress, netaddress);
+		alias->port = port;
+		alias->id = id;
+		alias->next = registry.buckets[bucket];
+		registry.buckets[bucket] = alias;
+	}
+
+	pthread_mutex_unlock(&registry.lock);
+
+	return id;
+}
+
+const endpoint_caloe * get_endpoint_caloe(int id) {
+	const endpoint_caloe * entry = NULL;
+
+	pthread_mutex_lock(&registry.lock);
+
+	// Entries are never released, so they can be used once the lock is released
+	if (id >= 1 && id <= registry.nentries)
+		entry = registry.entries[id - 1];
+
+	pthread_mutex_unlock(&registry.lock);
+
+	return entry;
+}
+
+int count_endpoints_caloe(void) {
+	int nentries;
+
+	pthread_mutex_lock(&registry.lock);
+	nentries = registry.nentries;
+	pthread_mutex_unlock(&registry.lock);
+
+	return nentries;
+}
@@ -0,0 +1,144 @@
+/**
+ *******************************************************************************
+ * @file endpoint_internals.h
+ *  @brief Endpoint registry: every board address is parsed once and used through a small handle
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+
+#ifndef ENDPOINT_INTERNALS_CALOE_H
+#define ENDPOINT_INTERNALS_CALOE_H
+
+#include <pthread.h>
+
+/// Default Etherbone port
+#define ENDPOINT_DEFAULT_PORT 60368
+
+/// Max length of an endpoint key (<tcp|udp>/<ip>/<port>)
+#define ENDPOINT_KEY_LEN 64
+
+/// Max length of the host of an endpoint (room for the protocol, the port and the end of the key)
+#define ENDPOINT_HOST_LEN (ENDPOINT_KEY_LEN - 11)
+
+/// Max number of different endpoints (handles are never released)
+#define MAX_ENDPOINTS 4096
+
+/// Number of buckets of the registry
+#define ENDPOINT_BUCKETS 256
+
+/**
+* @brief Board address parsed and validated once.
+*/
+
+typedef struct endpoint_caloe {
+	int id; /**< Endpoint handle (1..MAX_ENDPOINTS) */
+	int tcp; /**< Protocol (1: tcp, 0: udp) */
+	char host[ENDPOINT_HOST_LEN]; /**< IP address or host name */
+	unsigned int port; /**< Etherbone port */
+	char netaddress[ENDPOINT_HOST_LEN + 4]; /**< Address without port (<tcp|udp>/<ip>) */
+	char key[ENDPOINT_KEY_LEN]; /**< Etherbone address (<tcp|udp>/<ip>/<port>) */
+} endpoint_caloe;
+
+/**
+* @brief One spelling (netaddress and port given by the user) of a registered endpoint.
+*/
+
+typedef struct endpoint_alias_caloe {
+	char netaddress[ENDPOINT_KEY_LEN]; /**< Address as given by the user */
+	unsigned int port; /**< Port as given by the user */
+	int id; /**< Handle of the endpoint */
+	struct endpoint_alias_caloe * next; /**< Next alias of the bucket */
+} endpoint_alias_caloe;
+
+/**
+* @brief Registered endpoints and their spellings. Entries are never released, so a handle is valid
+* until the program ends.
+*/
+
+typedef struct endpoint_registry_caloe {
+	pthread_mutex_t lock; /**< It protects registration and aliases */
+	endpoint_caloe * entries[MAX_ENDPOINTS]; /**< Endpoints by handle (entry i has handle i+1) */
+	int nentries; /**< Number of registered endpoints */
+	endpoint_alias_caloe * buckets[ENDPOINT_BUCKETS]; /**< Aliases by netaddress and port */
+} endpoint_registry_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Parse and validate an endpoint address
+*
+* @param netaddress Address (<tcp|udp>/<ip> or <tcp|udp>/<ip>/<port>)
+* @param port Port (it is used if netaddress has not any port)
+* @param endpoint Parsed endpoint (its handle is not set)
+*
+* @return ALL_OK if the address is valid or ERROR_ENDPOINT otherwise
+*
+**/
+
+int parse_endpoint_caloe(const char * netaddress, unsigned int port, endpoint_caloe * endpoint);
+
+/**
+*
+* Get the handle of an endpoint. The address is parsed and registered the first time it is seen, later
+* calls with the same address only look up the registry (no formatting and no memory allocation).
+* Different spellings of the same endpoint (e.g. udp/<ip> and udp/<ip>/60368) get the same handle.
+*
+* @param netaddress Address (<tcp|udp>/<ip> or <tcp|udp>/<ip>/<port>)
+* @param port Port (it is used if netaddress has not any port)
+*
+* @return Endpoint handle (> 0) or ERROR_ENDPOINT if the address is not valid or the registry is full
+*
+**/
+
+int register_endpoint_caloe(const char * netaddress, unsigned int port);
+
+/**
+*
+* Get a registered endpoint
+*
+* @param id Endpoint handle
+*
+* @return Endpoint or NULL if the handle is not valid
+*
+**/
+
+const endpoint_caloe * get_endpoint_caloe(int id);
+
+/**
+*
+* Get the number of registered endpoints
+*
+* @return Number of endpoints (handles go from 1 to this number)
+*
+**/
+
+int count_endpoints_caloe(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,234 @@
+/**
+ *******************************************************************************
+ * @file sdb_internals.c
+ *  @brief Implements the SDB cache (interval index of device records)
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "sdb_internals.h"
+
+/**
+* @brief State of one bus while the cache is being filled.
+*/
+
+struct sdb_fill_record {
+	sdb_cache_caloe * cache; /**< Cache to fill */
+	int stop; /**< It indicates if the bus has been scanned */
+	eb_status_t status; /**< Scan result */
+};
+
+static void add_sdb_entry_caloe(sdb_cache_caloe * cache, const struct sdb_device * device) {
+	if(cache->nentries == cache->capacity) {
+		cache->capacity = (cache->capacity == 0 ? 16 : cache->capacity*2);
+		cache->entries = realloc(cache->entries,sizeof(sdb_entry_caloe)*cache->capacity);
+	}
+
+	cache->entries[cache->nentries].addr_first = device->sdb_component.addr_first;
+	cache->entries[cache->nentries].addr_last = device->sdb_component.addr_last;
+	cache->entries[cache->nentries].bus_specific = device->bus_specific;
+	cache->nentries++;
+}
+
+// The code of this function is based on eb-ls tool code
+// Please, see http://www.ohwr.org/projects/etherbone-core if you want to get more information
+
+static void fill_callback_caloe(eb_user_data_t user, eb_device_t dev, const struct sdb_table* sdb, eb_status_t status) {
+	struct sdb_fill_record * fr = (struct sdb_fill_record *) user;
+	struct sdb_fill_record child;
+	const union sdb_record* des;
+	int devices;
+	int i;
+	int timeout;
+
+	fr->stop = 1;
+	fr->status = status;
+
+	if (status != EB_OK)
+		return;
+
+	devices = sdb->interconnect.sdb_records - 1;
+
+	for (i = 0; i < devices; ++i) {
+		des = &sdb->record[i];
+
+		switch (des->empty.record_type) {
+			case sdb_record_device:
+				add_sdb_entry_caloe(fr->cache,&des->device);
+			break;
+
+			case sdb_record_bridge:
+				// Scan the child bus and wait for it
+				child.cache = fr->cache;
+				child.stop = 0;
+				child.status = EB_OK;
+
+				if (eb_sdb_scan_bus(dev, &des->bridge, &child, &fill_callback_caloe) != EB_OK)
+					break;
+
+				timeout = TIMEOUT_LIMIT;
+
+				while (timeout > 0) {
+					int telapsed = eb_socket_run(eb_device_socket(dev),timeout);
+
+					if(child.stop)
+						break;
+
+					timeout -= telapsed;
+				}
+
+				if(!child.stop || child.status != EB_OK)
+					fr->status = (child.stop ? child.status : EB_TIMEOUT);
+			break;
+
+			default:
+			break;
+		}
+	}
+}
+
+static int compare_sdb_entry_caloe(const void * a, const void * b) {
+	const sdb_entry_caloe * ea = (const sdb_entry_caloe *) a;
+	const sdb_entry_caloe * eb = (const sdb_entry_caloe *) b;
+
+	if(ea->addr_first < eb->addr_first)
+		return -1;
+
+	if(ea->addr_first > eb->addr_first)
+		return 1;
+
+	return 0;
+}
+
+int fill_sdb_cache_caloe(eb_device_t device, sdb_cache_caloe * cache) {
+	struct sdb_fill_record fr;
+	eb_status_t status;
+	int timeout;
+
+	invalidate_sdb_cache_caloe(cache);
+
+	fr.cache = cache;
+	fr.stop = 0;
+	fr.status = EB_OK;
+
+	if ((status = eb_sdb_scan_root(device, &fr, &fill_callback_caloe)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Failed to scan remote device: %s\n", eb_status(status));
+
+		return ERROR_SDB_SCAN;
+	}
+
+	timeout = TIMEOUT_LIMIT;
+
+	while (timeout > 0) {
+		int telapsed = eb_socket_run(eb_device_socket(device),timeout);
+
+		if(fr.stop)
+			break;
+
+		timeout -= telapsed;
+	}
+
+	if(!fr.stop) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Timeout expired! \n");
+
+		invalidate_sdb_cache_caloe(cache);
+
+		return ERROR_TIMEOUT;
+	}
+
+	if(fr.status != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: failed to retrieve SDB: %s\n", eb_status(fr.status));
+
+		invalidate_sdb_cache_caloe(cache);
+
+		return ERROR_SDB_SCAN;
+	}
+
+	// Sort records so lookups can use a binary search
+	qsort(cache->entries,cache->nentries,sizeof(sdb_entry_caloe),&compare_sdb_entry_caloe);
+	cache->valid = 1;
+
+	return ALL_OK;
+}
+
+int lookup_sdb_cache_caloe(eb_device_t device, sdb_cache_caloe * cache, eb_address_t address, uint32_t * bus_specific) {
+	struct sdb_device info;
+	eb_status_t status;
+	int low, high, mid;
+
+	if(!cache->valid)
+		fill_sdb_cache_caloe(device,cache);
+
+	if(cache->valid) {
+		// Last record whose first address is not greater than address
+		low = 0;
+		high = cache->nentries - 1;
+
+		while(low <= high) {
+			mid = (low + high) / 2;
+
+			if(cache->entries[mid].addr_first <= address)
+				low = mid + 1;
+			else
+				high = mid - 1;
+		}
+
+		if(high >= 0 && address <= cache->entries[high].addr_last) {
+			*bus_specific = cache->entries[high].bus_specific;
+			return ALL_OK;
+		}
+	}
+
+	// Address is not in the cache (or it could not be filled), ask the device
+	if ((status = eb_sdb_find_by_address(device, address, &info)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR %d: SDB scan failed! \n",(int) status);
+
+		return ERROR_SDB_SCAN;
+	}
+
+	*bus_specific = info.bus_specific;
+
+	return ALL_OK;
+}
+
+void invalidate_sdb_cache_caloe(sdb_cache_caloe * cache) {
+	cache->nentries = 0;
+	cache->valid = 0;
+}
+
+void free_sdb_cache_caloe(sdb_cache_caloe * cache) {
+	if(cache->entries != NULL)
+		free(cache->entries);
+
+	cache->entries = NULL;
+	cache->nentries = 0;
+	cache->capacity = 0;
+	cache->valid = 0;
+}
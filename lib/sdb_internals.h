@@ -0,0 +1,111 @@
+/**
+ *******************************************************************************
+ * @file sdb_internals.h
+ *  @brief SDB cache: answers address to (endian, width) queries locally
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef SDB_INTERNALS_CALOE_H
+#define SDB_INTERNALS_CALOE_H
+
+#include "access_internals.h"
+
+/**
+* @brief Address range of one SDB device record.
+*/
+
+typedef struct sdb_entry_caloe {
+	eb_address_t addr_first; /**< First address of the device */
+	eb_address_t addr_last; /**< Last address of the device */
+	uint32_t bus_specific; /**< Wishbone endian and width flags */
+} sdb_entry_caloe;
+
+/**
+* @brief Device records of one endpoint, sorted by address (interval index).
+*/
+
+typedef struct sdb_cache_caloe {
+	sdb_entry_caloe * entries; /**< Device records sorted by addr_first */
+	int nentries; /**< Number of records */
+	int capacity; /**< Allocated records */
+	int valid; /**< It indicates if the cache has been filled (1) or not (0) */
+} sdb_cache_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Fills the cache with a full SDB scan of the device
+*
+* @param device Open Etherbone device
+* @param cache Cache to fill
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int fill_sdb_cache_caloe(eb_device_t device, sdb_cache_caloe * cache);
+
+/**
+*
+* Gets Wishbone flags (endian and width) of the device that contains an address. The cache is filled
+* with a scan the first time. If the address is not in the cache, the remote SDB is probed.
+*
+* @param device Open Etherbone device
+* @param cache Cache of the device
+* @param address Memory address
+* @param bus_specific Returned Wishbone flags
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int lookup_sdb_cache_caloe(eb_device_t device, sdb_cache_caloe * cache, eb_address_t address, uint32_t * bus_specific);
+
+/**
+*
+* Drops all records of the cache (next lookup scans again)
+*
+* @param cache Cache to invalidate
+*
+**/
+
+void invalidate_sdb_cache_caloe(sdb_cache_caloe * cache);
+
+/**
+*
+* Cache destructor
+*
+* @param cache Cache to destroy
+*
+**/
+
+void free_sdb_cache_caloe(sdb_cache_caloe * cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
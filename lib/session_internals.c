@@ -0,0 +1,319 @@
+/**
+ *******************************************************************************
+ * @file session_internals.c
+ *  @brief Implements the session pool (open Etherbone sockets/devices)
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include <time.h>
+
+#include "session_internals.h"
+
+/// Pool shared by all accesses of the library
+static session_pool_caloe default_pool = { PTHREAD_MUTEX_INITIALIZER, NULL, SESSION_IDLE_LIMIT, 0, EB_NULL, 0 };
+
+session_pool_caloe * default_session_pool_caloe(void) {
+	return &default_pool;
+}
+
+long long now_us_caloe(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((long long) ts.tv_sec)*1000000 + ts.tv_nsec/1000;
+}
+
+int init_shared_session_pool_caloe(session_pool_caloe * pool) {
+	memset(pool,0,sizeof(session_pool_caloe));
+	pthread_mutex_init(&pool->lock,NULL);
+
+	pool->idle_limit = -1;
+	pool->shared_socket = 1;
+
+	return ALL_OK;
+}
+
+static int open_socket_caloe(eb_socket_t * socket) {
+	eb_status_t status;
+
+	if ((status = eb_socket_open(EB_ABI_CODE, 0, EB_ADDRX|EB_DATAX, socket)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR %d: Could not connect Etherbone socket \n",(int) status);
+
+		return ERROR_OPEN_SOCKET;
+	}
+
+	return ALL_OK;
+}
+
+static int open_session_caloe(session_pool_caloe * pool, session_caloe * session) {
+	eb_status_t status;
+	int rcode;
+
+	if(pool->shared_socket) {
+		// All sessions of the pool use one socket (opened with the first session)
+		if(!pool->socket_open) {
+			if((rcode = open_socket_caloe(&pool->socket)) != ALL_OK)
+				return rcode;
+
+			pool->socket_open = 1;
+		}
+
+		session->socket = pool->socket;
+	}
+	else {
+		if((rcode = open_socket_caloe(&session->socket)) != ALL_OK)
+			return rcode;
+	}
+
+	if ((status = eb_device_open(session->socket, session->key, EB_ADDRX|EB_DATAX, SESSION_OPEN_ATTEMPTS, &session->device)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR %d: Could not connect Etherbone device \n", (int) status);
+
+		if(!pool->shared_socket)
+			eb_socket_close(session->socket);
+
+		return ERROR_OPEN_DEVICE;
+	}
+
+	session->line_width = eb_device_width(session->device);
+
+	return ALL_OK;
+}
+
+static int close_session_caloe(session_pool_caloe * pool, session_caloe * session) {
+	eb_status_t status;
+	int rcode = ALL_OK;
+
+	if ((status = eb_device_close(session->device)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR %d: failed to close Etherbone device \n", (int) status);
+
+		rcode = ERROR_CLOSE_DEVICE;
+	}
+
+	if (!pool->shared_socket && (status = eb_socket_close(session->socket)) != EB_OK) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR %d: failed to close Etherbone socket \n", (int) status);
+
+		rcode = ERROR_CLOSE_SOCKET;
+	}
+
+	free_sdb_cache_caloe(&session->sdb);
+	free(session);
+
+	return rcode;
+}
+
+int acquire_session_caloe(session_pool_caloe * pool, network_connection * nc, session_caloe ** session) {
+	const endpoint_caloe * endpoint = get_endpoint_caloe(nc->endpoint);
+	session_caloe * s;
+	int rcode;
+
+	if(endpoint == NULL)
+		return ERROR_ENDPOINT;
+
+	// Close sessions which have not been used for a long time
+	evict_idle_sessions_caloe(pool);
+
+	pthread_mutex_lock(&pool->lock);
+
+	// Look for an idle session with the same endpoint (any session of the endpoint if the socket is shared)
+	for(s = pool->sessions ; s != NULL ; s = s->next) {
+		if((!s->in_use || pool->shared_socket) && s->endpoint == endpoint->id) {
+			s->in_use++;
+
+			if(s->sdb_stale) {
+				invalidate_sdb_cache_caloe(&s->sdb);
+				s->sdb_stale = 0;
+			}
+
+			pthread_mutex_unlock(&pool->lock);
+
+			*session = s;
+			return ALL_OK;
+		}
+	}
+
+	// There is not any session for this endpoint, open a new one
+	s = malloc(sizeof(session_caloe));
+	memset(s,0,sizeof(session_caloe));
+	s->endpoint = endpoint->id;
+	strcpy(s->key,endpoint->key);
+
+	// The lock is held while connecting so the shared socket is opened only once
+	if((rcode = open_session_caloe(pool,s)) != ALL_OK) {
+		pthread_mutex_unlock(&pool->lock);
+		free(s);
+		return rcode;
+	}
+
+	s->in_use++;
+	s->next = pool->sessions;
+	pool->sessions = s;
+
+	pthread_mutex_unlock(&pool->lock);
+
+	*session = s;
+
+	return ALL_OK;
+}
+
+static void unlink_session_caloe(session_pool_caloe * pool, session_caloe * session) {
+	session_caloe ** it;
+
+	for(it = &pool->sessions ; *it != NULL ; it = &((*it)->next)) {
+		if(*it == session) {
+			*it = session->next;
+			break;
+		}
+	}
+
+	session->unlinked = 1;
+}
+
+void release_session_caloe(session_pool_caloe * pool, session_caloe * session, int rcode) {
+	int close_it;
+
+	pthread_mutex_lock(&pool->lock);
+
+	session->in_use--;
+	session->last_used = now_us_caloe();
+
+	// A failed access may leave the device in an unknown state, reconnect next time
+	if(rcode != ALL_OK && rcode != INVALID_OPERATION && !session->unlinked)
+		unlink_session_caloe(pool,session);
+
+	// Sessions out of the pool are closed when their last user releases them
+	close_it = (session->unlinked && session->in_use == 0);
+
+	pthread_mutex_unlock(&pool->lock);
+
+	if(close_it)
+		close_session_caloe(pool,session);
+}
+
+int same_endpoint_caloe(network_connection * a, network_connection * b) {
+	return a->endpoint == b->endpoint;
+}
+
+void evict_idle_sessions_caloe(session_pool_caloe * pool) {
+	session_caloe ** it;
+	session_caloe * s;
+	long long now;
+
+	session_caloe * idle = NULL;
+
+	if(pool->idle_limit < 0)
+		return;
+
+	now = now_us_caloe();
+
+	pthread_mutex_lock(&pool->lock);
+
+	it = &pool->sessions;
+
+	while(*it != NULL) {
+		s = *it;
+
+		if(!s->in_use && now - s->last_used > pool->idle_limit) {
+			*it = s->next;
+			s->next = idle;
+			idle = s;
+		}
+		else {
+			it = &(s->next);
+		}
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	// Sessions are closed out of the lock (nobody else can reach them)
+	while(idle != NULL) {
+		s = idle;
+		idle = s->next;
+		close_session_caloe(pool,s);
+	}
+}
+
+void invalidate_sdb_caches_caloe(session_pool_caloe * pool) {
+	session_caloe * s;
+
+	pthread_mutex_lock(&pool->lock);
+
+	// Sessions in use are dropped on their next checkout
+	for(s = pool->sessions ; s != NULL ; s = s->next) {
+		if(s->in_use)
+			s->sdb_stale = 1;
+		else
+			invalidate_sdb_cache_caloe(&s->sdb);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+int close_session_pool_caloe(session_pool_caloe * pool) {
+	session_caloe * s;
+	int rcode = ALL_OK;
+	int rcode_s;
+	int busy = 0;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while(pool->sessions != NULL) {
+		s = pool->sessions;
+		pool->sessions = s->next;
+
+		// Sessions checked out by other users are closed when their last user releases them
+		if(s->in_use) {
+			s->unlinked = 1;
+			busy = 1;
+			continue;
+		}
+
+		if((rcode_s = close_session_caloe(pool,s)) != ALL_OK)
+			rcode = rcode_s;
+	}
+
+	// The shared socket is kept while a session still uses it
+	if(pool->socket_open && !busy) {
+		if(eb_socket_close(pool->socket) != EB_OK) {
+
+			if(VERBOSE_CALOE)
+				fprintf(stderr, "ERROR: failed to close Etherbone socket \n");
+
+			rcode = ERROR_CLOSE_SOCKET;
+		}
+
+		pool->socket_open = 0;
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return rcode;
+}
@@ -0,0 +1,192 @@
+/**
+ *******************************************************************************
+ * @file session_internals.h
+ *  @brief Session pool: keeps Etherbone sockets/devices open between accesses
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef SESSION_INTERNALS_CALOE_H
+#define SESSION_INTERNALS_CALOE_H
+
+#include <pthread.h>
+
+#include "access_internals.h"
+#include "sdb_internals.h"
+
+/// Max length of a session key (<tcp|udp>/<ip>/<port>)
+#define SESSION_KEY_LEN ENDPOINT_KEY_LEN
+
+/// Time (us) a session can stay unused before it is closed (-1: NOT LIMITED)
+#define SESSION_IDLE_LIMIT 10000000
+
+/// Number of attempts to connect with an Etherbone device
+#define SESSION_OPEN_ATTEMPTS 3
+
+/**
+* @brief Open Etherbone connection with one endpoint (netaddress/port).
+*/
+
+typedef struct session_caloe {
+	int endpoint; /**< Endpoint handle (sessions are looked up by it) */
+	char key[SESSION_KEY_LEN]; /**< Endpoint key (<tcp|udp>/<ip>/<port>) */
+	eb_socket_t socket; /**< Etherbone socket */
+	eb_device_t device; /**< Etherbone device */
+	eb_width_t line_width; /**< Negotiated device width */
+	int in_use; /**< Number of users that have checked out the session (0: idle) */
+	int unlinked; /**< It indicates if the session has been dropped from the pool (1) or not (0) */
+	long long last_used; /**< Timestamp (us) of last release */
+	sdb_cache_caloe sdb; /**< SDB records of the endpoint (dropped on reconnect) */
+	int sdb_stale; /**< It indicates if the SDB cache must be dropped on next checkout (1) or not (0) */
+	struct session_caloe * next; /**< Next session in the pool */
+} session_caloe;
+
+/**
+* @brief List of open sessions. The list is protected by a mutex; a checked out session of a
+* pool without shared socket belongs to one thread until it is released.
+*/
+
+typedef struct session_pool_caloe {
+	pthread_mutex_t lock; /**< It protects the session list and the shared socket */
+	session_caloe * sessions; /**< Open sessions */
+	long idle_limit; /**< Time (us) before an idle session is closed (-1: NOT LIMITED) */
+	int shared_socket; /**< It indicates if all sessions share one socket (1) or each one opens its own (0) */
+	eb_socket_t socket; /**< Shared socket (only if shared_socket is set) */
+	int socket_open; /**< It indicates if the shared socket has been opened (1) or not (0) */
+} session_pool_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Gets the session pool used by read_caloe, write_caloe and scan_caloe
+*
+* @return Default session pool
+*
+**/
+
+session_pool_caloe * default_session_pool_caloe(void);
+
+/**
+*
+* Initializes an empty pool whose sessions share one Etherbone socket. A session of a
+* shared pool can be checked out by several users at once (one event loop drives the socket).
+*
+* @param pool Session pool to initialize
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int init_shared_session_pool_caloe(session_pool_caloe * pool);
+
+/**
+*
+* Gets a timestamp in microseconds (monotonic clock)
+*
+* @return Current timestamp (us)
+*
+**/
+
+long long now_us_caloe(void);
+
+/**
+*
+* Checks out an open session for one endpoint. If there is no open session for it,
+* a new device (and socket, if it is not shared) is opened.
+*
+* @param pool Session pool
+* @param nc Network connection of the endpoint
+* @param session Returned session
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int acquire_session_caloe(session_pool_caloe * pool, network_connection * nc, session_caloe ** session);
+
+/**
+*
+* Gives back a session to the pool. If the access failed, the session is closed so the next access reconnects.
+*
+* @param pool Session pool
+* @param session Session to release
+* @param rcode Result of the access performed with the session
+*
+**/
+
+void release_session_caloe(session_pool_caloe * pool, session_caloe * session, int rcode);
+
+/**
+*
+* Checks if two network connections refer to the same endpoint
+*
+* @param a Network connection
+* @param b Network connection
+*
+* @return 1 if they are the same endpoint or zero otherwise
+*
+**/
+
+int same_endpoint_caloe(network_connection * a, network_connection * b);
+
+/**
+*
+* Closes all idle sessions not used for longer than the pool idle limit
+*
+* @param pool Session pool
+*
+**/
+
+void evict_idle_sessions_caloe(session_pool_caloe * pool);
+
+/**
+*
+* Drops the SDB cache of every session in the pool (the next access scans the device again)
+*
+* @param pool Session pool
+*
+**/
+
+void invalidate_sdb_caches_caloe(session_pool_caloe * pool);
+
+/**
+*
+* Closes all sessions of the pool (and the shared socket). Sessions checked out by other users are
+* dropped from the pool and closed when they are released; the shared socket is then kept open until
+* the pool is closed again.
+*
+* @param pool Session pool
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int close_session_pool_caloe(session_pool_caloe * pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
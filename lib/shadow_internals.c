@@ -0,0 +1,402 @@
+/**
+ *******************************************************************************
+ * @file shadow_internals.c
+ *  @brief Shadow cache: last written/read value of cacheable registers of each endpoint
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+
+#include "shadow_internals.h"
+#include "wire_internals.h"
+
+/// Shadow cache shared by all accesses of the library
+static shadow_cache_caloe default_cache = { PTHREAD_MUTEX_INITIALIZER, COALESCE_WINDOW, { NULL }, 0, { 0, 0, 0, 0 } };
+
+shadow_cache_caloe * default_shadow_cache_caloe(void) {
+	return &default_cache;
+}
+
+void init_shadow_cache_caloe(shadow_cache_caloe * cache) {
+	memset(cache, 0, sizeof(shadow_cache_caloe));
+	pthread_mutex_init(&cache->lock, NULL);
+
+	cache->window = COALESCE_WINDOW;
+}
+
+static unsigned int shadow_bucket_caloe(int endpoint, eb_address_t address) {
+	unsigned int hash = (2166136261u ^ (unsigned int) endpoint) * 16777619u;
+
+	return (hash ^ (unsigned int) (address >> 2)) % SHADOW_BUCKETS;
+}
+
+static eb_data_t width_mask_caloe(align_access_caloe align) {
+	return (~(eb_data_t)0) >> (sizeof(eb_data_t)-align_bytes_caloe(align))*8;
+}
+
+// Lock of the cache must be held
+static shadow_entry_caloe * find_shadow_caloe(shadow_cache_caloe * cache, int endpoint, eb_address_t address, align_access_caloe align) {
+	shadow_entry_caloe * entry;
+
+	for (entry = cache->buckets[shadow_bucket_caloe(endpoint, address)]; entry != NULL; entry = entry->next) {
+		if (entry->address == address && entry->align == align && entry->endpoint == endpoint)
+			return entry;
+	}
+
+	return NULL;
+}
+
+// Lock of the cache must be held
+static void store_shadow_caloe(shadow_cache_caloe * cache, int endpoint, eb_address_t address, align_access_caloe align, eb_data_t value, int known) {
+	shadow_entry_caloe * entry;
+	unsigned int bucket;
+
+	if ((entry = find_shadow_caloe(cache, endpoint, address, align)) == NULL) {
+		bucket = shadow_bucket_caloe(endpoint, address);
+
+		entry = malloc(sizeof(shadow_entry_caloe));
+		entry->endpoint = endpoint;
+		entry->address = address;
+		entry->align = align;
+		entry->next = cache->buckets[bucket];
+		cache->buckets[bucket] = entry;
+
+		__sync_fetch_and_add(&cache->entries, 1);
+	}
+
+	entry->value = value & width_mask_caloe(align);
+	entry->known = known;
+	entry->stamp = now_us_caloe();
+}
+
+// Lock of the cache must be held
+static void drop_shadow_caloe(shadow_cache_caloe * cache, int endpoint, eb_address_t address) {
+	shadow_entry_caloe ** link = &cache->buckets[shadow_bucket_caloe(endpoint, address)];
+	shadow_entry_caloe * entry;
+
+	while ((entry = *link) != NULL) {
+		if (entry->address == address && entry->endpoint == endpoint) {
+			*link = entry->next;
+			free(entry);
+
+			__sync_fetch_and_sub(&cache->entries, 1);
+		}
+		else {
+			link = &entry->next;
+		}
+	}
+}
+
+static int is_cacheable_caloe(access_caloe * access) {
+	return access->cacheable && !access->is_config && access->mode != SCAN;
+}
+
+// Writes change the register whatever the access says about it (config space is never cached)
+static int is_write_caloe(access_caloe * access) {
+	return (access->mode == WRITE || access->mode == READ_WRITE) && !access->is_config;
+}
+
+static int has_entries_caloe(shadow_cache_caloe * cache) {
+	return __sync_fetch_and_add(&cache->entries, 0) > 0;
+}
+
+static int is_coalescable_caloe(access_caloe * access) {
+	return access->mode == READ && !access->is_config && !access->side_effects;
+}
+
+// A read returns the whole register if its mask does not change any bit
+static int is_raw_read_caloe(access_caloe * access) {
+	eb_data_t width = width_mask_caloe(access->align);
+
+	if (access->mask_oper == MASK_OR)
+		return (access->mask & width) == 0;
+
+	return (access->mask & width) == width;
+}
+
+static int same_register_caloe(access_caloe * a, access_caloe * b) {
+	return a->address + a->offset == b->address + b->offset && a->align == b->align &&
+		a->is_config == b->is_config && same_endpoint_caloe(&a->networkc, &b->networkc);
+}
+
+int use_shadow_caloe(shadow_cache_caloe * cache, access_caloe * accesses, int naccess) {
+	int reads = 0;
+	int i;
+
+	for (i = 0; i < naccess; ++i) {
+		if (accesses[i].cacheable)
+			return 1;
+
+		// Writes drop the shadow and the recent reads of their register
+		if (is_write_caloe(&accesses[i]) && (cache->window > 0 || has_entries_caloe(cache)))
+			return 1;
+
+		if (is_coalescable_caloe(&accesses[i]))
+			reads++;
+	}
+
+	return (reads > 1 || (reads > 0 && cache->window > 0));
+}
+
+/// How an access of a batch is executed by execute_shadow_caloe
+enum { SHADOW_SERVED, SHADOW_SENT, SHADOW_RAW, SHADOW_ALIAS, SHADOW_CONVERTED };
+
+int execute_shadow_caloe(shadow_cache_caloe * cache, transport_caloe * transport, access_caloe * accesses, int naccess, int * ndone) {
+	access_caloe * sent = malloc(sizeof(access_caloe)*naccess);
+	int * slot = malloc(sizeof(int)*naccess);
+	char * state = malloc(naccess);
+	shadow_entry_caloe * entry;
+	long long now = now_us_caloe();
+	eb_data_t value;
+	int nsent = 0;
+	int done = 0;
+	int rcode;
+	int i, j;
+
+	pthread_mutex_lock(&cache->lock);
+
+	for (i = 0; i < naccess; ++i) {
+		access_caloe * access = &accesses[i];
+
+		entry = NULL;
+
+		if (is_cacheable_caloe(access) || (is_coalescable_caloe(access) && cache->window > 0)) {
+			entry = find_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset, access->align);
+		}
+
+		// Recent read of the register (coalescing window)
+		if (entry != NULL && !entry->known && is_coalescable_caloe(access) && now - entry->stamp <= cache->window) {
+			access->value = apply_mask_caloe(access, entry->value);
+			cache->stats.coalesced++;
+			state[i] = SHADOW_SERVED;
+			continue;
+		}
+
+		if (!is_cacheable_caloe(access) || entry == NULL || !entry->known) {
+			if (is_cacheable_caloe(access) && access->mode != WRITE)
+				cache->stats.misses++;
+
+			entry = NULL;
+		}
+
+		// Known register: reads are served by the shadow
+		if (entry != NULL && access->mode == READ) {
+			access->value = apply_mask_caloe(access, entry->value);
+			cache->stats.hits++;
+			state[i] = SHADOW_SERVED;
+			continue;
+		}
+
+		if (entry != NULL) {
+			// Value of the register after the write (a read-modify-write reads the shadow)
+			if (access->mode == READ_WRITE) {
+				value = apply_mask_caloe(access, entry->value);
+				access->value = value;
+				cache->stats.hits++;
+			}
+			else {
+				value = apply_mask_caloe(access, access->value);
+			}
+
+			value &= width_mask_caloe(access->align);
+
+			if (value == entry->value) {
+				cache->stats.suppressed++;
+				state[i] = SHADOW_SERVED;
+				continue;
+			}
+
+			entry->value = value;
+
+			sent[nsent] = *access;
+			sent[nsent].mode = WRITE;
+			sent[nsent].value = value;
+			sent[nsent].mask = 0x00;
+			sent[nsent].mask_oper = MASK_OR;
+			state[i] = SHADOW_CONVERTED;
+			slot[i] = nsent++;
+			continue;
+		}
+
+		if (!is_coalescable_caloe(access)) {
+			sent[nsent] = *access;
+			state[i] = SHADOW_SENT;
+			slot[i] = nsent++;
+			continue;
+		}
+
+		// Previous read of the register in the batch (a write of it in between stops the search)
+		for (j = nsent-1; j >= 0 && j >= nsent-COALESCE_LOOKBACK; --j) {
+			if (same_register_caloe(&sent[j], access))
+				break;
+		}
+
+		if (j >= 0 && j >= nsent-COALESCE_LOOKBACK && sent[j].mode == READ && !sent[j].side_effects) {
+			cache->stats.coalesced++;
+			state[i] = SHADOW_ALIAS;
+			slot[i] = j;
+			continue;
+		}
+
+		// The whole register is read, the mask is applied later
+		sent[nsent] = *access;
+		sent[nsent].mask = 0x00;
+		sent[nsent].mask_oper = MASK_OR;
+		state[i] = SHADOW_RAW;
+		slot[i] = nsent++;
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+
+	rcode = (nsent > 0 ? execute_transport_batch_caloe(transport, sent, nsent, &done) : ALL_OK);
+
+	now = now_us_caloe();
+
+	pthread_mutex_lock(&cache->lock);
+
+	for (i = 0; i < naccess; ++i) {
+		access_caloe * access = &accesses[i];
+
+		if (state[i] == SHADOW_SERVED)
+			continue;
+
+		j = slot[i];
+
+		if (state[i] == SHADOW_ALIAS) {
+			if (j < done)
+				access->value = apply_mask_caloe(access, sent[j].value);
+
+			continue;
+		}
+
+		// Nothing to keep for volatile registers without coalescing window, but a write makes the shadow of its register stale
+		if (!is_cacheable_caloe(access) && cache->window == 0) {
+			if (j < done)
+				access->value = (state[i] == SHADOW_RAW ? apply_mask_caloe(access, sent[j].value) : sent[j].value);
+
+			if (is_write_caloe(access))
+				drop_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset);
+
+			continue;
+		}
+
+		// The register is unknown after a failed access
+		if (j >= done) {
+			drop_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset);
+			continue;
+		}
+
+		switch (state[i]) {
+			case SHADOW_RAW:
+				access->value = apply_mask_caloe(access, sent[j].value);
+
+				if (is_cacheable_caloe(access) || cache->window > 0)
+					store_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset, access->align, sent[j].value, is_cacheable_caloe(access));
+			break;
+
+			case SHADOW_CONVERTED:
+				store_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset, access->align, sent[j].value, 1);
+			break;
+
+			default:
+				access->value = sent[j].value;
+
+				if (!is_cacheable_caloe(access)) {
+					// Recent reads of a volatile register are stale after a write
+					if (access->mode != READ)
+						drop_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset);
+				}
+				else if (access->mode == READ) {
+					if (is_raw_read_caloe(access))
+						store_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset, access->align, sent[j].value, 1);
+				}
+				else if (access->mode == READ_WRITE) {
+					store_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset, access->align, sent[j].value, 1);
+				}
+				else {
+					store_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset, access->align, apply_mask_caloe(&sent[j], sent[j].value), 1);
+				}
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+
+	// Accesses are completed up to the first one the device did not complete
+	if (ndone != NULL) {
+		for (i = 0; i < naccess && (state[i] == SHADOW_SERVED || slot[i] < done); ++i);
+		*ndone = i;
+	}
+
+	free(sent);
+	free(slot);
+	free(state);
+
+	return rcode;
+}
+
+void invalidate_shadow_caloe(shadow_cache_caloe * cache, access_caloe * access) {
+	if (!has_entries_caloe(cache) || (!is_write_caloe(access) && !is_cacheable_caloe(access) && cache->window == 0))
+		return;
+
+	pthread_mutex_lock(&cache->lock);
+	drop_shadow_caloe(cache, access->networkc.endpoint, access->address + access->offset);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void clear_shadow_cache_caloe(shadow_cache_caloe * cache) {
+	shadow_entry_caloe * entry;
+	int i;
+
+	if (!has_entries_caloe(cache))
+		return;
+
+	pthread_mutex_lock(&cache->lock);
+
+	for (i = 0; i < SHADOW_BUCKETS; ++i) {
+		while ((entry = cache->buckets[i]) != NULL) {
+			cache->buckets[i] = entry->next;
+			free(entry);
+
+			__sync_fetch_and_sub(&cache->entries, 1);
+		}
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void set_coalesce_window_caloe(shadow_cache_caloe * cache, long window) {
+	pthread_mutex_lock(&cache->lock);
+	cache->window = window;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void get_shadow_stats_caloe(shadow_cache_caloe * cache, shadow_stats_caloe * stats, int reset) {
+	pthread_mutex_lock(&cache->lock);
+
+	*stats = cache->stats;
+
+	if (reset)
+		memset(&cache->stats, 0, sizeof(shadow_stats_caloe));
+
+	pthread_mutex_unlock(&cache->lock);
+}
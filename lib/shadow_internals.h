@@ -0,0 +1,197 @@
+/**
+ *******************************************************************************
+ * @file shadow_internals.h
+ *  @brief Shadow cache: last written/read value of cacheable registers of each endpoint
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+
+#ifndef SHADOW_INTERNALS_CALOE_H
+#define SHADOW_INTERNALS_CALOE_H
+
+#include <pthread.h>
+
+#include "access_internals.h"
+#include "session_internals.h"
+#include "transport_internals.h"
+
+/// Number of buckets of the shadow cache
+#define SHADOW_BUCKETS 1024
+
+/// Time (us) a read value is reused by reads of the same register (0: only reads of the same batch)
+#define COALESCE_WINDOW 0
+
+/// Number of previous accesses of a batch where a read of the same register is searched
+#define COALESCE_LOOKBACK 32
+
+/**
+* @brief Known value of one register of one endpoint.
+*/
+
+typedef struct shadow_entry_caloe {
+	int endpoint; /**< Endpoint handle */
+	eb_address_t address; /**< Register address (offset included) */
+	align_access_caloe align; /**< Register width */
+	eb_data_t value; /**< Last written or read value */
+	int known; /**< It indicates if the value is valid until it is dropped (1: cacheable register) or only within the coalescing window (0) */
+	long long stamp; /**< Timestamp (us) of the read that got the value */
+	struct shadow_entry_caloe * next; /**< Next entry of the bucket */
+} shadow_entry_caloe;
+
+/**
+* @brief Shadow cache counters.
+*/
+
+typedef struct shadow_stats_caloe {
+	long long hits; /**< Reads and read-modify-writes served without a network read */
+	long long misses; /**< Reads and read-modify-writes of cacheable registers that went to the device */
+	long long suppressed; /**< Writes not sent because the register already had the value */
+	long long coalesced; /**< Reads served by another read of the same register (same batch or coalescing window) */
+} shadow_stats_caloe;
+
+/**
+* @brief Shadow values of the cacheable registers of all endpoints and values of recent reads. It is
+* protected by a mutex.
+*/
+
+typedef struct shadow_cache_caloe {
+	pthread_mutex_t lock; /**< It protects entries and counters */
+	long window; /**< Coalescing window (us, see COALESCE_WINDOW) */
+	shadow_entry_caloe * buckets[SHADOW_BUCKETS]; /**< Entries by endpoint and address */
+	int entries; /**< Number of entries (it can be read without the lock with __sync builtins) */
+	shadow_stats_caloe stats; /**< Counters */
+} shadow_cache_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Gets the shadow cache used by execute_caloe and execute_batch_caloe
+*
+* @return Default shadow cache
+*
+**/
+
+shadow_cache_caloe * default_shadow_cache_caloe(void);
+
+/**
+*
+* Initializes an empty shadow cache
+*
+* @param cache Shadow cache to initialize
+*
+**/
+
+void init_shadow_cache_caloe(shadow_cache_caloe * cache);
+
+/**
+*
+* Checks if a list of accesses can take advantage of the shadow cache: it has cacheable accesses or
+* reads that can be coalesced. Writes of volatile registers go through the cache too while it has
+* entries, since the shadow of their register must be dropped.
+*
+* @param cache Shadow cache
+* @param accesses Accesses to execute
+* @param naccess Number of accesses
+*
+* @return 1 if the accesses should be executed with execute_shadow_caloe or 0 otherwise
+*
+**/
+
+int use_shadow_caloe(shadow_cache_caloe * cache, access_caloe * accesses, int naccess);
+
+/**
+*
+* Executes a list of accesses with a transport using the shadow cache. Cacheable accesses (see
+* access_caloe) whose register value is known are served locally: reads return the shadow value,
+* read-modify-writes become plain writes and writes of an unchanged value are not sent. Reads of the
+* same register are coalesced: the register is read once without mask and the mask of each read is
+* applied locally (reads with side effects are never coalesced). The rest is executed by the
+* transport in one batch, and its results update the shadow values.
+*
+* @param cache Shadow cache
+* @param transport Transport
+* @param accesses Accesses to execute
+* @param naccess Number of accesses
+* @param ndone Number of accesses completed (it can be NULL)
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int execute_shadow_caloe(shadow_cache_caloe * cache, transport_caloe * transport, access_caloe * accesses, int naccess, int * ndone);
+
+/**
+*
+* Drops the shadow value of the register of an access (its value is changed without the cache). Every
+* write or read-modify-write drops it, even if the access is not cacheable: the shadow belongs to the
+* register, not to the access.
+*
+* @param cache Shadow cache
+* @param access Access
+*
+**/
+
+void invalidate_shadow_caloe(shadow_cache_caloe * cache, access_caloe * access);
+
+/**
+*
+* Drops all shadow values (e.g. after a board reset). Counters are kept.
+*
+* @param cache Shadow cache
+*
+**/
+
+void clear_shadow_cache_caloe(shadow_cache_caloe * cache);
+
+/**
+*
+* Gets the counters of a shadow cache
+*
+* @param cache Shadow cache
+* @param stats Returned counters
+* @param reset Reset the counters (1) or not (0)
+*
+**/
+
+void get_shadow_stats_caloe(shadow_cache_caloe * cache, shadow_stats_caloe * stats, int reset);
+
+/**
+*
+* Sets the coalescing window: reads of a register within this time after a read of it are served
+* with the value of that read (only for registers whose reads have no side effects)
+*
+* @param cache Shadow cache
+* @param window Time (us, 0: reads are only coalesced within a batch)
+*
+**/
+
+void set_coalesce_window_caloe(shadow_cache_caloe * cache, long window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
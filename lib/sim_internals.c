@@ -0,0 +1,571 @@
+/**
+ *******************************************************************************
+ * @file sim_internals.c
+ *  @brief Implements the local Etherbone/SDB device simulator
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "sim_internals.h"
+
+/// Etherbone magic number (first two bytes of every packet)
+#define EB_MAGIC_SIM 0x4E6F
+
+/// Etherbone packet flags
+#define EB_PROBE_SIM 0x01
+#define EB_PROBE_REPLY_SIM 0x02
+
+/// Etherbone record flags
+#define EB_BCA_SIM 0x80
+#define EB_RCA_SIM 0x40
+#define EB_RFF_SIM 0x20
+#define EB_CYC_SIM 0x08
+#define EB_WCA_SIM 0x04
+#define EB_WFF_SIM 0x02
+
+/// Vendor identifier of the simulated devices (CERN)
+#define SIM_VENDOR_ID 0xce42
+
+static void put_be_caloe(uint8_t * buf, int len, uint64_t value) {
+	int i;
+
+	for (i = len-1; i >= 0; --i) {
+		buf[i] = value & 0xff;
+		value >>= 8;
+	}
+}
+
+static uint64_t get_be_caloe(const uint8_t * buf, int len) {
+	uint64_t value = 0;
+	int i;
+
+	for (i = 0; i < len; ++i)
+		value = (value << 8) | buf[i];
+
+	return value;
+}
+
+static void put_sdb_name_caloe(uint8_t * buf, const char * name) {
+	int i;
+
+	// SDB names are padded with spaces
+	for (i = 0; i < 19; ++i)
+		buf[i] = (*name != 0 ? *name++ : ' ');
+}
+
+static void put_sdb_component_caloe(uint8_t * record, uint64_t first, uint64_t last, uint64_t vendor_id, uint32_t device_id, const char * name, uint8_t type) {
+	put_be_caloe(record + 0x08, 8, first);
+	put_be_caloe(record + 0x10, 8, last);
+	put_be_caloe(record + 0x18, 8, vendor_id);
+	put_be_caloe(record + 0x20, 4, device_id);
+	put_be_caloe(record + 0x24, 4, 1);
+	put_be_caloe(record + 0x28, 4, 0x20130101);
+	put_sdb_name_caloe(record + 0x2C, name);
+	record[0x3F] = type;
+}
+
+static void build_sdb_table_caloe(sim_map_caloe * map) {
+	uint8_t * record;
+	uint64_t last = map->sdb_address + (map->ndevices+1)*64 - 1;
+	int i;
+
+	memset(map->sdb_table, 0, sizeof(map->sdb_table));
+	map->sdb_size = (map->ndevices+1)*64;
+
+	for (i = 0; i < map->ndevices; ++i) {
+		sim_device_caloe * dev = &map->devices[i];
+
+		if (dev->base + dev->size - 1 > last)
+			last = dev->base + dev->size - 1;
+
+		record = map->sdb_table + (i+1)*64;
+
+		put_be_caloe(record + 0x04, 4, dev->bus_specific);
+		put_sdb_component_caloe(record, dev->base, dev->base + dev->size - 1, dev->vendor_id, dev->device_id, dev->name, 0x01);
+	}
+
+	/* Interconnect record */
+	record = map->sdb_table;
+
+	put_be_caloe(record + 0x00, 4, 0x5344422D);
+	put_be_caloe(record + 0x04, 2, map->ndevices+1);
+	record[0x06] = 1;
+	record[0x07] = 0;
+	put_sdb_component_caloe(record, 0, last, SIM_VENDOR_ID, 0x00000001, "CALOE-SIM-CROSSBAR", 0x00);
+}
+
+void init_sim_map_caloe(sim_map_caloe * map, uint64_t sdb_address) {
+	memset(map, 0, sizeof(sim_map_caloe));
+
+	map->sdb_address = sdb_address;
+
+	build_sdb_table_caloe(map);
+}
+
+int add_sim_device_caloe(sim_map_caloe * map, const char * name, uint64_t vendor_id, uint32_t device_id, uint64_t base, uint64_t size) {
+	sim_device_caloe * dev;
+
+	if (map->ndevices == SIM_MAX_DEVICES || size == 0) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Simulator can not add device %s \n", name);
+
+		return INVALID_OPERATION;
+	}
+
+	dev = &map->devices[map->ndevices++];
+
+	memset(dev->name, 0, sizeof(dev->name));
+	strncpy(dev->name, name, sizeof(dev->name)-1);
+	dev->vendor_id = vendor_id;
+	dev->device_id = device_id;
+	dev->base = base;
+	dev->size = size;
+	dev->bus_specific = SIM_BUS_SPECIFIC;
+	dev->memory = malloc(size);
+	memset(dev->memory, 0, size);
+
+	build_sdb_table_caloe(map);
+
+	return ALL_OK;
+}
+
+void default_sim_map_caloe(sim_map_caloe * map) {
+	init_sim_map_caloe(map, SIM_SDB_ADDRESS);
+
+	add_sim_device_caloe(map, "WR-DIO", SIM_VENDOR_ID, 0x00000002, SIM_DIO_ADDRESS, SIM_DIO_SIZE);
+	add_sim_device_caloe(map, "WR-VUART", SIM_VENDOR_ID, 0x00000003, SIM_VUART_ADDRESS, SIM_VUART_SIZE);
+}
+
+void free_sim_map_caloe(sim_map_caloe * map) {
+	int i;
+
+	for (i = 0; i < map->ndevices; ++i) {
+		free(map->devices[i].memory);
+		map->devices[i].memory = NULL;
+	}
+
+	map->ndevices = 0;
+}
+
+// It returns the memory that backs [address, address+width) or NULL if it is not mapped
+
+static uint8_t * sim_memory_caloe(sim_map_caloe * map, uint64_t address, int width, int * writable) {
+	int i;
+
+	if (address >= map->sdb_address && address + width <= map->sdb_address + map->sdb_size) {
+		*writable = 0;
+		return map->sdb_table + (address - map->sdb_address);
+	}
+
+	for (i = 0; i < map->ndevices; ++i) {
+		sim_device_caloe * dev = &map->devices[i];
+
+		if (address >= dev->base && address + width <= dev->base + dev->size) {
+			*writable = 1;
+			return dev->memory + (address - dev->base);
+		}
+	}
+
+	return NULL;
+}
+
+int read_sim_caloe(sim_map_caloe * map, uint64_t address, int width, uint64_t * data) {
+	uint8_t * mem;
+	int writable;
+
+	address &= ~(uint64_t)(width-1);
+
+	if ((mem = sim_memory_caloe(map, address, width, &writable)) == NULL) {
+		*data = 0;
+		return 1;
+	}
+
+	*data = get_be_caloe(mem, width);
+
+	return 0;
+}
+
+int write_sim_caloe(sim_map_caloe * map, uint64_t address, int width, uint8_t select, uint64_t data) {
+	uint8_t * mem;
+	int writable;
+	int i;
+
+	address &= ~(uint64_t)(width-1);
+
+	if ((mem = sim_memory_caloe(map, address, width, &writable)) == NULL)
+		return 1;
+
+	if (!writable)
+		return 0;
+
+	/* Byte lane i holds bits [8i+7:8i], the last byte of a big endian word */
+	for (i = 0; i < width; ++i) {
+		if (select & (1 << i))
+			mem[width-1-i] = (data >> (i*8)) & 0xff;
+	}
+
+	return 0;
+}
+
+uint64_t read_sim_config_caloe(sim_map_caloe * map, uint64_t address, int width) {
+	uint8_t config[16];
+
+	/* 0x00: error shift register, 0x08: SDB address */
+	put_be_caloe(config, 8, map->error_shift);
+	put_be_caloe(config + 8, 8, map->sdb_address);
+
+	address &= ~(uint64_t)(width-1);
+
+	if (address + width > sizeof(config))
+		return 0;
+
+	return get_be_caloe(config + address, width);
+}
+
+static int width_bytes_caloe(int widths) {
+	/* Largest width of a width mask */
+	if (widths & 0x8) return 8;
+	if (widths & 0x4) return 4;
+	if (widths & 0x2) return 2;
+	if (widths & 0x1) return 1;
+
+	return 0;
+}
+
+int handle_sim_packet_caloe(sim_map_caloe * map, const uint8_t * in, int inlen, uint8_t * out, int outcap) {
+	int addr_b, data_b, align;
+	int pos, opos;
+	uint8_t flags, select, wcount, rcount;
+	uint64_t base, address, value;
+	int err;
+	int i;
+
+	if (inlen < 4 || get_be_caloe(in, 2) != EB_MAGIC_SIM)
+		return 0;
+
+	/* Probe: answer with the widths of the simulator (32-bit address and data) */
+	if (in[2] & EB_PROBE_SIM) {
+		if (inlen > outcap)
+			return 0;
+
+		memcpy(out, in, inlen);
+		out[2] = (in[2] & 0xF0) | EB_PROBE_REPLY_SIM;
+		out[3] = in[3] & 0x44;
+
+		return inlen;
+	}
+
+	addr_b = width_bytes_caloe(in[3] >> 4);
+	data_b = width_bytes_caloe(in[3] & 0x0F);
+
+	if (addr_b == 0 || data_b == 0)
+		return 0;
+
+	/* Every field is padded to the widest of address and data */
+	align = (addr_b > data_b ? addr_b : data_b);
+	if (align < 4)
+		align = 4;
+
+	if (outcap < align)
+		return 0;
+
+	memset(out, 0, align);
+	put_be_caloe(out, 2, EB_MAGIC_SIM);
+	out[2] = in[2] & 0xF0;
+	out[3] = in[3];
+
+	pos = align;
+	opos = align;
+
+	while (pos + align <= inlen) {
+		flags = in[pos];
+		select = in[pos+1];
+		wcount = in[pos+2];
+		rcount = in[pos+3];
+		pos += align;
+
+		/* Padding record */
+		if (wcount == 0 && rcount == 0)
+			continue;
+
+		if (wcount > 0) {
+			if (pos + align*(wcount+1) > inlen)
+				break;
+
+			base = get_be_caloe(in + pos + align - addr_b, addr_b);
+			pos += align;
+
+			for (i = 0; i < wcount; ++i) {
+				value = get_be_caloe(in + pos + align - data_b, data_b);
+				pos += align;
+
+				/* Config space writes are ignored */
+				if (!(flags & EB_WCA_SIM)) {
+					err = write_sim_caloe(map, base, data_b, select, value);
+					map->error_shift = (map->error_shift << 1) | err;
+				}
+
+				if (!(flags & EB_WFF_SIM))
+					base += data_b;
+			}
+		}
+
+		if (rcount > 0) {
+			if (pos + align*(rcount+1) > inlen)
+				break;
+
+			if (opos + align*(rcount+2) > outcap)
+				break;
+
+			/* Reads come back as writes to the return address */
+			memset(out + opos, 0, align*(rcount+2));
+			out[opos] = ((flags & EB_BCA_SIM) ? EB_WCA_SIM : 0) | ((flags & EB_RFF_SIM) ? EB_WFF_SIM : 0) | (flags & EB_CYC_SIM);
+			out[opos+1] = select;
+			out[opos+2] = rcount;
+			out[opos+3] = 0;
+			opos += align;
+
+			memcpy(out + opos, in + pos, align);
+			pos += align;
+			opos += align;
+
+			for (i = 0; i < rcount; ++i) {
+				address = get_be_caloe(in + pos + align - addr_b, addr_b);
+				pos += align;
+
+				if (flags & EB_RCA_SIM) {
+					value = read_sim_config_caloe(map, address, data_b);
+				}
+				else {
+					err = read_sim_caloe(map, address, data_b, &value);
+					map->error_shift = (map->error_shift << 1) | err;
+				}
+
+				put_be_caloe(out + opos + align - data_b, data_b, value);
+				opos += align;
+			}
+		}
+	}
+
+	/* Nothing to answer (only writes) */
+	if (opos == align)
+		return 0;
+
+	return opos;
+}
+
+int open_sim_server_caloe(sim_server_caloe * server, sim_map_caloe * map, int tcp, unsigned int port) {
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int on = 1;
+
+	server->map = map;
+	server->tcp = tcp;
+	server->served = 0;
+	server->dropped = 0;
+	server->running = 1;
+
+	if ((server->fd = socket(AF_INET, tcp ? SOCK_STREAM : SOCK_DGRAM, 0)) < 0) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Simulator could not open socket: %s \n", strerror(errno));
+
+		return ERROR_OPEN_SOCKET;
+	}
+
+	setsockopt(server->fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+
+	if (bind(server->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || (tcp && listen(server->fd, 4) < 0)) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Simulator could not listen on port %u: %s \n", port, strerror(errno));
+
+		close(server->fd);
+		return ERROR_OPEN_SOCKET;
+	}
+
+	getsockname(server->fd, (struct sockaddr *) &addr, &len);
+	server->port = ntohs(addr.sin_port);
+
+	return ALL_OK;
+}
+
+// It waits up to 100 ms for data on a socket (1: data, 0: timeout, -1: error)
+
+static int wait_readable_caloe(int fd) {
+	struct timeval tv;
+	fd_set rfds;
+
+	FD_ZERO(&rfds);
+	FD_SET(fd, &rfds);
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 100000;
+
+	return select(fd+1, &rfds, NULL, NULL, &tv);
+}
+
+// The server loop reads the flag while another thread may clear it (see stop_sim_server_caloe)
+
+static int is_running_caloe(sim_server_caloe * server) {
+	return __sync_fetch_and_add(&server->running, 0);
+}
+
+static int drop_packet_caloe(sim_server_caloe * server) {
+	if (server->loss > 0 && (int)(rand_r(&server->seed) % 100) < server->loss) {
+		server->dropped++;
+		return 1;
+	}
+
+	return 0;
+}
+
+static void serve_udp_caloe(sim_server_caloe * server) {
+	uint8_t in[SIM_MAX_PACKET];
+	uint8_t out[SIM_MAX_PACKET];
+	struct sockaddr_in peer;
+	socklen_t peerlen;
+	int inlen, outlen;
+
+	while (is_running_caloe(server)) {
+		if (wait_readable_caloe(server->fd) <= 0)
+			continue;
+
+		peerlen = sizeof(peer);
+
+		if ((inlen = recvfrom(server->fd, in, sizeof(in), 0, (struct sockaddr *) &peer, &peerlen)) <= 0)
+			continue;
+
+		if (drop_packet_caloe(server))
+			continue;
+
+		if ((outlen = handle_sim_packet_caloe(server->map, in, inlen, out, sizeof(out))) <= 0)
+			continue;
+
+		if (server->latency > 0)
+			usleep(server->latency);
+
+		sendto(server->fd, out, outlen, 0, (struct sockaddr *) &peer, peerlen);
+		server->served++;
+	}
+}
+
+// It reads len bytes from a TCP client (1: done, 0: client closed or server stopped)
+
+static int read_full_caloe(sim_server_caloe * server, int fd, uint8_t * buf, int len) {
+	int n;
+
+	while (len > 0 && is_running_caloe(server)) {
+		if (wait_readable_caloe(fd) <= 0)
+			continue;
+
+		if ((n = read(fd, buf, len)) <= 0)
+			return 0;
+
+		buf += n;
+		len -= n;
+	}
+
+	return len == 0;
+}
+
+static void serve_tcp_caloe(sim_server_caloe * server) {
+	uint8_t in[SIM_MAX_PACKET];
+	uint8_t out[SIM_MAX_PACKET+2];
+	uint8_t lenbuf[2];
+	int client;
+	int inlen, outlen;
+
+	while (is_running_caloe(server)) {
+		if (wait_readable_caloe(server->fd) <= 0)
+			continue;
+
+		if ((client = accept(server->fd, NULL, NULL)) < 0)
+			continue;
+
+		/* One client at a time: each packet is preceded by its length */
+		while (read_full_caloe(server, client, lenbuf, 2)) {
+			inlen = get_be_caloe(lenbuf, 2);
+
+			if (inlen > SIM_MAX_PACKET || !read_full_caloe(server, client, in, inlen))
+				break;
+
+			if (drop_packet_caloe(server))
+				continue;
+
+			if ((outlen = handle_sim_packet_caloe(server->map, in, inlen, out+2, SIM_MAX_PACKET)) <= 0)
+				continue;
+
+			if (server->latency > 0)
+				usleep(server->latency);
+
+			put_be_caloe(out, 2, outlen);
+
+			if (write(client, out, outlen+2) != outlen+2)
+				break;
+
+			server->served++;
+		}
+
+		close(client);
+	}
+}
+
+int run_sim_server_caloe(sim_server_caloe * server) {
+	if (server->tcp)
+		serve_tcp_caloe(server);
+	else
+		serve_udp_caloe(server);
+
+	return ALL_OK;
+}
+
+void * sim_server_thread_caloe(void * server) {
+	run_sim_server_caloe((sim_server_caloe *) server);
+
+	return NULL;
+}
+
+void stop_sim_server_caloe(sim_server_caloe * server) {
+	__sync_lock_test_and_set(&server->running, 0);
+}
+
+void close_sim_server_caloe(sim_server_caloe * server) {
+	if (server->fd >= 0)
+		close(server->fd);
+
+	server->fd = -1;
+}
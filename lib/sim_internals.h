@@ -0,0 +1,278 @@
+/**
+ *******************************************************************************
+ * @file sim_internals.h
+ *  @brief Local Etherbone/SDB device simulator (memory map, wire protocol and UDP/TCP responder)
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef SIM_INTERNALS_CALOE_H
+#define SIM_INTERNALS_CALOE_H
+
+#include <stdint.h>
+
+#include "access_internals.h"
+
+/// Default Etherbone port of the simulator
+#define SIM_DEFAULT_PORT 60368
+
+/// Max number of devices of a simulated memory map
+#define SIM_MAX_DEVICES 16
+
+/// Max size (bytes) of an Etherbone packet
+#define SIM_MAX_PACKET 1500
+
+/// Address of the SDB root table in the default map
+#define SIM_SDB_ADDRESS 0x00000
+
+/// Base address and size of the DIO register block in the default map
+#define SIM_DIO_ADDRESS 0x62300
+#define SIM_DIO_SIZE 0x100
+
+/// Base address and size of the VUART register block in the default map
+#define SIM_VUART_ADDRESS 0x20500
+#define SIM_VUART_SIZE 0x100
+
+/// Wishbone widths supported by the simulated devices (32 bits, big endian)
+#define SIM_BUS_SPECIFIC 0x4
+
+/**
+* @brief One simulated Wishbone device (a register block backed by memory).
+*/
+
+typedef struct sim_device_caloe {
+	char name[20]; /**< Device name (SDB product name, 19 characters max) */
+	uint64_t vendor_id; /**< SDB vendor identifier */
+	uint32_t device_id; /**< SDB device identifier */
+	uint64_t base; /**< First address of the device */
+	uint64_t size; /**< Size (bytes) of the device */
+	uint32_t bus_specific; /**< Wishbone endian and width flags */
+	uint8_t * memory; /**< Register contents (big endian) */
+} sim_device_caloe;
+
+/**
+* @brief Simulated memory map: devices plus the SDB table that describes them.
+*/
+
+typedef struct sim_map_caloe {
+	sim_device_caloe devices[SIM_MAX_DEVICES]; /**< Devices */
+	int ndevices; /**< Number of devices */
+	uint64_t sdb_address; /**< Address of the SDB root table */
+	uint8_t sdb_table[(SIM_MAX_DEVICES+1)*64]; /**< SDB records (interconnect record and one record per device) */
+	uint64_t sdb_size; /**< Size (bytes) of the SDB table */
+	uint64_t error_shift; /**< Etherbone error shift register (one bit per Wishbone operation) */
+} sim_map_caloe;
+
+/**
+* @brief Etherbone responder on a loopback socket.
+*/
+
+typedef struct sim_server_caloe {
+	sim_map_caloe * map; /**< Simulated memory map */
+	int tcp; /**< It indicates if the server uses TCP (1) or UDP (0) */
+	unsigned int port; /**< Listening port */
+	long latency; /**< Delay (us) added before each reply */
+	int loss; /**< Percentage of requests dropped without reply */
+	unsigned int seed; /**< Seed of the loss generator */
+	int fd; /**< Listening socket */
+	int running; /**< It indicates if the server loop must go on (1) or stop (0), accessed with atomic builtins */
+	long long served; /**< Number of packets answered */
+	long long dropped; /**< Number of packets dropped */
+} sim_server_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Initializes an empty memory map whose SDB table is placed at an address
+*
+* @param map Memory map
+* @param sdb_address Address of the SDB root table
+*
+**/
+
+void init_sim_map_caloe(sim_map_caloe * map, uint64_t sdb_address);
+
+/**
+*
+* Adds a device to a memory map (its registers are cleared) and rebuilds the SDB table
+*
+* @param map Memory map
+* @param name Device name
+* @param vendor_id SDB vendor identifier
+* @param device_id SDB device identifier
+* @param base First address of the device
+* @param size Size (bytes) of the device
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int add_sim_device_caloe(sim_map_caloe * map, const char * name, uint64_t vendor_id, uint32_t device_id, uint64_t base, uint64_t size);
+
+/**
+*
+* Initializes the memory map of a SPEC board with the DIO and VUART register blocks
+*
+* @param map Memory map
+*
+**/
+
+void default_sim_map_caloe(sim_map_caloe * map);
+
+/**
+*
+* Frees the memory of the devices of a map
+*
+* @param map Memory map
+*
+**/
+
+void free_sim_map_caloe(sim_map_caloe * map);
+
+/**
+*
+* Performs a Wishbone read on the memory map
+*
+* @param map Memory map
+* @param address Address
+* @param width Width (bytes) of the access
+* @param data Returned data
+*
+* @return Zero if success or 1 if no device answers the address (bus error)
+*
+**/
+
+int read_sim_caloe(sim_map_caloe * map, uint64_t address, int width, uint64_t * data);
+
+/**
+*
+* Performs a Wishbone write on the memory map
+*
+* @param map Memory map
+* @param address Address
+* @param width Width (bytes) of the access
+* @param select Byte select of the access
+* @param data Data to write
+*
+* @return Zero if success or 1 if no device answers the address (bus error)
+*
+**/
+
+int write_sim_caloe(sim_map_caloe * map, uint64_t address, int width, uint8_t select, uint64_t data);
+
+/**
+*
+* Performs a read of the Etherbone configuration space (error shift register and SDB address)
+*
+* @param map Memory map
+* @param address Configuration address
+* @param width Width (bytes) of the access
+*
+* @return Read data (zero out of the configuration registers)
+*
+**/
+
+uint64_t read_sim_config_caloe(sim_map_caloe * map, uint64_t address, int width);
+
+/**
+*
+* Answers an Etherbone packet (probe or records)
+*
+* @param map Memory map
+* @param in Request packet
+* @param inlen Request length
+* @param out Reply buffer
+* @param outcap Reply buffer size
+*
+* @return Reply length (zero: no reply) or error code
+*
+**/
+
+int handle_sim_packet_caloe(sim_map_caloe * map, const uint8_t * in, int inlen, uint8_t * out, int outcap);
+
+/**
+*
+* Opens the socket of a simulator on loopback. TCP packets are preceded by their 16-bit big endian length.
+*
+* @param server Simulator
+* @param map Simulated memory map
+* @param tcp Use TCP (1) or UDP (0)
+* @param port Listening port (0: any free port, it is stored in server)
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int open_sim_server_caloe(sim_server_caloe * server, sim_map_caloe * map, int tcp, unsigned int port);
+
+/**
+*
+* Runs a simulator until stop_sim_server_caloe is called
+*
+* @param server Simulator
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int run_sim_server_caloe(sim_server_caloe * server);
+
+/**
+*
+* Thread entry point of a simulator (pthread_create). It calls run_sim_server_caloe.
+*
+* @param server Simulator
+*
+* @return NULL
+*
+**/
+
+void * sim_server_thread_caloe(void * server);
+
+/**
+*
+* Asks a running simulator to stop (it returns within 100 ms)
+*
+* @param server Simulator
+*
+**/
+
+void stop_sim_server_caloe(sim_server_caloe * server);
+
+/**
+*
+* Closes the socket of a simulator
+*
+* @param server Simulator
+*
+**/
+
+void close_sim_server_caloe(sim_server_caloe * server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
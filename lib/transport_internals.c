@@ -0,0 +1,854 @@
+/**
+ *******************************************************************************
+ * @file transport_internals.c
+ *  @brief Implements the transports and the dispatch of accesses to the current one
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "transport_internals.h"
+#include "shadow_internals.h"
+#include "wire_internals.h"
+
+static int native_execute_caloe(transport_caloe * transport, access_caloe * access) {
+	(void) transport;
+
+	return execute_native_caloe(access);
+}
+
+static int native_batch_caloe(transport_caloe * transport, access_caloe * accesses, int naccess, int * ndone) {
+	(void) transport;
+
+	return execute_native_batch_caloe(accesses, naccess, ndone);
+}
+
+static int native_read_block_caloe(transport_caloe * transport, access_caloe * access, int stride, int count, eb_data_t * buffer) {
+	(void) transport;
+
+	return read_block_native_caloe(access, stride, count, buffer);
+}
+
+static int native_write_block_caloe(transport_caloe * transport, access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats) {
+	(void) transport;
+
+	return write_block_native_caloe(access, stride, count, data, verify, stats);
+}
+
+static int tools_execute_caloe(transport_caloe * transport, access_caloe * access) {
+	(void) transport;
+
+	return execute_tools_caloe(access);
+}
+
+/// Etherbone transport
+static transport_caloe native_transport = { "etherbone", &native_execute_caloe, &native_batch_caloe, &native_read_block_caloe, &native_write_block_caloe, 1, NULL, NULL };
+
+/// eb-tools transport (it can not pack accesses)
+static transport_caloe tools_transport = { "eb-tools", &tools_execute_caloe, NULL, NULL, NULL, 0, NULL, NULL };
+
+/// Transport selected by the user (NULL: default transport)
+static transport_caloe * current_transport = NULL;
+
+/// Capture mode state (see start_capture_caloe), protected by trace_lock
+static pthread_once_t capture_once = PTHREAD_ONCE_INIT;
+static int capturing = 0;
+static transport_caloe capture_transport;
+static transport_caloe * capture_previous = NULL;
+static trace_caloe capture_trace;
+static char * capture_path = NULL;
+
+/// It protects the entries of the traces and the capture mode state
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void exit_capture_caloe(void) {
+	if (capturing)
+		stop_capture_caloe();
+}
+
+// Capture mode requested by the environment
+static void check_capture_env_caloe(void) {
+	const char * path;
+
+	if ((path = getenv(TRACE_ENV)) != NULL && start_capture_caloe(path) == ALL_OK)
+		atexit(&exit_capture_caloe);
+}
+
+static transport_caloe * selected_transport_caloe(void) {
+	if (current_transport != NULL)
+		return current_transport;
+
+	return (EXECUTE_CALOE_MODE ? &tools_transport : &native_transport);
+}
+
+transport_caloe * native_transport_caloe(void) {
+	return &native_transport;
+}
+
+transport_caloe * tools_transport_caloe(void) {
+	return &tools_transport;
+}
+
+transport_caloe * get_transport_caloe(void) {
+	pthread_once(&capture_once, &check_capture_env_caloe);
+
+	return selected_transport_caloe();
+}
+
+void set_transport_caloe(transport_caloe * transport) {
+	current_transport = transport;
+}
+
+/**
+* Generic implementations of the optional functions of a transport (one access each time)
+**/
+
+int execute_transport_batch_caloe(transport_caloe * transport, access_caloe * accesses, int naccess, int * ndone) {
+	int rcode = ALL_OK;
+	int i;
+
+	if (transport->execute_batch != NULL)
+		return transport->execute_batch(transport, accesses, naccess, ndone);
+
+	for (i = 0; i < naccess; ++i) {
+		if ((rcode = transport->execute(transport, &accesses[i])) != ALL_OK)
+			break;
+	}
+
+	if (ndone != NULL)
+		*ndone = i;
+
+	return rcode;
+}
+
+static int transport_read_block_caloe(transport_caloe * transport, access_caloe * access, int stride, int count, eb_data_t * buffer) {
+	access_caloe word = *access;
+	int rcode = ALL_OK;
+	int i;
+
+	if (transport->read_block != NULL)
+		return transport->read_block(transport, access, stride, count, buffer);
+
+	for (i = 0; i < count && rcode == ALL_OK; ++i) {
+		rcode = transport->execute(transport, &word);
+		buffer[i] = word.value;
+		word.offset += align_bytes_caloe(access->align)*stride;
+	}
+
+	return rcode;
+}
+
+static int write_words_caloe(transport_caloe * transport, access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats) {
+	access_caloe word = *access;
+	long long start = now_us_caloe();
+	eb_data_t width_mask;
+	int rcode = ALL_OK;
+	int i;
+
+	for (i = 0; i < count && rcode == ALL_OK; ++i) {
+		word.value = data[i];
+		rcode = transport->execute(transport, &word);
+		word.offset += align_bytes_caloe(access->align)*stride;
+	}
+
+	if (stats != NULL) {
+		stats->bytes = (long long) i*align_bytes_caloe(access->align);
+		stats->elapsed = now_us_caloe() - start;
+		stats->rtt = (i > 0 ? stats->elapsed/i : -1);
+		stats->window = 1;
+		stats->throughput = (stats->elapsed > 0 ? (double) stats->bytes/stats->elapsed : 0);
+	}
+
+	if (rcode != ALL_OK || !verify)
+		return rcode;
+
+	// Read back the whole words without mask
+	word = *access;
+	word.mode = READ;
+	word.mask = 0x00;
+	word.mask_oper = MASK_OR;
+
+	width_mask = ~(eb_data_t)0;
+	width_mask >>= (sizeof(eb_data_t)-align_bytes_caloe(access->align))*8;
+
+	for (i = 0; i < count; ++i) {
+		if ((rcode = transport->execute(transport, &word)) != ALL_OK)
+			return rcode;
+
+		if (word.value != (apply_mask_caloe(access, data[i]) & width_mask)) {
+
+			if(VERBOSE_CALOE)
+				fprintf(stderr, "ERROR: Verify failed at word %d \n", i);
+
+			return ERROR_VERIFY;
+		}
+
+		word.offset += align_bytes_caloe(access->align)*stride;
+	}
+
+	return ALL_OK;
+}
+
+static int transport_write_block_caloe(transport_caloe * transport, access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats) {
+	if (transport->write_block != NULL)
+		return transport->write_block(transport, access, stride, count, data, verify, stats);
+
+	return write_words_caloe(transport, access, stride, count, data, verify, stats);
+}
+
+int execute_caloe(access_caloe * access) {
+	transport_caloe * transport = get_transport_caloe();
+	int rcode;
+
+	if (use_shadow_caloe(default_shadow_cache_caloe(), access, 1))
+		rcode = execute_shadow_caloe(default_shadow_cache_caloe(), transport, access, 1, NULL);
+	else
+		rcode = transport->execute(transport, access);
+
+	if(SLEEP_ACCESS != 0)
+		usleep(SLEEP_ACCESS);
+
+	return rcode;
+}
+
+int execute_batch_caloe(access_caloe * accesses, int naccess, int * ndone) {
+	int rcode;
+
+	if (use_shadow_caloe(default_shadow_cache_caloe(), accesses, naccess))
+		rcode = execute_shadow_caloe(default_shadow_cache_caloe(), get_transport_caloe(), accesses, naccess, ndone);
+	else
+		rcode = execute_transport_batch_caloe(get_transport_caloe(), accesses, naccess, ndone);
+
+	if(SLEEP_ACCESS != 0)
+		usleep(SLEEP_ACCESS);
+
+	return rcode;
+}
+
+int read_block_caloe(access_caloe * access, int stride, int count, eb_data_t * buffer) {
+	int rcode;
+
+	if(access->mode != READ) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr,"ERROR: Invalid block read operation \n");
+
+		return INVALID_OPERATION;
+	}
+
+	// Blocks do not go through the shadow cache
+	if (access->cacheable)
+		clear_shadow_cache_caloe(default_shadow_cache_caloe());
+
+	rcode = transport_read_block_caloe(get_transport_caloe(), access, stride, count, buffer);
+
+	if(SLEEP_ACCESS != 0)
+		usleep(SLEEP_ACCESS);
+
+	return rcode;
+}
+
+int write_block_caloe(access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats) {
+	int rcode;
+
+	if(access->mode != WRITE) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr,"ERROR: Invalid block write operation \n");
+
+		return INVALID_OPERATION;
+	}
+
+	// Blocks do not go through the shadow cache, the shadow of any written register is stale
+	clear_shadow_cache_caloe(default_shadow_cache_caloe());
+
+	rcode = transport_write_block_caloe(get_transport_caloe(), access, stride, count, data, verify, stats);
+
+	if(SLEEP_ACCESS != 0)
+		usleep(SLEEP_ACCESS);
+
+	return rcode;
+}
+
+int wait_until_caloe(access_caloe * access, eb_data_t mask, eb_data_t expected, long timeout, volatile int * cancel) {
+	access_caloe poll = *access;
+	long long start = now_us_caloe();
+	long long now;
+	long interval = WAIT_POLL_MIN;
+	int rcode;
+
+	// The whole register is read every time
+	poll.mode = READ;
+	poll.mask = 0x00;
+	poll.mask_oper = MASK_OR;
+	poll.cacheable = 0;
+	poll.side_effects = 1;
+
+	while (1) {
+		if ((rcode = execute_caloe(&poll)) != ALL_OK)
+			break;
+
+		if ((poll.value & mask) == expected)
+			break;
+
+		if (cancel != NULL && *cancel) {
+			rcode = ERROR_CANCELLED;
+			break;
+		}
+
+		now = now_us_caloe();
+
+		if (timeout >= 0 && now - start >= timeout) {
+
+			if(VERBOSE_CALOE)
+				fprintf(stderr, "ERROR: Timeout expired! \n");
+
+			rcode = ERROR_TIMEOUT;
+			break;
+		}
+
+		// Do not sleep past the deadline
+		usleep((timeout >= 0 && start + timeout - now < interval) ? start + timeout - now : interval);
+
+		interval = (interval*2 > WAIT_POLL_MAX ? WAIT_POLL_MAX : interval*2);
+	}
+
+	access->value = poll.value;
+
+	return rcode;
+}
+
+/**
+* Memory transport: accesses are performed on a simulated memory map
+**/
+
+static int memory_read_caloe(sim_map_caloe * map, access_caloe * access, eb_data_t * data) {
+	uint64_t address = access->address + access->offset;
+	int width = align_bytes_caloe(access->align);
+	uint64_t value;
+
+	if (access->is_config) {
+		value = read_sim_config_caloe(map, address, width);
+	}
+	else if (read_sim_caloe(map, address, width, &value)) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: wishbone segfault reading address 0x%"EB_ADDR_FMT"\n", (eb_address_t) address);
+
+		return ERROR_OPERATION_RUN;
+	}
+
+	*data = value;
+
+	return ALL_OK;
+}
+
+static int memory_write_caloe(sim_map_caloe * map, access_caloe * access, eb_data_t data) {
+	uint64_t address = access->address + access->offset;
+	int width = align_bytes_caloe(access->align);
+
+	// Configuration registers are read only
+	if (access->is_config)
+		return ALL_OK;
+
+	if (write_sim_caloe(map, address, width, (uint8_t) ((1 << width) - 1), data)) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: wishbone segfault writing address 0x%"EB_ADDR_FMT"\n", (eb_address_t) address);
+
+		return ERROR_OPERATION_RUN;
+	}
+
+	return ALL_OK;
+}
+
+static int memory_execute_caloe(transport_caloe * transport, access_caloe * access) {
+	sim_map_caloe * map = (sim_map_caloe *) transport->state;
+	eb_data_t data;
+	int rcode = ALL_OK;
+
+	switch (access->mode) {
+		case READ:
+			if ((rcode = memory_read_caloe(map, access, &data)) == ALL_OK)
+				access->value = apply_mask_caloe(access, data);
+		break;
+
+		case WRITE:
+			rcode = memory_write_caloe(map, access, apply_mask_caloe(access, access->value));
+		break;
+
+		case READ_WRITE:
+			if ((rcode = memory_read_caloe(map, access, &data)) != ALL_OK)
+				break;
+
+			access->value = apply_mask_caloe(access, data);
+			rcode = memory_write_caloe(map, access, access->value);
+		break;
+
+		default:
+			// There is nothing to scan, the map is known
+		break;
+	}
+
+	return rcode;
+}
+
+void init_memory_transport_caloe(transport_caloe * transport, sim_map_caloe * map) {
+	memset(transport, 0, sizeof(transport_caloe));
+
+	transport->name = "memory";
+	transport->execute = &memory_execute_caloe;
+	transport->state = map;
+}
+
+/**
+* Record transport: accesses are executed by the inner transport and appended to the trace
+**/
+
+static int record_execute_caloe(transport_caloe * transport, access_caloe * access) {
+	long long start = now_us_caloe();
+	int rcode;
+
+	rcode = transport->inner->execute(transport->inner, access);
+
+	add_trace_entry_caloe((trace_caloe *) transport->state, access, rcode, start, now_us_caloe());
+
+	return rcode;
+}
+
+// The accesses done are recorded, followed by the one that failed
+static void record_accesses_caloe(trace_caloe * trace, access_caloe * accesses, int naccess, int ndone, int rcode, long long start) {
+	long long end = now_us_caloe();
+	int i;
+
+	for (i = 0; i < ndone; ++i)
+		add_trace_entry_caloe(trace, &accesses[i], ALL_OK, start, end);
+
+	if (rcode != ALL_OK && ndone < naccess)
+		add_trace_entry_caloe(trace, &accesses[ndone], rcode, start, end);
+}
+
+static int record_batch_caloe(transport_caloe * transport, access_caloe * accesses, int naccess, int * ndone) {
+	long long start = now_us_caloe();
+	int rcode;
+	int done;
+
+	rcode = execute_transport_batch_caloe(transport->inner, accesses, naccess, &done);
+
+	record_accesses_caloe((trace_caloe *) transport->state, accesses, naccess, done, rcode, start);
+
+	if (ndone != NULL)
+		*ndone = done;
+
+	return rcode;
+}
+
+static void record_block_caloe(trace_caloe * trace, access_caloe * access, int stride, int count, const eb_data_t * values, int rcode, long long start) {
+	access_caloe word = *access;
+	long long end = now_us_caloe();
+	int i;
+
+	// A failed block is recorded as its first word
+	if (rcode != ALL_OK) {
+		add_trace_entry_caloe(trace, &word, rcode, start, end);
+		return;
+	}
+
+	for (i = 0; i < count; ++i) {
+		word.value = values[i];
+		add_trace_entry_caloe(trace, &word, ALL_OK, start, end);
+		word.offset += align_bytes_caloe(access->align)*stride;
+	}
+}
+
+static int record_read_block_caloe(transport_caloe * transport, access_caloe * access, int stride, int count, eb_data_t * buffer) {
+	long long start = now_us_caloe();
+	int rcode;
+
+	rcode = transport_read_block_caloe(transport->inner, access, stride, count, buffer);
+
+	record_block_caloe((trace_caloe *) transport->state, access, stride, count, buffer, rcode, start);
+
+	return rcode;
+}
+
+static int record_write_block_caloe(transport_caloe * transport, access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats) {
+	long long start = now_us_caloe();
+	int rcode;
+
+	rcode = transport_write_block_caloe(transport->inner, access, stride, count, data, verify, stats);
+
+	record_block_caloe((trace_caloe *) transport->state, access, stride, count, data, rcode, start);
+
+	return rcode;
+}
+
+void init_record_transport_caloe(transport_caloe * transport, transport_caloe * inner, trace_caloe * trace) {
+	memset(transport, 0, sizeof(transport_caloe));
+
+	transport->name = "record";
+	transport->execute = &record_execute_caloe;
+	transport->execute_batch = &record_batch_caloe;
+	transport->read_block = &record_read_block_caloe;
+	transport->write_block = &record_write_block_caloe;
+	// Asynchronous operations of an Etherbone transport are recorded by the event loop (see record_async_caloe)
+	transport->async = inner->async;
+	transport->inner = inner;
+	transport->state = trace;
+}
+
+void record_async_caloe(transport_caloe * transport, access_caloe * accesses, int naccess, int ndone, int rcode, long long start) {
+	if (transport->execute == &record_execute_caloe)
+		record_accesses_caloe((trace_caloe *) transport->state, accesses, naccess, ndone, rcode, start);
+}
+
+/**
+* Replay transport: accesses are answered from the trace
+**/
+
+static int replay_execute_caloe(transport_caloe * transport, access_caloe * access) {
+	trace_caloe * trace = (trace_caloe *) transport->state;
+	trace_entry_caloe * entry;
+
+	if (trace->next >= trace->nentries) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: There are no more accesses in the trace \n");
+
+		return ERROR_OPERATION_RUN;
+	}
+
+	entry = &trace->entries[trace->next++];
+
+	if (entry->address != access->address + access->offset || entry->mode != access->mode) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Access to 0x%"EB_ADDR_FMT" does not match the trace (0x%"EB_ADDR_FMT" expected) \n",
+				access->address + access->offset, entry->address);
+
+		return ERROR_OPERATION_RUN;
+	}
+
+	if (access->mode == READ || access->mode == READ_WRITE)
+		access->value = entry->value;
+
+	return entry->rcode;
+}
+
+static int replay_write_block_caloe(transport_caloe * transport, access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats) {
+	// The trace holds the written words only: the recorded result already covers the verify
+	(void) verify;
+
+	return write_words_caloe(transport, access, stride, count, data, 0, stats);
+}
+
+void init_replay_transport_caloe(transport_caloe * transport, trace_caloe * trace) {
+	memset(transport, 0, sizeof(transport_caloe));
+
+	transport->name = "replay";
+	transport->execute = &replay_execute_caloe;
+	transport->write_block = &replay_write_block_caloe;
+	transport->state = trace;
+}
+
+void init_trace_caloe(trace_caloe * trace) {
+	memset(trace, 0, sizeof(trace_caloe));
+
+	trace->origin = -1;
+}
+
+static int trace_endpoint_caloe(trace_caloe * trace, network_connection * nc) {
+	const endpoint_caloe * endpoint = get_endpoint_caloe(nc->endpoint);
+	int i;
+
+	if (endpoint == NULL)
+		return -1;
+
+	for (i = 0; i < trace->nendpoints; ++i) {
+		if (strcmp(trace->endpoints[i], endpoint->key) == 0)
+			return i;
+	}
+
+	if (trace->nendpoints == TRACE_MAX_ENDPOINTS)
+		return -1;
+
+	strcpy(trace->endpoints[trace->nendpoints], endpoint->key);
+
+	return trace->nendpoints++;
+}
+
+void add_trace_entry_caloe(trace_caloe * trace, access_caloe * access, int rcode, long long start, long long end) {
+	trace_entry_caloe * entry;
+
+	pthread_mutex_lock(&trace_lock);
+
+	if (trace->nentries == trace->capacity) {
+		trace->capacity = (trace->capacity == 0 ? 256 : trace->capacity*2);
+		trace->entries = realloc(trace->entries, sizeof(trace_entry_caloe)*trace->capacity);
+	}
+
+	if (trace->origin < 0)
+		trace->origin = start;
+
+	entry = &trace->entries[trace->nentries++];
+
+	entry->address = access->address + access->offset;
+	entry->value = access->value;
+	entry->mask = access->mask;
+	entry->mode = access->mode;
+	entry->align = access->align;
+	entry->mask_oper = access->mask_oper;
+	entry->is_config = access->is_config;
+	entry->endpoint = trace_endpoint_caloe(trace, &access->networkc);
+	entry->rcode = rcode;
+	entry->start = start - trace->origin;
+	entry->end = end - trace->origin;
+
+	pthread_mutex_unlock(&trace_lock);
+}
+
+void free_trace_caloe(trace_caloe * trace) {
+	if (trace->entries != NULL)
+		free(trace->entries);
+
+	init_trace_caloe(trace);
+}
+
+static void put_le_caloe(uint8_t * buffer, int size, uint64_t value) {
+	int i;
+
+	for (i = 0; i < size; ++i)
+		buffer[i] = (value >> (i*8)) & 0xff;
+}
+
+static uint64_t get_le_caloe(const uint8_t * buffer, int size) {
+	uint64_t value = 0;
+	int i;
+
+	for (i = size-1; i >= 0; --i)
+		value = (value << 8) | buffer[i];
+
+	return value;
+}
+
+static uint32_t clamp_us_caloe(long long us) {
+	if (us < 0)
+		return 0;
+
+	return (us > 0xffffffffLL ? 0xffffffff : (uint32_t) us);
+}
+
+int save_trace_caloe(trace_caloe * trace, const char * path) {
+	uint8_t buffer[TRACE_ENTRY_SIZE];
+	long long previous = 0;
+	FILE * file;
+	int length;
+	int i;
+
+	if ((file = fopen(path, "wb")) == NULL) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Could not open trace file %s \n", path);
+
+		return ERROR_TRACE_FILE;
+	}
+
+	// Header: magic, version, number of endpoints and number of accesses
+	memcpy(buffer, TRACE_MAGIC, 4);
+	put_le_caloe(buffer + 4, 2, TRACE_VERSION);
+	put_le_caloe(buffer + 6, 2, trace->nendpoints);
+	put_le_caloe(buffer + 8, 4, trace->nentries);
+	fwrite(buffer, 1, 12, file);
+
+	for (i = 0; i < trace->nendpoints; ++i) {
+		length = strlen(trace->endpoints[i]);
+		fputc(length, file);
+		fwrite(trace->endpoints[i], 1, length, file);
+	}
+
+	for (i = 0; i < trace->nentries; ++i) {
+		trace_entry_caloe * entry = &trace->entries[i];
+
+		put_le_caloe(buffer, 8, entry->address);
+		put_le_caloe(buffer + 8, 8, entry->value);
+		put_le_caloe(buffer + 16, 8, entry->mask);
+		buffer[24] = entry->mode;
+		buffer[25] = entry->align;
+		buffer[26] = entry->mask_oper;
+		buffer[27] = entry->is_config;
+		put_le_caloe(buffer + 28, 2, (uint16_t) entry->endpoint);
+		put_le_caloe(buffer + 30, 2, (uint16_t) entry->rcode);
+		put_le_caloe(buffer + 32, 4, clamp_us_caloe(entry->start - previous));
+		put_le_caloe(buffer + 36, 4, clamp_us_caloe(entry->end - entry->start));
+
+		previous = entry->start;
+
+		fwrite(buffer, 1, TRACE_ENTRY_SIZE, file);
+	}
+
+	if (fclose(file) != 0) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Could not write trace file %s \n", path);
+
+		return ERROR_TRACE_FILE;
+	}
+
+	return ALL_OK;
+}
+
+static int read_trace_file_caloe(trace_caloe * trace, FILE * file) {
+	uint8_t buffer[TRACE_ENTRY_SIZE];
+	long long start = 0;
+	int nentries;
+	int length;
+	int i;
+
+	if (fread(buffer, 1, 12, file) != 12 || memcmp(buffer, TRACE_MAGIC, 4) != 0 || get_le_caloe(buffer + 4, 2) != TRACE_VERSION)
+		return 1;
+
+	trace->nendpoints = get_le_caloe(buffer + 6, 2);
+	nentries = get_le_caloe(buffer + 8, 4);
+
+	if (trace->nendpoints > TRACE_MAX_ENDPOINTS || nentries < 0)
+		return 1;
+
+	for (i = 0; i < trace->nendpoints; ++i) {
+		if ((length = fgetc(file)) == EOF || length >= SESSION_KEY_LEN || fread(trace->endpoints[i], 1, length, file) != (size_t) length)
+			return 1;
+
+		trace->endpoints[i][length] = '\0';
+	}
+
+	trace->capacity = (nentries > 0 ? nentries : 1);
+	trace->entries = malloc(sizeof(trace_entry_caloe)*trace->capacity);
+
+	for (i = 0; i < nentries; ++i) {
+		trace_entry_caloe * entry = &trace->entries[i];
+
+		if (fread(buffer, 1, TRACE_ENTRY_SIZE, file) != TRACE_ENTRY_SIZE)
+			return 1;
+
+		entry->address = get_le_caloe(buffer, 8);
+		entry->value = get_le_caloe(buffer + 8, 8);
+		entry->mask = get_le_caloe(buffer + 16, 8);
+		entry->mode = buffer[24];
+		entry->align = buffer[25];
+		entry->mask_oper = buffer[26];
+		entry->is_config = buffer[27];
+		entry->endpoint = (int16_t) get_le_caloe(buffer + 28, 2);
+		entry->rcode = (int16_t) get_le_caloe(buffer + 30, 2);
+
+		// Timestamps are stored as gaps between accesses
+		start += get_le_caloe(buffer + 32, 4);
+		entry->start = start;
+		entry->end = start + get_le_caloe(buffer + 36, 4);
+
+		trace->nentries++;
+	}
+
+	trace->origin = (nentries > 0 ? 0 : -1);
+
+	return 0;
+}
+
+int load_trace_caloe(trace_caloe * trace, const char * path) {
+	FILE * file;
+
+	init_trace_caloe(trace);
+
+	if ((file = fopen(path, "rb")) == NULL) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Could not open trace file %s \n", path);
+
+		return ERROR_TRACE_FILE;
+	}
+
+	if (read_trace_file_caloe(trace, file)) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Invalid trace file %s \n", path);
+
+		fclose(file);
+		free_trace_caloe(trace);
+
+		return ERROR_TRACE_FILE;
+	}
+
+	fclose(file);
+
+	return ALL_OK;
+}
+
+int start_capture_caloe(const char * path) {
+	pthread_mutex_lock(&trace_lock);
+
+	if (capturing) {
+		pthread_mutex_unlock(&trace_lock);
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Capture already started \n");
+
+		return INVALID_OPERATION;
+	}
+
+	capture_previous = current_transport;
+	capture_path = strdup(path);
+
+	init_trace_caloe(&capture_trace);
+	init_record_transport_caloe(&capture_transport, selected_transport_caloe(), &capture_trace);
+
+	current_transport = &capture_transport;
+	capturing = 1;
+
+	pthread_mutex_unlock(&trace_lock);
+
+	return ALL_OK;
+}
+
+int stop_capture_caloe(void) {
+	int rcode;
+
+	pthread_mutex_lock(&trace_lock);
+
+	if (!capturing) {
+		pthread_mutex_unlock(&trace_lock);
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Capture not started \n");
+
+		return INVALID_OPERATION;
+	}
+
+	current_transport = capture_previous;
+	capturing = 0;
+
+	rcode = save_trace_caloe(&capture_trace, capture_path);
+
+	free_trace_caloe(&capture_trace);
+	free(capture_path);
+	capture_path = NULL;
+
+	pthread_mutex_unlock(&trace_lock);
+
+	return rcode;
+}
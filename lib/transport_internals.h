@@ -0,0 +1,322 @@
+/**
+ *******************************************************************************
+ * @file transport_internals.h
+ *  @brief Transports: runtime backends that execute accesses (Etherbone, eb-tools, memory, record/replay)
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef TRANSPORT_INTERNALS_CALOE_H
+#define TRANSPORT_INTERNALS_CALOE_H
+
+#include "access_internals.h"
+#include "session_internals.h"
+#include "sim_internals.h"
+
+/// Max number of endpoints of a trace
+#define TRACE_MAX_ENDPOINTS 256
+
+/// Trace file magic number and format version
+#define TRACE_MAGIC "CLTR"
+#define TRACE_VERSION 1
+
+/// Size (bytes) of one access in a trace file
+#define TRACE_ENTRY_SIZE 40
+
+/// Environment variable with the trace file of the capture mode (see start_capture_caloe)
+#define TRACE_ENV "CALOE_TRACE"
+
+/// First and max interval (us) between polls of wait_until_caloe (the interval doubles after each poll)
+#define WAIT_POLL_MIN 20
+#define WAIT_POLL_MAX 10000
+
+/**
+* @brief Backend that executes accesses. Optional functions can be NULL: accesses of a batch or
+* words of a block are then executed one by one with execute.
+*/
+
+typedef struct transport_caloe {
+	const char * name; /**< Transport name */
+	int (*execute)(struct transport_caloe * transport, access_caloe * access); /**< It executes one access */
+	int (*execute_batch)(struct transport_caloe * transport, access_caloe * accesses, int naccess, int * ndone); /**< It executes a list of accesses (optional) */
+	int (*read_block)(struct transport_caloe * transport, access_caloe * access, int stride, int count, eb_data_t * buffer); /**< It executes a block read (optional) */
+	int (*write_block)(struct transport_caloe * transport, access_caloe * access, int stride, int count, const eb_data_t * data, int verify, block_stats_caloe * stats); /**< It executes a block write (optional) */
+	int async; /**< It indicates if the Etherbone event loop can drive the transport (1) or not (0: asynchronous operations run synchronously) */
+	struct transport_caloe * inner; /**< Wrapped transport (record transport) */
+	void * state; /**< Backend state (memory map, trace) */
+} transport_caloe;
+
+/**
+* @brief One access of a trace.
+*/
+
+typedef struct trace_entry_caloe {
+	eb_address_t address; /**< Address (offset included) */
+	eb_data_t value; /**< Written value or returned read value */
+	eb_data_t mask; /**< Mask of the access */
+	uint8_t mode; /**< Access type (access_type_caloe) */
+	uint8_t align; /**< Memory width (align_access_caloe) */
+	uint8_t mask_oper; /**< Mask operation (mask_oper_caloe) */
+	uint8_t is_config; /**< It indicates if it is an Etherbone configuration space access */
+	int16_t endpoint; /**< Index of the endpoint in the trace (-1: unknown) */
+	int16_t rcode; /**< Result of the access */
+	long long start; /**< Start timestamp (us, relative to the first access) */
+	long long end; /**< End timestamp (us, relative to the first access) */
+} trace_entry_caloe;
+
+/**
+* @brief List of accesses recorded by a record transport (and served by a replay transport).
+*/
+
+typedef struct trace_caloe {
+	trace_entry_caloe * entries; /**< Accesses in execution order */
+	int nentries; /**< Number of accesses */
+	int capacity; /**< Allocated accesses */
+	char endpoints[TRACE_MAX_ENDPOINTS][SESSION_KEY_LEN]; /**< Endpoint keys (<tcp|udp>/<ip>/<port>) */
+	int nendpoints; /**< Number of endpoints */
+	long long origin; /**< Timestamp (us) of the first access (-1: empty trace) */
+	int next; /**< Next access served by a replay transport */
+} trace_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Gets the transport used by execute_caloe, execute_batch_caloe and block accesses
+*
+* @return Current transport
+*
+**/
+
+transport_caloe * get_transport_caloe(void);
+
+/**
+*
+* Sets the transport used by execute_caloe, execute_batch_caloe and block accesses. It must be set
+* before accesses are executed (it is not changed while other threads execute accesses).
+*
+* @param transport New transport (NULL: default transport, see EXECUTE_CALOE_MODE)
+*
+**/
+
+void set_transport_caloe(transport_caloe * transport);
+
+/**
+*
+* Executes a list of accesses with a transport (one by one if it has no execute_batch)
+*
+* @param transport Transport
+* @param accesses Accesses to execute
+* @param naccess Number of accesses
+* @param ndone Number of accesses completed (it can be NULL)
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int execute_transport_batch_caloe(transport_caloe * transport, access_caloe * accesses, int naccess, int * ndone);
+
+/**
+*
+* Polls a register until (value & mask) == expected. The register is read right away and then with
+* growing intervals (WAIT_POLL_MIN to WAIT_POLL_MAX), so a slow device does not keep the CPU busy. Polls
+* always reach the device (no shadow cache or read coalescing) through the open session of the endpoint.
+*
+* @param access Register to poll (address, offset, width and endpoint; it returns the last value read)
+* @param mask Bits to compare
+* @param expected Expected value of the bits
+* @param timeout Max waiting time (us, -1: NOT LIMITED)
+* @param cancel Flag that cancels the wait when it is set by another thread (it can be NULL)
+*
+* @return Zero if the condition is met, ERROR_TIMEOUT, ERROR_CANCELLED or error code of the read
+*
+**/
+
+int wait_until_caloe(access_caloe * access, eb_data_t mask, eb_data_t expected, long timeout, volatile int * cancel);
+
+/**
+*
+* Gets the Etherbone transport (session pool, packed cycles, event loop)
+*
+* @return Etherbone transport
+*
+**/
+
+transport_caloe * native_transport_caloe(void);
+
+/**
+*
+* Gets the eb-tools transport (fork/exec of eb-read, eb-write and eb-ls for each access)
+*
+* @return eb-tools transport
+*
+**/
+
+transport_caloe * tools_transport_caloe(void);
+
+/**
+*
+* Initializes a transport that executes accesses on an in-process memory map (no network). Endpoints
+* are ignored: all of them see the same map. It must be used from one thread.
+*
+* @param transport Transport to initialize
+* @param map Memory map (see sim_internals.h)
+*
+**/
+
+void init_memory_transport_caloe(transport_caloe * transport, sim_map_caloe * map);
+
+/**
+*
+* Initializes a transport that executes accesses with another transport and appends them to a trace
+*
+* @param transport Transport to initialize
+* @param inner Transport that executes the accesses
+* @param trace Trace where accesses are recorded
+*
+**/
+
+void init_record_transport_caloe(transport_caloe * transport, transport_caloe * inner, trace_caloe * trace);
+
+/**
+*
+* Appends the accesses of a finished asynchronous operation to the trace of a record transport
+* (the event loop drives Etherbone cycles itself, so they do not go through the transport)
+*
+* @param transport Current transport (nothing is done if it is not a record transport)
+* @param accesses Accesses of the operation
+* @param naccess Number of accesses
+* @param ndone Number of accesses done
+* @param rcode Result of the operation
+* @param start Start timestamp (us, see now_us_caloe)
+*
+**/
+
+void record_async_caloe(transport_caloe * transport, access_caloe * accesses, int naccess, int ndone, int rcode, long long start);
+
+/**
+*
+* Initializes a transport that answers accesses from a trace, in order (no device is used). An access
+* that does not match the next access of the trace fails.
+*
+* @param transport Transport to initialize
+* @param trace Recorded trace
+*
+**/
+
+void init_replay_transport_caloe(transport_caloe * transport, trace_caloe * trace);
+
+/**
+*
+* Initializes an empty trace
+*
+* @param trace Trace to initialize
+*
+**/
+
+void init_trace_caloe(trace_caloe * trace);
+
+/**
+*
+* Appends an executed access to a trace
+*
+* @param trace Trace
+* @param access Executed access
+* @param rcode Result of the access
+* @param start Start timestamp (us, see now_us_caloe)
+* @param end End timestamp (us)
+*
+**/
+
+void add_trace_entry_caloe(trace_caloe * trace, access_caloe * access, int rcode, long long start, long long end);
+
+/**
+*
+* Trace destructor
+*
+* @param trace Trace to destroy
+*
+**/
+
+void free_trace_caloe(trace_caloe * trace);
+
+/**
+*
+* Writes a trace to a binary file. The file has a header (magic, version, number of endpoints and
+* accesses), the endpoint keys and TRACE_ENTRY_SIZE bytes per access (little endian): address, value,
+* mask, mode, width, mask operation, configuration flag, endpoint, result, start gap from the previous
+* access (us) and duration (us).
+*
+* @param trace Trace to write
+* @param path File path
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int save_trace_caloe(trace_caloe * trace, const char * path);
+
+/**
+*
+* Reads a trace from a binary file (see save_trace_caloe)
+*
+* @param trace Trace to fill (it is initialized)
+* @param path File path
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int load_trace_caloe(trace_caloe * trace, const char * path);
+
+/**
+*
+* Starts the capture mode: the current transport is wrapped by a record transport and every access
+* is logged until stop_capture_caloe writes the trace file. If TRACE_ENV is set, the capture starts
+* with the first access and the trace is written when the program exits. Asynchronous operations run
+* synchronously while capturing.
+*
+* @param path Trace file
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int start_capture_caloe(const char * path);
+
+/**
+*
+* Stops the capture mode, restores the previous transport and writes the trace file
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int stop_capture_caloe(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,246 @@
+/**
+ *******************************************************************************
+ * @file watch_internals.c
+ *  @brief Watched files source file
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "watch_internals.h"
+#include "access_internals.h"
+#include "session_internals.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+/// Changes that may replace the contents of a file
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+/** Mark the files of a directory event as changed **/
+
+static void mark_changed_caloe(watch_caloe * watch, const struct inotify_event * ev) {
+	watch_file_caloe * f;
+
+	if(ev->len == 0)
+		return;
+
+	pthread_mutex_lock(&watch->lock);
+
+	for(f = watch->files ; f != NULL ; f = f->next) {
+		if(f->wd == ev->wd && strcmp(f->name,ev->name) == 0)
+			f->changed = 1;
+	}
+
+	pthread_mutex_unlock(&watch->lock);
+}
+
+/** Report the changed files (the callback is called without the lock of the watcher) **/
+
+static void report_changed_caloe(watch_caloe * watch) {
+	watch_file_caloe * f;
+	char * path;
+
+	do {
+		path = NULL;
+
+		pthread_mutex_lock(&watch->lock);
+
+		for(f = watch->files ; f != NULL && path == NULL ; f = f->next) {
+			if(f->changed) {
+				f->changed = 0;
+				path = strdup(f->path);
+			}
+		}
+
+		pthread_mutex_unlock(&watch->lock);
+
+		if(path != NULL) {
+			watch->callback(path,watch->user);
+			free(path);
+		}
+	} while(path != NULL);
+}
+
+static void * watch_thread_caloe(void * arg) {
+	watch_caloe * watch = (watch_caloe *) arg;
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct pollfd fds[2];
+	long long last = 0;
+	int pending = 0;
+	int timeout;
+	ssize_t len;
+	ssize_t i;
+
+	fds[0].fd = watch->fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = watch->wakeup[0];
+	fds[1].events = POLLIN;
+
+	for(;;) {
+		// Changes are reported once the file has been quiet for a while
+		timeout = -1;
+
+		if(pending) {
+			timeout = (int) ((last + watch->settle - now_us_caloe()) / 1000);
+
+			if(timeout <= 0) {
+				pending = 0;
+				report_changed_caloe(watch);
+				continue;
+			}
+		}
+
+		if(poll(fds,2,timeout) < 0)
+			continue;
+
+		if(fds[1].revents != 0)
+			break;
+
+		if(fds[0].revents == 0)
+			continue;
+
+		if((len = read(watch->fd,buffer,sizeof(buffer))) <= 0)
+			continue;
+
+		for(i = 0 ; i < len ; i += sizeof(struct inotify_event) + ((struct inotify_event *) (buffer + i))->len)
+			mark_changed_caloe(watch,(const struct inotify_event *) (buffer + i));
+
+		pending = 1;
+		last = now_us_caloe();
+	}
+
+	return NULL;
+}
+
+int init_watch_caloe(watch_caloe * watch, watch_callback_caloe callback, void * user) {
+	memset(watch,0,sizeof(watch_caloe));
+	pthread_mutex_init(&watch->lock,NULL);
+
+	watch->settle = WATCH_SETTLE_TIME;
+	watch->callback = callback;
+	watch->user = user;
+
+	if((watch->fd = inotify_init()) < 0) {
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Could not initialize inotify\n");
+
+		return ERROR_WATCH_FILE;
+	}
+
+	fcntl(watch->fd,F_SETFD,FD_CLOEXEC);
+
+	if(pipe(watch->wakeup) != 0) {
+		close(watch->fd);
+		return ERROR_WATCH_FILE;
+	}
+
+	if(pthread_create(&watch->thread,NULL,watch_thread_caloe,watch) != 0) {
+		close(watch->fd);
+		close(watch->wakeup[0]);
+		close(watch->wakeup[1]);
+		return ERROR_WATCH_FILE;
+	}
+
+	watch->running = 1;
+
+	return ALL_OK;
+}
+
+int add_watch_caloe(watch_caloe * watch, const char * path) {
+	watch_file_caloe * f;
+	char * slash;
+	char * dir;
+	int wd;
+
+	pthread_mutex_lock(&watch->lock);
+
+	for(f = watch->files ; f != NULL ; f = f->next) {
+		if(strcmp(f->path,path) == 0) {
+			pthread_mutex_unlock(&watch->lock);
+			return ALL_OK;
+		}
+	}
+
+	pthread_mutex_unlock(&watch->lock);
+
+	f = (watch_file_caloe *) calloc(1,sizeof(watch_file_caloe));
+	f->path = strdup(path);
+
+	slash = strrchr(f->path,'/');
+	f->name = (slash != NULL ? slash + 1 : f->path);
+
+	if(slash == NULL)
+		dir = strdup(".");
+	else if(slash == f->path)
+		dir = strdup("/");
+	else
+		dir = strndup(f->path,slash - f->path);
+
+	// The same directory gives the same descriptor to all of its files
+	wd = inotify_add_watch(watch->fd,dir,WATCH_EVENTS);
+
+	free(dir);
+
+	if(wd < 0) {
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Could not watch %s\n", path);
+
+		free(f->path);
+		free(f);
+
+		return ERROR_WATCH_FILE;
+	}
+
+	f->wd = wd;
+
+	pthread_mutex_lock(&watch->lock);
+	f->next = watch->files;
+	watch->files = f;
+	pthread_mutex_unlock(&watch->lock);
+
+	return ALL_OK;
+}
+
+void stop_watch_caloe(watch_caloe * watch) {
+	watch_file_caloe * f;
+	watch_file_caloe * next;
+
+	if(watch->running) {
+		if(write(watch->wakeup[1],"",1) == 1)
+			pthread_join(watch->thread,NULL);
+
+		close(watch->fd);
+		close(watch->wakeup[0]);
+		close(watch->wakeup[1]);
+
+		watch->running = 0;
+	}
+
+	for(f = watch->files ; f != NULL ; f = next) {
+		next = f->next;
+		free(f->path);
+		free(f);
+	}
+
+	watch->files = NULL;
+}
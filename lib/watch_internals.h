@@ -0,0 +1,120 @@
+/**
+ *******************************************************************************
+ * @file watch_internals.h
+ *  @brief Watched files: a background thread waits for changes of files (inotify) and reports them
+ *  once they have settled
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef WATCH_INTERNALS_CALOE_H
+#define WATCH_INTERNALS_CALOE_H
+
+#include <pthread.h>
+
+/// Quiet time (us) after the last change of a file before it is reported (editors write in several steps)
+#define WATCH_SETTLE_TIME 100000
+
+/**
+* @brief Callback of a changed file. It is called from the thread of the watcher.
+*
+* @param path Path of the file (as it was given to add_watch_caloe)
+* @param user User data given on init
+*/
+
+typedef void (*watch_callback_caloe)(const char * path, void * user);
+
+/**
+* @brief Watched file. The directory of the file is watched, so files replaced by a rename (as most
+* editors save them) are still followed.
+*/
+
+typedef struct watch_file_caloe {
+	char * path; /**< Path of the file */
+	const char * name; /**< Name of the file (it points into path) */
+	int wd; /**< Watch descriptor of the directory */
+	int changed; /**< It indicates if the file has changed and it has not been reported yet (1) or not (0) */
+	struct watch_file_caloe * next; /**< Next watched file */
+} watch_file_caloe;
+
+/**
+* @brief Watcher: an inotify descriptor and the thread that reads it
+*/
+
+typedef struct watch_caloe {
+	int fd; /**< Inotify descriptor */
+	int wakeup[2]; /**< Pipe that wakes up the thread to stop it */
+	pthread_t thread; /**< Thread of the watcher */
+	int running; /**< It indicates if the thread is running (1) or not (0) */
+	pthread_mutex_t lock; /**< It protects the list of files */
+	watch_file_caloe * files; /**< Watched files */
+	long settle; /**< Quiet time (us) before a change is reported */
+	watch_callback_caloe callback; /**< Callback of changed files */
+	void * user; /**< User data of the callback */
+} watch_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Initializes a watcher without files and starts its thread
+*
+* @param watch Watcher
+* @param callback Callback of changed files
+* @param user User data of the callback
+*
+* @return ALL_OK or ERROR_WATCH_FILE if inotify or the thread are not available
+*
+**/
+
+int init_watch_caloe(watch_caloe * watch, watch_callback_caloe callback, void * user);
+
+/**
+*
+* Adds a file to a watcher (a file already watched is not added again)
+*
+* @param watch Watcher
+* @param path Path of the file (its directory must exist)
+*
+* @return ALL_OK or ERROR_WATCH_FILE if the directory cannot be watched
+*
+**/
+
+int add_watch_caloe(watch_caloe * watch, const char * path);
+
+/**
+*
+* Stops the thread of a watcher and frees its files. Changes not reported yet are dropped.
+*
+* @param watch Watcher
+*
+**/
+
+void stop_watch_caloe(watch_caloe * watch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
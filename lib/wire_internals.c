@@ -0,0 +1,302 @@
+/**
+ *******************************************************************************
+ * @file wire_internals.c
+ *  @brief Implements the wire layout of accesses
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "wire_internals.h"
+
+// The code of this function is based on eb-read/eb-write tools code (its comments has also been included)
+// Please, see http://www.ohwr.org/projects/etherbone-core if you want to get more information
+
+int plan_access_caloe(session_caloe * session, access_caloe * access, wire_access_caloe * plan) {
+	eb_format_t endian;
+	eb_width_t line_width;
+	eb_format_t line_widths;
+	eb_format_t device_support;
+	eb_format_t sizes;
+	eb_format_t format;
+	eb_format_t size;
+	uint32_t bus_specific;
+	int rcode;
+
+	eb_address_t address = access->address + access->offset;
+
+	size = EB_DATAX;
+
+	switch(access->align) {
+		case SIZE_1B: size = 1;
+		break;
+
+		case SIZE_2B: size = 2;
+		break;
+
+		case SIZE_4B: size = 4;
+		break;
+
+		case SIZE_8B: size = 8;
+		break;
+	}
+
+	/* How big can the data be? */
+	plan->mask = ~(eb_data_t)0;
+	plan->mask >>= (sizeof(eb_data_t)-size)*8;
+
+	line_width = session->line_width;
+
+	// Endian and width come from the SDB cache of the session
+	if ((rcode = lookup_sdb_cache_caloe(session->device, &session->sdb, address, &bus_specific)) != ALL_OK)
+		return rcode;
+
+	if ((bus_specific & SDB_WISHBONE_LITTLE_ENDIAN) != 0)
+		device_support = EB_LITTLE_ENDIAN;
+	else
+		device_support = EB_BIG_ENDIAN;
+
+	device_support |= bus_specific & EB_DATAX;
+
+	/* Select the probed endian. May still be 0 if device not found. */
+	endian = device_support & EB_ENDIAN_MASK;
+
+	/* Final operation endian has been chosen. If 0 the access had better be a full data width access! */
+	format = endian;
+
+	/* We need to pick the operation width we use.
+	* It must be supported both by the device and the line.
+	*/
+	line_widths = ((line_width & EB_DATAX) << 1) - 1; /* Link can support any access smaller than line_width */
+	sizes = line_widths & device_support;
+
+	/* We cannot work with a device that requires larger access than we support */
+	if (sizes == 0) {
+
+		if(VERBOSE_CALOE)
+			fprintf(stderr, "ERROR: Device could not access with size requested \n");
+
+		return ERROR_SIZE_NOT_SUPPORTED;
+	}
+
+	plan->address = address;
+	plan->count = 1;
+	plan->stride = 0;
+	plan->shift = 0;
+	plan->widen = 0;
+
+	/* Can the operation be performed with fidelity? */
+	if ((size & sizes) == 0) {
+		eb_format_t fragment_sizes;
+		eb_format_t fragment_size;
+		eb_format_t complete_size;
+		eb_address_t aligned_address;
+
+		/* What will we do? Prefer to fragment if possible; reading is evil. */
+
+		/* Fragmented access is possible if there is a bit in sizes smaller than a bit in size */
+		fragment_sizes = size;
+		fragment_sizes |= fragment_sizes >> 1;
+		fragment_sizes |= fragment_sizes >> 2; /* Filled in all sizes under max */
+
+		if ((fragment_sizes & sizes) != 0) {
+			int chunk;
+
+			/* We can do a fragmented access. Pick largest access possible. */
+			complete_size = fragment_sizes ^ (fragment_sizes >> 1); /* This many bytes to access */
+			/* (the above code sets complete_size = size, but works also if size were a mask) */
+
+			/* Filter out only those which have a good size */
+			fragment_sizes &= sizes;
+			/* Then pick the largest bit */
+			fragment_sizes |= fragment_sizes >> 1;
+			fragment_sizes |= fragment_sizes >> 2;
+			fragment_size = fragment_sizes ^ (fragment_sizes >> 1);
+
+			/* We access fragments */
+			format |= fragment_size;
+
+			/* Each operation accesses this many bytes */
+			chunk = format & EB_DATAX;
+			plan->count = complete_size / chunk;
+
+			/* Access the high bits first */
+			switch (format & EB_ENDIAN_MASK) {
+				case EB_BIG_ENDIAN:
+					plan->stride = chunk;
+				break;
+				case EB_LITTLE_ENDIAN:
+					plan->address += chunk*(plan->count-1);
+					plan->stride = -chunk;
+				break;
+				default:
+					if(VERBOSE_CALOE)
+						fprintf(stderr, "ERROR: Must know ENDIAN to fragment access \n");
+					return ERROR_UNKNOWN_ENDIAN;
+			}
+		} else {
+			/* All bits in sizes are larger than all bits in size */
+			/* We will need to do a larger operation than the access requested. */
+
+			/* Pick the largest sized access possible. */
+			fragment_size = fragment_sizes ^ (fragment_sizes >> 1);
+			/* (the above code sets fragment_size = size, but works also if size were a mask) */
+
+			/* Now pick the smallest bit in sizes. */
+			complete_size = sizes & -sizes;
+
+			/* We have our final operation format. */
+			format |= complete_size;
+
+			/* Align the address */
+			aligned_address = address & ~(eb_address_t)(complete_size-1);
+
+			/* How far do we need to shift the offset? */
+			switch (format & EB_ENDIAN_MASK) {
+				case EB_BIG_ENDIAN:
+					plan->shift = (complete_size-fragment_size) - (address - aligned_address);
+				break;
+				case EB_LITTLE_ENDIAN:
+					plan->shift = (address - aligned_address);
+				break;
+				default:
+					if(VERBOSE_CALOE)
+						fprintf(stderr, "ERROR: Must know ENDIAN to fill partial access \n");
+					return ERROR_UNKNOWN_ENDIAN;
+			}
+
+			plan->address = aligned_address;
+			plan->widen = 1;
+		}
+	} else {
+		/* There is a size requested that the device and link supports */
+		format |= (size & sizes);
+
+		/* If the access it full width, an endian is needed. Print a friendlier message than EB_ADDRESS. */
+		if ((format & line_width & EB_DATAX) == 0 && (format & EB_ENDIAN_MASK) == 0) {
+
+			if(VERBOSE_CALOE)
+				fprintf(stderr, "ERROR: ENDIAN is required \n");
+
+			return ERROR_UNKNOWN_ENDIAN;
+		}
+	}
+
+	plan->format = format;
+
+	return ALL_OK;
+}
+
+void queue_read_caloe(eb_cycle_t cycle, access_caloe * access, wire_access_caloe * plan) {
+	eb_address_t address = plan->address;
+	int i;
+
+	for (i = 0; i < plan->count; ++i) {
+
+		if (access->is_config)
+			eb_cycle_read_config(cycle, address, plan->format, 0);
+		else
+			eb_cycle_read(cycle, address, plan->format, 0);
+
+		address += plan->stride;
+	}
+}
+
+void queue_write_caloe(eb_cycle_t cycle, access_caloe * access, wire_access_caloe * plan, eb_data_t data) {
+	eb_address_t address = plan->address;
+	int chunk = plan->format & EB_DATAX;
+	eb_data_t data_mask, partial_data;
+	int i;
+
+	data_mask = ~(eb_data_t)0;
+	data_mask >>= (sizeof(eb_data_t)-chunk)*8;
+
+	/* Fragments are issued in the same order as reads: high bits first */
+	for (i = plan->count-1; i >= 0; --i) {
+		partial_data = (data >> (i*chunk*8)) & data_mask;
+
+		if (access->is_config)
+			eb_cycle_write_config(cycle, address, plan->format, partial_data);
+		else
+			eb_cycle_write(cycle, address, plan->format, partial_data);
+
+		address += plan->stride;
+	}
+}
+
+int align_bytes_caloe(align_access_caloe align) {
+	switch(align) {
+		case SIZE_1B: return 1;
+		case SIZE_2B: return 2;
+		case SIZE_8B: return 8;
+		default: return 4;
+	}
+}
+
+eb_data_t apply_mask_caloe(access_caloe * access, eb_data_t data) {
+	if(access->mask_oper == MASK_OR)
+		return access->mask | data;
+	else
+		return access->mask & data;
+}
+
+eb_operation_t gather_data_caloe(eb_operation_t op, int count, eb_data_t * value) {
+	int chunk;
+	int i;
+
+	*value = 0;
+
+	for (i = 0; i < count && op != EB_NULL; ++i, op = eb_operation_next(op)) {
+
+		if (eb_operation_had_error(op)) {
+
+			if(VERBOSE_CALOE)
+				fprintf(stderr, "ERROR: wishbone segfault %s %s %s bits to address 0x%"EB_ADDR_FMT"\n",
+					eb_operation_is_read(op)?"reading":"writing",
+					eb_width_data(eb_operation_format(op)),
+					eb_format_endian(eb_operation_format(op)),
+					eb_operation_address(op));
+		}
+
+		chunk = eb_operation_format(op) & EB_DATAX;
+		*value = (chunk == sizeof(eb_data_t) ? 0 : *value << chunk*8);
+		*value |= eb_operation_data(op);
+	}
+
+	return op;
+}
+
+void collect_cycle_caloe(eb_operation_t op, access_caloe * accesses, wire_access_caloe * plans, int naccess) {
+	eb_data_t value;
+	int i;
+
+	// Operations come back in the same order they were queued
+	for (i = 0; i < naccess; ++i) {
+		op = gather_data_caloe(op, plans[i].count, &value);
+
+		if (accesses[i].mode == READ) {
+			value >>= plans[i].shift*8;
+			value &= plans[i].mask;
+
+			accesses[i].value = apply_mask_caloe(&accesses[i], value);
+		}
+	}
+}
@@ -0,0 +1,147 @@
+/**
+ *******************************************************************************
+ * @file wire_internals.h
+ *  @brief Wire layout of accesses: format negotiation, fragmentation and cycle queueing
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#ifndef WIRE_INTERNALS_CALOE_H
+#define WIRE_INTERNALS_CALOE_H
+
+#include "access_internals.h"
+#include "session_internals.h"
+
+/**
+* @brief Wire-level layout of one access inside an Etherbone cycle (format negotiated with the device).
+*/
+
+typedef struct wire_access_caloe {
+	eb_address_t address; /**< Address of the first wire operation */
+	eb_format_t format; /**< Wire format (endian and width) */
+	int count; /**< Number of wire operations (more than one if the access is fragmented) */
+	int stride; /**< Address step between wire operations */
+	int shift; /**< Byte shift of the requested data inside the wire data */
+	eb_data_t mask; /**< Mask of the requested data width */
+	int widen; /**< It indicates if the wire operation is wider than the access (1) or not (0) */
+} wire_access_caloe;
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/**
+*
+* Computes the wire layout of an access (endian and width come from the SDB cache of the session)
+*
+* @param session Open session of the access endpoint
+* @param access Access to plan
+* @param plan Returned wire layout
+*
+* @return Error code if error or zero otherwise
+*
+**/
+
+int plan_access_caloe(session_caloe * session, access_caloe * access, wire_access_caloe * plan);
+
+/**
+*
+* Queues the wire reads of an access into an open cycle
+*
+* @param cycle Open Etherbone cycle
+* @param access Access to read
+* @param plan Wire layout of the access
+*
+**/
+
+void queue_read_caloe(eb_cycle_t cycle, access_caloe * access, wire_access_caloe * plan);
+
+/**
+*
+* Queues the wire writes of an access into an open cycle
+*
+* @param cycle Open Etherbone cycle
+* @param access Access to write
+* @param plan Wire layout of the access
+* @param data Data to write (wire width, already masked)
+*
+**/
+
+void queue_write_caloe(eb_cycle_t cycle, access_caloe * access, wire_access_caloe * plan, eb_data_t data);
+
+/**
+*
+* Gets the size in bytes of an access alignment
+*
+* @param align Access alignment
+*
+* @return Size in bytes
+*
+**/
+
+int align_bytes_caloe(align_access_caloe align);
+
+/**
+*
+* Applies the mask of an access (OR/AND) to a value
+*
+* @param access Access with the mask
+* @param data Value
+*
+* @return Masked value
+*
+**/
+
+eb_data_t apply_mask_caloe(access_caloe * access, eb_data_t data);
+
+/**
+*
+* Joins the data of the wire operations of one access (high bits first)
+*
+* @param op First wire operation of the access
+* @param count Number of wire operations of the access
+* @param value Returned data
+*
+* @return First wire operation of the next access
+*
+**/
+
+eb_operation_t gather_data_caloe(eb_operation_t op, int count, eb_data_t * value);
+
+/**
+*
+* Stores the read values of a finished cycle into its accesses (shift and mask are applied)
+*
+* @param op First wire operation of the cycle
+* @param accesses Accesses queued in the cycle
+* @param plans Wire layout of each access
+* @param naccess Number of accesses
+*
+**/
+
+void collect_cycle_caloe(eb_operation_t op, access_caloe * accesses, wire_access_caloe * plans, int naccess);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,522 @@
+/**
+ ******************************************************************************* 
+ * @file cfgc_spec.cpp
+ *  @brief Compiles configuration files (dio.cfg, vuart.cfg...) into binary files that are mapped
+ *  in memory at startup instead of being parsed, or into C++ headers with the operation tables
+ *  built into the program
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "../lib/OperationTable.h"
+
+#include <unistd.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <map>
+
+using namespace std;
+using namespace caloe;
+
+static void print_help() {
+	cout << endl;
+	cout << "Command: cfgc_spec.run <options> <file.cfg>..." << endl << endl;
+	cout << "Each file is compiled into <file.cfg>" << CFG_CACHE_SUFFIX << " (the library uses it while the source file does not change)." << endl << endl;
+	cout << "-o <file.cfgc>: Output file (only with one configuration file)." << endl;
+	cout << "-l: List the operations of the compiled files." << endl;
+	cout << "-g <file.h>: Generate a C++ header with the operation tables instead (only with one configuration file)." << endl;
+	cout << "-n <namespace>: Namespace of the generated header (default: name of the header)." << endl;
+	cout << "-L <dir>: Directory of the library used by the includes of the generated header (default: ../../lib)." << endl;
+	cout << "-h: Show this help." << endl << endl;
+}
+
+/** Turn a name into a C++ identifier **/
+
+static string identifier(const string & name) {
+	string id;
+
+	for(unsigned int i = 0 ; i < name.size() ; i++)
+		id += (isalnum((unsigned char) name[i]) ? name[i] : '_');
+
+	if(id.empty() || isdigit((unsigned char) id[0]))
+		id = "_" + id;
+
+	return id;
+}
+
+static string upper(const string & name) {
+	string s = name;
+
+	for(unsigned int i = 0 ; i < s.size() ; i++)
+		s[i] = toupper((unsigned char) s[i]);
+
+	return s;
+}
+
+/** Escape a string of the string pool as a C literal (octal escapes always take three digits) **/
+
+static string literal(const char * s) {
+	string lit = "\"";
+	char oct[8];
+
+	for( ; *s != '\0' ; s++) {
+		if(*s == '"' || *s == '\\') {
+			lit += '\\';
+			lit += *s;
+		}
+		else if(isprint((unsigned char) *s)) {
+			lit += *s;
+		}
+		else {
+			snprintf(oct,sizeof(oct),"\\%03o",(unsigned char) *s);
+			lit += oct;
+		}
+	}
+
+	return lit + "\\0\"";
+}
+
+static string hex64(uint64_t value) {
+	char buf[32];
+
+	snprintf(buf,sizeof(buf),"0x%llxull",(unsigned long long) value);
+
+	return buf;
+}
+
+static string number(uint64_t value) {
+	ostringstream os;
+
+	os << value;
+
+	return os.str();
+}
+
+/** Enumerator names of an access mode and width, as used by the generated accesses **/
+
+static const char * mode_name(int mode) {
+	static const char * names[] = { "READ", "WRITE", "SCAN", "READ_WRITE" };
+
+	return names[mode];
+}
+
+static const char * align_name(int align) {
+	static const char * names[] = { "SIZE_1B", "SIZE_2B", "SIZE_4B", "SIZE_8B" };
+
+	return names[align];
+}
+
+/** Generate a header with the compiled image of a configuration file as static tables **/
+
+static bool generate_header(const string & path, const string & header, const string & ns, const string & libdir) {
+	string compiled;
+	vector<uint64_t> buffer;
+	const cfg_cache_header_caloe * h;
+	const cfg_cache_operation_caloe * ops;
+	const cfg_cache_access_caloe * acc;
+	const int32_t * slots;
+	const int32_t * values;
+	const char * strings;
+	string guard = upper(identifier(header));
+	string base = header.substr(header.find_last_of('/') + 1);
+	ofstream out;
+
+	if(!OperationTable::compileImage(path,compiled))
+		return false;
+
+	// Sections are read in place from an aligned copy of the image
+	buffer.resize((compiled.size() + 7) / 8);
+	memcpy(&buffer[0],compiled.data(),compiled.size());
+
+	h = (const cfg_cache_header_caloe *) &buffer[0];
+	ops = (const cfg_cache_operation_caloe *) ((const char *) h + h->operations);
+	acc = (const cfg_cache_access_caloe *) ((const char *) h + h->accesses);
+	slots = (const int32_t *) ((const char *) h + h->slots);
+	values = (const int32_t *) ((const char *) h + h->values);
+	strings = (const char *) h + h->strings;
+
+	out.open(header.c_str(), ofstream::out | ofstream::trunc);
+
+	if(!out.good()) {
+		cout << "ERROR: Could not write header " << header << endl;
+		return false;
+	}
+
+	out << "/**" << endl;
+	out << " *******************************************************************************" << endl;
+	out << " * @file " << base << endl;
+	out << " *  @brief Operations of " << path << " built into the program (generated by cfgc_spec.run, do not edit)" << endl;
+	out << " *" << endl;
+	out << " *  The tables have the layout of a compiled configuration file (see cfgcache_internals.h). They are" << endl;
+	out << " *  constant data: loading a device reads and parses nothing. Operations whose accesses have constant" << endl;
+	out << " *  addresses and widths (no AUTO, BLOCK or SCAN) get wrappers that build their accesses on the stack" << endl;
+	out << " *  and run them with Operation::executeAccesses, without a device; the rest run through a Device" << endl;
+	out << " *  loaded with load. Regenerate this file with:" << endl;
+	out << " *" << endl;
+	out << " *    cfgc_spec.run -g " << base << " -n " << ns << " " << path << endl;
+	out << " *******************************************************************************" << endl;
+	out << " */" << endl << endl;
+
+	out << "#ifndef " << guard << endl;
+	out << "#define " << guard << endl << endl;
+	out << "#include \"" << libdir << "/Device.h\"" << endl;
+	out << "#include \"" << libdir << "/endpoint_internals.h\"" << endl << endl;
+	out << "using namespace caloe;" << endl << endl;
+	out << "namespace " << ns << " {" << endl << endl;
+
+	out << "/// Operation indices (valid in a device loaded only with load)" << endl;
+	out << "enum operation_index {" << endl;
+
+	for(uint32_t i = 0 ; i < h->noperations ; i++)
+		out << "\tOP_" << upper(identifier(strings + ops[i].name)) << " = " << i << "," << endl;
+
+	out << "\tOPERATIONS = " << h->noperations << endl;
+	out << "};" << endl << endl;
+
+	out << "/// Accesses: address_init, address, offset, value, mask, autoincr, block, ip, port, offsets, noffsets," << endl;
+	out << "/// masks, nmasks, mode, align, mask_oper, parameters, flags" << endl;
+	out << "static const cfg_cache_access_caloe accesses[] = {" << endl;
+
+	for(uint32_t i = 0 ; i < h->noperations ; i++) {
+		out << "\t/* " << strings + ops[i].name << " */" << endl;
+
+		for(uint32_t j = ops[i].first ; j < ops[i].first + ops[i].naccesses ; j++) {
+			const cfg_cache_access_caloe & a = acc[j];
+
+			out << "\t{ " << hex64(a.address_init) << ", " << hex64(a.address) << ", " << hex64(a.offset) << ", "
+				<< hex64(a.value) << ", " << hex64(a.mask) << ", " << a.autoincr << ", " << a.block << ", "
+				<< a.ip << "u, " << a.port << "u, " << a.offsets << "u, " << a.noffsets << "u, " << a.masks << "u, "
+				<< a.nmasks << "u, " << (int) a.mode << ", " << (int) a.align << ", " << (int) a.mask_oper << ", "
+				<< (int) a.parameters << ", " << (int) a.flags << ", { 0, 0, 0 } }," << endl;
+		}
+	}
+
+	if(h->naccesses == 0)
+		out << "\t{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, { 0, 0, 0 } }" << endl;
+
+	out << "};" << endl << endl;
+
+	out << "/// Operations: name, doc, hash, first, naccesses" << endl;
+	out << "static const cfg_cache_operation_caloe operations[] = {" << endl;
+
+	for(uint32_t i = 0 ; i < h->noperations ; i++) {
+		out << "\t{ " << ops[i].name << "u, " << ops[i].doc << "u, " << hex << "0x" << ops[i].hash << dec << "u, "
+			<< ops[i].first << "u, " << ops[i].naccesses << "u }," << endl;
+	}
+
+	if(h->noperations == 0)
+		out << "\t{ 0, 0, 0, 0, 0 }" << endl;
+
+	out << "};" << endl << endl;
+
+	out << "/// Name index (operation index or -1)" << endl;
+	out << "static const int32_t slots[] = {";
+
+	for(uint32_t i = 0 ; i < h->nslots ; i++)
+		out << (i % 16 == 0 ? "\n\t" : " ") << slots[i] << (i + 1 < h->nslots ? "," : "");
+
+	out << endl << "};" << endl << endl;
+
+	out << "/// Offsets and masks of the accesses" << endl;
+	out << "static const int32_t values[] = {";
+
+	for(uint32_t i = 0 ; i < h->nvalues ; i++)
+		out << (i % 8 == 0 ? "\n\t" : " ") << values[i] << (i + 1 < h->nvalues ? "," : "");
+
+	if(h->nvalues == 0)
+		out << "\n\t0";
+
+	out << endl << "};" << endl << endl;
+
+	out << "/// String pool" << endl;
+	out << "static const char strings[] =" << endl;
+
+	for(uint32_t i = 0 ; i < h->strings_size ; i += strlen(strings + i) + 1)
+		out << "\t" << literal(strings + i) << endl;
+
+	out << "\t;" << endl << endl;
+
+	out << "static const cfg_cache_header_caloe header = {" << endl;
+	out << "\t{ 'C', 'A', 'L', 'O', 'E', 'C', 'F', 'G' }, CFG_CACHE_VERSION, CFG_CACHE_ENDIAN, "
+		<< hex64(h->source_hash) << ", " << h->source_size << "ull," << endl;
+	out << "\t0, " << h->noperations << ", " << h->naccesses << ", " << h->nslots << ", " << h->nvalues << ", "
+		<< h->strings_size << ", 0, 0, 0, 0, 0, 0" << endl;
+	out << "};" << endl << endl;
+
+	out << "static const cfg_cache_caloe image = {" << endl;
+	out << "\t(void *) &header, 0, &header, operations, accesses, slots, values, strings" << endl;
+	out << "};" << endl << endl;
+
+	out << "/** @brief Load the operations of " << base << " into a device (nothing is read or parsed)" << endl;
+	out << " *" << endl;
+	out << " * @param dev Device" << endl;
+	out << " *" << endl;
+	out << " * @param name Device name" << endl;
+	out << " */" << endl << endl;
+	out << "static inline void load(Device & dev, const string & name) {" << endl;
+	out << "\tdev.loadImage(&image,name);" << endl;
+	out << "}" << endl << endl;
+
+	out << "/** @brief Result of a wrapper called with an offset or mask index out of range **/" << endl << endl;
+	out << "static inline OperationResult invalid_index(int access) {" << endl;
+	out << "\tOperationResult res;" << endl << endl;
+	out << "\tres.rcode = INVALID_OPERATION;" << endl;
+	out << "\tres.failed_access = access;" << endl;
+	out << "\tres.retries = 0;" << endl;
+	out << "\tres.elapsed = 0;" << endl << endl;
+	out << "\treturn res;" << endl;
+	out << "}" << endl;
+
+	// Typed wrappers: one argument per needed parameter. Operations whose accesses are the same on every
+	// execution are emitted as constant accesses run directly; the rest run by index on a loaded device.
+	for(uint32_t i = 0 ; i < h->noperations ; i++) {
+		string name = strings + ops[i].name;
+		string function = identifier(name);
+		ostringstream args;
+		ostringstream docs;
+		ostringstream body;
+		ostringstream endpoints;
+		ostringstream checks;
+		ostringstream batch;
+		map<string,string> endpoint_names;
+		bool direct = (ops[i].naccesses > 0);
+		int ip = 0;
+		int port = 0;
+
+		if(function == "load")
+			function = "op_load";
+
+		for(uint32_t j = 0 ; j < ops[i].naccesses ; j++) {
+			const cfg_cache_access_caloe & a = acc[ops[i].first + j];
+
+			ip |= (a.parameters & PARAM_NETADDRESS);
+			port |= (a.parameters & PARAM_PORT);
+
+			// Autoincrement changes the address after each execution, blocks and scans need an Operation
+			if(a.autoincr != 0 || a.block > 1 || a.mode == SCAN)
+				direct = false;
+		}
+
+		if(ip) {
+			args << ", const string & ip";
+			docs << " * @param ip IP netaddress" << endl << " *" << endl;
+		}
+
+		if(port) {
+			args << ", unsigned int port";
+			docs << " * @param port Port" << endl << " *" << endl;
+		}
+
+		for(uint32_t j = 0 ; j < ops[i].naccesses ; j++) {
+			const cfg_cache_access_caloe & a = acc[ops[i].first + j];
+			ostringstream key;
+			string offset = hex64(a.offset);
+			string mask = hex64(a.mask);
+			string value = hex64(a.value);
+
+			body << endl << "\tp.reset();" << endl;
+
+			if(a.parameters & PARAM_NETADDRESS)
+				body << "\tp.setIP(ip);" << endl;
+
+			if(a.parameters & PARAM_PORT)
+				body << "\tp.setPort(port);" << endl;
+
+			if(a.parameters & PARAM_OFFSET) {
+				args << ", unsigned int offset" << j;
+				docs << " * @param offset" << j << " Offset of access " << j << " (index of {";
+				for(uint32_t k = 0 ; k < a.noffsets ; k++)
+					docs << (k ? "," : "") << hex << values[a.offsets + k] << dec;
+				docs << "})" << endl << " *" << endl;
+				body << "\tp.setOffset(offset" << j << ");" << endl;
+				checks << "\tif(offset" << j << " >= " << a.noffsets << "u)" << endl << "\t\treturn invalid_index(" << j << ");" << endl << endl;
+				offset = "(eb_address_t) values[" + number(a.offsets) + " + offset" + number(j) + "]";
+			}
+
+			if(a.parameters & PARAM_MASK) {
+				args << ", unsigned int mask" << j;
+				docs << " * @param mask" << j << " Mask of access " << j << " (index of {";
+				for(uint32_t k = 0 ; k < a.nmasks ; k++)
+					docs << (k ? "," : "") << hex << values[a.masks + k] << dec;
+				docs << "})" << endl << " *" << endl;
+				body << "\tp.setMask(mask" << j << ");" << endl;
+				checks << "\tif(mask" << j << " >= " << a.nmasks << "u)" << endl << "\t\treturn invalid_index(" << j << ");" << endl << endl;
+				mask = "(eb_data_t) values[" + number(a.masks) + " + mask" + number(j) + "]";
+			}
+
+			if(a.parameters & PARAM_VALUE) {
+				args << ", " << (direct ? "eb_data_t" : "int") << " value" << j;
+				docs << " * @param value" << j << " Value of access " << j << endl << " *" << endl;
+				body << "\tp.setValue(value" << j << ");" << endl;
+				value = "value" + number(j);
+			}
+
+			body << "\tparams.addParameter(p);" << endl;
+
+			// Endpoint of the access: a constant one is registered once
+			key << ((a.parameters & PARAM_NETADDRESS) ? "ip.c_str()" : literal(strings + a.ip)) << ","
+				<< ((a.parameters & PARAM_PORT) ? string("port") : number(a.port) + "u");
+
+			if(endpoint_names.find(key.str()) == endpoint_names.end()) {
+				string var = "endpoint" + number(endpoint_names.size());
+				bool fixed = !(a.parameters & (PARAM_NETADDRESS | PARAM_PORT));
+
+				endpoint_names[key.str()] = var;
+				endpoints << "\t" << (fixed ? "static const int " : "int ") << var << " = register_endpoint_caloe(" << key.str() << ");" << endl;
+			}
+
+			batch << "\t\t{ " << hex64(a.address) << ", " << offset << ", " << value << ", " << mask << ", "
+				<< (a.mask_oper == MASK_OR ? "MASK_OR" : "MASK_AND") << ", " << ((a.flags & CFG_ACCESS_CONFIG) ? 1 : 0) << ", "
+				<< mode_name(a.mode) << ", " << align_name(a.align) << ", " << ((a.flags & CFG_ACCESS_CACHEABLE) ? 1 : 0) << ", "
+				<< ((a.flags & CFG_ACCESS_SIDE_EFFECTS) ? 1 : 0) << ", { " << endpoint_names[key.str()] << " } }," << endl;
+		}
+
+		out << endl << "/** @brief " << (*(strings + ops[i].doc) != '\0' ? strings + ops[i].doc : name.c_str()) << endl;
+		out << " *" << endl;
+
+		if(direct) {
+			// Arguments without the leading comma, the policy goes last
+			string list = args.str();
+
+			list = (list.empty() ? "" : list.substr(2) + ", ") + "const RetryPolicy & policy = RetryPolicy()";
+
+			out << " *  Its accesses are constant (addresses, masks, widths): they run directly, without a device." << endl;
+			out << " *" << endl;
+			out << docs.str();
+			out << " * @param policy Retry policy" << endl;
+			out << " *" << endl;
+			out << " * @return Read values and error code" << endl;
+			out << " */" << endl << endl;
+			out << "static inline OperationResult " << function << "(" << list << ") {" << endl;
+			out << endpoints.str() << endl;
+			out << checks.str();
+			out << "\taccess_caloe batch[] = {" << endl;
+			out << batch.str();
+			out << "\t};" << endl << endl;
+			out << "\treturn Operation::executeAccesses(batch," << ops[i].naccesses << ",policy);" << endl;
+			out << "}" << endl;
+		}
+		else {
+			out << " * @param dev Device loaded with load" << endl;
+			out << " *" << endl;
+			out << docs.str();
+			out << " * @return Read values" << endl;
+			out << " */" << endl << endl;
+			out << "static inline vector<eb_data_t> " << function << "(Device & dev" << args.str() << ") {" << endl;
+			out << "\tOperationHandle handle = { -1, OP_" << upper(identifier(name)) << " };" << endl;
+			out << "\tParamOperation params;" << endl;
+			out << "\tParamAccess p;" << endl;
+			out << body.str() << endl;
+			out << "\treturn dev.execute(handle,params);" << endl;
+			out << "}" << endl;
+		}
+	}
+
+	out << endl << "}" << endl << endl;
+	out << "#endif" << endl;
+
+	out.close();
+
+	return out.good();
+}
+
+int main(int argc, char ** argv)
+{
+	string output;
+	string header;
+	string ns;
+	string libdir = "../../lib";
+	bool list = false;
+	int errors = 0;
+	int opt;
+
+	while((opt = getopt(argc, argv, "o:lg:n:L:h")) != -1) {
+		switch(opt) {
+			case 'o': output = optarg;
+			break;
+			case 'l': list = true;
+			break;
+			case 'g': header = optarg;
+			break;
+			case 'n': ns = optarg;
+			break;
+			case 'L': libdir = optarg;
+			break;
+			default:
+				print_help();
+				return (opt == 'h' ? 0 : -1);
+		}
+	}
+
+	if(optind >= argc || ((!output.empty() || !header.empty()) && argc - optind > 1)) {
+		print_help();
+		return -1;
+	}
+
+	if(!header.empty()) {
+		if(ns.empty())
+			ns = identifier(header.substr(header.find_last_of('/') + 1, header.find_last_of('.') - header.find_last_of('/') - 1));
+
+		if(!generate_header(argv[optind],header,ns,libdir)) {
+			cout << "ERROR: " << argv[optind] << " not generated" << endl;
+			return -1;
+		}
+
+		cout << argv[optind] << ": operations generated into " << header << " (namespace " << ns << ")" << endl;
+
+		return 0;
+	}
+
+	// The library recognizes compiled files by their suffix
+	if(!output.empty() && OperationTable::compiledPath(output) != output) {
+		cout << "ERROR: Output file " << output << " must end with .cfg" << CFG_CACHE_SUFFIX << endl;
+		return -1;
+	}
+
+	for(int i = optind ; i < argc ; i++) {
+		string path = argv[i];
+		string compiled = (output.empty() ? OperationTable::compiledPath(path) : output);
+
+		if(!OperationTable::compile(path,compiled)) {
+			cout << "ERROR: " << path << " not compiled" << endl;
+			errors++;
+			continue;
+		}
+
+		OperationTable * table = OperationTable::load(compiled);
+
+		cout << path << ": " << table->size() << " operations compiled into " << compiled << endl;
+
+		if(list) {
+			for(unsigned int j = 0 ; j < table->size() ; j++)
+				cout << "  " << table->getName(j) << endl;
+		}
+
+		table->release();
+	}
+
+	return (errors == 0 ? 0 : -1);
+}
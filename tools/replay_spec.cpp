@@ -0,0 +1,184 @@
+/**
+ ******************************************************************************* 
+ * @file replay_spec.cpp
+ *  @brief Re-issues a recorded access trace against a board or the simulator
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+
+#include "../lib/System.h"
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+using namespace std;
+using namespace caloe;
+
+static void print_help() {
+	cout << endl;
+	cout << "Command: replay_spec.run <options>" << endl << endl;
+	cout << "-t <file>: Trace file (recorded with " << TRACE_ENV << "=<file> or System::startCapture)." << endl;
+	cout << "-i <ip>: Send every access to this network address (default: the recorded endpoints)." << endl;
+	cout << "-p <port>: Port of -i (default 60368)." << endl;
+	cout << "-M: Use the in-process memory simulator (no network)." << endl;
+	cout << "-s: Keep the original timing between accesses (default: maximum speed)." << endl;
+	cout << "-c: Compare read values with the recorded ones." << endl;
+	cout << "-h: Show this help." << endl << endl;
+}
+
+int main(int argc, char ** argv)
+{
+	char * path = NULL;
+	string ip;
+	unsigned int port = 60368;
+	bool memory = false;
+	bool original = false;
+	bool compare = false;
+	int opt;
+
+	while((opt = getopt(argc, argv, "t:i:p:Msch")) != -1) {
+		switch(opt) {
+			case 't': path = optarg;
+			break;
+			case 'i': ip = optarg;
+			break;
+			case 'p': port = strtoul(optarg, NULL, 0);
+			break;
+			case 'M': memory = true;
+			break;
+			case 's': original = true;
+			break;
+			case 'c': compare = true;
+			break;
+			default:
+				print_help();
+				return (opt == 'h' ? 0 : -1);
+		}
+	}
+
+	if(path == NULL) {
+		print_help();
+		return -1;
+	}
+
+	trace_caloe trace;
+
+	if(load_trace_caloe(&trace,path) != ALL_OK) {
+		cout << "ERROR: Could not load " << path << endl;
+		return -1;
+	}
+
+	sim_map_caloe map;
+	transport_caloe transport;
+
+	if(memory) {
+		default_sim_map_caloe(&map);
+		init_memory_transport_caloe(&transport,&map);
+		set_transport_caloe(&transport);
+	}
+
+	// One network connection per recorded endpoint (index 0 is also used for unknown endpoints)
+	int nendpoints = (trace.nendpoints > 0 ? trace.nendpoints : 1);
+	vector<network_connection> ncs(nendpoints);
+
+	for(int i = 0 ; i < nendpoints ; i++) {
+		// Recorded keys carry their port (<tcp|udp>/<ip>/<port>)
+		if(!ip.empty() || trace.nendpoints == 0)
+			build_network_con_full_caloe((ip.empty() ? "udp/127.0.0.1" : ip.c_str()),port,&ncs[i]);
+		else
+			build_network_con_caloe(trace.endpoints[i],&ncs[i]);
+	}
+
+	long long start = now_us_caloe();
+	long long busy = 0;
+	long long recorded = 0;
+	int errors = 0;
+	int mismatches = 0;
+
+	for(int i = 0 ; i < trace.nentries ; i++) {
+		trace_entry_caloe * entry = &trace.entries[i];
+		access_caloe access;
+		long long t0;
+		int rcode;
+
+		// Wait for the recorded start of the access
+		if(original) {
+			long long gap = start + entry->start - now_us_caloe();
+
+			if(gap > 0)
+				usleep(gap);
+		}
+
+		memset(&access,0,sizeof(access_caloe));
+		access.address = entry->address;
+		access.value = entry->value;
+		access.mask = entry->mask;
+		access.mask_oper = (mask_oper_caloe) entry->mask_oper;
+		access.is_config = entry->is_config;
+		access.mode = (access_type_caloe) entry->mode;
+		access.align = (align_access_caloe) entry->align;
+		access.networkc = ncs[(entry->endpoint >= 0 && entry->endpoint < nendpoints ? entry->endpoint : 0)];
+
+		t0 = now_us_caloe();
+		rcode = execute_caloe(&access);
+		busy += now_us_caloe() - t0;
+		recorded += entry->end - entry->start;
+
+		if(rcode != ALL_OK)
+			errors++;
+		else if(compare && entry->rcode == ALL_OK && (access.mode == READ || access.mode == READ_WRITE) && access.value != entry->value)
+			mismatches++;
+	}
+
+	long long elapsed = now_us_caloe() - start;
+	long long span = (trace.nentries > 0 ? trace.entries[trace.nentries-1].end : 0);
+
+	cout << "Replayed " << trace.nentries << " accesses in " << elapsed/1000.0 << " ms";
+	cout << " (recorded " << span/1000.0 << " ms, " << (elapsed > 0 ? trace.nentries*1000000.0/elapsed : 0) << " accesses/s)" << endl;
+	cout << "Mean access time: " << (trace.nentries > 0 ? (double) busy/trace.nentries : 0) << " us";
+	cout << " (recorded " << (trace.nentries > 0 ? (double) recorded/trace.nentries : 0) << " us)" << endl;
+	cout << "Errors: " << errors;
+
+	if(compare)
+		cout << ", read mismatches: " << mismatches;
+
+	cout << endl;
+
+	for(int i = 0 ; i < nendpoints ; i++)
+		free_network_con_caloe(&ncs[i]);
+
+	free_trace_caloe(&trace);
+
+	System sys;
+	sys.shutdown();
+
+	if(memory) {
+		set_transport_caloe(NULL);
+		free_sim_map_caloe(&map);
+	}
+
+	return (errors == 0 && mismatches == 0 ? 0 : -1);
+}
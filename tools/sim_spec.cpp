@@ -0,0 +1,124 @@
+/**
+ ******************************************************************************* 
+ * @file sim_spec.cpp
+ *  @brief Local SPEC simulator (Etherbone/SDB responder with DIO and VUART register blocks)
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "../lib/sim_internals.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+
+using namespace std;
+
+static sim_server_caloe server;
+
+static void stop_handler(int sig) {
+	(void) sig;
+
+	stop_sim_server_caloe(&server);
+}
+
+static void print_help() {
+	cout << endl;
+	cout << "Command: sim_spec.run <options>" << endl << endl;
+	cout << "-u: Use UDP packets (default)." << endl;
+	cout << "-t: Use TCP packets." << endl;
+	cout << "-p <port>: Listening port (default 60368, 0: any free port)." << endl;
+	cout << "-l <us>: Latency added before each reply." << endl;
+	cout << "-d <percent>: Percentage of requests dropped." << endl;
+	cout << "-s <seed>: Seed of the packet loss generator." << endl;
+	cout << "-D <name>:<base>:<size>: Add a device (hex base and size). DIO and VUART are always present." << endl;
+	cout << "-h: Show this help." << endl << endl;
+}
+
+int main(int argc, char ** argv)
+{
+	sim_map_caloe map;
+	int tcp = 0;
+	unsigned int port = SIM_DEFAULT_PORT;
+	long latency = 0;
+	int loss = 0;
+	unsigned int seed = 1;
+	int opt;
+
+	default_sim_map_caloe(&map);
+
+	while((opt = getopt(argc, argv, "utp:l:d:s:D:h")) != -1) {
+		switch(opt) {
+			case 'u': tcp = 0;
+			break;
+			case 't': tcp = 1;
+			break;
+			case 'p': port = strtoul(optarg, NULL, 0);
+			break;
+			case 'l': latency = strtol(optarg, NULL, 0);
+			break;
+			case 'd': loss = atoi(optarg);
+			break;
+			case 's': seed = strtoul(optarg, NULL, 0);
+			break;
+			case 'D': {
+				char name[20];
+				unsigned long base, size;
+
+				if(sscanf(optarg, "%19[^:]:%lx:%lx", name, &base, &size) != 3 || add_sim_device_caloe(&map, name, 0xce42, 0x100 + map.ndevices, base, size) != ALL_OK) {
+					cout << "ERROR: Invalid device " << optarg << endl;
+					return -1;
+				}
+			}
+			break;
+			default:
+				print_help();
+				return (opt == 'h' ? 0 : -1);
+		}
+	}
+
+	if(open_sim_server_caloe(&server, &map, tcp, port) != ALL_OK)
+		return -1;
+
+	server.latency = latency;
+	server.loss = loss;
+	server.seed = seed;
+
+	signal(SIGINT, stop_handler);
+	signal(SIGTERM, stop_handler);
+
+	cout << "Simulator listening on " << (tcp ? "tcp" : "udp") << "/127.0.0.1/" << server.port << endl;
+
+	for(int i = 0 ; i < map.ndevices ; i++)
+		cout << "  " << map.devices[i].name << " at 0x" << hex << map.devices[i].base << " (0x" << map.devices[i].size << " bytes)" << dec << endl;
+
+	run_sim_server_caloe(&server);
+
+	cout << endl << "Packets answered: " << server.served << ", dropped: " << server.dropped << endl;
+
+	close_sim_server_caloe(&server);
+	free_sim_map_caloe(&map);
+
+	return 0;
+}
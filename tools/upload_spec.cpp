@@ -0,0 +1,172 @@
+/**
+ ******************************************************************************* 
+ * @file upload_spec.cpp
+ *  @brief Uploads a file (firmware image, lookup table) into the memory of a SPEC board
+ *
+ *  Copyright (C) 2013
+ *
+ *  @author Miguel Jimenez Lopez <klyone@ugr.es>
+ *
+ *  @bug ---
+ *
+ *******************************************************************************
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 3 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************
+ */
+
+#include "../lib/System.h"
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+
+using namespace std;
+using namespace caloe;
+
+/// Words sent in each block write (the file is streamed in chunks of this size)
+#define UPLOAD_CHUNK 65536
+
+static void print_help() {
+	cout << endl;
+	cout << "Command: upload_spec.run <options>" << endl << endl;
+	cout << "-i <ip>: Board network address (e.g. udp/192.168.1.10)." << endl;
+	cout << "-p <port>: Board port (default 60368)." << endl;
+	cout << "-a <address>: First address (hex)." << endl;
+	cout << "-f <file>: File to upload." << endl;
+	cout << "-w <bytes>: Word width (1, 2, 4 or 8, default 4)." << endl;
+	cout << "-L: File words are little endian (default big endian, as LM32 images)." << endl;
+	cout << "-v: Read back and verify the uploaded data." << endl;
+	cout << "-h: Show this help." << endl << endl;
+}
+
+int main(int argc, char ** argv)
+{
+	string ip;
+	unsigned int port = 60368;
+	eb_address_t address = 0;
+	char * path = NULL;
+	unsigned int width = 4;
+	bool little = false;
+	bool verify = false;
+	int opt;
+
+	while((opt = getopt(argc, argv, "i:p:a:f:w:Lvh")) != -1) {
+		switch(opt) {
+			case 'i': ip = optarg;
+			break;
+			case 'p': port = strtoul(optarg, NULL, 0);
+			break;
+			case 'a': address = strtoull(optarg, NULL, 16);
+			break;
+			case 'f': path = optarg;
+			break;
+			case 'w': width = strtoul(optarg, NULL, 0);
+			break;
+			case 'L': little = true;
+			break;
+			case 'v': verify = true;
+			break;
+			default:
+				print_help();
+				return (opt == 'h' ? 0 : -1);
+		}
+	}
+
+	align_access_caloe align;
+
+	switch(width) {
+		case 1: align = SIZE_1B;
+		break;
+		case 2: align = SIZE_2B;
+		break;
+		case 4: align = SIZE_4B;
+		break;
+		case 8: align = SIZE_8B;
+		break;
+		default:
+			print_help();
+			return -1;
+	}
+
+	if(ip.empty() || path == NULL) {
+		print_help();
+		return -1;
+	}
+
+	FILE * file = fopen(path,"rb");
+
+	if(file == NULL) {
+		cout << "ERROR: Could not open " << path << endl;
+		return -1;
+	}
+
+	System sys;
+	Netcon endpoint(ip,port);
+	vector<unsigned char> bytes(UPLOAD_CHUNK*width);
+	vector<eb_data_t> words(UPLOAD_CHUNK);
+	long long total_bytes = 0;
+	long long total_time = 0;
+	long long rtt = -1;
+	int window = 0;
+	int rcode = ALL_OK;
+	size_t nbytes;
+
+	while(rcode == ALL_OK && (nbytes = fread(&bytes[0],1,bytes.size(),file)) > 0) {
+		int count = (nbytes + width - 1)/width;
+		block_stats_caloe stats;
+
+		// The last word is padded with zeros
+		for(size_t i = nbytes ; i < count*width ; i++)
+			bytes[i] = 0;
+
+		for(int i = 0 ; i < count ; i++) {
+			words[i] = 0;
+
+			for(unsigned int b = 0 ; b < width ; b++) {
+				unsigned int shift = (little ? b : width-1-b)*8;
+				words[i] |= ((eb_data_t) bytes[i*width+b]) << shift;
+			}
+		}
+
+		rcode = sys.writeBlock(endpoint,address,count,align,&words[0],verify,&stats);
+
+		if(rcode == ALL_OK || rcode == ERROR_VERIFY) {
+			total_bytes += stats.bytes;
+			total_time += stats.elapsed;
+
+			if(rtt < 0 || stats.rtt < rtt)
+				rtt = stats.rtt;
+
+			if(stats.window > window)
+				window = stats.window;
+		}
+
+		address += count*width;
+	}
+
+	fclose(file);
+	sys.shutdown();
+
+	if(rcode != ALL_OK) {
+		cout << "ERROR " << rcode << ": Upload failed" << (rcode == ERROR_VERIFY ? " (verify)" : "") << endl;
+		return -1;
+	}
+
+	cout << "Uploaded " << total_bytes << " bytes in " << total_time/1000.0 << " ms";
+	cout << " (" << (total_time > 0 ? (double) total_bytes/total_time : 0) << " MB/s, RTT " << rtt << " us, window " << window << ")";
+	cout << (verify ? ", verified" : "") << endl;
+
+	return 0;
+}